@@ -17,6 +17,7 @@ from flask_cors import CORS
 import threading
 import datetime
 import re
+import cv2
 
 # Setup logging
 logging.basicConfig(level=logging.INFO, 
@@ -27,6 +28,10 @@ logger = logging.getLogger(__name__)
 # We'll assume these are in the right import path
 from nano_inference_server.storage.result_storage import ResultStorage
 from nano_inference_server.inference.model import ModelHandler
+from nano_inference_server.inference.executor import InferenceExecutor
+from nano_inference_server.storage.thumbnail_cache import ThumbnailCache
+from nano_inference_server.inference.annotation import AnnotationRenderer
+from nano_inference_server.monitoring import metrics as server_metrics
 
 
 class APIServer:
@@ -35,18 +40,29 @@ class APIServer:
     def __init__(self, 
                  storage: ResultStorage,
                  model: Optional[ModelHandler] = None,
-                 config: Dict = None):
+                 config: Dict = None,
+                 thumbnails: Optional[ThumbnailCache] = None,
+                 metrics: Optional[server_metrics.MetricsRegistry] = None):
         """
         Initialize the API server.
         
         Args:
             storage: ResultStorage instance
-            model: Optional ModelHandler instance for on-demand inference
+            model: Optional ModelHandler (or InferenceExecutor) for on-demand inference;
+                   a bare model is wrapped in an InferenceExecutor so concurrent
+                   requests never call it from several threads
             config: Server configuration dictionary
+            thumbnails: Optional shared ThumbnailCache (one is created if not given)
+            metrics: Registry served on /metrics; pass the one the rest of the
+                     process records into (defaults to this module's REGISTRY)
         """
         self.storage = storage
-        self.model = model
         self.config = config or {}
+        self.metrics = metrics or server_metrics.REGISTRY
+        self._stage_seconds = self.metrics.histogram(
+            server_metrics.STAGE_SECONDS.name, server_metrics.STAGE_SECONDS.documentation, ("stage",))
+        self._events = self.metrics.counter(
+            server_metrics.EVENTS.name, server_metrics.EVENTS.documentation, ("event",))
         
         # Default configuration
         self.default_config = {
@@ -60,7 +76,15 @@ class APIServer:
             "max_content_length": 16 * 1024 * 1024,  # 16 MB
             "templates_folder": os.path.join(os.path.dirname(__file__), "templates"),
             "use_v0_ui": True,  # Enable the V0.dev UI
-            "v0_ui_primary": False  # Use V0.dev UI as the primary interface
+            "v0_ui_primary": False,  # Use V0.dev UI as the primary interface
+            "thumbnail_sizes": [320, 960],  # Widths served for /images/...?w=
+            "thumbnail_format": "jpg",  # "jpg" or "webp"
+            "thumbnail_cache_mb": 512,  # Disk used by cached thumbnails (None for no cap)
+            "image_cache_max_age": 86400,  # Cache-Control max-age for images (seconds)
+            "annotation_cache_mb": 32,  # Memory for rendered annotated images
+            "request_timeout_ms": 10000,  # Inference deadline for /api/upload
+            "inference_queue_size": 32,  # Queued images before uploads get 429
+            "inference_batch_wait_ms": 10  # Wait to merge concurrent uploads into one batch
         }
         
         # Merge provided config with defaults
@@ -68,10 +92,34 @@ class APIServer:
             if key not in self.config:
                 self.config[key] = value
         
+        # Model lifecycle reported by /health: starting, ready or failed
+        self.started_at = time.time()
+        self.model = None
+        self.model_status = "starting"
+        self.model_error = None
+        if model is not None:
+            self.set_model(model, status="ready" if getattr(model, "ready", True) else "starting")
+        
         # Create upload folder if it doesn't exist
         if not os.path.exists(self.config["upload_folder"]):
             os.makedirs(self.config["upload_folder"], exist_ok=True)
         
+        # Resized images for the gallery and details pages
+        self.thumbnails = thumbnails or ThumbnailCache(
+            cache_dir=os.path.join(storage.base_dir, "thumbnails"),
+            sizes=self.config["thumbnail_sizes"],
+            image_format=self.config["thumbnail_format"],
+            max_size_mb=self.config["thumbnail_cache_mb"]
+        )
+        # Retention deletes a result's thumbnails along with it
+        if storage.thumbnails is None:
+            storage.thumbnails = self.thumbnails
+        
+        # Annotated images are rendered from the stored boxes when viewed
+        self.annotations = AnnotationRenderer(
+            max_bytes=int(self.config["annotation_cache_mb"] * 1024 * 1024)
+        )
+        
         # Initialize Flask app
         self.app = Flask("bird_detection_api", 
                          template_folder=self.config["templates_folder"])
@@ -85,16 +133,25 @@ class APIServer:
         
         # Rate limiting data
         self.request_counts = {}
+        self.request_counts_lock = threading.Lock()
         
         # Setup routes
         self._setup_routes()
     
     def _setup_routes(self):
         """Setup Flask routes"""
+        # Readiness probe (no authentication, polled by the Pi and systemd)
+        self.app.add_url_rule("/health", "health", self._handle_health, methods=["GET"])
+        
+        # Prometheus scrape endpoint (pass ?api_key= when an access key is set)
+        self.app.add_url_rule("/metrics", "metrics", self._handle_metrics, methods=["GET"])
+        
         # API routes
         self.app.add_url_rule("/api/results", "results", self._handle_results, methods=["GET"])
         self.app.add_url_rule("/api/results/<int:result_id>", "result", self._handle_result, methods=["GET"])
+        self.app.add_url_rule("/api/results/<int:result_id>/annotated", "annotated", self._serve_annotated, methods=["GET"])
         self.app.add_url_rule("/api/search", "search", self._handle_search, methods=["GET"])
+        self.app.add_url_rule("/api/visits", "visits", self._handle_visits, methods=["GET"])
         self.app.add_url_rule("/api/stats", "stats", self._handle_stats, methods=["GET"])
         self.app.add_url_rule("/api/upload", "upload", self._handle_upload, methods=["POST"])
         
@@ -134,39 +191,39 @@ class APIServer:
         current_time = time.time()
         time_window = current_time - 60  # 1 minute window
         
-        # Initialize or clean up old requests
-        if client_ip not in self.request_counts:
-            self.request_counts[client_ip] = []
-        
-        # Remove old requests
-        self.request_counts[client_ip] = [t for t in self.request_counts[client_ip] if t > time_window]
-        
-        # Check rate limit
-        if len(self.request_counts[client_ip]) >= self.config["rate_limit"]:
-            return False
-        
-        # Add current request
-        self.request_counts[client_ip].append(current_time)
-        return True
+        # Requests are handled on several threads
+        with self.request_counts_lock:
+            # Remove old requests
+            recent = [t for t in self.request_counts.get(client_ip, []) if t > time_window]
+            
+            # Check rate limit
+            if len(recent) >= self.config["rate_limit"]:
+                self.request_counts[client_ip] = recent
+                return False
+            
+            # Add current request
+            recent.append(current_time)
+            self.request_counts[client_ip] = recent
+            return True
     
-    def _auth_required(self, f):
-        """Decorator for routes that require authentication"""
+    def _auth_required(f):
+        """Decorator for routes that require authentication (applied in the class body)"""
         @wraps(f)
-        def decorated(*args, **kwargs):
+        def decorated(self, *args, **kwargs):
             # Check rate limit first
             if not self._rate_limit_check(request):
                 return jsonify({"error": "Rate limit exceeded"}), 429
             
             # Check if authentication is required
             if not self.config.get("access_key"):
-                return f(*args, **kwargs)
+                return f(self, *args, **kwargs)
             
             # Check API key
             api_key = request.headers.get("X-API-Key") or request.args.get("api_key")
             if not api_key or api_key != self.config["access_key"]:
                 return jsonify({"error": "Unauthorized"}), 401
             
-            return f(*args, **kwargs)
+            return f(self, *args, **kwargs)
         return decorated
     
     def _sanitize_path(self, filename):
@@ -206,16 +263,24 @@ class APIServer:
             bird_only = request.args.get("bird_only", "").lower() == "true"
             with_species = request.args.get("with_species", "").lower() == "true"
             
+            # Keyset cursor "<timestamp>,<id>" from a previous page's next_cursor
+            before = None
+            if request.args.get("before"):
+                try:
+                    before_timestamp, before_id = request.args["before"].rsplit(",", 1)
+                    before = (before_timestamp, int(before_id))
+                except ValueError:
+                    return jsonify({"error": "Invalid cursor, expected before=<timestamp>,<id>"}), 400
+            
             # Get results
             results = self.storage.get_recent_results(
-                limit=limit + offset,
+                limit=limit,
                 bird_only=bird_only,
-                with_species=with_species
+                with_species=with_species,
+                before=before,
+                offset=offset
             )
             
-            # Apply offset
-            results = results[offset:offset + limit]
-            
             # Only return essential fields for list view
             simplified = []
             for result in results:
@@ -227,14 +292,20 @@ class APIServer:
                     "species": result["species"],
                     "confidence": result["confidence"],
                     "image_path": f"/images/{os.path.basename(result['image_path'])}",
-                    "annotated_path": f"/images/{os.path.basename(result['annotated_path'])}" if result["annotated_path"] else None
+                    "annotated_path": self._annotated_url(result)
                 })
             
+            # Cursor for the next page; None on the last page
+            next_cursor = None
+            if len(results) == limit:
+                next_cursor = f"{results[-1]['timestamp']},{results[-1]['id']}"
+            
             return jsonify({
                 "success": True,
                 "results": simplified,
                 "count": len(simplified),
-                "total_count": self.storage.get_stats().get("total_detections", 0)
+                "total_count": self.storage.count_results(bird_only=bird_only, with_species=with_species),
+                "next_cursor": next_cursor
             })
             
         except Exception as e:
@@ -251,11 +322,7 @@ class APIServer:
                 return jsonify({"error": "Result not found"}), 404
             
             # Update image paths for API
-            if result.get("image_path"):
-                result["image_url"] = f"/images/{os.path.basename(result['image_path'])}"
-            
-            if result.get("annotated_path"):
-                result["annotated_url"] = f"/images/{os.path.basename(result['annotated_path'])}"
+            self._add_image_urls(result)
             
             return jsonify({
                 "success": True,
@@ -266,6 +333,33 @@ class APIServer:
             logger.error(f"Error handling result request: {str(e)}")
             return jsonify({"error": str(e)}), 500
     
+    @_auth_required
+    def _handle_visits(self):
+        """Handle GET /api/visits"""
+        try:
+            limit = int(request.args.get("limit", 20))
+            offset = int(request.args.get("offset", 0))
+            if limit <= 0 or limit > 100:
+                limit = 20
+            if offset < 0:
+                offset = 0
+            
+            visits = []
+            for visit in self.storage.get_visits(limit=limit, offset=offset):
+                image_path = visit.pop("image_path")
+                visit["image_path"] = f"/images/{os.path.basename(image_path)}" if image_path else None
+                visits.append(visit)
+            
+            return jsonify({
+                "success": True,
+                "visits": visits,
+                "count": len(visits)
+            })
+            
+        except Exception as e:
+            logger.error(f"Error handling visits request: {str(e)}")
+            return jsonify({"error": str(e)}), 500
+    
     @_auth_required
     def _handle_search(self):
         """Handle GET /api/search"""
@@ -288,8 +382,8 @@ class APIServer:
                 except ValueError:
                     pass
             
-            # Search results
-            results = self.storage.search_results(
+            # Search results, with species x day facet counts for the matches
+            search = self.storage.search_with_facets(
                 query=query,
                 start_date=start_date,
                 end_date=end_date,
@@ -297,6 +391,7 @@ class APIServer:
                 species=species,
                 limit=limit
             )
+            results = search["results"]
             
             # Simplify results for API
             simplified = []
@@ -309,24 +404,78 @@ class APIServer:
                     "species": result["species"],
                     "confidence": result["confidence"],
                     "image_path": f"/images/{os.path.basename(result['image_path'])}",
-                    "annotated_path": f"/images/{os.path.basename(result['annotated_path'])}" if result["annotated_path"] else None
+                    "annotated_path": self._annotated_url(result)
                 })
             
             return jsonify({
                 "success": True,
                 "results": simplified,
-                "count": len(simplified)
+                "count": len(simplified),
+                "total_count": search["total"],
+                "facets": search["facets"]
             })
             
         except Exception as e:
             logger.error(f"Error handling search request: {str(e)}")
             return jsonify({"error": str(e)}), 500
     
+    def set_model(self, model, status: str = "ready", error: Optional[str] = None):
+        """
+        Attach the model once it has been loaded and warmed up
+        
+        Args:
+            model: InferenceExecutor, or a ModelHandler/TwoStageDetector to wrap in
+                   one; None if loading failed
+            status: Status reported by /health (starting, ready or failed)
+            error: Error message reported while the status is failed
+        """
+        # Duck-typed: main.py imports the executor under another module name
+        if model is not None and not hasattr(model, "submit"):
+            model = InferenceExecutor(
+                model,
+                max_batch_size=self.config.get("batch_size", 8),
+                max_batch_wait_ms=self.config["inference_batch_wait_ms"],
+                max_queue_size=self.config["inference_queue_size"]
+            )
+        self.model = model
+        self.model_status = status
+        self.model_error = error
+    
+    def _model_ready(self) -> bool:
+        """Whether the model is loaded and warm"""
+        return self.model is not None and self.model_status == "ready"
+    
+    def _handle_health(self):
+        """Handle GET /health; 200 only once the model is warm, 503 while starting"""
+        ready = self._model_ready()
+        health = {
+            "status": self.model_status if not ready else "ready",
+            "ready": ready,
+            "uptime_s": round(time.time() - self.started_at, 1)
+        }
+        if self.model_error:
+            health["error"] = self.model_error
+        warmup_time = getattr(self.model, "warmup_time", None)
+        if warmup_time is not None:
+            health["warmup_s"] = round(warmup_time, 2)
+        
+        response = jsonify(health)
+        if not ready:
+            response.status_code = 503
+            response.headers["Retry-After"] = "5"
+        return response
+    
     @_auth_required
     def _handle_stats(self):
         """Handle GET /api/stats"""
         try:
             stats = self.storage.get_stats()
+            
+            # Include batch inference statistics when a model is attached
+            if self.model:
+                stats["inference"] = self.model.get_batch_stats()
+            stats["annotation_cache"] = self.annotations.get_stats()
+            
             return jsonify({
                 "success": True,
                 "stats": stats
@@ -336,12 +485,19 @@ class APIServer:
             logger.error(f"Error handling stats request: {str(e)}")
             return jsonify({"error": str(e)}), 500
     
+    @_auth_required
+    def _handle_metrics(self):
+        """Handle GET /metrics in the Prometheus text format"""
+        return Response(self.metrics.render(), content_type=server_metrics.PROMETHEUS_CONTENT_TYPE)
+    
     @_auth_required
     def _handle_upload(self):
         """Handle POST /api/upload for on-demand inference"""
         try:
             # Check if model is available
             if not self.model:
+                if self.model_status == "starting":
+                    return jsonify({"error": "Model is warming up"}), 503, {"Retry-After": "5"}
                 return jsonify({"error": "On-demand inference not available"}), 400
             
             # Check for file
@@ -365,31 +521,38 @@ class APIServer:
             filepath = os.path.join(self.app.config["UPLOAD_FOLDER"], unique_filename)
             file.save(filepath)
             
-            # Run inference
+            # Decode here, in parallel with other requests; the executor only runs the model
+            decode_start = time.time()
+            frame = cv2.imread(filepath)
+            if frame is None:
+                return jsonify({"error": "Could not decode image"}), 400
+            self._observe("upload_decode", time.time() - decode_start)
+            
+            # Run inference through the shared executor, within the request deadline
             start_time = time.time()
-            detections = self.model.detect(filepath)
+            detections = self.model.detect(frame, timeout=self._request_timeout())
             processing_time = time.time() - start_time
             
-            # Annotate image if detections found
-            annotated_path = None
-            if detections:
-                annotated_path = self.model.annotate_image(filepath, detections)
-            
-            # Save result
+            # Save result; clients may pass their own X-Trace-Id to correlate logs
+            trace_id = request.headers.get("X-Trace-Id") or server_metrics.new_trace_id()
             metadata = {
                 "source": "upload",
                 "original_filename": filename,
                 "user_agent": request.user_agent.string,
-                "remote_addr": request.remote_addr
+                "remote_addr": request.remote_addr,
+                "trace": {"id": trace_id, "received": decode_start}
             }
             
+            save_started = time.time()
             result = self.storage.save_result(
                 image_path=filepath,
                 detections=detections,
-                annotated_path=annotated_path,
                 metadata=metadata,
                 processing_time=processing_time
             )
+            self._observe("upload_storage", time.time() - save_started)
+            self._observe("upload_total", time.time() - decode_start)
+            self._count("upload_processed")
             
             # Return result
             return jsonify({
@@ -398,48 +561,157 @@ class APIServer:
                 "detections": detections,
                 "processing_time": processing_time,
                 "image_url": f"/images/{os.path.basename(result['image_path'])}",
-                "annotated_url": f"/images/{os.path.basename(result['annotated_path'])}" if result.get("annotated_path") else None
+                "annotated_url": self._annotated_url(result),
+                "trace_id": trace_id
             })
             
         except Exception as e:
+            # Matched by name: main.py imports the executor under another module name
+            error = type(e).__name__
+            if error == "QueueFullError":
+                # Shed load instead of queueing requests that would miss their deadline
+                self._count("upload_shed")
+                return jsonify({"error": "Inference queue full, retry later"}), 429, {"Retry-After": "1"}
+            if error == "DeadlineExceededError":
+                self._count("upload_expired")
+                return jsonify({"error": "Inference deadline exceeded"}), 504
             logger.error(f"Error handling upload: {str(e)}")
             return jsonify({"error": str(e)}), 500
     
+    def _observe(self, stage: str, seconds: float):
+        """Record a request stage span in the served registry"""
+        self._stage_seconds.labels(stage).observe(max(0.0, seconds))
+    
+    def _count(self, event: str):
+        """Count a request outcome in the served registry"""
+        self._events.labels(event).inc()
+    
+    def _request_timeout(self) -> float:
+        """Inference deadline in seconds; clients may ask for a shorter one with X-Request-Timeout-Ms"""
+        timeout_ms = float(self.config["request_timeout_ms"])
+        requested = request.headers.get("X-Request-Timeout-Ms")
+        if requested:
+            try:
+                timeout_ms = min(timeout_ms, max(1.0, float(requested)))
+            except ValueError:
+                pass
+        return timeout_ms / 1000.0
+    
     def _serve_image(self, filename):
-        """Serve an image file with sanitized path"""
+        """Serve an image file with sanitized path, optionally resized with ?w=<width>"""
         try:
-            # Sanitize the filename
-            safe_filename = self._sanitize_path(filename)
-            
-            # Construct search paths
-            search_paths = [
-                os.path.join(self.storage.images_dir, safe_filename),
-                os.path.join(self.storage.annotated_dir, safe_filename),
-                os.path.join(self.config["upload_folder"], safe_filename)
-            ]
-            
-            # If date-based folders are used, also search in dated folders
-            if self.storage.organize_by_date:
-                for date_dir in os.listdir(self.storage.images_dir):
-                    if os.path.isdir(os.path.join(self.storage.images_dir, date_dir)):
-                        search_paths.append(os.path.join(self.storage.images_dir, date_dir, safe_filename))
-                
-                for date_dir in os.listdir(self.storage.annotated_dir):
-                    if os.path.isdir(os.path.join(self.storage.annotated_dir, date_dir)):
-                        search_paths.append(os.path.join(self.storage.annotated_dir, date_dir, safe_filename))
+            path = self._find_image(filename)
+        except Exception as e:
+            logger.error(f"Error serving image: {str(e)}")
+            abort(500)
+        
+        if path is None:
+            abort(404)
+        
+        try:
+            # Images never change under a name, so the file identity is a strong ETag
+            width = request.args.get("w", type=int)
+            mimetype = None
+            if width:
+                thumbnail_path = self.thumbnails.get(path, width)
+                if thumbnail_path:
+                    path = thumbnail_path
+                    mimetype = self.thumbnails.mimetype
+            
+            etag = self.thumbnails.content_key(path)
+            if etag in request.if_none_match:
+                response = Response(status=304)
+            else:
+                response = send_file(path, mimetype=mimetype, conditional=False)
             
-            # Find the first matching file
-            for path in search_paths:
-                if os.path.isfile(path) and os.access(path, os.R_OK):
-                    return send_file(path)
+            response.set_etag(etag)
+            response.headers["Cache-Control"] = f"public, max-age={self.config['image_cache_max_age']}"
+            return response
             
-            # If no file found, return 404
+        except Exception as e:
+            logger.error(f"Error serving image: {str(e)}")
+            abort(500)
+    
+    def _serve_annotated(self, result_id):
+        """Serve a result's image with its detection boxes drawn, optionally resized with ?w=<width>"""
+        # Not behind the API key, like /images, so <img> tags can load it
+        try:
+            result = self.storage.get_result_by_id(result_id)
+        except Exception as e:
+            logger.error(f"Error serving annotated image: {str(e)}")
+            abort(500)
+        
+        image_path = result.get("image_path") if result else None
+        if not image_path or not os.path.isfile(image_path):
             abort(404)
+        
+        try:
+            # Snap to the thumbnail sizes so the cache holds a bounded set of renderings
+            width = request.args.get("w", type=int)
+            if width:
+                width = self.thumbnails.snap_width(width)
+            detections = result.get("detections") or []
+            
+            etag = self.annotations.key(image_path, detections, width)
+            if etag in request.if_none_match:
+                response = Response(status=304)
+            else:
+                data = self.annotations.render(image_path, detections, width)
+                if data is None:
+                    abort(500)
+                response = Response(data, mimetype="image/jpeg")
+            
+            response.set_etag(etag)
+            response.headers["Cache-Control"] = f"public, max-age={self.config['image_cache_max_age']}"
+            return response
             
         except Exception as e:
-            logger.error(f"Error serving image: {str(e)}")
+            logger.error(f"Error serving annotated image: {str(e)}")
             abort(500)
     
+    def _annotated_url(self, result):
+        """URL of a result's annotated image, or None when nothing was detected"""
+        if result.get("id") is None or not result.get("bird_detected"):
+            return None
+        return f"/api/results/{result['id']}/annotated"
+    
+    def _add_image_urls(self, result):
+        """Add image_url and annotated_url to a result for the API and templates"""
+        if result.get("image_path"):
+            result["image_url"] = f"/images/{os.path.basename(result['image_path'])}"
+        annotated_url = self._annotated_url(result)
+        if annotated_url:
+            result["annotated_url"] = annotated_url
+    
+    def _find_image(self, filename):
+        """Find a stored, annotated or uploaded image by sanitized filename"""
+        # Sanitize the filename
+        safe_filename = self._sanitize_path(filename)
+        
+        # Construct search paths
+        search_paths = [
+            os.path.join(self.storage.images_dir, safe_filename),
+            os.path.join(self.storage.annotated_dir, safe_filename),
+            os.path.join(self.config["upload_folder"], safe_filename)
+        ]
+        
+        # If date-based folders are used, also search in dated folders
+        if self.storage.organize_by_date:
+            for date_dir in os.listdir(self.storage.images_dir):
+                if os.path.isdir(os.path.join(self.storage.images_dir, date_dir)):
+                    search_paths.append(os.path.join(self.storage.images_dir, date_dir, safe_filename))
+            
+            for date_dir in os.listdir(self.storage.annotated_dir):
+                if os.path.isdir(os.path.join(self.storage.annotated_dir, date_dir)):
+                    search_paths.append(os.path.join(self.storage.annotated_dir, date_dir, safe_filename))
+        
+        # Find the first matching file
+        for path in search_paths:
+            if os.path.isfile(path) and os.access(path, os.R_OK):
+                return path
+        
+        return None
+    
     def _allowed_file(self, filename):
         """Check if file extension is allowed"""
         ALLOWED_EXTENSIONS = {'png', 'jpg', 'jpeg', 'gif'}
@@ -456,10 +728,7 @@ class APIServer:
             
             # Format results for template
             for result in recent_results:
-                if result.get("image_path"):
-                    result["image_url"] = f"/images/{os.path.basename(result['image_path'])}"
-                if result.get("annotated_path"):
-                    result["annotated_url"] = f"/images/{os.path.basename(result['annotated_path'])}"
+                self._add_image_urls(result)
             
             return render_template(
                 "index.html", 
@@ -496,19 +765,16 @@ class APIServer:
             results = self.storage.get_recent_results(
                 limit=per_page,
                 bird_only=bird_only,
-                with_species=with_species
+                with_species=with_species,
+                offset=offset
             )
             
-            # Get total count for pagination
-            stats = self.storage.get_stats()
-            total_count = stats.get("total_detections", 0)
+            # Get total count for pagination, under the same filters
+            total_count = self.storage.count_results(bird_only=bird_only, with_species=with_species)
             
             # Format results for template
             for result in results:
-                if result.get("image_path"):
-                    result["image_url"] = f"/images/{os.path.basename(result['image_path'])}"
-                if result.get("annotated_path"):
-                    result["annotated_url"] = f"/images/{os.path.basename(result['annotated_path'])}"
+                self._add_image_urls(result)
             
             # Calculate pagination details
             total_pages = (total_count + per_page - 1) // per_page
@@ -542,10 +808,7 @@ class APIServer:
                 return render_template("error.html", error="Result not found"), 404
             
             # Format paths for template
-            if result.get("image_path"):
-                result["image_url"] = f"/images/{os.path.basename(result['image_path'])}"
-            if result.get("annotated_path"):
-                result["annotated_url"] = f"/images/{os.path.basename(result['annotated_path'])}"
+            self._add_image_urls(result)
             
             return render_template(
                 "details.html", 
@@ -624,7 +887,9 @@ class APIServer:
         run_config = {
             "host": self.config["host"],
             "port": self.config["port"],
-            "debug": self.config["debug"]
+            "debug": self.config["debug"],
+            # One thread per request; inference itself is serialized by the executor
+            "threaded": True
         }
         run_config.update(kwargs)
         
@@ -0,0 +1,152 @@
+"""
+Detection overlay rendering.
+Annotated images are rendered on request from the stored detection boxes and
+memoized in a byte-bounded LRU cache, so frames nobody views are never drawn
+or encoded.
+"""
+import os
+import json
+import hashlib
+import logging
+import threading
+from collections import OrderedDict
+from typing import Dict, List, Optional
+
+import numpy as np
+import cv2
+
+# Set up logging
+logging.basicConfig(level=logging.INFO,
+                    format='%(asctime)s - %(name)s - %(levelname)s - %(message)s')
+logger = logging.getLogger(__name__)
+
+
+def draw_detections(image: np.ndarray, detections: List[Dict], scale: float = 1.0) -> np.ndarray:
+    """
+    Draw detection boxes and labels onto an image in place
+
+    Args:
+        image: BGR image
+        detections: Detection dictionaries with "bbox" as (x, y, w, h) in source pixels
+        scale: Factor mapping source pixel coordinates onto this image
+
+    Returns:
+        The annotated image
+    """
+    for detection in detections:
+        # Get box coordinates
+        x, y, w, h = [int(round(v * scale)) for v in detection["bbox"]]
+        
+        # Draw rectangle
+        cv2.rectangle(image, (x, y), (x + w, y + h), (0, 255, 0), 2)
+        
+        # Create label
+        name = detection.get("class_name", detection.get("class", "bird"))
+        label = f"{name}: {detection.get('confidence', 0.0):.2f}"
+        
+        # Draw label background
+        cv2.rectangle(image, (x, y - 20), (x + len(label) * 8, y), (0, 255, 0), -1)
+        
+        # Draw label text
+        cv2.putText(image, label, (x, y - 5),
+                    cv2.FONT_HERSHEY_SIMPLEX, 0.5, (0, 0, 0), 1)
+    
+    return image
+
+
+class AnnotationRenderer:
+    """Renders detection overlays on demand with an in-memory LRU cache"""
+
+    def __init__(self, max_bytes: int = 32 * 1024 * 1024, quality: int = 85):
+        """
+        Initialize the renderer
+
+        Args:
+            max_bytes: Upper bound on the encoded images kept in memory
+            quality: JPEG quality (0-100)
+        """
+        self.max_bytes = max_bytes
+        self.quality = quality
+        self._cache = OrderedDict()
+        self._cache_bytes = 0
+        self._lock = threading.Lock()
+        self.hits = 0
+        self.misses = 0
+
+    def key(self, image_path: str, detections: List[Dict], width: Optional[int] = None) -> str:
+        """
+        Get the cache key (and ETag) of a rendering
+
+        Args:
+            image_path: Path to the source image
+            detections: Detection dictionaries drawn onto it
+            width: Output width, or None for the source size
+
+        Returns:
+            Hex digest identifying the source file, boxes and size
+        """
+        stat = os.stat(image_path)
+        boxes = json.dumps([[d.get("bbox"), d.get("class_name", d.get("class")), d.get("confidence")]
+                            for d in detections], sort_keys=True, default=str)
+        identity = f"{os.path.realpath(image_path)}:{stat.st_size}:{stat.st_mtime_ns}:{width}:{boxes}"
+        return hashlib.sha1(identity.encode("utf-8")).hexdigest()
+
+    def render(self, image_path: str, detections: List[Dict], width: Optional[int] = None) -> Optional[bytes]:
+        """
+        Get the annotated JPEG for an image, rendering it on a cache miss
+
+        Args:
+            image_path: Path to the source image
+            detections: Detection dictionaries to draw
+            width: Output width (downscale only), or None for the source size
+
+        Returns:
+            Encoded JPEG bytes, or None if the image could not be read
+        """
+        key = self.key(image_path, detections, width)
+        with self._lock:
+            data = self._cache.get(key)
+            if data is not None:
+                self._cache.move_to_end(key)
+                self.hits += 1
+                return data
+            self.misses += 1
+
+        image = cv2.imread(image_path)
+        if image is None:
+            logger.warning(f"Could not read image for annotation: {image_path}")
+            return None
+
+        # Downscale before drawing so the boxes stay crisp and the draw is cheap
+        scale = 1.0
+        if width and width < image.shape[1]:
+            scale = width / image.shape[1]
+            image = cv2.resize(image, (width, max(1, round(image.shape[0] * scale))),
+                               interpolation=cv2.INTER_AREA)
+
+        draw_detections(image, detections, scale)
+        ok, buffer = cv2.imencode(".jpg", image, [cv2.IMWRITE_JPEG_QUALITY, self.quality])
+        if not ok:
+            logger.warning(f"Could not encode annotated image for {image_path}")
+            return None
+        data = buffer.tobytes()
+
+        with self._lock:
+            if key not in self._cache and len(data) <= self.max_bytes:
+                self._cache[key] = data
+                self._cache_bytes += len(data)
+                while self._cache_bytes > self.max_bytes:
+                    _, evicted = self._cache.popitem(last=False)
+                    self._cache_bytes -= len(evicted)
+
+        return data
+
+    def get_stats(self) -> Dict:
+        """Cache occupancy and hit counts"""
+        with self._lock:
+            return {
+                "entries": len(self._cache),
+                "bytes": self._cache_bytes,
+                "hits": self.hits,
+                "misses": self.misses
+            }
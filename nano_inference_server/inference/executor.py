@@ -0,0 +1,292 @@
+"""
+Single-owner inference executor.
+HTTP handlers and the directory monitor submit images to one bounded request
+queue; one worker thread owns the model (and its GPU context), merges queued
+requests into dynamic batches, skips requests whose deadline has passed and
+sheds load with QueueFullError when the queue is full.
+"""
+import time
+import logging
+import threading
+import collections
+from typing import Callable, Dict, List, Optional
+
+# Set up logging
+logging.basicConfig(level=logging.INFO,
+                    format='%(asctime)s - %(name)s - %(levelname)s - %(message)s')
+logger = logging.getLogger(__name__)
+
+
+class QueueFullError(Exception):
+    """The request queue is full; the caller should retry later (HTTP 429)"""
+
+
+class DeadlineExceededError(Exception):
+    """The request's deadline passed before its inference finished (HTTP 504)"""
+
+
+class _Request:
+    """Images submitted together, with their deadline and result"""
+    __slots__ = ("images", "deadline", "enqueued_at", "started_at", "event", "result", "error",
+                 "cancelled")
+
+    def __init__(self, images: List, deadline: Optional[float]):
+        self.images = images
+        self.deadline = deadline
+        self.enqueued_at = time.monotonic()
+        self.started_at = None
+        self.event = threading.Event()
+        self.result = None
+        self.error = None
+        self.cancelled = False
+
+
+class InferenceExecutor:
+    """Serializes inference on one model with dynamic batching"""
+
+    def __init__(self, model, max_batch_size: int = 8, max_batch_wait_ms: float = 10.0,
+                 max_queue_size: int = 32,
+                 span_observer: Optional[Callable[[str, float], None]] = None):
+        """
+        Initialize the executor and start its worker
+
+        Args:
+            model: ModelHandler or TwoStageDetector; only the worker thread calls it
+            max_batch_size: Maximum images per forward pass
+            max_batch_wait_ms: How long the worker waits for more requests to fill a batch
+            max_queue_size: Maximum queued images before new requests are rejected
+            span_observer: Optional callback receiving ("queue_wait", seconds) per request
+        """
+        self.model = model
+        self.max_batch_size = max_batch_size
+        self.max_batch_wait = max_batch_wait_ms / 1000.0
+        self.max_queue_size = max_queue_size
+        self.span_observer = span_observer
+
+        self._queue = collections.deque()
+        self._queued_images = 0
+        self._condition = threading.Condition()
+        self._stopped = False
+
+        # Counters reported by get_batch_stats()
+        self.stats = {
+            "requests": 0,
+            "started": 0,
+            "images": 0,
+            "batches": 0,
+            "shed": 0,
+            "expired": 0,
+            "errors": 0,
+            "total_queue_wait": 0.0,
+            "max_queue_depth": 0
+        }
+
+        self._worker = threading.Thread(target=self._run, name="inference-executor")
+        self._worker.daemon = True
+        self._worker.start()
+
+    @property
+    def ready(self) -> bool:
+        """Whether the model is warm and the executor is accepting requests"""
+        return getattr(self.model, "ready", True) and not self._stopped
+
+    @property
+    def warmup_time(self) -> Optional[float]:
+        """Warm-up time of the wrapped model in seconds"""
+        return getattr(self.model, "warmup_time", None)
+
+    def submit(self, images: List, timeout: Optional[float] = None, block: bool = False) -> _Request:
+        """
+        Queue images for inference
+
+        Args:
+            images: Image paths or decoded BGR frames, detected in one batch
+            timeout: Seconds until the request's deadline (None for no deadline)
+            block: Wait for queue space instead of raising QueueFullError
+
+        Returns:
+            Request handle for wait()
+
+        Raises:
+            QueueFullError: If the queue is full and block is False
+        """
+        deadline = time.monotonic() + timeout if timeout is not None else None
+        request = _Request(list(images), deadline)
+
+        with self._condition:
+            # A request larger than the queue is admitted once the queue is empty
+            while (self._queued_images and
+                   self._queued_images + len(request.images) > self.max_queue_size):
+                if not block:
+                    self.stats["shed"] += 1
+                    raise QueueFullError(f"Inference queue full ({self._queued_images} images)")
+                self._condition.wait()
+            if self._stopped:
+                raise RuntimeError("Inference executor stopped")
+
+            self._queue.append(request)
+            self._queued_images += len(request.images)
+            self.stats["requests"] += 1
+            self.stats["max_queue_depth"] = max(self.stats["max_queue_depth"], self._queued_images)
+            self._condition.notify_all()
+        return request
+
+    def wait(self, request: _Request) -> List[List[Dict]]:
+        """
+        Wait for a submitted request
+
+        Args:
+            request: Handle returned by submit()
+
+        Returns:
+            One list of detection dictionaries per submitted image
+
+        Raises:
+            DeadlineExceededError: If the deadline passes first
+        """
+        timeout = None
+        if request.deadline is not None:
+            timeout = max(0.0, request.deadline - time.monotonic())
+        if not request.event.wait(timeout):
+            # The worker skips it if it has not started yet
+            request.cancelled = True
+            raise DeadlineExceededError("Inference deadline exceeded")
+        if request.error is not None:
+            raise request.error
+        return request.result
+
+    def detect(self, image_path, timeout: Optional[float] = None, block: bool = False) -> List[Dict]:
+        """
+        Detect birds in one image (see ModelHandler.detect)
+
+        Args:
+            image_path: Path to the image file or a decoded BGR frame
+            timeout: Seconds until the deadline (None for no deadline)
+            block: Wait for queue space instead of raising QueueFullError
+
+        Raises:
+            QueueFullError: If the queue is full and block is False
+            DeadlineExceededError: If the deadline passes first
+        """
+        return self.wait(self.submit([image_path], timeout, block=block))[0]
+
+    def detect_batch(self, image_paths: List, timeout: Optional[float] = None) -> List[List[Dict]]:
+        """
+        Detect birds in several images (see ModelHandler.detect_batch)
+
+        Used by the directory monitor, so it waits for queue space instead of
+        shedding load.
+
+        Args:
+            image_paths: Paths to the image files or decoded BGR frames
+            timeout: Seconds until the deadline (None for no deadline)
+        """
+        if not image_paths:
+            return []
+        return self.wait(self.submit(image_paths, timeout, block=True))
+
+    def _next_batch(self) -> Optional[List[_Request]]:
+        """Wait for requests and take up to max_batch_size images; None when stopped"""
+        with self._condition:
+            while not self._queue:
+                if self._stopped:
+                    return None
+                self._condition.wait()
+
+            # Give other clients a moment to fill the batch
+            gather_until = time.monotonic() + self.max_batch_wait
+            while self._queued_images < self.max_batch_size and not self._stopped:
+                remaining = gather_until - time.monotonic()
+                if remaining <= 0:
+                    break
+                self._condition.wait(remaining)
+
+            now = time.monotonic()
+            batch = []
+            batch_images = 0
+            while self._queue and (not batch or
+                                   batch_images + len(self._queue[0].images) <= self.max_batch_size):
+                request = self._queue.popleft()
+                self._queued_images -= len(request.images)
+                if request.cancelled or (request.deadline is not None and request.deadline <= now):
+                    self.stats["expired"] += 1
+                    request.error = DeadlineExceededError("Deadline passed while queued")
+                    request.event.set()
+                    continue
+                request.started_at = now
+                self.stats["started"] += 1
+                self.stats["total_queue_wait"] += now - request.enqueued_at
+                batch.append(request)
+                batch_images += len(request.images)
+
+            # Wake submitters waiting for queue space
+            self._condition.notify_all()
+            return batch
+
+    def _run(self):
+        """Worker loop: the only thread that runs the model"""
+        while True:
+            batch = self._next_batch()
+            if batch is None:
+                return
+            if not batch:
+                continue
+
+            if self.span_observer is not None:
+                for request in batch:
+                    self.span_observer("queue_wait", request.started_at - request.enqueued_at)
+
+            images = [image for request in batch for image in request.images]
+            try:
+                results = self.model.detect_batch(images)
+            except Exception as e:
+                logger.error(f"Inference batch of {len(images)} images failed: {str(e)}")
+                self.stats["errors"] += 1
+                for request in batch:
+                    request.error = e
+                    request.event.set()
+                continue
+
+            offset = 0
+            for request in batch:
+                request.result = results[offset:offset + len(request.images)]
+                offset += len(request.images)
+                request.event.set()
+
+            self.stats["batches"] += 1
+            self.stats["images"] += len(images)
+            if len(batch) > 1:
+                logger.debug(f"Merged {len(batch)} requests into a batch of {len(images)} images")
+
+    def stop(self, timeout: float = 10.0):
+        """Finish the queued requests and stop the worker"""
+        with self._condition:
+            self._stopped = True
+            self._condition.notify_all()
+        self._worker.join(timeout)
+
+    def get_batch_stats(self) -> Dict:
+        """
+        Get model batch statistics with the executor's queue statistics added
+
+        Returns:
+            ModelHandler.get_batch_stats() output with an "executor" section
+        """
+        stats = self.model.get_batch_stats()
+        with self._condition:
+            counters = dict(self.stats)
+            queue_depth = self._queued_images
+        stats["executor"] = {
+            "queue_depth": queue_depth,
+            "max_queue_depth": counters["max_queue_depth"],
+            "max_queue_size": self.max_queue_size,
+            "requests": counters["requests"],
+            "batches": counters["batches"],
+            "average_batch_size": counters["images"] / counters["batches"] if counters["batches"] else 0.0,
+            "shed": counters["shed"],
+            "expired": counters["expired"],
+            "errors": counters["errors"],
+            "average_queue_wait_ms": (1000.0 * counters["total_queue_wait"] / counters["started"]
+                                      if counters["started"] else 0.0)
+        }
+        return stats
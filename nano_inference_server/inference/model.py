@@ -4,42 +4,99 @@ Supports multiple model types and handles preprocessing/postprocessing.
 """
 import os
 import time
+import hashlib
 import logging
 import numpy as np
-from typing import Dict, List, Tuple, Optional, Union, Any
+from typing import Callable, Dict, List, Tuple, Optional, Union, Any
 import cv2
 import random  # Add import for development mode
 
+from .preprocessing import preprocess_frame
+from .postprocess import decode_yolo
+from .annotation import draw_detections
+
 # Set up logging
 logging.basicConfig(level=logging.INFO, 
                     format='%(asctime)s - %(name)s - %(levelname)s - %(message)s')
 logger = logging.getLogger(__name__)
 
+# File suffixes of the reduced precision ONNX variants
+PRECISION_SUFFIXES = {"fp16": ".fp16.onnx", "int8": ".int8.onnx"}
+
 
 class ModelHandler:
     """Handles loading and running inference for bird detection models"""
     
     def __init__(self, model_path: str, confidence_threshold: float = 0.5, 
                  model_type: str = "mobilenet", device: str = "cuda",
-                 development_mode: bool = False):
+                 nms_threshold: float = 0.45,
+                 precision: str = "fp32",
+                 development_mode: bool = False,
+                 engine_cache_dir: Optional[str] = None,
+                 input_mean: Optional[List[float]] = None,
+                 input_std: Optional[List[float]] = None):
         """
         Initialize the model handler.
         
         Args:
             model_path: Path to the model file
             confidence_threshold: Threshold for detection confidence
-            model_type: Type of model (mobilenet, yolo, or keras)
+            model_type: Type of model (mobilenet, yolo, keras, onnx or tensorrt)
             device: Device to run inference on (cuda or cpu)
+            nms_threshold: IoU above which overlapping detector boxes of one class are merged
+            precision: Inference precision for onnx/tensorrt models (fp32, fp16 or int8).
+                       Loads <model>.fp16.onnx / <model>.int8.onnx when present
+                       (see scripts/build_quantized_models.py) and enables the
+                       matching TensorRT precision
             development_mode: If True, use mock detections for development without hardware
+            engine_cache_dir: Directory for cached TensorRT engines (onnx/tensorrt only,
+                              defaults to a trt_cache directory next to the model)
+            input_mean: Optional per-channel RGB mean subtracted after scaling to [0, 1]
+            input_std: Optional per-channel RGB std divided out after mean subtraction
         """
         self.model_path = model_path
         self.confidence_threshold = confidence_threshold
+        self.nms_threshold = nms_threshold
+        self.precision = precision.lower()
         self.model_type = model_type.lower()
         self.device = device
         self.model = None
         self.input_shape = (224, 224)  # Default input shape
         self.class_names = []
         self.development_mode = development_mode
+        self.engine_cache_dir = engine_cache_dir
+        
+        # Set by warmup() once the first (slow) inference has run
+        self.ready = False
+        self.warmup_time = None
+        
+        # Input tensor format produced by preprocess_image
+        self.input_layout = "nhwc"
+        self.input_dtype = np.float32
+        self.input_mean = input_mean
+        self.input_std = input_std
+        
+        # ONNX Runtime session state (onnx/tensorrt model types)
+        self.onnx_input_name = None
+        self.onnx_output_names = []
+        self.io_binding = None
+        
+        # Largest batch the loaded graph accepts (None = dynamic batch dimension)
+        self.max_batch_size = None
+        
+        # Batch statistics reported by get_batch_stats()
+        self.batch_stats = {
+            "batches": 0,
+            "images": 0,
+            "total_latency": 0.0,
+            "max_latency": 0.0,
+            "last_batch_size": 0,
+            "max_batch_size": 0
+        }
+        
+        # Optional callback receiving (stage, seconds) for "preprocess" and
+        # "inference" spans, e.g. monitoring.metrics.observe_stage
+        self.span_observer: Optional[Callable[[str, float], None]] = None
         
         # Bird species for classification and development mode
         self.bird_species = [
@@ -58,8 +115,26 @@ class ModelHandler:
         self._load_model()
         logger.info(f"Model loaded successfully from {model_path}")
         
+    def _resolve_precision_path(self):
+        """Switch model_path to the reduced precision variant of an ONNX model if it exists"""
+        if self.precision not in PRECISION_SUFFIXES:
+            if self.precision != "fp32":
+                raise ValueError(f"Unsupported precision: {self.precision}")
+            return
+        variant_path = os.path.splitext(self.model_path)[0] + PRECISION_SUFFIXES[self.precision]
+        if os.path.exists(variant_path):
+            logger.info(f"Using {self.precision} model variant {variant_path}")
+            self.model_path = variant_path
+        elif self.precision == "int8":
+            # INT8 needs calibrated (QDQ) weights; fp16 only needs the TensorRT flag
+            logger.warning(f"No int8 variant at {variant_path}, falling back to fp16")
+            self.precision = "fp16"
+    
     def _load_model(self):
         """Load the model based on the specified type"""
+        if self.model_type in ("onnx", "tensorrt"):
+            self._resolve_precision_path()
+        
         if not os.path.exists(self.model_path):
             raise FileNotFoundError(f"Model file not found at {self.model_path}")
         
@@ -70,6 +145,8 @@ class ModelHandler:
                 self._load_yolo()
             elif self.model_type == "keras":
                 self._load_keras()
+            elif self.model_type in ("onnx", "tensorrt"):
+                self._load_onnx()
             else:
                 raise ValueError(f"Unsupported model type: {self.model_type}")
         except Exception as e:
@@ -105,6 +182,9 @@ class ModelHandler:
                 os.path.join(os.path.dirname(self.model_path), "yolo.cfg")
             )
             
+            # cv2.dnn takes NCHW blobs
+            self.input_layout = "nchw"
+            
             if self.device == "cuda":
                 self.model.setPreferableBackend(cv2.dnn.DNN_BACKEND_CUDA)
                 self.model.setPreferableTarget(cv2.dnn.DNN_TARGET_CUDA)
@@ -142,15 +222,7 @@ class ModelHandler:
                     self.input_shape = (input_shape[1], input_shape[2])
                     logger.info(f"Using input shape from model: {self.input_shape}")
             
-            # Look for a labels file with the same base name
-            base_path = os.path.splitext(self.model_path)[0]
-            for ext in ['.txt', '.labels', '_labels.txt', '_classes.txt']:
-                labels_path = base_path + ext
-                if os.path.exists(labels_path):
-                    with open(labels_path, 'r') as f:
-                        self.class_names = [line.strip() for line in f.readlines()]
-                    logger.info(f"Loaded {len(self.class_names)} class names from {labels_path}")
-                    break
+            self._load_labels()
             
             # No labels file found, create some defaults if there are none
             if not self.class_names:
@@ -161,46 +233,167 @@ class ModelHandler:
             logger.error("TensorFlow not available. Cannot load Keras model.")
             raise
     
-    def preprocess_image(self, image_path: str) -> np.ndarray:
+    def _load_onnx(self):
+        """Load ONNX model (.onnx file) with ONNX Runtime
+        
+        On CUDA devices the TensorRT execution provider is preferred. TensorRT
+        engines are serialized to the engine cache directory so only the first
+        start pays for the engine build. Model type "tensorrt" requires the
+        TensorRT provider instead of silently falling back to CUDA/CPU.
+        """
+        try:
+            import onnxruntime as ort
+        except ImportError:
+            logger.error("ONNX Runtime not available. Cannot load ONNX model.")
+            raise
+        
+        logger.info(f"Loading {self.precision} ONNX model from {self.model_path}")
+        
+        available_providers = ort.get_available_providers()
+        providers = []
+        
+        if self.device == "cuda":
+            if "TensorrtExecutionProvider" in available_providers:
+                cache_dir = self.engine_cache_dir or os.path.join(
+                    os.path.dirname(os.path.abspath(self.model_path)), "trt_cache")
+                # A serialized engine is only valid for the same model, device,
+                # precision and TensorRT build, so each gets its own directory
+                cache_dir = os.path.join(cache_dir, self._engine_cache_key(ort.__version__))
+                cached = os.path.isdir(cache_dir) and any(
+                    name.endswith(".engine") for name in os.listdir(cache_dir))
+                logger.info(f"TensorRT engine cache {cache_dir} "
+                            f"({'cached engine' if cached else 'building engine, this can take minutes'})")
+                os.makedirs(cache_dir, exist_ok=True)
+                providers.append(("TensorrtExecutionProvider", {
+                    "trt_engine_cache_enable": True,
+                    "trt_engine_cache_path": cache_dir,
+                    "trt_timing_cache_enable": True,
+                    "trt_max_workspace_size": 1 << 28,  # 256 MB, the Nano shares RAM with the GPU
+                    # INT8 graphs keep layers without QDQ nodes in FP16 rather than FP32
+                    "trt_fp16_enable": self.precision in ("fp16", "int8"),
+                    "trt_int8_enable": self.precision == "int8",
+                }))
+            elif self.model_type == "tensorrt":
+                raise RuntimeError("TensorRT execution provider is not available in this "
+                                   f"ONNX Runtime build (available: {available_providers})")
+            
+            if "CUDAExecutionProvider" in available_providers:
+                providers.append("CUDAExecutionProvider")
+        
+        providers.append("CPUExecutionProvider")
+        
+        sess_options = ort.SessionOptions()
+        sess_options.graph_optimization_level = ort.GraphOptimizationLevel.ORT_ENABLE_ALL
+        
+        self.model = ort.InferenceSession(self.model_path, sess_options=sess_options,
+                                          providers=providers)
+        active_providers = self.model.get_providers()
+        logger.info(f"ONNX Runtime providers: {active_providers}")
+        
+        # Input name, layout and spatial size come from the graph
+        model_input = self.model.get_inputs()[0]
+        self.onnx_input_name = model_input.name
+        self.onnx_output_names = [output.name for output in self.model.get_outputs()]
+        
+        if model_input.type == "tensor(float16)":
+            self.input_dtype = np.float16
+        
+        shape = model_input.shape
+        if shape and isinstance(shape[0], int) and shape[0] > 0:
+            self.max_batch_size = shape[0]
+        
+        if len(shape) == 4:
+            if shape[1] == 3:
+                self.input_layout = "nchw"
+                height, width = shape[2], shape[3]
+            else:
+                self.input_layout = "nhwc"
+                height, width = shape[1], shape[2]
+            
+            # Dynamic dimensions are reported as strings, keep the default for those
+            if isinstance(height, int) and isinstance(width, int):
+                self.input_shape = (height, width)
+        logger.info(f"Using input shape from model: {self.input_shape} ({self.input_layout})")
+        
+        # Keep input/output buffers on the GPU between calls when running on CUDA
+        if active_providers[0] != "CPUExecutionProvider":
+            self.io_binding = self.model.io_binding()
+        
+        self._load_labels()
+    
+    def _engine_cache_key(self, runtime_version: str) -> str:
+        """Engine cache directory name: model content hash, device, precision and runtime version"""
+        digest = hashlib.sha256()
+        with open(self.model_path, "rb") as f:
+            for chunk in iter(lambda: f.read(1024 * 1024), b""):
+                digest.update(chunk)
+        return f"{digest.hexdigest()[:16]}-{self.device}-{self.precision}-ort{runtime_version}"
+    
+    def _load_labels(self):
+        """Look for a labels file with the same base name as the model"""
+        base_path = os.path.splitext(self.model_path)[0]
+        for ext in ['.txt', '.labels', '_labels.txt', '_classes.txt']:
+            labels_path = base_path + ext
+            if os.path.exists(labels_path):
+                with open(labels_path, 'r') as f:
+                    self.class_names = [line.strip() for line in f.readlines()]
+                logger.info(f"Loaded {len(self.class_names)} class names from {labels_path}")
+                break
+    
+    def preprocess_image(self, image_path: Union[str, np.ndarray],
+                         out: Optional[np.ndarray] = None) -> np.ndarray:
         """
         Preprocess image for model input
         
+        Resize, BGR to RGB conversion and normalization happen in one pass
+        straight into the model's input dtype and layout.
+        
         Args:
-            image_path: Path to the image file
+            image_path: Path to the image file, or an already decoded BGR image
+            out: Optional preallocated output (e.g. one row of a batch tensor)
             
         Returns:
-            Preprocessed image as numpy array
+            Preprocessed image as numpy array with a batch dimension of 1
         """
         # Read and preprocess the image
         try:
-            img = cv2.imread(image_path)
+            if isinstance(image_path, np.ndarray):
+                img = image_path
+            else:
+                img = cv2.imread(image_path)
             if img is None:
                 raise ValueError(f"Failed to read image at {image_path}")
-                
-            # Resize
-            img = cv2.resize(img, self.input_shape)
-            
-            # Convert to RGB (OpenCV uses BGR)
-            img = cv2.cvtColor(img, cv2.COLOR_BGR2RGB)
-            
-            # Normalize
-            img = img / 255.0
             
-            # Add batch dimension
-            img = np.expand_dims(img, axis=0)
-            
-            return img
+            return preprocess_frame(
+                img,
+                self.input_shape,
+                layout=self.input_layout,
+                mean=self.input_mean,
+                std=self.input_std,
+                dtype=self.input_dtype,
+                out=out
+            )
             
         except Exception as e:
-            logger.error(f"Error preprocessing image {image_path}: {str(e)}")
+            logger.error(f"Error preprocessing image: {str(e)}")
             raise
     
-    def detect(self, image_path: str) -> List[Dict]:
+    def _allocate_batch(self, batch_size: int) -> np.ndarray:
+        """Allocate an input tensor for batch_size images in the model's layout and dtype"""
+        height, width = self.input_shape
+        if self.input_layout == "nchw":
+            shape = (batch_size, 3, height, width)
+        else:
+            shape = (batch_size, height, width, 3)
+        return np.empty(shape, dtype=self.input_dtype)
+    
+    def detect(self, image_path: Union[str, np.ndarray]) -> List[Dict]:
         """
         Run inference on an image and return detections
         
         Args:
-            image_path: Path to the image file
+            image_path: Path to the image file, or an already decoded BGR frame
+                        (skips the file read and JPEG decode entirely)
             
         Returns:
             List of detection dictionaries with keys:
@@ -209,28 +402,42 @@ class ModelHandler:
             - confidence: Detection confidence
             - bbox: Bounding box coordinates [x, y, width, height]
         """
-        # Use mock detections in development mode
-        if self.development_mode:
-            return self._generate_mock_detection(image_path)
-            
         try:
+            # Decode the image once; its size is reused by the detectors
+            if isinstance(image_path, np.ndarray):
+                image = image_path
+            else:
+                image = cv2.imread(image_path)
+            if image is None:
+                raise ValueError(f"Failed to read image at {image_path}")
+            height, width = image.shape[:2]
+            
+            # Use mock detections in development mode
+            if self.development_mode:
+                return self._generate_mock_detection(image)
+            
             # Time the inference
             start_time = time.time()
             
             # Preprocess the image
-            processed_img = self.preprocess_image(image_path)
+            processed_img = self.preprocess_image(image)
+            preprocess_time = time.time() - start_time
             
             # Run inference
             if self.model_type == "mobilenet":
                 detections = self._detect_mobilenet(processed_img)
             elif self.model_type == "yolo":
-                detections = self._detect_yolo(processed_img, image_path)
+                detections = self._detect_yolo(processed_img, (width, height))
             elif self.model_type == "keras":
-                detections = self._detect_keras(processed_img, image_path)
+                detections = self._detect_keras(processed_img, (width, height))
+            elif self.model_type in ("onnx", "tensorrt"):
+                detections = self._detect_onnx(processed_img, (width, height))
             else:
                 raise ValueError(f"Unsupported model type: {self.model_type}")
             
             inference_time = time.time() - start_time
+            self._observe("preprocess", preprocess_time)
+            self._observe("inference", inference_time - preprocess_time)
             logger.info(f"Inference completed in {inference_time:.2f} seconds")
             
             return detections
@@ -239,6 +446,209 @@ class ModelHandler:
             logger.error(f"Error during detection: {str(e)}")
             return []
     
+    def detect_batch(self, image_paths: List[Union[str, np.ndarray]]) -> List[List[Dict]]:
+        """
+        Run inference on several images in a single forward pass
+        
+        Args:
+            image_paths: Paths to the image files, or already decoded BGR frames
+            
+        Returns:
+            One list of detection dictionaries per input image (same order as
+            image_paths, see detect() for the dictionary keys). Images that fail
+            to decode get an empty list.
+        """
+        if not image_paths:
+            return []
+        
+        # Mock detections and YOLO (Darknet via cv2.dnn) are handled per image
+        if self.development_mode or self.model_type == "yolo" or \
+                self.model in ("placeholder_model", "placeholder_yolo_model"):
+            return [self.detect(image_path) for image_path in image_paths]
+        
+        results = [[] for _ in image_paths]
+        
+        try:
+            start_time = time.time()
+            
+            # Decode every image once, remembering its original size
+            images = []
+            sizes = []
+            indices = []
+            for i, image_path in enumerate(image_paths):
+                if isinstance(image_path, np.ndarray):
+                    img = image_path
+                else:
+                    img = cv2.imread(image_path)
+                if img is None:
+                    logger.warning(f"Failed to read image at {image_path}, skipping")
+                    continue
+                height, width = img.shape[:2]
+                images.append(img)
+                sizes.append((width, height))
+                indices.append(i)
+            
+            if not images:
+                return results
+            
+            # Preprocess straight into the rows of one batch tensor
+            batch = self._allocate_batch(len(images))
+            for row, img in enumerate(images):
+                self.preprocess_image(img, out=batch[row:row + 1])
+            preprocess_time = time.time() - start_time
+            
+            # Respect graphs exported with a fixed batch dimension
+            chunk_size = self.max_batch_size or len(batch)
+            for chunk_start in range(0, len(batch), chunk_size):
+                chunk = batch[chunk_start:chunk_start + chunk_size]
+                predictions = self._forward_batch(chunk)
+                
+                for offset in range(chunk.shape[0]):
+                    width, height = sizes[chunk_start + offset]
+                    if self.model_type == "mobilenet":
+                        detections = self._mobilenet_detections(predictions[offset])
+                    else:
+                        detections = self._parse_predictions(
+                            self._slice_predictions(predictions, offset), width, height)
+                    results[indices[chunk_start + offset]] = detections
+            
+            latency = time.time() - start_time
+            self._record_batch(len(batch), latency)
+            self._observe("preprocess", preprocess_time)
+            self._observe("inference", latency - preprocess_time)
+            logger.info(f"Batch inference on {len(batch)} images completed in {latency:.2f} seconds")
+            
+            return results
+            
+        except Exception as e:
+            logger.error(f"Error during batch detection: {str(e)}")
+            return results
+    
+    def classify_batch(self, images: List[np.ndarray]) -> Optional[np.ndarray]:
+        """
+        Run the model as a classifier on several decoded images in one forward pass
+        
+        Used by the two-stage pipeline to classify every detected bird crop of
+        a frame (or batch of frames) at once.
+        
+        Args:
+            images: Decoded BGR images, e.g. numpy views of regions of a larger frame
+            
+        Returns:
+            Class scores with one row per image, or None if no classifier is loaded
+        """
+        if not images or self.development_mode or self.model_type == "yolo" or \
+                self.model in ("placeholder_model", "placeholder_yolo_model"):
+            return None
+        
+        start_time = time.time()
+        
+        batch = self._allocate_batch(len(images))
+        for row, img in enumerate(images):
+            self.preprocess_image(img, out=batch[row:row + 1])
+        
+        scores = []
+        chunk_size = self.max_batch_size or len(batch)
+        for chunk_start in range(0, len(batch), chunk_size):
+            chunk = batch[chunk_start:chunk_start + chunk_size]
+            predictions = self._forward_batch(chunk)
+            if not hasattr(predictions, "shape"):
+                raise ValueError("Classifier model returned detection outputs")
+            scores.append(np.asarray(predictions, dtype=np.float32).reshape(chunk.shape[0], -1))
+        
+        self._record_batch(len(batch), time.time() - start_time)
+        return np.concatenate(scores)
+    
+    def warmup(self, batch_sizes: Tuple[int, ...] = (1,), runs: int = 2) -> float:
+        """
+        Run inference on blank input so engine builds, CUDA context creation
+        and kernel autotuning happen before the first real image
+        
+        Args:
+            batch_sizes: Batch sizes to run (each shape may compile its own kernels)
+            runs: Forward passes per batch size; later passes are timed in the log
+            
+        Returns:
+            Warm-up time in seconds
+        """
+        start_time = time.time()
+        
+        if not self.development_mode and \
+                self.model not in ("placeholder_model", "placeholder_yolo_model"):
+            for batch_size in sorted(set(batch_sizes)):
+                if self.model_type == "yolo":
+                    batch_size = 1  # Darknet models run one image at a time
+                elif self.max_batch_size:
+                    batch_size = min(batch_size, self.max_batch_size)
+                batch = self._allocate_batch(batch_size)
+                batch.fill(0)
+                for run in range(runs):
+                    run_start = time.time()
+                    if self.model_type == "yolo":
+                        self.model.setInput(batch)
+                        self.model.forward(self.model.getUnconnectedOutLayersNames())
+                    else:
+                        self._forward_batch(batch)
+                    logger.info(f"Warm-up pass {run + 1}/{runs} with batch size {batch_size}: "
+                                f"{1000.0 * (time.time() - run_start):.0f} ms")
+        
+        self.warmup_time = time.time() - start_time
+        self.ready = True
+        logger.info(f"Model warm-up completed in {self.warmup_time:.2f} seconds")
+        return self.warmup_time
+    
+    def _forward_batch(self, batch: np.ndarray):
+        """Run the loaded model on a stacked NHWC batch"""
+        if self.model_type == "keras":
+            return self.model.predict(batch, verbose=0)
+        if self.model_type in ("onnx", "tensorrt"):
+            outputs = self._run_onnx(batch)
+            return outputs if len(outputs) in (3, 4) else outputs[0]
+        # TensorFlow SavedModel (mobilenet)
+        return np.asarray(self.model(batch))
+    
+    def _slice_predictions(self, predictions, index: int):
+        """Select the outputs of one image from batched predictions, keeping the batch axis"""
+        if hasattr(predictions, "shape"):
+            return predictions[index:index + 1]
+        return [output[index:index + 1] for output in predictions]
+    
+    def _observe(self, stage: str, seconds: float):
+        """Report a span to the span observer, if one is set"""
+        if self.span_observer is not None:
+            self.span_observer(stage, seconds)
+    
+    def _record_batch(self, batch_size: int, latency: float):
+        """Update batch size and latency statistics"""
+        stats = self.batch_stats
+        stats["batches"] += 1
+        stats["images"] += batch_size
+        stats["total_latency"] += latency
+        stats["max_latency"] = max(stats["max_latency"], latency)
+        stats["last_batch_size"] = batch_size
+        stats["max_batch_size"] = max(stats["max_batch_size"], batch_size)
+    
+    def get_batch_stats(self) -> Dict:
+        """
+        Get batch inference statistics
+        
+        Returns:
+            Dictionary with batch counts, average batch size and latencies in milliseconds
+        """
+        stats = self.batch_stats
+        batches = stats["batches"]
+        return {
+            "batches": batches,
+            "images": stats["images"],
+            "average_batch_size": stats["images"] / batches if batches else 0.0,
+            "last_batch_size": stats["last_batch_size"],
+            "max_batch_size": stats["max_batch_size"],
+            "average_latency_ms": 1000.0 * stats["total_latency"] / batches if batches else 0.0,
+            "average_latency_per_image_ms": (1000.0 * stats["total_latency"] / stats["images"]
+                                             if stats["images"] else 0.0),
+            "max_latency_ms": 1000.0 * stats["max_latency"]
+        }
+    
     def _detect_mobilenet(self, preprocessed_img: np.ndarray) -> List[Dict]:
         """Run detection with MobileNet model"""
         # This is a placeholder for actual inference code
@@ -258,27 +668,30 @@ class ModelHandler:
             # This is a simplified example
             predictions = self.model(preprocessed_img)
             
-            # Process predictions to detections
-            detections = []
-            for i, confidence in enumerate(predictions[0]):
-                if confidence > self.confidence_threshold:
-                    class_id = i
-                    class_name = self.class_names[i] if i < len(self.class_names) else f"class_{i}"
-                    
-                    detections.append({
-                        "class_id": int(class_id),
-                        "class_name": class_name,
-                        "confidence": float(confidence),
-                        "bbox": [0, 0, 0, 0]  # Would be calculated from model output
-                    })
-            
-            return detections
+            return self._mobilenet_detections(predictions[0])
             
         except Exception as e:
             logger.error(f"MobileNet inference error: {str(e)}")
             return []
     
-    def _detect_yolo(self, preprocessed_img: np.ndarray, original_image_path: str) -> List[Dict]:
+    def _mobilenet_detections(self, scores) -> List[Dict]:
+        """Process MobileNet class scores for one image to detections"""
+        detections = []
+        for i, confidence in enumerate(scores):
+            if confidence > self.confidence_threshold:
+                class_id = i
+                class_name = self.class_names[i] if i < len(self.class_names) else f"class_{i}"
+                
+                detections.append({
+                    "class_id": int(class_id),
+                    "class_name": class_name,
+                    "confidence": float(confidence),
+                    "bbox": [0, 0, 0, 0]  # Would be calculated from model output
+                })
+        
+        return detections
+    
+    def _detect_yolo(self, preprocessed_img: np.ndarray, original_size: Tuple[int, int]) -> List[Dict]:
         """Run detection with YOLO model"""
         # This is a placeholder for actual YOLO inference code
         if self.model == "placeholder_yolo_model":
@@ -293,13 +706,11 @@ class ModelHandler:
             ]
         
         try:
-            # Get original image dimensions
-            original_img = cv2.imread(original_image_path)
-            height, width = original_img.shape[:2]
+            # Original image dimensions
+            width, height = original_size
             
-            # Create a blob from the image
-            blob = cv2.dnn.blobFromImage(preprocessed_img, 1/255.0, self.input_shape, swapRB=True)
-            self.model.setInput(blob)
+            # preprocess_image already produced a normalized NCHW blob
+            self.model.setInput(preprocessed_img)
             
             # Get output layer names
             output_layers = self.model.getUnconnectedOutLayersNames()
@@ -307,142 +718,167 @@ class ModelHandler:
             # Forward pass
             layer_outputs = self.model.forward(output_layers)
             
-            # Process detections
-            detections = []
-            for output in layer_outputs:
-                for detection in output:
-                    scores = detection[5:]
-                    class_id = np.argmax(scores)
-                    confidence = scores[class_id]
-                    
-                    if confidence > self.confidence_threshold:
-                        # YOLO returns coordinates relative to the center
-                        center_x = int(detection[0] * width)
-                        center_y = int(detection[1] * height)
-                        detect_width = int(detection[2] * width)
-                        detect_height = int(detection[3] * height)
-                        
-                        # Calculate top-left corner
-                        x = int(center_x - detect_width / 2)
-                        y = int(center_y - detect_height / 2)
-                        
-                        class_name = self.class_names[class_id] if class_id < len(self.class_names) else f"class_{class_id}"
-                        
-                        detections.append({
-                            "class_id": int(class_id),
-                            "class_name": class_name,
-                            "confidence": float(confidence),
-                            "bbox": [x, y, detect_width, detect_height]
-                        })
-            
-            return detections
+            # Vectorized threshold, class argmax and per-class NMS over all layers
+            # (cv2.dnn already folds objectness into the class scores)
+            return decode_yolo(layer_outputs, width, height, self.class_names,
+                               self.confidence_threshold, self.nms_threshold)
             
         except Exception as e:
             logger.error(f"YOLO inference error: {str(e)}")
             return []
     
-    def _detect_keras(self, preprocessed_img: np.ndarray, original_image_path: str) -> List[Dict]:
+    def _detect_keras(self, preprocessed_img: np.ndarray, original_size: Tuple[int, int]) -> List[Dict]:
         """Run detection with Keras model"""
         try:
-            # Get original image for dimensions
-            original_img = cv2.imread(original_image_path)
-            height, width = original_img.shape[:2]
+            # Original image dimensions
+            width, height = original_size
             
             # Run prediction
             predictions = self.model.predict(preprocessed_img)
             
-            # Parse predictions (the format depends on the model architecture)
-            detections = []
-            
-            # If model outputs a single class probability (binary classification)
-            if len(predictions.shape) == 2 and predictions.shape[1] <= 2:
-                # Binary classification - just bird or not bird
-                confidence = float(predictions[0][0])
-                if predictions.shape[1] == 2:
-                    # If two outputs, take the bird class probability
-                    confidence = float(predictions[0][1])
-                
-                if confidence > self.confidence_threshold:
-                    # Create a simple detection with the whole image as bounding box
-                    # For a real system, you'd need a separate object detection model
-                    # to get proper bounding boxes
-                    class_id = 1  # Bird
-                    class_name = "Bird"
-                    
-                    # Get a random bird species
-                    species = random.choice(self.bird_species)
-                    species_confidence = random.uniform(0.7, 0.95)
-                    
-                    detections.append({
-                        "class_id": class_id,
-                        "class_name": class_name,
-                        "confidence": confidence,
-                        "bbox": [width//4, height//4, width//2, height//2],  # Center rectangle
-                        "species": species,
-                        "species_confidence": species_confidence
-                    })
-            
-            # If model outputs multiple class probabilities
-            elif len(predictions.shape) == 2 and predictions.shape[1] > 2:
-                # Multi-class classification - find top class
-                class_id = np.argmax(predictions[0])
-                confidence = float(predictions[0][class_id])
-                
-                if confidence > self.confidence_threshold:
-                    # Get class name
-                    if class_id < len(self.class_names):
-                        class_name = self.class_names[class_id]
-                    else:
-                        class_name = f"Class {class_id}"
-                    
-                    # Assuming the label directly represents bird species
-                    detections.append({
-                        "class_id": class_id,
-                        "class_name": class_name,
-                        "confidence": confidence,
-                        "bbox": [width//4, height//4, width//2, height//2],  # Center rectangle
-                        "species": class_name,
-                        "species_confidence": confidence
-                    })
-            
-            # Object detection model with bounding boxes (YOLO-like output)
-            elif len(predictions) == 3:  # Boxes, scores, classes format
-                boxes, scores, classes = predictions
-                
-                for i, score in enumerate(scores[0]):
-                    if score > self.confidence_threshold:
-                        class_id = int(classes[0][i])
-                        # Get class name
-                        if class_id < len(self.class_names):
-                            class_name = self.class_names[class_id]
-                        else:
-                            class_name = f"Class {class_id}"
-                        
-                        # Convert normalized coordinates to pixels
-                        y1, x1, y2, x2 = boxes[0][i]
-                        x = int(x1 * width)
-                        y = int(y1 * height)
-                        w = int((x2 - x1) * width)
-                        h = int((y2 - y1) * height)
-                        
-                        detections.append({
-                            "class_id": class_id,
-                            "class_name": class_name,
-                            "confidence": float(score),
-                            "bbox": [x, y, w, h],
-                            "species": class_name if "bird" in class_name.lower() else "Unknown Bird",
-                            "species_confidence": float(score)
-                        })
-            
-            return detections
+            return self._parse_predictions(predictions, width, height)
                 
         except Exception as e:
             logger.error(f"Keras model inference error: {str(e)}")
             return []
+    
+    def _detect_onnx(self, preprocessed_img: np.ndarray, original_size: Tuple[int, int]) -> List[Dict]:
+        """Run detection with ONNX Runtime (TensorRT/CUDA/CPU)"""
+        try:
+            # Original image dimensions
+            width, height = original_size
+            
+            outputs = self._run_onnx(preprocessed_img)
+            
+            # Single-output graphs are classifiers or raw YOLO heads, three outputs
+            # are boxes/scores/classes and four are TensorRT EfficientNMS outputs
+            predictions = outputs if len(outputs) in (3, 4) else outputs[0]
+            return self._parse_predictions(predictions, width, height)
+            
+        except Exception as e:
+            logger.error(f"ONNX model inference error: {str(e)}")
+            return []
+    
+    def _run_onnx(self, preprocessed_img: np.ndarray) -> List[np.ndarray]:
+        """Run the ONNX Runtime session on a preprocessed batch (already in the graph's layout)"""
+        batch = np.ascontiguousarray(preprocessed_img, dtype=self.input_dtype)
+        
+        if self.io_binding is None:
+            return self.model.run(self.onnx_output_names, {self.onnx_input_name: batch})
+        
+        self.io_binding.bind_cpu_input(self.onnx_input_name, batch)
+        for name in self.onnx_output_names:
+            self.io_binding.bind_output(name, "cuda")
+        self.model.run_with_iobinding(self.io_binding)
+        return self.io_binding.copy_outputs_to_cpu()
+    
+    def _parse_predictions(self, predictions, width: int, height: int) -> List[Dict]:
+        """
+        Convert raw classifier/detector outputs into detection dictionaries
+        
+        Args:
+            predictions: Model output (class probabilities, raw YOLO rows, or
+                         boxes/scores/classes with NMS already applied)
+            width: Width of the original image
+            height: Height of the original image
+            
+        Returns:
+            List of detection dictionaries
+        """
+        # Parse predictions (the format depends on the model architecture)
+        detections = []
+        
+        # Detection models return a list of output arrays instead of one array
+        is_array = hasattr(predictions, "shape")
+        
+        # If model outputs a single class probability (binary classification)
+        if is_array and len(predictions.shape) == 2 and predictions.shape[1] <= 2:
+            # Binary classification - just bird or not bird
+            confidence = float(predictions[0][0])
+            if predictions.shape[1] == 2:
+                # If two outputs, take the bird class probability
+                confidence = float(predictions[0][1])
+            
+            if confidence > self.confidence_threshold:
+                # A classifier has no boxes, so the detection covers the whole
+                # frame. Species come from the two-stage pipeline (see
+                # two_stage.TwoStageDetector), not from this model.
+                detections.append({
+                    "class_id": 1,  # Bird
+                    "class_name": "Bird",
+                    "confidence": confidence,
+                    "bbox": [0, 0, width, height]
+                })
+        
+        # If model outputs multiple class probabilities
+        elif is_array and len(predictions.shape) == 2 and predictions.shape[1] > 2:
+            # Multi-class classification - find top class
+            class_id = int(np.argmax(predictions[0]))
+            confidence = float(predictions[0][class_id])
+            
+            if confidence > self.confidence_threshold:
+                # Get class name
+                if class_id < len(self.class_names):
+                    class_name = self.class_names[class_id]
+                else:
+                    class_name = f"Class {class_id}"
+                
+                # Assuming the label directly represents bird species
+                detections.append({
+                    "class_id": class_id,
+                    "class_name": class_name,
+                    "confidence": confidence,
+                    "bbox": [0, 0, width, height],  # Whole frame, classifiers have no boxes
+                    "species": class_name,
+                    "species_confidence": confidence
+                })
+        
+        # Raw YOLO head exported to ONNX: (1, rows, 5 + classes) in input pixels
+        elif is_array and len(predictions.shape) == 3 and predictions.shape[2] > 5:
+            detections = decode_yolo(predictions, width, height, self.class_names,
+                                     self.confidence_threshold, self.nms_threshold,
+                                     input_size=self.input_shape, use_objectness=True)
+        
+        # Object detection model with bounding boxes, NMS already applied in the graph
+        elif not is_array and len(predictions) in (3, 4):
+            if len(predictions) == 3:
+                # Boxes, scores, classes; normalized [y1, x1, y2, x2]
+                boxes, scores, classes = (np.asarray(output)[0] for output in predictions)
+                boxes = boxes[:, [1, 0, 3, 2]] * np.array([width, height, width, height],
+                                                          dtype=np.float32)
+            else:
+                # TensorRT EfficientNMS: count, boxes, scores, classes; [x1, y1, x2, y2] in input pixels
+                num_detections, boxes, scores, classes = (np.asarray(output)[0] for output in predictions)
+                count = int(np.ravel(num_detections)[0])
+                boxes, scores, classes = boxes[:count], scores[:count], classes[:count]
+                input_height, input_width = self.input_shape
+                boxes = boxes * np.array([width / input_width, height / input_height] * 2,
+                                         dtype=np.float32)
+            
+            for i in np.flatnonzero(scores > self.confidence_threshold):
+                class_id = int(classes[i])
+                # Get class name
+                if class_id < len(self.class_names):
+                    class_name = self.class_names[class_id]
+                else:
+                    class_name = f"Class {class_id}"
+                
+                x1, y1, x2, y2 = boxes[i]
+                detections.append({
+                    "class_id": class_id,
+                    "class_name": class_name,
+                    "confidence": float(scores[i]),
+                    "bbox": [int(x1), int(y1), int(x2 - x1), int(y2 - y1)]
+                })
+        
+        return detections
             
     def annotate_image(self, image_path: str, detections: List[Dict], output_path: Optional[str] = None) -> str:
         """
-        Annotate image with detection results
+        Annotate image with detection results and write it to disk
+        
+        The server renders overlays on demand (see annotation.AnnotationRenderer);
+        this is for offline tools that want an annotated file.
         
         Args:
             image_path: Path to original image
@@ -459,22 +895,7 @@ class ModelHandler:
                 raise ValueError(f"Failed to read image at {image_path}")
                 
             # Draw bounding boxes
-            for detection in detections:
-                # Get box coordinates
-                x, y, w, h = detection["bbox"]
-                
-                # Draw rectangle
-                cv2.rectangle(image, (x, y), (x + w, y + h), (0, 255, 0), 2)
-                
-                # Create label
-                label = f"{detection['class_name']}: {detection['confidence']:.2f}"
-                
-                # Draw label background
-                cv2.rectangle(image, (x, y - 20), (x + len(label) * 8, y), (0, 255, 0), -1)
-                
-                # Draw label text
-                cv2.putText(image, label, (x, y - 5),
-                            cv2.FONT_HERSHEY_SIMPLEX, 0.5, (0, 0, 0), 1)
+            draw_detections(image, detections)
             
             # Generate output path if not provided
             if output_path is None:
@@ -492,10 +913,11 @@ class ModelHandler:
             logger.error(f"Error annotating image: {str(e)}")
             return image_path
 
-    def _generate_mock_detection(self, image_path: str) -> List[Dict]:
+    def _generate_mock_detection(self, image: Union[str, np.ndarray]) -> List[Dict]:
         """Generate mock bird detections for development mode"""
         # Get image dimensions
-        image = cv2.imread(image_path)
+        if not isinstance(image, np.ndarray):
+            image = cv2.imread(image)
         if image is None:
             return []
             
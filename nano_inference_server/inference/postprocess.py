@@ -0,0 +1,135 @@
+"""
+Detector output post-processing.
+Decodes raw YOLO output rows with vectorized confidence filtering and class
+argmax, then removes overlapping boxes with OpenCV's native per-class
+non-maximum suppression, all in one pass over the concatenated outputs.
+"""
+import logging
+import numpy as np
+from typing import Dict, List, Optional, Sequence, Tuple
+import cv2
+
+# Set up logging
+logging.basicConfig(level=logging.INFO,
+                    format='%(asctime)s - %(name)s - %(levelname)s - %(message)s')
+logger = logging.getLogger(__name__)
+
+# cv2.dnn.NMSBoxesBatched was added in OpenCV 4.7; older builds (JetPack
+# ships 4.1) use the class-offset trick below with NMSBoxes
+_HAS_BATCHED_NMS = hasattr(cv2.dnn, "NMSBoxesBatched")
+
+
+def batched_nms(boxes: np.ndarray, scores: np.ndarray, class_ids: np.ndarray,
+                score_threshold: float, nms_threshold: float,
+                max_detections: Optional[int] = None) -> np.ndarray:
+    """
+    Per-class non-maximum suppression
+
+    Args:
+        boxes: Boxes as (N, 4) [x, y, width, height]
+        scores: Confidence per box, (N,)
+        class_ids: Class per box, (N,); boxes of different classes never suppress each other
+        score_threshold: Boxes below this score are dropped
+        nms_threshold: IoU above which the lower scoring box is suppressed
+        max_detections: Optional limit on the number of boxes kept
+
+    Returns:
+        Indices of the kept boxes, highest score first
+    """
+    if len(boxes) == 0:
+        return np.empty(0, dtype=np.int64)
+
+    top_k = max_detections or 0
+    if _HAS_BATCHED_NMS:
+        keep = cv2.dnn.NMSBoxesBatched(boxes.tolist(), scores.tolist(), class_ids.tolist(),
+                                       score_threshold, nms_threshold, top_k=top_k)
+    else:
+        # Shift each class into its own coordinate range so one NMS call
+        # never compares boxes of different classes
+        offset = float(boxes[:, :2].max() + boxes[:, 2:].max()) + 1.0
+        shifted = boxes.copy()
+        shifted[:, :2] += class_ids[:, None] * offset
+        keep = cv2.dnn.NMSBoxes(shifted.tolist(), scores.tolist(),
+                                score_threshold, nms_threshold, top_k=top_k)
+
+    keep = np.asarray(keep, dtype=np.int64).reshape(-1)
+    # Older OpenCV versions do not sort by score
+    return keep[np.argsort(-scores[keep], kind="stable")]
+
+
+def decode_yolo(outputs: Sequence[np.ndarray], width: int, height: int,
+                class_names: Sequence[str], confidence_threshold: float,
+                nms_threshold: float = 0.45,
+                input_size: Optional[Tuple[int, int]] = None,
+                use_objectness: bool = False,
+                max_detections: int = 100) -> List[Dict]:
+    """
+    Convert raw YOLO output rows into detections
+
+    Each row is [center_x, center_y, width, height, objectness, class scores...].
+
+    Args:
+        outputs: Output arrays of one image; any leading axes are flattened
+        width: Width of the original image
+        height: Height of the original image
+        class_names: Class names indexed by class ID
+        confidence_threshold: Minimum class confidence
+        nms_threshold: IoU threshold for non-maximum suppression
+        input_size: Model input size as (height, width) when box coordinates are
+                    in input pixels (ONNX exports); None for normalized coordinates
+                    (cv2.dnn Darknet outputs)
+        use_objectness: Multiply class scores by objectness (cv2.dnn already does this)
+        max_detections: Maximum detections returned
+
+    Returns:
+        List of detection dictionaries, highest confidence first
+    """
+    rows = [np.asarray(output, dtype=np.float32) for output in outputs]
+    rows = [output.reshape(-1, output.shape[-1]) for output in rows if output.size]
+    if not rows:
+        return []
+    rows = rows[0] if len(rows) == 1 else np.concatenate(rows)
+
+    scores = rows[:, 5:]
+    if use_objectness:
+        scores = scores * rows[:, 4:5]
+
+    # Vectorized class argmax and confidence threshold
+    class_ids = scores.argmax(axis=1)
+    confidences = scores[np.arange(len(scores)), class_ids]
+    candidates = np.flatnonzero(confidences > confidence_threshold)
+    if len(candidates) == 0:
+        return []
+
+    rows = rows[candidates]
+    class_ids = class_ids[candidates]
+    confidences = confidences[candidates]
+
+    # Center/size to top-left/size in original image pixels
+    scale_x, scale_y = float(width), float(height)
+    if input_size is not None:
+        scale_x /= input_size[1]
+        scale_y /= input_size[0]
+    boxes = np.empty((len(rows), 4), dtype=np.float32)
+    boxes[:, 2] = rows[:, 2] * scale_x
+    boxes[:, 3] = rows[:, 3] * scale_y
+    boxes[:, 0] = rows[:, 0] * scale_x - boxes[:, 2] / 2
+    boxes[:, 1] = rows[:, 1] * scale_y - boxes[:, 3] / 2
+
+    keep = batched_nms(boxes, confidences, class_ids, confidence_threshold,
+                       nms_threshold, max_detections)
+
+    detections = []
+    for i in keep:
+        class_id = int(class_ids[i])
+        class_name = class_names[class_id] if class_id < len(class_names) else f"class_{class_id}"
+        x, y, w, h = boxes[i]
+        detections.append({
+            "class_id": class_id,
+            "class_name": class_name,
+            "confidence": float(confidences[i]),
+            "bbox": [int(x), int(y), int(w), int(h)]
+        })
+
+    logger.debug(f"YOLO decode: {len(candidates)} candidates, {len(detections)} after NMS")
+    return detections
@@ -0,0 +1,93 @@
+"""
+Image preprocessing for model input.
+Resizes, swaps BGR to RGB and normalizes a frame straight into the model's
+input tensor (float32 or float16, NHWC or NCHW) without float64 intermediates.
+"""
+import logging
+import numpy as np
+from typing import Optional, Sequence, Tuple
+import cv2
+
+# Set up logging
+logging.basicConfig(level=logging.INFO,
+                    format='%(asctime)s - %(name)s - %(levelname)s - %(message)s')
+logger = logging.getLogger(__name__)
+
+# OpenCV's resize, color conversion and blob kernels are vectorized with its
+# universal intrinsics (NEON on the Pi/Jetson ARM cores, SSE/AVX2 on x86) as
+# long as optimized code paths are enabled.
+cv2.setUseOptimized(True)
+
+
+def preprocess_frame(image: np.ndarray,
+                     size: Tuple[int, int],
+                     layout: str = "nhwc",
+                     scale: float = 1.0 / 255.0,
+                     mean: Optional[Sequence[float]] = None,
+                     std: Optional[Sequence[float]] = None,
+                     swap_rb: bool = True,
+                     dtype=np.float32,
+                     out: Optional[np.ndarray] = None) -> np.ndarray:
+    """
+    Convert a decoded BGR frame into a normalized model input tensor
+
+    The resize runs on the uint8 frame, so the channel swap and the float
+    conversion only touch model-sized pixels. Scale, mean and std are folded
+    into a single multiply (and one subtract when a mean is given) writing
+    directly into the output tensor.
+
+    Args:
+        image: Decoded BGR image (height, width, 3), uint8
+        size: Model input size as (height, width)
+        layout: Output layout, "nhwc" or "nchw"
+        scale: Factor applied to the pixel values before mean/std normalization
+        mean: Per-channel mean (RGB order, after scaling) to subtract
+        std: Per-channel standard deviation (RGB order, after scaling) to divide by
+        swap_rb: Whether to convert BGR to RGB
+        dtype: Output dtype (np.float32 or np.float16)
+        out: Optional preallocated output of shape (1, H, W, 3) or (1, 3, H, W),
+             e.g. one row of a batch tensor
+
+    Returns:
+        Preprocessed tensor with a leading batch dimension of 1
+    """
+    height, width = size
+
+    # Resize on uint8 pixels; INTER_AREA for downscaling camera frames
+    if image.shape[0] != height or image.shape[1] != width:
+        interpolation = cv2.INTER_AREA if image.shape[0] > height else cv2.INTER_LINEAR
+        image = cv2.resize(image, (width, height), interpolation=interpolation)
+
+    # Swap channels on the small image
+    if swap_rb:
+        image = cv2.cvtColor(image, cv2.COLOR_BGR2RGB)
+
+    # Fold (x * scale - mean) / std into x * factor - offset
+    factor = np.full(3, scale, dtype=np.float32)
+    offset = None
+    if std is not None:
+        factor = factor / np.asarray(std, dtype=np.float32)
+    if mean is not None:
+        offset = np.asarray(mean, dtype=np.float32)
+        if std is not None:
+            offset = offset / np.asarray(std, dtype=np.float32)
+
+    if layout == "nchw":
+        if out is None:
+            out = np.empty((1, 3, height, width), dtype=dtype)
+        # Per-plane writes keep each output channel contiguous
+        for channel in range(3):
+            plane = out[0, channel]
+            np.multiply(image[:, :, channel], factor[channel], out=plane, dtype=plane.dtype)
+            if offset is not None:
+                np.subtract(plane, offset[channel], out=plane, dtype=plane.dtype)
+    elif layout == "nhwc":
+        if out is None:
+            out = np.empty((1, height, width, 3), dtype=dtype)
+        np.multiply(image, factor, out=out[0], dtype=out.dtype)
+        if offset is not None:
+            np.subtract(out[0], offset, out=out[0], dtype=out.dtype)
+    else:
+        raise ValueError(f"Unsupported layout: {layout}")
+
+    return out
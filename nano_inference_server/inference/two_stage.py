@@ -0,0 +1,259 @@
+"""
+Two-stage bird detection: detect, then classify the crops.
+A small detector finds birds on its downscaled input, then every bird crop is
+cut from the full-resolution frame (numpy views of the frame already decoded)
+and classified by the species model in one batched forward pass. The
+classifier cost scales with the number of birds, not with the resolution.
+"""
+import time
+import logging
+import numpy as np
+from typing import Dict, List, Optional, Sequence, Tuple, Union
+import cv2
+
+from .model import ModelHandler
+
+# Set up logging
+logging.basicConfig(level=logging.INFO,
+                    format='%(asctime)s - %(name)s - %(levelname)s - %(message)s')
+logger = logging.getLogger(__name__)
+
+
+class TwoStageDetector:
+    """Runs a bird detector and a species classifier on the detected regions"""
+
+    def __init__(self, detector: ModelHandler, classifier: ModelHandler,
+                 crop_padding: float = 0.1, min_crop_size: int = 16,
+                 species_threshold: float = 0.3,
+                 bird_classes: Optional[Sequence[str]] = ("bird",)):
+        """
+        Initialize the pipeline
+
+        Args:
+            detector: Model producing bird boxes (e.g. yolo or onnx detector)
+            classifier: Species classifier run on the crops (e.g. MobileNet)
+            crop_padding: Fraction of the box size added on each side of a crop,
+                          so the classifier sees some context around the bird
+            min_crop_size: Boxes smaller than this many pixels are not classified
+            species_threshold: Minimum classifier confidence to report a species
+            bird_classes: Detector class names that are birds (case-insensitive);
+                          None classifies every detection
+        """
+        self.detector = detector
+        self.classifier = classifier
+        self.crop_padding = crop_padding
+        self.min_crop_size = min_crop_size
+        self.species_threshold = species_threshold
+        self.bird_classes = {name.lower() for name in bird_classes} if bird_classes else None
+
+        # Crop statistics reported by get_batch_stats()
+        self.crop_stats = {
+            "frames": 0,
+            "crops": 0,
+            "classified": 0,
+            "total_latency": 0.0
+        }
+
+    @property
+    def ready(self) -> bool:
+        """Whether both models have been warmed up"""
+        return self.detector.ready and self.classifier.ready
+
+    @property
+    def warmup_time(self) -> Optional[float]:
+        """Combined warm-up time of both models in seconds"""
+        if self.detector.warmup_time is None or self.classifier.warmup_time is None:
+            return None
+        return self.detector.warmup_time + self.classifier.warmup_time
+
+    def warmup(self, batch_sizes: Tuple[int, ...] = (1,), runs: int = 2) -> float:
+        """
+        Warm up the detector and the classifier
+
+        Args:
+            batch_sizes: Detector batch sizes to run; the classifier is warmed
+                         up for single crops and a few crops at once
+            runs: Forward passes per batch size
+
+        Returns:
+            Warm-up time in seconds
+        """
+        self.detector.warmup(batch_sizes, runs)
+        self.classifier.warmup((1, 4), runs)
+        return self.warmup_time
+
+    def detect(self, image_path: Union[str, np.ndarray]) -> List[Dict]:
+        """
+        Detect birds in one image and classify their species
+
+        Args:
+            image_path: Path to the image file, or an already decoded BGR frame
+
+        Returns:
+            List of detection dictionaries (see ModelHandler.detect), with
+            species, species_id and species_confidence set on classified birds
+        """
+        return self.detect_batch([image_path])[0]
+
+    def detect_batch(self, image_paths: List[Union[str, np.ndarray]]) -> List[List[Dict]]:
+        """
+        Detect birds in several images, classifying all crops in one pass
+
+        Args:
+            image_paths: Paths to the image files, or already decoded BGR frames
+
+        Returns:
+            One list of detection dictionaries per input image
+        """
+        if not image_paths:
+            return []
+
+        results = [[] for _ in image_paths]
+
+        try:
+            # Decode each image once; the detector and the crops share it
+            images = []
+            indices = []
+            for i, image_path in enumerate(image_paths):
+                if isinstance(image_path, np.ndarray):
+                    img = image_path
+                else:
+                    img = cv2.imread(image_path)
+                if img is None:
+                    logger.warning(f"Failed to read image at {image_path}, skipping")
+                    continue
+                images.append(img)
+                indices.append(i)
+
+            if not images:
+                return results
+
+            detections = self.detector.detect_batch(images)
+            for i, image_detections in zip(indices, detections):
+                results[i] = image_detections
+
+            # Mock detections already carry a species
+            if not self.detector.development_mode:
+                self._classify_regions(images, detections)
+
+            return results
+
+        except Exception as e:
+            logger.error(f"Error during two-stage detection: {str(e)}")
+            return results
+
+    def _is_bird(self, detection: Dict) -> bool:
+        """Whether a detection should be passed to the species classifier"""
+        if "bbox" not in detection:
+            return False
+        if self.bird_classes is None:
+            return True
+        return str(detection.get("class_name", "")).lower() in self.bird_classes
+
+    def _crop_region(self, bbox: Sequence[float], width: int,
+                     height: int) -> Optional[Tuple[int, int, int, int]]:
+        """
+        Pad a detection box and clip it to the frame
+
+        Args:
+            bbox: Box as [x, y, width, height] in frame pixels
+            width: Frame width
+            height: Frame height
+
+        Returns:
+            (x0, y0, x1, y1) slice bounds, or None if the box is too small
+        """
+        x, y, w, h = bbox
+        pad_x = w * self.crop_padding
+        pad_y = h * self.crop_padding
+        x0 = max(0, int(x - pad_x))
+        y0 = max(0, int(y - pad_y))
+        x1 = min(width, int(x + w + pad_x))
+        y1 = min(height, int(y + h + pad_y))
+        if x1 - x0 < self.min_crop_size or y1 - y0 < self.min_crop_size:
+            return None
+        return x0, y0, x1, y1
+
+    def _classify_regions(self, images: List[np.ndarray], detections: List[List[Dict]]):
+        """Classify every bird crop of every image in one batch, updating the detections"""
+        start_time = time.time()
+
+        crops = []
+        targets = []
+        for image, image_detections in zip(images, detections):
+            height, width = image.shape[:2]
+            for detection in image_detections:
+                if not self._is_bird(detection):
+                    continue
+                region = self._crop_region(detection["bbox"], width, height)
+                if region is None:
+                    continue
+                x0, y0, x1, y1 = region
+                # A view into the full-resolution frame, no copy or re-decode
+                crops.append(image[y0:y1, x0:x1])
+                targets.append(detection)
+
+        self.crop_stats["frames"] += len(images)
+        if not crops:
+            return
+
+        scores = self.classifier.classify_batch(crops)
+        if scores is None:
+            logger.warning("Species classifier not loaded, reporting detections without species")
+            return
+        probabilities = self._probabilities(scores)
+
+        classified = 0
+        for detection, row in zip(targets, probabilities):
+            class_id = int(np.argmax(row))
+            confidence = float(row[class_id])
+            if confidence < self.species_threshold:
+                continue
+            detection["species"] = self._species_name(class_id)
+            detection["species_id"] = class_id
+            detection["species_confidence"] = confidence
+            classified += 1
+
+        latency = time.time() - start_time
+        stats = self.crop_stats
+        stats["crops"] += len(crops)
+        stats["classified"] += classified
+        stats["total_latency"] += latency
+        logger.info(f"Classified {len(crops)} bird crops from {len(images)} images "
+                    f"in {latency:.2f} seconds")
+
+    @staticmethod
+    def _probabilities(scores: np.ndarray) -> np.ndarray:
+        """Softmax the scores unless the classifier already outputs probabilities"""
+        if scores.size and (scores.min() < 0.0 or scores.max() > 1.0):
+            scores = scores - scores.max(axis=1, keepdims=True)
+            np.exp(scores, out=scores)
+            scores /= scores.sum(axis=1, keepdims=True)
+        return scores
+
+    def _species_name(self, class_id: int) -> str:
+        """Return the classifier label for a class ID"""
+        names = self.classifier.class_names
+        return names[class_id] if class_id < len(names) else f"Class {class_id}"
+
+    def get_batch_stats(self) -> Dict:
+        """
+        Get detector, classifier and crop statistics
+
+        Returns:
+            Detector batch statistics (see ModelHandler.get_batch_stats) with
+            "classifier" and "crops" sections added
+        """
+        stats = self.detector.get_batch_stats()
+        stats["classifier"] = self.classifier.get_batch_stats()
+
+        crops = self.crop_stats
+        stats["crops"] = {
+            "frames": crops["frames"],
+            "crops": crops["crops"],
+            "classified": crops["classified"],
+            "average_crops_per_frame": crops["crops"] / crops["frames"] if crops["frames"] else 0.0,
+            "average_latency_per_crop_ms": (1000.0 * crops["total_latency"] / crops["crops"]
+                                            if crops["crops"] else 0.0)
+        }
+        return stats
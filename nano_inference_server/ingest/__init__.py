@@ -0,0 +1,6 @@
+"""
+Ingest module for receiving images from the camera.
+ 
+This module accepts streamed uploads from the Pi and places completed images
+in the monitored input directory.
+"""
@@ -0,0 +1,108 @@
+"""
+H.264 keyframes sent by cameras in clip mode.
+A keyframe is one IDR access unit, with its SPS/PPS, cut from the camera's
+hardware encoder output. It is decoded once at ingest, on the Jetson's
+NVDEC through GStreamer when OpenCV was built with it, and stored as a JPEG
+so the monitor, model, storage and gallery only ever see images.
+"""
+import os
+import logging
+import numpy as np
+from typing import Optional
+import cv2
+
+# Set up logging
+logging.basicConfig(level=logging.INFO,
+                    format='%(asctime)s - %(name)s - %(levelname)s - %(message)s')
+logger = logging.getLogger(__name__)
+
+KEYFRAME_EXTENSIONS = (".h264", ".264")
+
+# nvv4l2decoder is the Jetson's hardware decoder; nvvidconv copies out of NVMM memory
+NVDEC_PIPELINE = ('filesrc location="{path}" ! h264parse ! nvv4l2decoder ! nvvidconv ! '
+                  'video/x-raw,format=BGRx ! videoconvert ! video/x-raw,format=BGR ! '
+                  'appsink sync=false')
+
+_gstreamer_available = None
+
+
+def is_keyframe(name: str) -> bool:
+    """Whether a file name is an H.264 keyframe"""
+    return name.lower().endswith(KEYFRAME_EXTENSIONS)
+
+
+def gstreamer_available() -> bool:
+    """Whether this OpenCV build can open GStreamer pipelines (checked once)"""
+    global _gstreamer_available
+    if _gstreamer_available is None:
+        _gstreamer_available = False
+        for line in cv2.getBuildInformation().splitlines():
+            if line.strip().startswith("GStreamer:"):
+                _gstreamer_available = "YES" in line
+                break
+    return _gstreamer_available
+
+
+def _read_first_frame(capture) -> Optional[np.ndarray]:
+    """Read one frame from a VideoCapture and release it"""
+    try:
+        if not capture.isOpened():
+            return None
+        ok, frame = capture.read()
+        return frame if ok else None
+    finally:
+        capture.release()
+
+
+def decode_keyframe(path: str, decoder: str = "auto") -> Optional[np.ndarray]:
+    """
+    Decode an H.264 keyframe file to a BGR image
+
+    Args:
+        path: Keyframe file (raw H.264 elementary stream)
+        decoder: "nvdec" (GStreamer on the hardware decoder), "ffmpeg"
+                 (software) or "auto" (NVDEC when available, else FFmpeg)
+
+    Returns:
+        BGR image, or None if the keyframe cannot be decoded
+    """
+    if decoder in ("auto", "nvdec") and gstreamer_available():
+        frame = _read_first_frame(cv2.VideoCapture(NVDEC_PIPELINE.format(path=path),
+                                                   cv2.CAP_GSTREAMER))
+        if frame is not None:
+            return frame
+        logger.warning(f"NVDEC could not decode {os.path.basename(path)}, trying FFmpeg")
+    if decoder in ("auto", "ffmpeg"):
+        return _read_first_frame(cv2.VideoCapture(path, cv2.CAP_FFMPEG))
+    return None
+
+
+def keyframe_to_jpeg(path: str, output_path: str, quality: int = 90,
+                     decoder: str = "auto") -> Optional[np.ndarray]:
+    """
+    Decode a keyframe and write it as a JPEG
+
+    Args:
+        path: Keyframe file
+        output_path: JPEG file to write; any extension, e.g. a .part name
+        quality: JPEG quality
+        decoder: See decode_keyframe()
+
+    Returns:
+        The decoded BGR image, or None if it could not be decoded or written
+    """
+    frame = decode_keyframe(path, decoder)
+    if frame is None:
+        return None
+    # Encoded explicitly: imwrite picks the format from the file extension
+    ok, encoded = cv2.imencode(".jpg", frame, [cv2.IMWRITE_JPEG_QUALITY, quality])
+    if not ok:
+        logger.error(f"Could not encode {os.path.basename(path)} as JPEG")
+        return None
+    try:
+        with open(output_path, "wb") as f:
+            f.write(encoded.tobytes())
+    except OSError as e:
+        logger.error(f"Could not write {output_path}: {str(e)}")
+        return None
+    return frame
@@ -0,0 +1,502 @@
+"""
+Streaming ingest server for images sent by the Pi camera.
+Receives length-prefixed messages over one persistent TCP connection per
+camera, verifies each image by its SHA-256, and moves completed images into
+the monitored input directory.
+
+Wire format (both directions): a 4-byte big-endian header length, a UTF-8 JSON
+header, then header["size"] bytes of payload (0 when absent).
+
+    client                              server
+    hello {client, access_key}    ->
+                                  <-    welcome {window}
+                                        (or not_ready {retry_after} while the model warms up)
+    offer {seq, sha256, name, size_bytes, metadata}  ->
+                                  <-    accept {seq, status: send|duplicate|busy|too_large, offset}
+    data {seq, offset} + payload  ->    (repeated from the accepted offset)
+    end {seq}                     ->
+                                  <-    done {seq, status: stored|duplicate|corrupt, visit}
+
+Partially received images are kept as <sha256>.part in the spool directory,
+so a client reconnecting after a dropped link resumes from the last byte
+received. Hashes of stored images are logged so retried uploads are
+acknowledged as duplicates without being written or processed again; hashes
+older than received_ttl_hours are pruned with abandoned partial uploads.
+With a VisitTracker, images nearly identical to the camera's previous image
+are acknowledged as duplicates too and only extend that image's visit.
+H.264 keyframes from cameras in clip mode are decoded (on NVDEC when
+available) and stored as JPEGs, so everything downstream sees images.
+"""
+import os
+import json
+import time
+import struct
+import hashlib
+import logging
+import threading
+import socketserver
+from typing import Callable, Dict, Optional, Tuple
+
+from werkzeug.utils import secure_filename
+
+from .visits import VisitTracker, image_dhash
+from .keyframes import is_keyframe, keyframe_to_jpeg
+
+# Set up logging
+logging.basicConfig(level=logging.INFO,
+                    format='%(asctime)s - %(name)s - %(levelname)s - %(message)s')
+logger = logging.getLogger(__name__)
+
+PROTOCOL_VERSION = 1
+_LENGTH = struct.Struct(">I")
+MAX_HEADER_SIZE = 64 * 1024
+MAX_PAYLOAD_SIZE = 4 * 1024 * 1024
+MAX_IMAGE_SIZE = 64 * 1024 * 1024
+PRUNE_INTERVAL = 3600.0
+
+
+class ProtocolError(Exception):
+    """Raised when a peer sends a malformed message"""
+
+
+def send_message(sock, header: Dict, payload: bytes = b""):
+    """
+    Send one framed message
+
+    Args:
+        sock: Connected socket
+        header: JSON-serializable header
+        payload: Optional binary payload
+    """
+    header = dict(header, size=len(payload))
+    encoded = json.dumps(header, separators=(",", ":"), default=str).encode("utf-8")
+    sock.sendall(_LENGTH.pack(len(encoded)) + encoded + payload)
+
+
+def _read_exact(stream, size: int) -> bytes:
+    """Read exactly size bytes, raising EOFError if the peer disconnects"""
+    data = stream.read(size)
+    if data is None or len(data) < size:
+        raise EOFError("Connection closed")
+    return data
+
+
+def recv_message(stream) -> Tuple[Dict, bytes]:
+    """
+    Receive one framed message
+
+    Args:
+        stream: Buffered binary file object from socket.makefile("rb")
+
+    Returns:
+        Tuple of (header, payload)
+    """
+    (length,) = _LENGTH.unpack(_read_exact(stream, _LENGTH.size))
+    if length > MAX_HEADER_SIZE:
+        raise ProtocolError(f"Header too large: {length} bytes")
+    header = json.loads(_read_exact(stream, length).decode("utf-8"))
+    size = int(header.get("size", 0))
+    if size > MAX_PAYLOAD_SIZE:
+        raise ProtocolError(f"Payload too large: {size} bytes")
+    payload = _read_exact(stream, size) if size else b""
+    return header, payload
+
+
+def _file_sha256(path: str) -> str:
+    """SHA-256 of a file, read in chunks"""
+    digest = hashlib.sha256()
+    with open(path, "rb") as f:
+        for chunk in iter(lambda: f.read(1024 * 1024), b""):
+            digest.update(chunk)
+    return digest.hexdigest()
+
+
+class _ConnectionHandler(socketserver.StreamRequestHandler):
+    """Handles one camera connection"""
+
+    def handle(self):
+        self.server.ingest.handle_connection(self.request, self.rfile, self.client_address)
+
+
+class _ThreadingServer(socketserver.ThreadingTCPServer):
+    allow_reuse_address = True
+    daemon_threads = True
+
+
+class StreamIngestServer:
+    """Receives streamed images and places them in the input directory"""
+
+    def __init__(self,
+                 input_dir: str,
+                 host: str = "0.0.0.0",
+                 port: int = 5001,
+                 spool_dir: Optional[str] = None,
+                 access_key: Optional[str] = None,
+                 window: int = 4,
+                 idle_timeout: float = 120.0,
+                 part_ttl_hours: float = 24.0,
+                 ready_check: Optional[Callable[[], bool]] = None,
+                 retry_after: float = 5.0,
+                 visits: Optional[VisitTracker] = None,
+                 keyframe_decoder: str = "auto",
+                 max_image_size: int = MAX_IMAGE_SIZE,
+                 received_ttl_hours: float = 168.0):
+        """
+        Initialize the ingest server
+
+        Args:
+            input_dir: Directory completed images are moved into (the monitored directory)
+            host: Address to listen on
+            port: TCP port to listen on
+            spool_dir: Directory for partial uploads; must be on the same filesystem as
+                       input_dir (defaults to input_dir/.incoming)
+            access_key: Key clients must present in their hello (None to disable)
+            window: In-flight image limit advertised to clients
+            idle_timeout: Seconds without a message before a connection is dropped
+            part_ttl_hours: Age after which abandoned partial uploads are deleted
+            ready_check: Returns False while the server cannot process images yet
+                         (model warming up); clients are then told to hold their photos
+            retry_after: Seconds clients are told to wait before reconnecting when not ready
+            visits: Collapses near-duplicate images into visits (None stores every image)
+            keyframe_decoder: Decoder for H.264 keyframes: "auto", "nvdec" or "ffmpeg"
+            max_image_size: Largest image in bytes a client may offer
+            received_ttl_hours: Age after which stored image hashes are forgotten; retries
+                                of older images are stored again
+        """
+        self.input_dir = os.path.abspath(input_dir)
+        self.spool_dir = os.path.abspath(spool_dir or os.path.join(self.input_dir, ".incoming"))
+        self.host = host
+        self.port = port
+        self.access_key = access_key
+        self.window = window
+        self.idle_timeout = idle_timeout
+        self.part_ttl_hours = part_ttl_hours
+        self.ready_check = ready_check
+        self.retry_after = retry_after
+        self.visits = visits
+        self.keyframe_decoder = keyframe_decoder
+        self.max_image_size = max_image_size
+        self.received_ttl_hours = received_ttl_hours
+
+        os.makedirs(self.input_dir, exist_ok=True)
+        os.makedirs(self.spool_dir, exist_ok=True)
+
+        # Hashes of stored images, for dedup across retries and restarts
+        self.received_log = os.path.join(self.spool_dir, "received.log")
+        self._received = {}  # sha256 -> time it was stored
+        self._active = set()  # Hashes currently being received
+        self._lock = threading.Lock()
+        self._last_prune = 0.0
+        self._load_received()
+        self._prune()
+
+        self.stats = {"connections": 0, "stored": 0, "duplicates": 0,
+                      "resumed": 0, "corrupt": 0, "near_duplicates": 0, "keyframes": 0,
+                      "too_large": 0, "bytes": 0}
+        self._server = None
+        self._thread = None
+
+    def _load_received(self):
+        """Load the hashes of previously stored images"""
+        if not os.path.exists(self.received_log):
+            return
+        now = time.time()
+        with open(self.received_log, "r") as f:
+            for line in f:
+                fields = line.split()
+                if not fields:
+                    continue
+                # Logs written before hashes expired have no time; they age from now
+                try:
+                    self._received[fields[0]] = float(fields[1]) if len(fields) > 1 else now
+                except ValueError:
+                    self._received[fields[0]] = now
+        logger.info(f"Loaded {len(self._received)} received image hashes")
+
+    def _prune(self):
+        """Delete partial uploads nobody resumed and forget expired image hashes"""
+        now = time.time()
+        self._last_prune = now
+        with self._lock:
+            active = set(self._active)
+
+        cutoff = now - self.part_ttl_hours * 3600
+        for name in os.listdir(self.spool_dir):
+            path = os.path.join(self.spool_dir, name)
+            if not name.endswith(".part") or name.split(".")[0] in active:
+                continue
+            try:
+                if os.path.getmtime(path) < cutoff:
+                    os.remove(path)
+                    logger.info(f"Removed stale partial upload {name}")
+            except OSError:
+                pass
+
+        cutoff = now - self.received_ttl_hours * 3600
+        with self._lock:
+            kept = {sha256: received_at for sha256, received_at in self._received.items()
+                    if received_at >= cutoff}
+            if len(kept) == len(self._received):
+                return
+            # Rewritten under the lock so no hash logged meanwhile is lost
+            temp_path = f"{self.received_log}.tmp"
+            with open(temp_path, "w") as f:
+                for sha256, received_at in kept.items():
+                    f.write(f"{sha256} {received_at:.0f}\n")
+            os.replace(temp_path, self.received_log)
+            removed = len(self._received) - len(kept)
+            self._received = kept
+        logger.info(f"Forgot {removed} received image hashes older than {self.received_ttl_hours} hours")
+
+    def _part_path(self, sha256: str) -> str:
+        """Spool path of a partial upload"""
+        return os.path.join(self.spool_dir, f"{sha256}.part")
+
+    def start(self):
+        """Start listening in a background thread"""
+        self._server = _ThreadingServer((self.host, self.port), _ConnectionHandler)
+        self._server.ingest = self
+        self._thread = threading.Thread(target=self._server.serve_forever, name="stream-ingest")
+        self._thread.daemon = True
+        self._thread.start()
+        logger.info(f"Stream ingest listening on {self.host}:{self.port}")
+
+    def stop(self):
+        """Stop listening"""
+        if self._server:
+            self._server.shutdown()
+            self._server.server_close()
+            self._server = None
+        if self._thread:
+            self._thread.join(timeout=5)
+            self._thread = None
+
+    def get_stats(self) -> Dict:
+        """Ingest counters"""
+        with self._lock:
+            return dict(self.stats)
+
+    def _count(self, key: str, amount: int = 1):
+        with self._lock:
+            self.stats[key] += amount
+
+    def handle_connection(self, sock, stream, address):
+        """Serve one client connection until it disconnects"""
+        sock.settimeout(self.idle_timeout)
+        transfers = {}  # seq -> open transfer state
+        self._count("connections")
+        client = f"{address[0]}:{address[1]}"
+
+        try:
+            header, _ = recv_message(stream)
+            if header.get("type") != "hello":
+                raise ProtocolError("Expected hello")
+            if self.access_key and header.get("access_key") != self.access_key:
+                send_message(sock, {"type": "error", "message": "Unauthorized"})
+                logger.warning(f"Rejected stream client {client}: bad access key")
+                return
+            client = header.get("client") or client
+            if self.ready_check is not None and not self.ready_check():
+                send_message(sock, {"type": "not_ready", "retry_after": self.retry_after,
+                                    "message": "Model is warming up"})
+                logger.info(f"Asked stream client {client} to wait, model not ready")
+                return
+            send_message(sock, {"type": "welcome", "version": PROTOCOL_VERSION, "window": self.window})
+            logger.info(f"Stream client connected: {client}")
+
+            while True:
+                header, payload = recv_message(stream)
+                kind = header.get("type")
+                if kind == "offer":
+                    self._handle_offer(sock, transfers, header)
+                elif kind == "data":
+                    self._handle_data(sock, transfers, header, payload)
+                elif kind == "end":
+                    self._handle_end(sock, transfers, header, client)
+                else:
+                    raise ProtocolError(f"Unexpected message type: {kind}")
+
+        except EOFError:
+            logger.info(f"Stream client disconnected: {client}")
+        except Exception as e:
+            logger.warning(f"Stream connection from {client} closed: {str(e)}")
+        finally:
+            # Keep the .part files so the client can resume
+            for transfer in transfers.values():
+                transfer["file"].close()
+                with self._lock:
+                    self._active.discard(transfer["sha256"])
+
+    def _handle_offer(self, sock, transfers: Dict, header: Dict):
+        """Reply to an offer with the offset to send from, or mark it a duplicate"""
+        seq = header["seq"]
+        sha256 = str(header["sha256"]).lower()
+        if len(sha256) != 64 or any(c not in "0123456789abcdef" for c in sha256):
+            raise ProtocolError(f"Invalid sha256 for seq {seq}")
+
+        with self._lock:
+            if sha256 in self._received:
+                self.stats["duplicates"] += 1
+                status = "duplicate"
+            elif sha256 in self._active:
+                # Usually a half-open connection from before a reconnect
+                status = "busy"
+            else:
+                self._active.add(sha256)
+                status = "send"
+
+        if status != "send":
+            send_message(sock, {"type": "accept", "seq": seq, "status": status})
+            return
+
+        size = int(header["size_bytes"])
+        if size < 0 or size > self.max_image_size:
+            with self._lock:
+                self._active.discard(sha256)
+                self.stats["too_large"] += 1
+            logger.warning(f"Refused {header.get('name')}: {size} bytes is over the "
+                           f"{self.max_image_size} byte limit")
+            send_message(sock, {"type": "accept", "seq": seq, "status": "too_large"})
+            return
+
+        part_path = self._part_path(sha256)
+        part = open(part_path, "ab")
+        offset = part.tell()
+        if offset > size:
+            part.truncate(0)
+            offset = 0
+        if offset:
+            self._count("resumed")
+            logger.info(f"Resuming {header.get('name')} at byte {offset}/{size}")
+
+        transfers[seq] = {
+            "sha256": sha256,
+            "name": header.get("name") or f"{sha256}.jpg",
+            "size": size,
+            "metadata": header.get("metadata"),
+            "file": part,
+            "path": part_path
+        }
+        send_message(sock, {"type": "accept", "seq": seq, "status": "send", "offset": offset})
+
+    def _handle_data(self, sock, transfers: Dict, header: Dict, payload: bytes):
+        """Append a chunk to its partial upload"""
+        transfer = transfers.get(header["seq"])
+        if transfer is None:
+            raise ProtocolError(f"Data for unknown seq {header['seq']}")
+        if header["offset"] != transfer["file"].tell():
+            raise ProtocolError(f"Out of order data for seq {header['seq']}")
+        if header["offset"] + len(payload) > transfer["size"]:
+            raise ProtocolError(f"Data past the offered size for seq {header['seq']}")
+        transfer["file"].write(payload)
+        self._count("bytes", len(payload))
+
+    def _handle_end(self, sock, transfers: Dict, header: Dict, client: str):
+        """Verify a completed upload and move it into the input directory"""
+        seq = header["seq"]
+        transfer = transfers.pop(seq, None)
+        if transfer is None:
+            raise ProtocolError(f"End for unknown seq {seq}")
+
+        sha256 = transfer["sha256"]
+        try:
+            part = transfer["file"]
+            part.flush()
+            os.fsync(part.fileno())
+            part.close()
+
+            if os.path.getsize(transfer["path"]) != transfer["size"] or \
+                    _file_sha256(transfer["path"]) != sha256:
+                os.remove(transfer["path"])
+                self._count("corrupt")
+                logger.warning(f"Discarded corrupt upload {transfer['name']}")
+                send_message(sock, {"type": "done", "seq": seq, "status": "corrupt"})
+                return
+
+            # Clip keyframes are decoded once, here, and continue as JPEGs. The
+            # JPEG keeps a .part suffix until it is renamed into input_dir, so
+            # the directory monitor (watching input_dir recursively) skips it
+            name, image_path = transfer["name"], transfer["path"]
+            if is_keyframe(name):
+                image_path = transfer["path"][:-len(".part")] + ".jpg.part"
+                decoded = keyframe_to_jpeg(transfer["path"], image_path, decoder=self.keyframe_decoder)
+                os.remove(transfer["path"])
+                if decoded is None:
+                    if os.path.exists(image_path):
+                        os.remove(image_path)
+                    self._count("corrupt")
+                    logger.warning(f"Discarded undecodable keyframe {name}")
+                    send_message(sock, {"type": "done", "seq": seq, "status": "corrupt"})
+                    return
+                name = os.path.splitext(name)[0] + ".jpg"
+                self._count("keyframes")
+
+            metadata = dict(transfer["metadata"] or {})
+            visit = self._observe_visit(image_path, client)
+            if visit is not None:
+                visit, is_new = visit
+                if not is_new:
+                    # Same scene as the camera's last image: extend its visit only
+                    os.remove(image_path)
+                    self._mark_received(sha256, "near_duplicates")
+                    logger.info(f"Near-duplicate {name} added to visit {visit['key']} "
+                                f"({visit['frames']} images)")
+                    send_message(sock, {"type": "done", "seq": seq, "status": "duplicate",
+                                        "visit": visit["key"]})
+                    return
+                # The camera's own visit ID is kept alongside
+                metadata["visit"] = {"key": visit["key"], "source": visit["source"],
+                                     "phash": visit["phash"],
+                                     "camera_visit": (metadata.get("visit") or {}).get("id")}
+
+            # Arrival time, for the transfer and end-to-end spans
+            trace = metadata.get("trace")
+            metadata["trace"] = dict(trace if isinstance(trace, dict) else {}, received=time.time())
+
+            final_path = self._final_path(name, sha256)
+            with open(os.path.splitext(final_path)[0] + ".json", "w") as f:
+                json.dump(metadata, f, indent=2)
+
+            # Atomic rename; the directory monitor sees a finished file
+            os.replace(image_path, final_path)
+            self._mark_received(sha256, "stored")
+
+            logger.info(f"Received {os.path.basename(final_path)} ({transfer['size']} bytes)")
+            reply = {"type": "done", "seq": seq, "status": "stored"}
+            if visit is not None:
+                reply["visit"] = visit["key"]
+            send_message(sock, reply)
+
+        finally:
+            with self._lock:
+                self._active.discard(sha256)
+
+    def _mark_received(self, sha256: str, counter: str):
+        """Log a handled image hash so retries are acknowledged as duplicates"""
+        received_at = time.time()
+        with self._lock:
+            with open(self.received_log, "a") as f:
+                f.write(f"{sha256} {received_at:.0f}\n")
+            self._received[sha256] = received_at
+            self.stats[counter] += 1
+        if received_at - self._last_prune >= PRUNE_INTERVAL:
+            self._prune()
+
+    def _observe_visit(self, path: str, client: str) -> Optional[Tuple[Dict, bool]]:
+        """Hash a received image and assign it to a visit; None without a tracker"""
+        if self.visits is None:
+            return None
+        frame_hash = image_dhash(path)
+        if frame_hash is None:
+            logger.warning(f"Could not hash {path}, storing it without a visit")
+            return None
+        return self.visits.observe(frame_hash, source=client)
+
+    def _final_path(self, name: str, sha256: str) -> str:
+        """Path in the input directory, avoiding clobbering a different image"""
+        name = secure_filename(os.path.basename(name)) or f"{sha256}.jpg"
+        path = os.path.join(self.input_dir, name)
+        if os.path.exists(path):
+            base, ext = os.path.splitext(name)
+            path = os.path.join(self.input_dir, f"{base}_{sha256[:8]}{ext}")
+        return path
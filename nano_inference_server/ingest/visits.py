@@ -0,0 +1,141 @@
+"""
+Near-duplicate suppression for ingested images.
+Each image is reduced to a 64-bit difference hash (dHash) of its luminance;
+consecutive images from the same camera within a few bits of each other are
+one "visit". Only the first image of a visit is passed on to inference and
+storage, later ones just extend the visit record.
+"""
+import time
+import logging
+import threading
+import numpy as np
+from typing import Callable, Dict, Optional, Tuple
+import cv2
+
+# Set up logging
+logging.basicConfig(level=logging.INFO,
+                    format='%(asctime)s - %(name)s - %(levelname)s - %(message)s')
+logger = logging.getLogger(__name__)
+
+
+def dhash(gray: np.ndarray, hash_size: int = 8) -> int:
+    """
+    Compute the difference hash of a grayscale image
+
+    Args:
+        gray: Grayscale image (H, W)
+        hash_size: Hash is hash_size * hash_size bits
+
+    Returns:
+        The hash; each bit says whether a block is brighter than its left neighbour
+    """
+    small = cv2.resize(gray, (hash_size + 1, hash_size), interpolation=cv2.INTER_AREA)
+    bits = (small[:, 1:] > small[:, :-1]).ravel()
+    value = 0
+    for bit in bits:
+        value = (value << 1) | int(bit)
+    return value
+
+
+def image_dhash(image_path: str, hash_size: int = 8) -> Optional[int]:
+    """
+    Compute the difference hash of an image file
+
+    Args:
+        image_path: Path to the image file
+        hash_size: Hash is hash_size * hash_size bits
+
+    Returns:
+        The hash, or None if the image cannot be decoded
+    """
+    # JPEGs are decoded at 1/8 scale in the DCT domain
+    gray = cv2.imread(image_path, cv2.IMREAD_REDUCED_GRAYSCALE_8)
+    if gray is None:
+        return None
+    return dhash(gray, hash_size)
+
+
+def hamming_distance(a: int, b: int) -> int:
+    """Number of differing bits between two hashes"""
+    return bin(a ^ b).count("1")
+
+
+class VisitTracker:
+    """Groups consecutive near-duplicate images per camera into visits"""
+
+    def __init__(self, max_distance: int = 5, visit_gap: float = 30.0,
+                 max_visit_duration: float = 300.0,
+                 on_frame: Optional[Callable[[Dict, bool], None]] = None):
+        """
+        Initialize the tracker
+
+        Args:
+            max_distance: Maximum Hamming distance (of 64 bits) for a duplicate
+            visit_gap: Seconds without a matching image that end a visit
+            max_visit_duration: Visits are split after this many seconds so a
+                                long stay still produces fresh images
+            on_frame: Called with (visit, is_new) for every image, e.g. to
+                      persist the visit record
+        """
+        self.max_distance = max_distance
+        self.visit_gap = visit_gap
+        self.max_visit_duration = max_visit_duration
+        self.on_frame = on_frame
+
+        self._current: Dict[str, Dict] = {}  # source -> open visit
+        self._sequence = 0
+        self._lock = threading.Lock()
+        self.stats = {"visits": 0, "suppressed": 0}
+
+    def observe(self, frame_hash: int, source: str = "default",
+                timestamp: Optional[float] = None) -> Tuple[Dict, bool]:
+        """
+        Assign an image to its camera's current visit or start a new one
+
+        Args:
+            frame_hash: dHash of the image
+            source: Camera the image came from
+            timestamp: Arrival time (defaults to now)
+
+        Returns:
+            Tuple of (visit, is_new); only new visits should be processed
+        """
+        now = time.time() if timestamp is None else timestamp
+
+        with self._lock:
+            visit = self._current.get(source)
+            is_new = (visit is None
+                      or now - visit["last_seen"] > self.visit_gap
+                      or now - visit["started_at"] > self.max_visit_duration
+                      or hamming_distance(frame_hash, visit["last_hash"]) > self.max_distance)
+
+            if is_new:
+                self._sequence += 1
+                visit = {
+                    "key": f"{source}-{int(now)}-{self._sequence}",
+                    "source": source,
+                    "phash": f"{frame_hash:016x}",
+                    "started_at": now,
+                    "frames": 0
+                }
+                self._current[source] = visit
+                self.stats["visits"] += 1
+            else:
+                self.stats["suppressed"] += 1
+
+            visit["last_hash"] = frame_hash
+            visit["last_seen"] = now
+            visit["frames"] += 1
+            snapshot = dict(visit)
+
+        if self.on_frame is not None:
+            try:
+                self.on_frame(snapshot, is_new)
+            except Exception as e:
+                logger.error(f"Error recording visit {snapshot['key']}: {str(e)}")
+        return snapshot, is_new
+
+    def get_stats(self) -> Dict:
+        """Visit and suppression counters"""
+        with self._lock:
+            return dict(self.stats)
@@ -6,8 +6,11 @@ This file provides a safe entry point that handles ARM-specific issues.
 
 import os
 import sys
+import time
 import logging
+import shlex
 import argparse
+import threading
 from pathlib import Path
 
 # Configure logging
@@ -17,15 +20,36 @@ logging.basicConfig(
 )
 logger = logging.getLogger('jetson_server')
 
-def parse_args():
-    """Parse command line arguments"""
+# Models searched for when --model is not given, fastest-starting first
+MODEL_SEARCH_PATHS = [
+    "./common/models/bird_model.onnx",
+    "../common/models/bird_model.onnx",
+    "./common/models/bird_mobilenet_v5data.keras",
+    "../common/models/bird_mobilenet_v5data.keras",
+    os.path.expanduser("~/projects/backyard_bird_cam/common/models/bird_model.onnx"),
+]
+
+def parse_args(argv=None):
+    """Parse command line arguments (argv defaults to sys.argv)"""
     parser = argparse.ArgumentParser(description='Jetson Nano Inference Server')
     parser.add_argument('--dev-mode', action='store_true', help='Run in development mode with mock data')
     parser.add_argument('--host', type=str, default='0.0.0.0', help='Host to listen on')
     parser.add_argument('--port', type=int, default=5000, help='Port to listen on')
-    parser.add_argument('--model', type=str, help='Path to Keras model file')
+    parser.add_argument('--model', type=str, help='Path to the model file (.onnx or .keras)')
+    parser.add_argument('--precision', choices=['fp32', 'fp16', 'int8'], default='fp16',
+                        help='Inference precision for ONNX models (default: fp16)')
+    parser.add_argument('--engine-cache-dir', type=str, default=None,
+                        help='Directory for cached TensorRT engines')
+    parser.add_argument('--batch-size', type=int, default=8,
+                        help='Maximum images per forward pass (default: 8)')
+    parser.add_argument('--batch-wait-ms', type=float, default=10.0,
+                        help='How long to wait for concurrent requests to fill a batch (default: 10)')
+    parser.add_argument('--queue-size', type=int, default=32,
+                        help='Queued images before requests are rejected with 429 (default: 32)')
+    parser.add_argument('--request-timeout-ms', type=float, default=10000.0,
+                        help='Per-request inference deadline (default: 10000)')
     parser.add_argument('--verbose', action='store_true', help='Enable verbose logging')
-    return parser.parse_args()
+    return parser.parse_args(argv)
 
 def setup_environment(args):
     """Set up environment variables and paths"""
@@ -45,104 +69,194 @@ def setup_environment(args):
     logger.info(f"Python version: {sys.version}")
     logger.info(f"Python path: {sys.path}")
 
-def main():
-    """Main entry point for the Jetson inference server"""
-    args = parse_args()
-    setup_environment(args)
+def find_model(args):
+    """Return the model path from the command line or the first one found"""
+    if args.model:
+        return args.model
+    for path in MODEL_SEARCH_PATHS:
+        if os.path.exists(path):
+            return path
+    return None
+
+def load_model(args, state):
+    """Load and warm up the model, recording progress in state for /health"""
+    from inference.model import ModelHandler
+    from inference.executor import InferenceExecutor
+    from monitoring.metrics import observe_stage
     
     try:
-        # Import the compatibility layer to handle architecture issues
-        import jetson_compatibility
-        jetson_compatibility.initialize_dev_mode()
+        model_path = find_model(args)
+        if not args.dev_mode and (not model_path or not os.path.exists(model_path)):
+            raise FileNotFoundError("No model file found")
         
-        # Import Flask components for the web API
-        from flask import Flask, request, jsonify
-        from flask_cors import CORS
+        model_type = "keras" if model_path and model_path.endswith(".keras") else "onnx"
+        logger.info(f"Loading {model_type} model from: {model_path}")
+        model = ModelHandler(
+            model_path=model_path or "",
+            model_type=model_type,
+            device="cpu" if args.dev_mode else "cuda",
+            precision=args.precision,
+            development_mode=args.dev_mode,
+            engine_cache_dir=args.engine_cache_dir
+        )
+        model.span_observer = observe_stage
+        model.warmup(batch_sizes=(1, args.batch_size))
         
-        # Create the Flask application
-        app = Flask(__name__)
-        CORS(app)
+        # Request threads share one executor, the only caller of the model
+        state["model"] = InferenceExecutor(
+            model,
+            max_batch_size=args.batch_size,
+            max_batch_wait_ms=args.batch_wait_ms,
+            max_queue_size=args.queue_size,
+            span_observer=observe_stage
+        )
+        state["status"] = "ready"
+        logger.info("Model ready")
+    except Exception as e:
+        # No silent mock fallback: /health reports the failure instead
+        logger.error(f"Error setting up inference engine: {e}")
+        state["status"] = "failed"
+        state["error"] = str(e)
+
+def request_timeout(args, request):
+    """Deadline in seconds; X-Request-Timeout-Ms may shorten the default"""
+    timeout_ms = args.request_timeout_ms
+    header = request.headers.get("X-Request-Timeout-Ms")
+    if header:
+        try:
+            timeout_ms = min(timeout_ms, max(1.0, float(header)))
+        except ValueError:
+            pass
+    return timeout_ms / 1000.0
+
+def create_app(argv=None):
+    """
+    Create the Flask application and start loading the model
+    
+    Used directly by gunicorn with one process and several threads, so every
+    request thread shares the one model and GPU context:
+        gunicorn -k gthread -w 1 --threads 8 -b 0.0.0.0:5000 'jetson_server:create_app()'
+    Server options then come from the JETSON_SERVER_ARGS environment variable.
+    
+    Args:
+        argv: Command line arguments (None reads JETSON_SERVER_ARGS)
+    """
+    if argv is None:
+        argv = shlex.split(os.environ.get("JETSON_SERVER_ARGS", ""))
+    args = parse_args(argv)
+    setup_environment(args)
+    
+    # Import Flask components for the web API
+    from flask import Flask, Response, request, jsonify
+    from flask_cors import CORS
+    import numpy as np
+    import cv2
+    from inference.executor import QueueFullError, DeadlineExceededError
+    from monitoring.metrics import (REGISTRY, PROMETHEUS_CONTENT_TYPE, observe_stage,
+                                    count_event)
+    
+    # Create the Flask application
+    app = Flask(__name__)
+    CORS(app)
+    app.config["SERVER_ARGS"] = args
+    
+    # Load the model in the background so /health answers immediately
+    state = {"status": "starting", "model": None, "error": None, "started_at": time.time()}
+    loader = threading.Thread(target=load_model, args=(args, state), name="model-loader")
+    loader.daemon = True
+    loader.start()
+    
+    # Executor queue state, read when /metrics is scraped
+    def executor_stats():
+        if state["model"] is None:
+            return {}
+        stats = state["model"].get_batch_stats()["executor"]
+        return {(("stat", key),): stats[key]
+                for key in ("queue_depth", "max_queue_depth", "shed", "expired", "errors")}
+    REGISTRY.gauge("birdserver_executor", "Inference executor queue depth and counters",
+                   executor_stats)
+    
+    # Define API routes
+    @app.route('/metrics', methods=['GET'])
+    def metrics():
+        return Response(REGISTRY.render(), content_type=PROMETHEUS_CONTENT_TYPE)
+    
+    @app.route('/health', methods=['GET'])
+    def health_check():
+        model = state["model"]
+        ready = state["status"] == "ready"
+        health = {
+            "status": state["status"],
+            "ready": ready,
+            "mode": "development" if args.dev_mode else "production",
+            "uptime_s": round(time.time() - state["started_at"], 1)
+        }
+        if state["error"]:
+            health["error"] = state["error"]
+        if model is not None and model.warmup_time is not None:
+            health["warmup_s"] = round(model.warmup_time, 2)
+        if ready:
+            return jsonify(health)
+        return jsonify(health), 503, {"Retry-After": "5"}
+    
+    @app.route('/detect', methods=['POST'])
+    def detect_birds():
+        if state["status"] != "ready":
+            return jsonify({"error": f"Model {state['status']}"}), 503, {"Retry-After": "5"}
         
-        # Set up inference engine
-        if args.dev_mode:
-            logger.info("Running in development mode with mock inference")
-            inference_engine = jetson_compatibility.get_mock_inference_engine()
-        else:
-            # Try to import TensorFlow safely
-            tf = jetson_compatibility.safe_import_tensorflow()
+        if 'image' not in request.files:
+            return jsonify({"error": "No image provided"}), 400
             
-            if tf is None:
-                logger.warning("TensorFlow unavailable, falling back to mock inference")
-                inference_engine = jetson_compatibility.get_mock_inference_engine()
-            else:
-                try:
-                    # Find the original main.py to import its components
-                    sys.path.insert(0, str(Path(__file__).resolve().parent))
-                    from inference.inference_engine import InferenceEngine
-                    
-                    model_path = args.model
-                    if not model_path:
-                        # Look for model in common locations
-                        for path in [
-                            "./common/models/bird_mobilenet_v5data.keras",
-                            "../common/models/bird_mobilenet_v5data.keras",
-                            os.path.expanduser("~/projects/backyard_bird_cam/common/models/bird_mobilenet_v5data.keras")
-                        ]:
-                            if os.path.exists(path):
-                                model_path = path
-                                break
-                    
-                    if not model_path or not os.path.exists(model_path):
-                        logger.warning("No model file found, falling back to mock inference")
-                        inference_engine = jetson_compatibility.get_mock_inference_engine()
-                    else:
-                        logger.info(f"Loading model from: {model_path}")
-                        inference_engine = InferenceEngine(model_path)
-                        
-                except Exception as e:
-                    logger.error(f"Error setting up real inference engine: {e}")
-                    logger.info("Falling back to mock inference engine")
-                    inference_engine = jetson_compatibility.get_mock_inference_engine()
-        
-        # Define API routes
-        @app.route('/health', methods=['GET'])
-        def health_check():
-            return jsonify({"status": "healthy", "mode": "development" if args.dev_mode else "production"})
-        
-        @app.route('/detect', methods=['POST'])
-        def detect_birds():
-            # This is a placeholder - in the real implementation,
-            # we would process the uploaded image and run inference
-            if 'image' not in request.files:
-                return jsonify({"error": "No image provided"}), 400
-                
-            image_file = request.files['image']
-            if image_file.filename == '':
-                return jsonify({"error": "Empty image file"}), 400
-                
-            try:
-                # Import image processing on-demand to avoid import errors
-                from PIL import Image
-                import numpy as np
-                
-                # Process the image
-                img = Image.open(image_file.stream)
-                
-                # Run inference
-                result = inference_engine.predict(img)
-                
-                return jsonify(result)
-            except Exception as e:
-                logger.error(f"Error in bird detection: {e}")
-                return jsonify({"error": str(e)}), 500
+        image_file = request.files['image']
+        if image_file.filename == '':
+            return jsonify({"error": "Empty image file"}), 400
+            
+        try:
+            # Decode on the request thread; only inference is serialized
+            decode_start = time.time()
+            data = np.frombuffer(image_file.read(), dtype=np.uint8)
+            frame = cv2.imdecode(data, cv2.IMREAD_COLOR)
+            if frame is None:
+                return jsonify({"error": "Could not decode image"}), 400
+            observe_stage("decode", time.time() - decode_start)
+            
+            # Run inference
+            start_time = time.time()
+            detections = state["model"].detect(frame, timeout=request_timeout(args, request))
+            observe_stage("request_total", time.time() - decode_start)
+            count_event("processed")
+            
+            return jsonify({
+                "detections": detections,
+                "bird_detected": len(detections) > 0,
+                "processing_time": time.time() - start_time
+            })
+        except QueueFullError:
+            count_event("shed")
+            return jsonify({"error": "Server busy, retry later"}), 429, {"Retry-After": "1"}
+        except DeadlineExceededError:
+            count_event("expired")
+            return jsonify({"error": "Inference deadline exceeded"}), 504
+        except Exception as e:
+            logger.error(f"Error in bird detection: {e}")
+            return jsonify({"error": str(e)}), 500
+    
+    return app
+
+def main():
+    """Main entry point for the Jetson inference server"""
+    try:
+        app = create_app(sys.argv[1:])
+        args = app.config["SERVER_ARGS"]
         
-        # Start the server
+        # Start the server; each request runs on its own thread
         logger.info(f"Starting server on {args.host}:{args.port}")
-        app.run(host=args.host, port=args.port, debug=args.dev_mode)
+        app.run(host=args.host, port=args.port, debug=args.dev_mode,
+                use_reloader=False, threaded=True)
         
     except Exception as e:
         logger.error(f"Fatal error: {e}")
         sys.exit(1)
 
 if __name__ == "__main__":
-    main() 
\ No newline at end of file
+    main()
@@ -25,9 +25,15 @@ sys.path.insert(0, parent_dir)
 
 # Import modules from this package
 from inference.model import ModelHandler
+from inference.two_stage import TwoStageDetector
+from inference.executor import InferenceExecutor
 from monitoring.directory_monitor import DirectoryMonitor
 from storage.result_storage import ResultStorage
+from storage.thumbnail_cache import ThumbnailCache
+from ingest.stream_server import StreamIngestServer
+from ingest.visits import VisitTracker
 from api.server import APIServer
+from monitoring.metrics import REGISTRY, observe_stage, count_event, new_trace_id
 
 # Optional cloudflared import
 try:
@@ -51,6 +57,15 @@ def signal_handler(sig, frame):
     shutdown_requested = True
 
 
+def wait_for_shutdown():
+    """Block until a signal or Ctrl+C asks the server to stop"""
+    try:
+        while not shutdown_requested:
+            time.sleep(1)
+    except KeyboardInterrupt:
+        logger.info("Interrupted by user")
+
+
 def load_config(config_path: str) -> Dict[str, Any]:
     """Load configuration from a JSON file"""
     if not os.path.exists(config_path):
@@ -67,21 +82,88 @@ def load_config(config_path: str) -> Dict[str, Any]:
         sys.exit(1)
 
 
-def process_image(model, storage, image_path):
+def queue_thumbnails(thumbnails, result):
+    """Pre-generate gallery/details thumbnails for a stored result in the background"""
+    if thumbnails is None or not result or not result.get("image_path"):
+        return
+    thumbnails.generate_async(result["image_path"])
+
+
+def ingest_metadata(image_path):
+    """
+    Read the metadata the stream ingest server wrote next to an image
+    
+    Args:
+        image_path: Path to the image in the input directory
+        
+    Returns:
+        Metadata fields to store with the result: the visit, if any, and the
+        trace (a new one for images that did not come from a camera)
+    """
+    fields = {"trace": {"id": new_trace_id()}}
+    sidecar_path = os.path.splitext(image_path)[0] + ".json"
+    if not os.path.exists(sidecar_path):
+        return fields
+    try:
+        with open(sidecar_path, "r") as f:
+            sidecar = json.load(f)
+    except Exception as e:
+        logger.warning(f"Could not read metadata for {image_path}: {e}")
+        return fields
+    if sidecar.get("visit"):
+        fields["visit"] = sidecar["visit"]
+    if isinstance(sidecar.get("trace"), dict):
+        fields["trace"] = dict(sidecar["trace"])
+        fields["trace"].setdefault("id", new_trace_id())
+    return fields
+
+
+def record_wait_spans(trace, started_at):
+    """
+    Record how long an image took to reach the Nano and to be picked up
+    
+    Args:
+        trace: Trace from ingest_metadata(); gains the processing start time
+        started_at: Time inference started
+    """
+    trace["processing_started"] = started_at
+    received = trace.get("received")
+    if received is None:
+        return
+    if trace.get("stored") is not None:
+        observe_stage("transfer", received - trace["stored"])
+    observe_stage("monitor_wait", started_at - received)
+
+
+def record_saved_spans(trace, save_started):
+    """
+    Record the storage span and the end-to-end latency of a stored result
+    
+    Args:
+        trace: Trace of the image
+        save_started: Time save_result() was called
+    """
+    saved_at = time.time()
+    observe_stage("storage", saved_at - save_started)
+    origin = trace.get("pir_edge") or trace.get("captured") or trace.get("received")
+    if origin is not None:
+        observe_stage("end_to_end", saved_at - origin)
+    count_event("processed")
+
+
+def process_image(model, storage, image_path, thumbnails=None):
     """Process a single image with the model and store the results"""
     try:
         logger.info(f"Processing image: {image_path}")
         
-        # Run inference
+        # Run inference; the monitor waits for queue space, only API requests are shed
         start_time = time.time()
-        detections = model.detect(image_path)
+        detections = model.detect(image_path, block=True)
         processing_time = time.time() - start_time
         
-        # Generate annotated image if birds were detected
-        annotated_path = None
+        # Only the boxes are stored; the API renders overlays when viewed
         if detections:
             logger.info(f"Found {len(detections)} detections")
-            annotated_path = model.annotate_image(image_path, detections)
         else:
             logger.info("No birds detected")
         
@@ -90,21 +172,149 @@ def process_image(model, storage, image_path):
             "source": "directory_monitor",
             "original_path": image_path
         }
+        metadata.update(ingest_metadata(image_path))
+        record_wait_spans(metadata["trace"], start_time)
         
+        save_started = time.time()
         result = storage.save_result(
             image_path=image_path,
             detections=detections,
-            annotated_path=annotated_path,
             metadata=metadata,
             processing_time=processing_time
         )
+        record_saved_spans(metadata["trace"], save_started)
+        
+        queue_thumbnails(thumbnails, result)
         
         logger.info(f"Processed and saved results for {image_path}")
         return result
     
     except Exception as e:
+        # Raised so the monitor leaves the image for a retry
         logger.error(f"Error processing image {image_path}: {e}")
-        return None
+        count_event("failed")
+        raise
+
+
+def process_batch(model, storage, image_paths, thumbnails=None):
+    """Process a micro-batch of images in one forward pass and store the results"""
+    try:
+        logger.info(f"Processing batch of {len(image_paths)} images")
+        
+        # Run batched inference
+        start_time = time.time()
+        batch_detections = model.detect_batch(image_paths)
+        batch_time = time.time() - start_time
+        
+        # Attribute an equal share of the batch time to each image
+        processing_time = batch_time / len(image_paths)
+        
+        results = []
+        for image_path, detections in zip(image_paths, batch_detections):
+            if detections:
+                logger.info(f"Found {len(detections)} detections in {image_path}")
+            
+            metadata = {
+                "source": "directory_monitor",
+                "original_path": image_path,
+                "batch_size": len(image_paths)
+            }
+            metadata.update(ingest_metadata(image_path))
+            record_wait_spans(metadata["trace"], start_time)
+            
+            save_started = time.time()
+            result = storage.save_result(
+                image_path=image_path,
+                detections=detections,
+                metadata=metadata,
+                processing_time=processing_time
+            )
+            record_saved_spans(metadata["trace"], save_started)
+            queue_thumbnails(thumbnails, result)
+            results.append(result)
+        
+        logger.info(f"Processed and saved results for batch of {len(image_paths)} images "
+                    f"in {batch_time:.2f} seconds")
+        return results
+    
+    except Exception as e:
+        # Raised so the monitor leaves the images for a retry
+        logger.error(f"Error processing batch: {e}")
+        count_event("failed", len(image_paths))
+        raise
+
+
+def register_gauges(executor, ingest_server=None):
+    """Expose executor and ingest state on /metrics, read at scrape time"""
+    def executor_stats():
+        stats = executor.get_batch_stats()["executor"]
+        return {(("stat", key),): stats[key]
+                for key in ("queue_depth", "max_queue_depth", "shed", "expired", "errors")}
+    
+    REGISTRY.gauge("birdserver_executor", "Inference executor queue depth and counters",
+                   executor_stats)
+    if ingest_server is not None:
+        REGISTRY.gauge("birdserver_ingest", "Stream ingest counters",
+                       lambda: {(("stat", key),): value
+                                for key, value in ingest_server.get_stats().items()})
+
+
+def load_model(config, development=False):
+    """
+    Load the detection model (and optional species classifier) and warm it up
+    
+    Args:
+        config: Server configuration
+        development: Use mock detections instead of loading a model
+        
+    Returns:
+        Warm ModelHandler, or TwoStageDetector when a species classifier is configured
+    """
+    start_time = time.time()
+    logger.info(f"Loading model from {config['model_path']}")
+    model = ModelHandler(
+        model_path=config["model_path"],
+        confidence_threshold=config.get("confidence_threshold", 0.5),
+        model_type=config["model_type"],
+        device=config["device"],
+        nms_threshold=config.get("nms_threshold", 0.45),
+        precision=config.get("precision", "fp32"),
+        development_mode=development,
+        engine_cache_dir=config.get("engine_cache_dir"),
+        input_mean=config.get("input_mean"),
+        input_std=config.get("input_std")
+    )
+    model.span_observer = observe_stage
+    
+    # Optional second stage: classify the species of each detected bird crop
+    classifier_config = config.get("species_classifier", {})
+    if classifier_config.get("model_path"):
+        logger.info(f"Loading species classifier from {classifier_config['model_path']}")
+        classifier = ModelHandler(
+            model_path=classifier_config["model_path"],
+            model_type=classifier_config.get("model_type", "onnx"),
+            device=config["device"],
+            precision=classifier_config.get("precision", config.get("precision", "fp32")),
+            development_mode=development,
+            engine_cache_dir=config.get("engine_cache_dir"),
+            input_mean=classifier_config.get("input_mean"),
+            input_std=classifier_config.get("input_std")
+        )
+        classifier.span_observer = lambda stage, seconds: observe_stage(f"classifier_{stage}", seconds)
+        model = TwoStageDetector(
+            detector=model,
+            classifier=classifier,
+            crop_padding=classifier_config.get("crop_padding", 0.1),
+            min_crop_size=classifier_config.get("min_crop_size", 16),
+            species_threshold=classifier_config.get("confidence_threshold", 0.3)
+        )
+    
+    # Build/load engines and run the first inferences now, not on the first image;
+    # the monitor batches up to batch_size images, so warm that shape too
+    model.warmup(batch_sizes=(1, config.get("batch_size", 8)),
+                 runs=config.get("warmup_runs", 2))
+    logger.info(f"Model ready {time.time() - start_time:.2f} seconds after start of loading")
+    return model
 
 
 def main():
@@ -119,7 +329,7 @@ def main():
                        help="Directory to store results")
     parser.add_argument("--model", "-m", type=str,
                        help="Path to the detection model")
-    parser.add_argument("--model-type", "-t", choices=["mobilenet", "yolo"],
+    parser.add_argument("--model-type", "-t", choices=["mobilenet", "yolo", "keras", "onnx", "tensorrt"],
                        help="Type of detection model")
     parser.add_argument("--device", "-d", choices=["cuda", "cpu"],
                        help="Device to run inference on")
@@ -127,6 +337,10 @@ def main():
                        help="Port for the API server")
     parser.add_argument("--development", action="store_true",
                        help="Run in development mode (without CUDA) for testing")
+    parser.add_argument("--process-existing", "-e", action="store_true",
+                       help="Process existing files in the input directory (skips files already processed)")
+    parser.add_argument("--no-server", action="store_true",
+                       help="Don't start the web server")
     
     args = parser.parse_args()
     
@@ -152,16 +366,16 @@ def main():
         logger.info("Running in development mode - using CPU for inference")
         config["device"] = "cpu"
     
-    # Set up components
+    # Set up components. The API server and stream ingest come up first so
+    # /health answers (503 "starting") while the model loads and warms up.
     try:
-        # Initialize model
-        logger.info(f"Loading model from {config['model_path']}")
-        model = ModelHandler(
-            model_path=config["model_path"],
-            confidence_threshold=config.get("confidence_threshold", 0.5),
-            model_type=config["model_type"],
-            device=config["device"],
-            development_mode=args.development
+        # Thumbnails are shared by the processing path (pre-generation), the API
+        # server and retention, which deletes them with their results
+        thumbnails = ThumbnailCache(
+            cache_dir=os.path.join(config["output_dir"], "thumbnails"),
+            sizes=config.get("thumbnail_sizes", [320, 960]),
+            image_format=config.get("thumbnail_format", "jpg"),
+            max_size_mb=config.get("thumbnail_cache_mb", 512)
         )
         
         # Initialize storage
@@ -169,25 +383,54 @@ def main():
         storage = ResultStorage(
             base_dir=config["output_dir"],
             max_results=config.get("max_results", 1000),
-            organize_by_date=config.get("organize_by_date", True)
-        )
-        
-        # Initialize directory monitor
-        logger.info(f"Setting up directory monitor for {config['input_dir']}")
-        monitor = DirectoryMonitor(
-            input_dir=config["input_dir"],
-            storage=storage,
-            model=model,
-            file_patterns=config.get("file_patterns", [".*\.(jpg|jpeg|png)$"])
+            organize_by_date=config.get("organize_by_date", True),
+            reader_connections=config.get("db_reader_connections", 4),
+            max_storage_gb=config.get("max_storage_gb"),
+            retention_interval=config.get("retention_interval_s", 300),
+            thumbnails=thumbnails
         )
         
-        # Initialize API server (if enabled)
+        # Initialize API server (if enabled); the model is attached once warm
+        server = None
         if not args.no_server:
             logger.info("Setting up API server")
             server = APIServer(
                 storage=storage,
-                model=model,
-                config=config
+                model=None,
+                config=config,
+                thumbnails=thumbnails,
+                metrics=REGISTRY
+            )
+        
+        # Streamed uploads from the Pi land in the monitored input directory.
+        # Cameras are asked to hold their photos until the model is warm.
+        model = None
+        ingest_server = None
+        ingest_config = config.get("stream_ingest", {})
+        if ingest_config.get("enabled", False):
+            # Near-identical images from a camera are collapsed into one visit
+            visits = None
+            dedup_config = ingest_config.get("dedup", {})
+            if dedup_config.get("enabled", True):
+                visits = VisitTracker(
+                    max_distance=dedup_config.get("max_distance", 5),
+                    visit_gap=dedup_config.get("visit_gap_s", 30.0),
+                    max_visit_duration=dedup_config.get("max_visit_duration_s", 300.0),
+                    on_frame=lambda visit, is_new: storage.record_visit_frame(visit)
+                )
+            
+            logger.info("Setting up stream ingest server")
+            ingest_server = StreamIngestServer(
+                input_dir=config["input_dir"],
+                host=config.get("host", "0.0.0.0"),
+                port=ingest_config.get("port", 5001),
+                access_key=config.get("access_key"),
+                window=ingest_config.get("window", 4),
+                ready_check=lambda: model is not None and model.ready,
+                visits=visits,
+                keyframe_decoder=ingest_config.get("keyframe_decoder", "auto"),
+                max_image_size=int(ingest_config.get("max_image_mb", 64) * 1024 * 1024),
+                received_ttl_hours=ingest_config.get("received_ttl_hours", 168)
             )
         
         # Setup cloudflared if enabled
@@ -199,12 +442,11 @@ def main():
                 port=config.get("port", 5000)
             )
         
-        # Start the directory monitor
-        logger.info("Starting directory monitor")
-        monitor.start()
+        if ingest_server:
+            ingest_server.start()
         
         # Start the API server in a separate thread (if enabled)
-        if not args.no_server:
+        if server:
             logger.info(f"Starting API server on port {config['port']}")
             server_thread = threading.Thread(
                 target=server.run,
@@ -215,17 +457,60 @@ def main():
             server_thread.daemon = True
             server_thread.start()
         
+        # Load and warm up the model
+        try:
+            model = load_model(config, args.development)
+        except Exception as e:
+            logger.error(f"Failed to load model: {e}")
+            if ingest_server:
+                ingest_server.stop()
+            if server:
+                # Keep reporting the failure on /health until stopped
+                server.set_model(None, status="failed", error=str(e))
+                logger.info("Model unavailable; serving /health until stopped. Press Ctrl+C to exit.")
+                wait_for_shutdown()
+            thumbnails.close()
+            storage.close()
+            return 1
+        
+        # The monitor and API requests share one executor, the only caller of the model
+        executor = InferenceExecutor(
+            model,
+            max_batch_size=config.get("batch_size", 8),
+            max_batch_wait_ms=config.get("inference_batch_wait_ms", 10),
+            max_queue_size=config.get("inference_queue_size", 32),
+            span_observer=observe_stage
+        )
+        if server:
+            server.set_model(executor)
+        register_gauges(executor, ingest_server)
+        
+        # Initialize and start the directory monitor
+        logger.info(f"Setting up directory monitor for {config['input_dir']}")
+        monitor = DirectoryMonitor(
+            input_dir=config["input_dir"],
+            callback=lambda path: process_image(executor, storage, path, thumbnails),
+            file_patterns=config.get("file_patterns", [".*\.(jpg|jpeg|png)$"]),
+            process_existing=args.process_existing,
+            batch_callback=lambda paths: process_batch(executor, storage, paths, thumbnails),
+            max_batch_size=config.get("batch_size", 8),
+            max_batch_wait_ms=config.get("batch_timeout_ms", 50)
+        )
+        logger.info("Starting directory monitor")
+        monitor.start()
+        
         # Main loop
         logger.info("Nano Inference Server is running. Press Ctrl+C to exit.")
-        try:
-            while not shutdown_requested:
-                time.sleep(1)
-        except KeyboardInterrupt:
-            logger.info("Interrupted by user")
+        wait_for_shutdown()
         
         # Shutdown
         logger.info("Shutting down...")
+        if ingest_server:
+            ingest_server.stop()
         monitor.stop()
+        executor.stop()
+        thumbnails.close()
+        storage.close()
         logger.info("Shutdown complete")
         
     except Exception as e:
@@ -1,6 +1,7 @@
 """
 Directory monitor for watching input directories and processing new images.
-Uses watchdog to monitor filesystem events.
+Uses inotify close-write/moved-to events on Linux (watchdog elsewhere) and a
+persisted watermark so restarts skip files that were already processed.
 """
 import os
 import time
@@ -8,11 +9,18 @@ import logging
 import threading
 from typing import Callable, List, Optional
 from pathlib import Path
-from queue import Queue
+from queue import Queue, Empty
 import re
 
-from watchdog.observers import Observer
-from watchdog.events import FileSystemEventHandler, FileCreatedEvent
+try:
+    from watchdog.observers import Observer
+    from watchdog.events import FileSystemEventHandler
+except ImportError:
+    Observer = None
+    FileSystemEventHandler = object
+
+from .inotify_watcher import InotifyWatcher, inotify_available
+from .watermark import ProcessedWatermark
 
 # Set up logging
 logging.basicConfig(level=logging.INFO, 
@@ -21,7 +29,7 @@ logger = logging.getLogger(__name__)
 
 
 class ImageFileEventHandler(FileSystemEventHandler):
-    """Watches for image files created in the monitored directory"""
+    """Watches for image files created in the monitored directory (watchdog fallback without inotify)"""
     
     def __init__(self, 
                 callback: Callable[[str], None], 
@@ -44,22 +52,30 @@ class ImageFileEventHandler(FileSystemEventHandler):
     def on_created(self, event):
         """Called when a file is created"""
         if not event.is_directory:
-            file_path = event.src_path
+            # Add a small delay to ensure the file is fully written
+            self._handle_file(event.src_path, settle_delay=0.5)
+    
+    def on_moved(self, event):
+        """Called when a file is renamed, e.g. a completed upload moved into place"""
+        if not event.is_directory:
+            # Renames are atomic, the file is already complete
+            self._handle_file(event.dest_path)
+    
+    def _handle_file(self, file_path: str, settle_delay: float = 0.0):
+        """Queue or process a new file if it matches our patterns"""
+        if any(regex.match(file_path) for regex in self.file_regex):
+            logger.info(f"New image detected: {file_path}")
             
-            # Check if the file matches our patterns
-            if any(regex.match(file_path) for regex in self.file_regex):
-                logger.info(f"New image detected: {file_path}")
-                
-                # Add a small delay to ensure the file is fully written
-                time.sleep(0.5)
-                
-                if self.queue:
-                    # Add to queue for async processing
-                    self.queue.put(file_path)
-                    logger.debug(f"Added {file_path} to processing queue")
-                else:
-                    # Process synchronously
-                    self.callback(file_path)
+            if settle_delay:
+                time.sleep(settle_delay)
+            
+            if self.queue:
+                # Add to queue for async processing
+                self.queue.put(file_path)
+                logger.debug(f"Added {file_path} to processing queue")
+            else:
+                # Process synchronously
+                self.callback(file_path)
 
 
 class DirectoryMonitor:
@@ -70,34 +86,74 @@ class DirectoryMonitor:
                 callback: Callable[[str], None],
                 file_patterns: List[str] = None,
                 use_queue: bool = True,
-                process_existing: bool = False):
+                process_existing: bool = False,
+                batch_callback: Optional[Callable[[List[str]], None]] = None,
+                max_batch_size: int = 1,
+                max_batch_wait_ms: float = 50.0,
+                state_path: Optional[str] = None,
+                use_inotify: bool = True):
         """
         Initialize the directory monitor.
         
         Args:
             input_dir: Directory to monitor for new images
-            callback: Function to call when a new image is detected
+            callback: Function to call when a new image is detected; it raises
+                      to leave the image for a retry
             file_patterns: List of file patterns to match
             use_queue: Whether to use a queue for async processing
             process_existing: Whether to process existing files in the directory
+            batch_callback: Function to call with a list of queued images (micro-batching);
+                            it raises to leave the images for a retry
+            max_batch_size: Maximum number of images passed to batch_callback at once
+            max_batch_wait_ms: Maximum time to wait for a batch to fill after the first image
+            state_path: File the processed watermark is saved to
+                        (defaults to .monitor_state.json in input_dir)
+            use_inotify: Use inotify events when available instead of watchdog
         """
         self.input_dir = os.path.abspath(input_dir)
         self.callback = callback
         self.file_patterns = file_patterns or [r".*\.(jpg|jpeg|png)$"]
         self.use_queue = use_queue
         self.process_existing = process_existing
+        self.batch_callback = batch_callback
+        self.max_batch_size = max(1, max_batch_size)
+        self.max_batch_wait = max_batch_wait_ms / 1000.0
+        
+        # Batch statistics reported by get_stats()
+        self.stats = {
+            "batches": 0,
+            "files": 0,
+            "total_latency": 0.0,
+            "max_latency": 0.0,
+            "max_batch_size": 0
+        }
+        
+        self.file_regex = [re.compile(pattern, re.IGNORECASE) for pattern in self.file_patterns]
         
         # Create the queue if needed
         self.queue = Queue() if use_queue else None
         
-        # Create the observer and event handler
-        self.observer = Observer()
-        self.event_handler = ImageFileEventHandler(
-            callback=self._process_file,
-            file_patterns=self.file_patterns,
-            queue=self.queue
+        # Which files were already processed, across restarts
+        self.watermark = ProcessedWatermark(
+            state_path or os.path.join(self.input_dir, ".monitor_state.json")
         )
         
+        # Files are reported once complete: inotify IN_CLOSE_WRITE/IN_MOVED_TO
+        # on Linux, otherwise watchdog with a settle delay
+        self.watcher = None
+        self.observer = None
+        if use_inotify and inotify_available():
+            self.watcher = InotifyWatcher(self.input_dir, self._enqueue_file,
+                                          on_overflow=self._process_existing_files)
+        elif Observer is not None:
+            self.observer = Observer()
+            self.event_handler = ImageFileEventHandler(
+                callback=self._enqueue_file,
+                file_patterns=self.file_patterns
+            )
+        else:
+            raise RuntimeError("Neither inotify nor watchdog is available for directory monitoring")
+        
         # Create the worker thread if using a queue
         self.worker_thread = None
         self.stop_event = threading.Event()
@@ -107,12 +163,71 @@ class DirectoryMonitor:
             logger.info(f"Creating input directory: {self.input_dir}")
             os.makedirs(self.input_dir, exist_ok=True)
         
+    def _enqueue_file(self, file_path: str):
+        """Queue (or process) a completed file that matches our patterns"""
+        if not any(regex.match(file_path) for regex in self.file_regex):
+            return
+        # Writers that reopen a file produce more than one close event
+        if self.watermark.is_pending(file_path) or not self.watermark.mark_pending(file_path):
+            return
+        logger.info(f"New image detected: {file_path}")
+        
+        if self.queue:
+            # Add to queue for async processing
+            self.queue.put(file_path)
+            logger.debug(f"Added {file_path} to processing queue")
+        else:
+            # Process synchronously
+            self._process_file(file_path)
+    
     def _process_file(self, file_path: str):
-        """Process a single file"""
+        """Process a single file; the watermark only passes it once the callback succeeds"""
         try:
             self.callback(file_path)
         except Exception as e:
-            logger.error(f"Error processing file {file_path}: {str(e)}")
+            logger.error(f"Error processing file {file_path}, will retry it: {str(e)}")
+            self.watermark.mark_failed(file_path)
+            return
+        self.watermark.mark_done(file_path)
+    
+    def _process_batch(self, file_paths: List[str]):
+        """Process a batch of files with the batch callback"""
+        start_time = time.time()
+        try:
+            self.batch_callback(file_paths)
+            processed = True
+        except Exception as e:
+            logger.error(f"Error processing batch of {len(file_paths)} files, will retry them: {str(e)}")
+            processed = False
+        for file_path in file_paths:
+            if processed:
+                self.watermark.mark_done(file_path)
+            else:
+                self.watermark.mark_failed(file_path)
+        
+        latency = time.time() - start_time
+        self.stats["batches"] += 1
+        self.stats["files"] += len(file_paths)
+        self.stats["total_latency"] += latency
+        self.stats["max_latency"] = max(self.stats["max_latency"], latency)
+        self.stats["max_batch_size"] = max(self.stats["max_batch_size"], len(file_paths))
+        logger.debug(f"Processed batch of {len(file_paths)} files in {latency:.3f} seconds")
+    
+    def _collect_batch(self, first_path: str) -> List[str]:
+        """Collect up to max_batch_size queued files, waiting at most max_batch_wait"""
+        batch = [first_path]
+        deadline = time.monotonic() + self.max_batch_wait
+        
+        while len(batch) < self.max_batch_size:
+            remaining = deadline - time.monotonic()
+            if remaining <= 0:
+                break
+            try:
+                batch.append(self.queue.get(timeout=remaining))
+            except Empty:
+                break
+        
+        return batch
     
     def _worker_loop(self):
         """Worker thread for processing queued files"""
@@ -121,21 +236,47 @@ class DirectoryMonitor:
             try:
                 # Get a file from the queue with a timeout
                 file_path = self.queue.get(timeout=1.0)
-                self._process_file(file_path)
-                self.queue.task_done()
+            except Empty:
+                continue
+            
+            try:
+                if self.batch_callback and self.max_batch_size > 1:
+                    batch = self._collect_batch(file_path)
+                    self._process_batch(batch)
+                else:
+                    batch = [file_path]
+                    self._process_file(file_path)
+                
+                for _ in batch:
+                    self.queue.task_done()
             except Exception as e:
-                if not isinstance(e, TimeoutError):
-                    logger.error(f"Error in worker thread: {str(e)}")
+                logger.error(f"Error in worker thread: {str(e)}")
         
         logger.info("Worker thread stopped")
     
+    def get_stats(self) -> dict:
+        """
+        Get micro-batching statistics
+        
+        Returns:
+            Dictionary with queue depth, batch counts, average batch size and latencies
+        """
+        batches = self.stats["batches"]
+        return {
+            "queue_depth": self.queue.qsize() if self.queue else 0,
+            "batches": batches,
+            "files": self.stats["files"],
+            "average_batch_size": self.stats["files"] / batches if batches else 0.0,
+            "max_batch_size": self.stats["max_batch_size"],
+            "average_batch_latency_ms": 1000.0 * self.stats["total_latency"] / batches if batches else 0.0,
+            "max_batch_latency_ms": 1000.0 * self.stats["max_latency"]
+        }
+    
     def _process_existing_files(self):
-        """Process existing files in the directory"""
+        """Queue existing files that are newer than the processed watermark"""
         logger.info(f"Processing existing files in {self.input_dir}")
         count = 0
-        
-        # Compile regex patterns
-        patterns = [re.compile(pattern, re.IGNORECASE) for pattern in self.file_patterns]
+        skipped = 0
         
         # Walk through the directory
         for root, _, files in os.walk(self.input_dir):
@@ -143,17 +284,19 @@ class DirectoryMonitor:
                 file_path = os.path.join(root, file)
                 
                 # Check if the file matches our patterns
-                if any(regex.match(file_path) for regex in patterns):
-                    logger.info(f"Processing existing file: {file_path}")
-                    
-                    if self.queue:
-                        self.queue.put(file_path)
-                    else:
-                        self._process_file(file_path)
-                    
-                    count += 1
-        
-        logger.info(f"Queued {count} existing files for processing")
+                if not any(regex.match(file_path) for regex in self.file_regex):
+                    continue
+                
+                # Skip files finished before the last shutdown, or already queued
+                if self.watermark.is_processed(file_path) or self.watermark.is_pending(file_path):
+                    skipped += 1
+                    continue
+                
+                logger.debug(f"Queueing existing file: {file_path}")
+                self._enqueue_file(file_path)
+                count += 1
+        
+        logger.info(f"Queued {count} existing files ({skipped} already processed)")
     
     def start(self):
         """Start monitoring the directory"""
@@ -164,9 +307,12 @@ class DirectoryMonitor:
             self.worker_thread.daemon = True
             self.worker_thread.start()
         
-        # Schedule the directory for monitoring
-        self.observer.schedule(self.event_handler, self.input_dir, recursive=True)
-        self.observer.start()
+        # Start watching the directory
+        if self.watcher:
+            self.watcher.start()
+        else:
+            self.observer.schedule(self.event_handler, self.input_dir, recursive=True)
+            self.observer.start()
         
         logger.info(f"Started monitoring directory: {self.input_dir}")
         
@@ -176,15 +322,19 @@ class DirectoryMonitor:
     
     def stop(self):
         """Stop monitoring the directory"""
-        # Stop the observer
-        self.observer.stop()
-        self.observer.join()
+        # Stop watching
+        if self.watcher:
+            self.watcher.stop()
+        else:
+            self.observer.stop()
+            self.observer.join()
         
         # Stop the worker thread if using a queue
         if self.use_queue and self.worker_thread:
             self.stop_event.set()
             self.worker_thread.join(timeout=2.0)
         
+        self.watermark.save()
         logger.info(f"Stopped monitoring directory: {self.input_dir}")
 
 
@@ -0,0 +1,199 @@
+"""
+Linux inotify watcher for completed files.
+Reports a file when it is closed after writing (IN_CLOSE_WRITE) or renamed
+into a watched directory (IN_MOVED_TO), so files are picked up the moment
+they are complete instead of after a fixed settle delay.
+"""
+import os
+import errno
+import select
+import struct
+import ctypes
+import ctypes.util
+import logging
+import threading
+from typing import Callable, Dict, Optional
+
+# Set up logging
+logging.basicConfig(level=logging.INFO,
+                    format='%(asctime)s - %(name)s - %(levelname)s - %(message)s')
+logger = logging.getLogger(__name__)
+
+# Event masks from <sys/inotify.h>
+IN_CLOSE_WRITE = 0x00000008
+IN_MOVED_TO = 0x00000080
+IN_CREATE = 0x00000100
+IN_DELETE_SELF = 0x00000400
+IN_MOVE_SELF = 0x00000800
+IN_Q_OVERFLOW = 0x00004000
+IN_IGNORED = 0x00008000
+IN_ONLYDIR = 0x01000000
+IN_ISDIR = 0x40000000
+IN_CLOEXEC = 0o2000000
+IN_NONBLOCK = 0o4000
+
+WATCH_MASK = IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE | IN_DELETE_SELF | IN_MOVE_SELF | IN_ONLYDIR
+
+_EVENT = struct.Struct("iIII")  # wd, mask, cookie, len
+
+_libc = None
+
+
+def _load_libc():
+    """Load libc and the inotify functions, or return None if unavailable"""
+    global _libc
+    if _libc is None:
+        try:
+            libc = ctypes.CDLL(ctypes.util.find_library("c") or "libc.so.6", use_errno=True)
+            libc.inotify_init1.argtypes = [ctypes.c_int]
+            libc.inotify_add_watch.argtypes = [ctypes.c_int, ctypes.c_char_p, ctypes.c_uint32]
+            libc.inotify_rm_watch.argtypes = [ctypes.c_int, ctypes.c_int]
+            _libc = libc
+        except (OSError, AttributeError):
+            _libc = False
+    return _libc or None
+
+
+def inotify_available() -> bool:
+    """Whether inotify can be used on this system"""
+    return _load_libc() is not None
+
+
+class InotifyWatcher:
+    """Watches a directory tree and reports completed files"""
+
+    def __init__(self, path: str, on_file: Callable[[str], None],
+                 recursive: bool = True, on_overflow: Optional[Callable[[], None]] = None):
+        """
+        Initialize the watcher
+
+        Args:
+            path: Directory to watch
+            on_file: Called with the path of each completed file (on the watcher thread)
+            recursive: Whether to watch subdirectories, including ones created later
+            on_overflow: Called when the kernel queue overflowed and events were lost
+        """
+        self.path = os.path.abspath(path)
+        self.on_file = on_file
+        self.recursive = recursive
+        self.on_overflow = on_overflow
+        self._libc = _load_libc()
+        if self._libc is None:
+            raise OSError("inotify is not available")
+
+        self._fd = -1
+        self._watches: Dict[int, str] = {}  # wd -> directory
+        self._stop_r, self._stop_w = -1, -1
+        self._thread = None
+
+    def start(self):
+        """Add the watches and start the reader thread"""
+        self._fd = self._libc.inotify_init1(IN_CLOEXEC | IN_NONBLOCK)
+        if self._fd < 0:
+            err = ctypes.get_errno()
+            raise OSError(err, os.strerror(err))
+        self._stop_r, self._stop_w = os.pipe()
+
+        self._add_tree(self.path)
+
+        self._thread = threading.Thread(target=self._read_loop, name="inotify-watcher")
+        self._thread.daemon = True
+        self._thread.start()
+
+    def stop(self):
+        """Stop the reader thread and close the inotify descriptor"""
+        if self._thread is None:
+            return
+        os.write(self._stop_w, b"x")
+        self._thread.join(timeout=2.0)
+        self._thread = None
+        for fd in (self._fd, self._stop_r, self._stop_w):
+            os.close(fd)
+        self._fd = self._stop_r = self._stop_w = -1
+        self._watches.clear()
+
+    def _add_watch(self, directory: str) -> bool:
+        """Watch one directory"""
+        wd = self._libc.inotify_add_watch(self._fd, os.fsencode(directory), WATCH_MASK)
+        if wd < 0:
+            err = ctypes.get_errno()
+            if err == errno.ENOSPC:
+                logger.error("inotify watch limit reached; raise fs.inotify.max_user_watches")
+            elif err != errno.ENOENT:
+                logger.warning(f"Could not watch {directory}: {os.strerror(err)}")
+            return False
+        self._watches[wd] = directory
+        return True
+
+    def _add_tree(self, directory: str, report_files: bool = False):
+        """
+        Watch a directory and (if recursive) its subdirectories
+
+        Args:
+            directory: Root of the tree
+            report_files: Report files already present, for directories created
+                          after watching started (they may fill before the watch lands)
+        """
+        if not self._add_watch(directory) or not self.recursive:
+            return
+        try:
+            entries = list(os.scandir(directory))
+        except OSError:
+            return
+        for entry in entries:
+            if entry.is_dir(follow_symlinks=False):
+                self._add_tree(entry.path, report_files)
+            elif report_files and entry.is_file(follow_symlinks=False):
+                self.on_file(entry.path)
+
+    def _read_loop(self):
+        """Read and dispatch events until stopped"""
+        poller = select.poll()
+        poller.register(self._fd, select.POLLIN)
+        poller.register(self._stop_r, select.POLLIN)
+
+        while True:
+            ready = {fd for fd, _ in poller.poll()}
+            if self._stop_r in ready:
+                break
+            try:
+                data = os.read(self._fd, 64 * 1024)
+            except BlockingIOError:
+                continue
+            except OSError as e:
+                logger.error(f"inotify read failed: {str(e)}")
+                break
+
+            try:
+                self._dispatch(data)
+            except Exception as e:
+                logger.error(f"Error handling inotify events: {str(e)}")
+
+    def _dispatch(self, data: bytes):
+        """Decode a buffer of inotify events"""
+        offset = 0
+        while offset + _EVENT.size <= len(data):
+            wd, mask, _, length = _EVENT.unpack_from(data, offset)
+            offset += _EVENT.size
+            name = data[offset:offset + length].rstrip(b"\0")
+            offset += length
+
+            if mask & IN_Q_OVERFLOW:
+                logger.warning("inotify queue overflowed, events were lost")
+                if self.on_overflow:
+                    self.on_overflow()
+                continue
+
+            directory = self._watches.get(wd)
+            if directory is None:
+                continue
+            if mask & IN_IGNORED or mask & (IN_DELETE_SELF | IN_MOVE_SELF):
+                self._watches.pop(wd, None)
+                continue
+
+            path = os.path.join(directory, os.fsdecode(name))
+            if mask & IN_ISDIR:
+                if self.recursive and mask & (IN_CREATE | IN_MOVED_TO):
+                    self._add_tree(path, report_files=True)
+            elif mask & (IN_CLOSE_WRITE | IN_MOVED_TO):
+                self.on_file(path)
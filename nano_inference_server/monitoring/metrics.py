@@ -0,0 +1,275 @@
+"""
+Low-overhead metrics for pipeline stage timing.
+Counters and histograms keep one shard per writing thread, so recording a
+span is a few list additions without a lock; shards are summed when the
+registry is rendered in the Prometheus text format for GET /metrics.
+"""
+import bisect
+import uuid
+import logging
+import threading
+from typing import Callable, Dict, List, Optional, Sequence, Tuple
+
+# Set up logging
+logging.basicConfig(level=logging.INFO,
+                    format='%(asctime)s - %(name)s - %(levelname)s - %(message)s')
+logger = logging.getLogger(__name__)
+
+# Upper bounds in seconds, from a preprocess call to a Pi-to-Nano transfer
+DEFAULT_BUCKETS = (0.001, 0.0025, 0.005, 0.01, 0.025, 0.05, 0.1, 0.25, 0.5,
+                   1.0, 2.5, 5.0, 10.0, 30.0, 60.0)
+
+# Shards kept before those of finished threads are folded into the total
+_MAX_SHARDS = 64
+
+
+def new_trace_id() -> str:
+    """Return a new ID for an image without one from the camera"""
+    return uuid.uuid4().hex[:16]
+
+
+class _ShardedValues:
+    """
+    Fixed-size vector of floats with one shard per writing thread
+
+    Only the owning thread writes a shard, so writes need no lock. Shards of
+    finished threads (the API server runs each request on its own thread) are
+    folded into a retired total.
+    """
+
+    def __init__(self, size: int):
+        self.size = size
+        self._local = threading.local()
+        self._shards: List[Tuple[threading.Thread, List[float]]] = []
+        self._retired = [0.0] * size
+        self._lock = threading.Lock()  # Only taken to add or fold shards
+
+    def shard(self) -> List[float]:
+        """Return the calling thread's shard"""
+        values = getattr(self._local, "values", None)
+        if values is None:
+            values = [0.0] * self.size
+            with self._lock:
+                if len(self._shards) >= _MAX_SHARDS:
+                    self._fold()
+                self._shards.append((threading.current_thread(), values))
+            self._local.values = values
+        return values
+
+    def _fold(self):
+        """Merge shards of finished threads into the retired total; caller holds the lock"""
+        live = []
+        for thread, values in self._shards:
+            if thread.is_alive():
+                live.append((thread, values))
+            else:
+                self._retired = [a + b for a, b in zip(self._retired, values)]
+        self._shards = live
+
+    def snapshot(self) -> List[float]:
+        """Return the sum over all shards"""
+        with self._lock:
+            self._fold()
+            total = list(self._retired)
+            for _, values in self._shards:
+                total = [a + b for a, b in zip(total, values)]
+        return total
+
+
+class Counter:
+    """Monotonic counter"""
+
+    def __init__(self):
+        self._values = _ShardedValues(1)
+
+    def inc(self, amount: float = 1.0):
+        """Add amount to the counter"""
+        self._values.shard()[0] += amount
+
+    def value(self) -> float:
+        """Current total"""
+        return self._values.snapshot()[0]
+
+
+class Histogram:
+    """Cumulative-bucket histogram with Prometheus semantics"""
+
+    def __init__(self, buckets: Sequence[float] = DEFAULT_BUCKETS):
+        self.buckets = tuple(sorted(buckets))
+        # Per-bucket counts, then +Inf, sum and count
+        self._values = _ShardedValues(len(self.buckets) + 3)
+
+    def observe(self, value: float):
+        """Record one observation"""
+        shard = self._values.shard()
+        shard[bisect.bisect_left(self.buckets, value)] += 1
+        shard[-2] += value
+        shard[-1] += 1
+
+    def snapshot(self) -> Tuple[List[float], float, float]:
+        """Return (cumulative bucket counts including +Inf, sum, count)"""
+        values = self._values.snapshot()
+        cumulative = []
+        running = 0.0
+        for count in values[:len(self.buckets) + 1]:
+            running += count
+            cumulative.append(running)
+        return cumulative, values[-2], values[-1]
+
+
+class _Family:
+    """A named metric with one child per combination of label values"""
+
+    def __init__(self, kind: str, name: str, documentation: str,
+                 labelnames: Sequence[str], factory: Callable):
+        self.kind = kind
+        self.name = name
+        self.documentation = documentation
+        self.labelnames = tuple(labelnames)
+        self._factory = factory
+        self._children: Dict[Tuple, object] = {}
+        self._lock = threading.Lock()
+
+    def labels(self, *values):
+        """Return the child for these label values, creating it on first use"""
+        child = self._children.get(values)
+        if child is None:
+            if len(values) != len(self.labelnames):
+                raise ValueError(f"{self.name} expects labels {self.labelnames}")
+            with self._lock:
+                child = self._children.setdefault(values, self._factory())
+        return child
+
+    def children(self) -> List[Tuple[Tuple, object]]:
+        """Return (label values, child) pairs"""
+        with self._lock:
+            return list(self._children.items())
+
+
+class MetricsRegistry:
+    """Holds counters, histograms and gauges and renders them for Prometheus"""
+
+    def __init__(self):
+        self._families: Dict[str, _Family] = {}
+        self._gauges: Dict[str, Tuple[str, Callable]] = {}
+        self._lock = threading.Lock()
+
+    def _family(self, kind: str, name: str, documentation: str,
+                labelnames: Sequence[str], factory: Callable) -> _Family:
+        with self._lock:
+            family = self._families.get(name)
+            if family is None:
+                family = _Family(kind, name, documentation, labelnames, factory)
+                self._families[name] = family
+            return family
+
+    def counter(self, name: str, documentation: str, labelnames: Sequence[str] = ()) -> _Family:
+        """
+        Get or create a counter family
+
+        Args:
+            name: Metric name
+            documentation: HELP text
+            labelnames: Label names; .labels(...) returns the counter
+        """
+        return self._family("counter", name, documentation, labelnames, Counter)
+
+    def histogram(self, name: str, documentation: str, labelnames: Sequence[str] = (),
+                  buckets: Sequence[float] = DEFAULT_BUCKETS) -> _Family:
+        """
+        Get or create a histogram family
+
+        Args:
+            name: Metric name
+            documentation: HELP text
+            labelnames: Label names; .labels(...) returns the histogram
+            buckets: Bucket upper bounds in seconds
+        """
+        return self._family("histogram", name, documentation, labelnames,
+                            lambda: Histogram(buckets))
+
+    def gauge(self, name: str, documentation: str, read: Callable):
+        """
+        Register a gauge that is read when the metrics are rendered
+
+        Args:
+            name: Metric name
+            documentation: HELP text
+            read: Returns a number, or {tuple of (label, value) pairs: number}
+        """
+        with self._lock:
+            self._gauges[name] = (documentation, read)
+
+    def render(self) -> str:
+        """Render all metrics in the Prometheus text exposition format (0.0.4)"""
+        lines = []
+        with self._lock:
+            families = list(self._families.values())
+            gauges = list(self._gauges.items())
+
+        for family in families:
+            lines.append(f"# HELP {family.name} {family.documentation}")
+            lines.append(f"# TYPE {family.name} {family.kind}")
+            for values, child in family.children():
+                labels = list(zip(family.labelnames, values))
+                if family.kind == "counter":
+                    lines.append(f"{family.name}{_labels(labels)} {child.value():g}")
+                    continue
+                cumulative, total, count = child.snapshot()
+                bounds = [f"{bound:g}" for bound in child.buckets] + ["+Inf"]
+                for bound, bucket_count in zip(bounds, cumulative):
+                    lines.append(f"{family.name}_bucket{_labels(labels + [('le', bound)])} "
+                                 f"{bucket_count:g}")
+                lines.append(f"{family.name}_sum{_labels(labels)} {total:g}")
+                lines.append(f"{family.name}_count{_labels(labels)} {count:g}")
+
+        for name, (documentation, read) in gauges:
+            try:
+                value = read()
+            except Exception as e:
+                logger.warning(f"Could not read gauge {name}: {str(e)}")
+                continue
+            lines.append(f"# HELP {name} {documentation}")
+            lines.append(f"# TYPE {name} gauge")
+            samples = value.items() if isinstance(value, dict) else [((), value)]
+            for labels, sample in samples:
+                lines.append(f"{name}{_labels(list(labels))} {float(sample):g}")
+
+        return "\n".join(lines) + "\n"
+
+
+def _labels(pairs: List[Tuple[str, str]]) -> str:
+    """Format label pairs as {a="b",...}"""
+    if not pairs:
+        return ""
+    escaped = [(key, str(value).replace("\\", "\\\\").replace('"', '\\"')) for key, value in pairs]
+    return "{" + ",".join(f'{key}="{value}"' for key, value in escaped) + "}"
+
+
+# Process-wide registry with the span histogram every stage records into
+REGISTRY = MetricsRegistry()
+STAGE_SECONDS = REGISTRY.histogram(
+    "birdserver_stage_seconds", "Time spent in each server pipeline stage", ("stage",))
+EVENTS = REGISTRY.counter(
+    "birdserver_events_total", "Server pipeline events by outcome", ("event",))
+
+PROMETHEUS_CONTENT_TYPE = "text/plain; version=0.0.4; charset=utf-8"
+
+
+def observe_stage(stage: str, seconds: Optional[float]):
+    """
+    Record the duration of one pipeline stage
+
+    Args:
+        stage: Stage name, e.g. "queue_wait" or "inference"
+        seconds: Duration; None is ignored and negative values (clock skew
+                 between the Pi and the Nano) are clamped to zero
+    """
+    if seconds is None:
+        return
+    STAGE_SECONDS.labels(stage).observe(max(0.0, seconds))
+
+
+def count_event(event: str, amount: float = 1.0):
+    """Count a pipeline event, e.g. "processed" or "shed" """
+    EVENTS.labels(event).inc(amount)
@@ -0,0 +1,165 @@
+"""
+Persisted processing watermark for the directory monitor.
+Records how far processing has got by file change time (ctime), so a restart
+only re-queues files that were never processed. ctime is used rather than
+mtime because copies that preserve mtime (rsync -a, scp -p) still get a new
+ctime when they land in the input directory.
+"""
+import os
+import json
+import time
+import logging
+import threading
+from typing import Dict, Optional
+
+# Set up logging
+logging.basicConfig(level=logging.INFO,
+                    format='%(asctime)s - %(name)s - %(levelname)s - %(message)s')
+logger = logging.getLogger(__name__)
+
+
+class ProcessedWatermark:
+    """
+    Tracks processed files by change time
+
+    Every file with a ctime at or below the watermark has been processed.
+    Files finish out of order (micro-batches, retries), so the watermark only
+    advances to just below the oldest file still in flight; files finished
+    above it are remembered by name until the watermark passes them. Files
+    whose processing failed hold the watermark back like files in flight, so
+    they are queued again after a restart or when they are rewritten.
+    """
+
+    def __init__(self, state_path: str, save_interval: float = 1.0):
+        """
+        Initialize the watermark, loading any saved state
+
+        Args:
+            state_path: JSON file the watermark is persisted to
+            save_interval: Minimum seconds between writes of the state file
+        """
+        self.state_path = state_path
+        self.save_interval = save_interval
+        self.watermark_ns = 0
+        self._done_above: Dict[str, int] = {}  # path -> ctime for files done above the watermark
+        self._pending: Dict[str, int] = {}  # path -> ctime for files queued but not done
+        self._failed: Dict[str, int] = {}  # path -> ctime for files whose processing failed
+        self._lock = threading.Lock()
+        self._dirty = False
+        self._last_save = 0.0
+        self._load()
+
+    def _load(self):
+        """Load the saved watermark"""
+        if not os.path.exists(self.state_path):
+            return
+        try:
+            with open(self.state_path, "r") as f:
+                state = json.load(f)
+            self.watermark_ns = int(state.get("watermark_ns", 0))
+            self._done_above = {path: int(ctime) for path, ctime in state.get("done_above", {}).items()}
+            logger.info(f"Loaded processing watermark from {self.state_path}")
+        except Exception as e:
+            logger.warning(f"Could not load processing watermark, starting from zero: {str(e)}")
+
+    @staticmethod
+    def ctime_ns(path: str) -> Optional[int]:
+        """Change time of a file, or None if it is gone"""
+        try:
+            return os.stat(path).st_ctime_ns
+        except OSError:
+            return None
+
+    def is_processed(self, path: str, ctime_ns: Optional[int] = None) -> bool:
+        """
+        Check whether a file was already processed
+
+        Args:
+            path: File path
+            ctime_ns: Its change time, if already known
+
+        Returns:
+            True if the file is at or below the watermark or was finished above it
+        """
+        if ctime_ns is None:
+            ctime_ns = self.ctime_ns(path)
+            if ctime_ns is None:
+                return True
+        with self._lock:
+            if ctime_ns <= self.watermark_ns:
+                return True
+            return self._done_above.get(path) == ctime_ns
+
+    def is_pending(self, path: str) -> bool:
+        """Check whether a file is queued and not yet done"""
+        with self._lock:
+            return path in self._pending
+
+    def mark_pending(self, path: str) -> bool:
+        """
+        Record that a file was queued
+
+        Returns:
+            False if the file no longer exists
+        """
+        ctime_ns = self.ctime_ns(path)
+        if ctime_ns is None:
+            return False
+        with self._lock:
+            self._failed.pop(path, None)
+            self._pending[path] = ctime_ns
+        return True
+
+    def mark_failed(self, path: str):
+        """Record that processing a file failed; the watermark stays below it"""
+        with self._lock:
+            ctime_ns = self._pending.pop(path, None)
+            if ctime_ns is not None:
+                self._failed[path] = ctime_ns
+
+    def mark_done(self, path: str):
+        """Record that a file was processed successfully and advance the watermark"""
+        with self._lock:
+            ctime_ns = self._pending.pop(path, None)
+            if ctime_ns is None:
+                ctime_ns = self.ctime_ns(path)
+                if ctime_ns is None:
+                    return
+            self._failed.pop(path, None)
+            self._done_above[path] = ctime_ns
+
+            # Failed files that have since been deleted no longer hold the watermark
+            self._failed = {p: m for p, m in self._failed.items() if os.path.exists(p)}
+
+            # Advance to just below the oldest file still in flight or failed
+            held = list(self._pending.values()) + list(self._failed.values())
+            limit = min(held) - 1 if held else None
+            candidates = [m for m in self._done_above.values() if limit is None or m <= limit]
+            if candidates:
+                self.watermark_ns = max(self.watermark_ns, max(candidates))
+            self._done_above = {p: m for p, m in self._done_above.items() if m > self.watermark_ns}
+            self._dirty = True
+
+        if time.time() - self._last_save >= self.save_interval:
+            self.save()
+
+    def save(self):
+        """Write the watermark atomically"""
+        with self._lock:
+            if not self._dirty:
+                return
+            state = {"watermark_ns": self.watermark_ns, "done_above": dict(self._done_above)}
+            self._dirty = False
+            self._last_save = time.time()
+
+        temp_path = f"{self.state_path}.tmp"
+        try:
+            with open(temp_path, "w") as f:
+                json.dump(state, f)
+                f.flush()
+                os.fsync(f.fileno())
+            os.replace(temp_path, self.state_path)
+        except Exception as e:
+            logger.error(f"Error saving processing watermark: {str(e)}")
+            with self._lock:
+                self._dirty = True
@@ -0,0 +1,113 @@
+"""
+SQLite connection pool for the result database.
+One long-lived writer connection and a pool of read-only connections, with
+the database in WAL mode so API reads never block inference writes.
+"""
+import logging
+import sqlite3
+import threading
+from contextlib import contextmanager
+from queue import Queue, Empty
+from typing import Iterator
+
+# Set up logging
+logging.basicConfig(level=logging.INFO,
+                    format='%(asctime)s - %(name)s - %(levelname)s - %(message)s')
+logger = logging.getLogger(__name__)
+
+
+class SQLitePool:
+    """Pool of persistent SQLite connections: one writer, N readers"""
+
+    def __init__(self, db_path: str, readers: int = 4, timeout: float = 10.0,
+                 cached_statements: int = 128):
+        """
+        Initialize the pool and open the writer connection
+
+        Args:
+            db_path: Path to the SQLite database
+            readers: Maximum number of reader connections
+            timeout: Seconds to wait for a locked database or a free reader
+            cached_statements: Prepared statements kept per connection
+        """
+        self.db_path = db_path
+        self.max_readers = readers
+        self.timeout = timeout
+        self.cached_statements = cached_statements
+
+        self._writer_lock = threading.Lock()
+        self._readers = Queue()
+        self._reader_count = 0
+        self._reader_lock = threading.Lock()
+        self._closed = False
+
+        self._writer = self._connect()
+        # WAL lets readers see the last committed state while the writer works;
+        # the journal mode is persistent, so readers opened later inherit it
+        mode = self._writer.execute('PRAGMA journal_mode=WAL').fetchone()[0]
+        if mode.lower() != 'wal':
+            logger.warning(f"Could not enable WAL mode, journal mode is {mode}")
+        # NORMAL is durable across application crashes in WAL mode
+        self._writer.execute('PRAGMA synchronous=NORMAL')
+
+    def _connect(self, read_only: bool = False) -> sqlite3.Connection:
+        """Open a connection shared between threads (access is serialized by the pool)"""
+        conn = sqlite3.connect(self.db_path, timeout=self.timeout,
+                               check_same_thread=False,
+                               cached_statements=self.cached_statements)
+        conn.row_factory = sqlite3.Row
+        conn.execute(f'PRAGMA busy_timeout={int(self.timeout * 1000)}')
+        if read_only:
+            conn.execute('PRAGMA query_only=1')
+        return conn
+
+    @contextmanager
+    def writer(self) -> Iterator[sqlite3.Connection]:
+        """
+        Use the writer connection inside a transaction
+
+        Commits when the block succeeds and rolls back when it raises.
+        """
+        with self._writer_lock:
+            try:
+                yield self._writer
+                self._writer.commit()
+            except Exception:
+                self._writer.rollback()
+                raise
+
+    @contextmanager
+    def reader(self) -> Iterator[sqlite3.Connection]:
+        """Borrow a read-only connection, opening one if the pool isn't full"""
+        conn = None
+        try:
+            conn = self._readers.get_nowait()
+        except Empty:
+            with self._reader_lock:
+                if self._reader_count < self.max_readers:
+                    conn = self._connect(read_only=True)
+                    self._reader_count += 1
+            if conn is None:
+                conn = self._readers.get(timeout=self.timeout)
+
+        try:
+            yield conn
+        finally:
+            # End the implicit read transaction so the WAL can be checkpointed
+            if conn.in_transaction:
+                conn.rollback()
+            if self._closed:
+                conn.close()
+            else:
+                self._readers.put(conn)
+
+    def close(self):
+        """Close all connections"""
+        self._closed = True
+        with self._writer_lock:
+            self._writer.close()
+        while True:
+            try:
+                self._readers.get_nowait().close()
+            except Empty:
+                break
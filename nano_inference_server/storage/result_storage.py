@@ -11,6 +11,11 @@ import datetime
 from typing import Dict, List, Optional, Union, Any, Tuple
 from pathlib import Path
 import shutil
+import threading
+from collections import defaultdict
+
+from .db_pool import SQLitePool
+from .thumbnail_cache import ThumbnailCache
 
 # Set up logging
 logging.basicConfig(level=logging.INFO, 
@@ -21,9 +26,56 @@ logger = logging.getLogger(__name__)
 class ResultStorage:
     """Handles storage and retrieval of inference results"""
     
+    # Constant SQL text so the connection's statement cache reuses the prepared statement
+    _INSERT_DETECTION = '''
+        INSERT INTO detections (
+            timestamp, 
+            image_path, 
+            annotated_path, 
+            result_path, 
+            bird_detected, 
+            bird_count, 
+            has_species, 
+            species, 
+            confidence, 
+            processing_time,
+            source,
+            file_size
+        ) VALUES (?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?)
+        '''
+    
+    _INSERT_FTS = '''
+        INSERT INTO detections_fts (rowid, species, classes, notes, source)
+        VALUES (?, ?, ?, ?, ?)
+        '''
+    
+    # Materialized counters, updated in the same transaction as the detections.
+    # Two statements instead of an UPSERT: the Nano's SQLite (3.22) predates it.
+    _INSERT_COUNTER = '''
+        INSERT OR IGNORE INTO detection_counts (kind, key, count, confidence_sum)
+        VALUES (?, ?, 0, 0.0)
+        '''
+    _UPDATE_COUNTER = '''
+        UPDATE detection_counts
+        SET count = count + ?, confidence_sum = confidence_sum + ?
+        WHERE kind = ? AND key = ?
+        '''
+    
+    # Visit rows are created by whichever of ingest or storage gets there first
+    _INSERT_VISIT = '''
+        INSERT OR IGNORE INTO visits (visit_key, source, started_at, ended_at, frame_count, phash)
+        VALUES (?, ?, ?, ?, 0, ?)
+        '''
+    
     def __init__(self, base_dir: str, db_path: Optional[str] = None,
                  max_results: int = 1000, 
-                 organize_by_date: bool = True):
+                 organize_by_date: bool = True,
+                 reader_connections: int = 4,
+                 max_storage_gb: Optional[float] = None,
+                 retention_interval: float = 300.0,
+                 retention_high_water: float = 1.05,
+                 retention_batch_size: int = 500,
+                 thumbnails: Optional[ThumbnailCache] = None):
         """
         Initialize the result storage.
         
@@ -32,10 +84,22 @@ class ResultStorage:
             db_path: Path to the SQLite database (if None, one will be created in base_dir)
             max_results: Maximum number of results to keep
             organize_by_date: Whether to organize results by date
+            reader_connections: Number of pooled read-only database connections
+            max_storage_gb: Keep stored images, annotations, results and thumbnails
+                            under this size (None to only limit the number of results)
+            retention_interval: Seconds between scheduled retention runs
+            retention_high_water: Run retention early once a limit is exceeded by this factor
+            retention_batch_size: Results deleted per retention transaction
+            thumbnails: Thumbnail cache whose files are deleted with their results
         """
         self.base_dir = os.path.abspath(base_dir)
         self.max_results = max_results
+        self.max_storage_bytes = int(max_storage_gb * 1024 ** 3) if max_storage_gb else None
+        self.retention_interval = retention_interval
+        self.retention_high_water = retention_high_water
+        self.retention_batch_size = retention_batch_size
         self.organize_by_date = organize_by_date
+        self.thumbnails = thumbnails
         
         # Set up directories
         self.images_dir = os.path.join(self.base_dir, "images")
@@ -51,38 +115,35 @@ class ResultStorage:
             self.db_path = os.path.join(self.base_dir, "results.db")
         else:
             self.db_path = os.path.abspath(db_path)
-            
+        
+        self.pool = SQLitePool(self.db_path, readers=reader_connections)
+        self.fts_enabled = False
         self._init_database()
+        
+        # Retention runs on a background thread, woken early at the high-water mark
+        self._retention_wakeup = threading.Event()
+        self._retention_stop = threading.Event()
+        self._retention_thread = threading.Thread(target=self._retention_loop, daemon=True)
+        self._retention_thread.start()
     
     def _init_database(self):
         """Initialize the SQLite database"""
         try:
-            conn = sqlite3.connect(self.db_path)
-            cursor = conn.cursor()
-            
-            # Create detections table
-            cursor.execute('''
-            CREATE TABLE IF NOT EXISTS detections (
-                id INTEGER PRIMARY KEY AUTOINCREMENT,
-                timestamp TEXT NOT NULL,
-                image_path TEXT NOT NULL,
-                annotated_path TEXT,
-                result_path TEXT,
-                bird_detected BOOLEAN,
-                bird_count INTEGER,
-                has_species BOOLEAN,
-                species TEXT,
-                confidence REAL,
-                processing_time REAL,
-                source TEXT
-            )
-            ''')
-            
-            # Create index on timestamp for faster retrieval
-            cursor.execute('CREATE INDEX IF NOT EXISTS idx_timestamp ON detections(timestamp)')
-            
-            conn.commit()
-            conn.close()
+            with self.pool.writer() as conn:
+                cursor = conn.cursor()
+                self._create_schema(cursor)
+                
+                # Databases created before size-based retention lack file_size
+                cursor.execute('PRAGMA table_info(detections)')
+                if 'file_size' not in [row[1] for row in cursor.fetchall()]:
+                    cursor.execute('ALTER TABLE detections ADD COLUMN file_size INTEGER DEFAULT 0')
+                
+                # Databases created before the counters existed need a backfill
+                cursor.execute("SELECT 1 FROM detection_counts WHERE kind = 'total'")
+                if cursor.fetchone() is None:
+                    self._rebuild_counters(cursor)
+                
+                self._init_fts(cursor)
             
             logger.info(f"Database initialized at {self.db_path}")
             
@@ -90,6 +151,155 @@ class ResultStorage:
             logger.error(f"Error initializing database: {str(e)}")
             raise
     
+    def _create_schema(self, cursor: sqlite3.Cursor):
+        """Create tables and indexes"""
+        # Create detections table
+        cursor.execute('''
+        CREATE TABLE IF NOT EXISTS detections (
+            id INTEGER PRIMARY KEY AUTOINCREMENT,
+            timestamp TEXT NOT NULL,
+            image_path TEXT NOT NULL,
+            annotated_path TEXT,
+            result_path TEXT,
+            bird_detected BOOLEAN,
+            bird_count INTEGER,
+            has_species BOOLEAN,
+            species TEXT,
+            confidence REAL,
+            processing_time REAL,
+            source TEXT,
+            file_size INTEGER DEFAULT 0
+        )
+        ''')
+        
+        # Create index on timestamp for faster retrieval
+        cursor.execute('CREATE INDEX IF NOT EXISTS idx_timestamp ON detections(timestamp)')
+        # Filtered listings (bird_only / with_species) ordered by time
+        cursor.execute('CREATE INDEX IF NOT EXISTS idx_bird_detected ON detections(bird_detected, timestamp)')
+        cursor.execute('CREATE INDEX IF NOT EXISTS idx_has_species ON detections(has_species, timestamp)')
+        # Species lookups and GROUP BY species in get_stats
+        cursor.execute('CREATE INDEX IF NOT EXISTS idx_species ON detections(species)')
+        # /api/search filters: date range + confidence, and species + date range
+        cursor.execute('CREATE INDEX IF NOT EXISTS idx_timestamp_confidence ON detections(timestamp, confidence)')
+        cursor.execute('CREATE INDEX IF NOT EXISTS idx_species_timestamp ON detections(species, timestamp, confidence)')
+        
+        # Totals ('total', 'bird', 'species_identified'), per-species and per-day counts
+        cursor.execute('''
+        CREATE TABLE IF NOT EXISTS detection_counts (
+            kind TEXT NOT NULL,
+            key TEXT NOT NULL,
+            count INTEGER NOT NULL DEFAULT 0,
+            confidence_sum REAL NOT NULL DEFAULT 0.0,
+            PRIMARY KEY (kind, key)
+        )
+        ''')
+        cursor.execute('CREATE INDEX IF NOT EXISTS idx_counts_kind_count ON detection_counts(kind, count)')
+        
+        # Runs of near-identical images; only the representative was processed
+        cursor.execute('''
+        CREATE TABLE IF NOT EXISTS visits (
+            id INTEGER PRIMARY KEY AUTOINCREMENT,
+            visit_key TEXT NOT NULL UNIQUE,
+            source TEXT,
+            started_at TEXT NOT NULL,
+            ended_at TEXT NOT NULL,
+            frame_count INTEGER NOT NULL DEFAULT 0,
+            phash TEXT,
+            representative_id INTEGER
+        )
+        ''')
+        cursor.execute('CREATE INDEX IF NOT EXISTS idx_visits_started ON visits(started_at)')
+        cursor.execute('CREATE INDEX IF NOT EXISTS idx_visits_ended ON visits(ended_at)')
+    
+    def _update_counters(self, cursor: sqlite3.Cursor, rows: List[Tuple], sign: int = 1):
+        """
+        Add (sign=1) or remove (sign=-1) detection rows from the counters
+        
+        Args:
+            cursor: Cursor inside the writer transaction
+            rows: (timestamp, bird_detected, has_species, species, confidence, file_size) tuples
+            sign: 1 when the rows are inserted, -1 when they are deleted
+        """
+        # Aggregate first so a batch delete touches each counter once
+        deltas = defaultdict(lambda: [0, 0.0])
+        for timestamp, bird_detected, has_species, species, confidence, file_size in rows:
+            deltas[("total", "")][0] += sign
+            deltas[("day", timestamp[:10])][0] += sign
+            deltas[("bytes", "")][0] += sign * (file_size or 0)
+            if bird_detected:
+                deltas[("bird", "")][0] += sign
+                deltas[("bird", "")][1] += sign * (confidence or 0.0)
+            if has_species:
+                deltas[("species_identified", "")][0] += sign
+                deltas[("species", species)][0] += sign
+        
+        for (kind, key), (count_delta, confidence_delta) in deltas.items():
+            cursor.execute(self._INSERT_COUNTER, (kind, key))
+            cursor.execute(self._UPDATE_COUNTER, (count_delta, confidence_delta, kind, key))
+        
+        if sign < 0:
+            # Keep the per-species/per-day tables small as history is pruned
+            cursor.execute("DELETE FROM detection_counts WHERE count <= 0 AND kind IN ('species', 'day')")
+    
+    def _init_fts(self, cursor: sqlite3.Cursor):
+        """Create the full-text index over species, class names, notes and source"""
+        cursor.execute("SELECT 1 FROM sqlite_master WHERE name = 'detections_fts'")
+        exists = cursor.fetchone() is not None
+        try:
+            # rowid is the detection id
+            cursor.execute('''
+            CREATE VIRTUAL TABLE IF NOT EXISTS detections_fts
+            USING fts5(species, classes, notes, source)
+            ''')
+        except sqlite3.OperationalError as e:
+            logger.warning(f"FTS5 not available, search falls back to LIKE: {str(e)}")
+            return
+        
+        self.fts_enabled = True
+        if not exists:
+            # Existing rows only have the species and source columns to index
+            cursor.execute('''
+            INSERT INTO detections_fts (rowid, species, classes, notes, source)
+            SELECT id, species, '', '', source FROM detections
+            ''')
+            logger.info("Built full-text search index")
+    
+    def _fts_query(self, text: str, column: Optional[str] = None) -> str:
+        """Turn user text into an FTS5 query: every word must match as a prefix"""
+        terms = ['"' + word.replace('"', '""') + '"*' for word in text.split()]
+        if column:
+            terms = [f"{column}:{term}" for term in terms]
+        return " AND ".join(terms)
+    
+    def _rebuild_counters(self, cursor: sqlite3.Cursor):
+        """Recompute all counters from the detections table"""
+        cursor.execute('DELETE FROM detection_counts')
+        cursor.execute('''
+        INSERT INTO detection_counts (kind, key, count, confidence_sum)
+        SELECT 'total', '', COUNT(*), 0.0 FROM detections
+        ''')
+        cursor.execute('''
+        INSERT INTO detection_counts (kind, key, count, confidence_sum)
+        SELECT 'bytes', '', COALESCE(SUM(file_size), 0), 0.0 FROM detections
+        ''')
+        cursor.execute('''
+        INSERT INTO detection_counts (kind, key, count, confidence_sum)
+        SELECT 'bird', '', COUNT(*), COALESCE(SUM(confidence), 0.0) FROM detections WHERE bird_detected = 1
+        ''')
+        cursor.execute('''
+        INSERT INTO detection_counts (kind, key, count, confidence_sum)
+        SELECT 'species_identified', '', COUNT(*), 0.0 FROM detections WHERE has_species = 1
+        ''')
+        cursor.execute('''
+        INSERT INTO detection_counts (kind, key, count, confidence_sum)
+        SELECT 'species', species, COUNT(*), 0.0 FROM detections WHERE has_species = 1 GROUP BY species
+        ''')
+        cursor.execute('''
+        INSERT INTO detection_counts (kind, key, count, confidence_sum)
+        SELECT 'day', substr(timestamp, 1, 10), COUNT(*), 0.0 FROM detections GROUP BY substr(timestamp, 1, 10)
+        ''')
+        logger.info("Rebuilt detection counters")
+    
     def _get_paths(self, image_path: str, result_id: Optional[str] = None) -> Tuple[str, str, str]:
         """
         Get paths for storing an image, its annotated version, and results
@@ -155,12 +365,10 @@ class ResultStorage:
             # Generate paths
             timestamp = datetime.datetime.now().isoformat()
             result_id = datetime.datetime.now().strftime("%Y%m%d_%H%M%S_%f")
-            stored_image_path, default_annotated_path, result_path = self._get_paths(image_path, result_id)
-            
-            # Use provided annotated path or default
-            if annotated_path is None:
-                annotated_path = default_annotated_path
+            stored_image_path, _, result_path = self._get_paths(image_path, result_id)
             
+            # Annotated images are rendered on demand by the API; a path is
+            # only stored when the caller wrote one
             # Copy original image if requested
             if copy_original and os.path.exists(image_path):
                 shutil.copy2(image_path, stored_image_path)
@@ -175,20 +383,23 @@ class ResultStorage:
             max_confidence = 0.0
             
             for detection in detections:
-                if "class_name" in detection and detection["class_name"] != "bird":
+                # Species from the two-stage classifier, else species-level detector classes
+                if detection.get("species"):
+                    species_list.append(detection["species"])
+                elif "class_name" in detection and detection["class_name"].lower() != "bird":
                     species_list.append(detection["class_name"])
                 
                 if "confidence" in detection and detection["confidence"] > max_confidence:
                     max_confidence = detection["confidence"]
             
             has_species = len(species_list) > 0
-            species = ", ".join(set(species_list))
+            species = ", ".join(sorted(set(species_list)))
             
             # Prepare result data
             result_data = {
                 "timestamp": timestamp,
                 "image_path": os.path.abspath(stored_image_path),
-                "annotated_path": os.path.abspath(annotated_path),
+                "annotated_path": os.path.abspath(annotated_path) if annotated_path else None,
                 "result_path": os.path.abspath(result_path),
                 "bird_detected": bird_detected,
                 "bird_count": bird_count,
@@ -204,12 +415,15 @@ class ResultStorage:
             with open(result_path, 'w') as f:
                 json.dump(result_data, f, indent=2)
             
+            # Bytes this result occupies, for size-based retention
+            result_data["file_size"] = sum(
+                os.path.getsize(path) for path in {stored_image_path, annotated_path, result_path}
+                if path and os.path.exists(path)
+            )
+            
             # Save to database
             self._save_to_database(result_data)
             
-            # Cleanup old results if needed
-            self._cleanup_old_results()
-            
             return result_data
             
         except Exception as e:
@@ -224,138 +438,302 @@ class ResultStorage:
     def _save_to_database(self, result_data: Dict):
         """Save result data to database"""
         try:
-            conn = sqlite3.connect(self.db_path)
-            cursor = conn.cursor()
+            with self.pool.writer() as conn:
+                cursor = conn.cursor()
+                cursor.execute(self._INSERT_DETECTION, (
+                    result_data["timestamp"],
+                    result_data["image_path"],
+                    result_data["annotated_path"],
+                    result_data["result_path"],
+                    result_data["bird_detected"],
+                    result_data["bird_count"],
+                    result_data["has_species"],
+                    result_data["species"],
+                    result_data["confidence"],
+                    result_data["processing_time"],
+                    result_data.get("metadata", {}).get("source", "unknown"),
+                    result_data.get("file_size", 0)
+                ))
+                result_data["id"] = cursor.lastrowid
+                if self.fts_enabled:
+                    cursor.execute(self._INSERT_FTS, (
+                        result_data["id"],
+                        result_data["species"],
+                        " ".join(sorted({d.get("class_name", "") for d in result_data.get("detections", [])})),
+                        result_data.get("metadata", {}).get("notes", ""),
+                        result_data.get("metadata", {}).get("source", "unknown")
+                    ))
+                visit = result_data.get("metadata", {}).get("visit")
+                if visit and visit.get("key"):
+                    cursor.execute(self._INSERT_VISIT, (
+                        visit["key"], visit.get("source"), result_data["timestamp"],
+                        result_data["timestamp"], visit.get("phash")
+                    ))
+                    cursor.execute('''
+                    UPDATE visits SET representative_id = ?
+                    WHERE visit_key = ? AND representative_id IS NULL
+                    ''', (result_data["id"], visit["key"]))
+                self._update_counters(cursor, [(
+                    result_data["timestamp"],
+                    result_data["bird_detected"],
+                    result_data["has_species"],
+                    result_data["species"],
+                    result_data["confidence"],
+                    result_data.get("file_size", 0)
+                )])
+                
+                # Wake the retention thread once a limit is clearly exceeded
+                cursor.execute("SELECT kind, count FROM detection_counts WHERE kind IN ('total', 'bytes')")
+                totals = dict(cursor.fetchall())
             
-            cursor.execute('''
-            INSERT INTO detections (
-                timestamp, 
-                image_path, 
-                annotated_path, 
-                result_path, 
-                bird_detected, 
-                bird_count, 
-                has_species, 
-                species, 
-                confidence, 
-                processing_time,
-                source
-            ) VALUES (?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?)
-            ''', (
-                result_data["timestamp"],
-                result_data["image_path"],
-                result_data["annotated_path"],
-                result_data["result_path"],
-                result_data["bird_detected"],
-                result_data["bird_count"],
-                result_data["has_species"],
-                result_data["species"],
-                result_data["confidence"],
-                result_data["processing_time"],
-                result_data.get("metadata", {}).get("source", "unknown")
-            ))
-            
-            conn.commit()
-            conn.close()
+            total_bytes = totals.get("bytes", 0) + self._thumbnail_bytes()
+            if self._over_limit(totals.get("total", 0), total_bytes, self.retention_high_water):
+                self._retention_wakeup.set()
             
         except Exception as e:
             logger.error(f"Error saving to database: {str(e)}")
     
-    def _cleanup_old_results(self):
-        """Clean up old results if we've exceeded max_results"""
+    def record_visit_frame(self, visit: Dict):
+        """
+        Count one more image of a visit (see ingest.visits.VisitTracker)
+        
+        Args:
+            visit: Visit with key, source, phash, started_at and last_seen (epoch seconds)
+        """
+        started_at = datetime.datetime.fromtimestamp(visit["started_at"]).isoformat()
+        last_seen = datetime.datetime.fromtimestamp(visit["last_seen"]).isoformat()
         try:
-            conn = sqlite3.connect(self.db_path)
-            cursor = conn.cursor()
+            with self.pool.writer() as conn:
+                cursor = conn.cursor()
+                cursor.execute(self._INSERT_VISIT, (
+                    visit["key"], visit.get("source"), started_at, last_seen, visit.get("phash")
+                ))
+                cursor.execute('''
+                UPDATE visits SET frame_count = frame_count + 1, ended_at = ?
+                WHERE visit_key = ?
+                ''', (last_seen, visit["key"]))
+        except Exception as e:
+            logger.error(f"Error recording visit: {str(e)}")
+    
+    def get_visits(self, limit: int = 100, offset: int = 0) -> List[Dict]:
+        """
+        Get the most recent visits with their representative result
+        
+        Args:
+            limit: Maximum number of visits to return
+            offset: Number of visits to skip (for pagination)
             
-            # Get count of results
-            cursor.execute('SELECT COUNT(*) FROM detections')
-            count = cursor.fetchone()[0]
+        Returns:
+            List of visit dictionaries, newest first
+        """
+        try:
+            with self.pool.reader() as conn:
+                rows = conn.execute('''
+                SELECT v.visit_key, v.source, v.started_at, v.ended_at, v.frame_count, v.phash,
+                       v.representative_id, d.image_path, d.bird_detected, d.bird_count,
+                       d.species, d.confidence
+                FROM visits v
+                LEFT JOIN detections d ON d.id = v.representative_id
+                ORDER BY v.started_at DESC
+                LIMIT ? OFFSET ?
+                ''', (limit, offset)).fetchall()
+            return [dict(row) for row in rows]
             
-            if count > self.max_results:
-                # Calculate how many to delete
-                to_delete = count - self.max_results
-                
-                # Get the oldest results to delete
-                cursor.execute('''
-                SELECT id, image_path, annotated_path, result_path 
-                FROM detections 
-                ORDER BY timestamp ASC 
-                LIMIT ?
-                ''', (to_delete,))
-                
-                old_results = cursor.fetchall()
-                
-                # Delete files and database entries
-                for result in old_results:
-                    result_id, img_path, ann_path, res_path = result
+        except Exception as e:
+            logger.error(f"Error getting visits: {str(e)}")
+            return []
+    
+    def _thumbnail_bytes(self) -> int:
+        """Size of the cached thumbnails, which count toward max_storage_gb"""
+        return self.thumbnails.total_bytes if self.thumbnails is not None else 0
+    
+    def _over_limit(self, count: int, total_bytes: int, factor: float = 1.0) -> bool:
+        """Check whether the result count or size exceeds its limit times factor"""
+        if count > self.max_results * factor:
+            return True
+        return self.max_storage_bytes is not None and total_bytes > self.max_storage_bytes * factor
+    
+    def _retention_loop(self):
+        """Run retention on a schedule, or early when woken at the high-water mark"""
+        while not self._retention_stop.is_set():
+            self._retention_wakeup.wait(self.retention_interval)
+            self._retention_wakeup.clear()
+            if self._retention_stop.is_set():
+                break
+            self._cleanup_old_results()
+    
+    def _cleanup_old_results(self) -> int:
+        """
+        Delete the oldest results until both the count and size limits are met
+        
+        Each batch is selected and removed with a single ranged DELETE in one
+        short writer transaction; files are unlinked after the commit so the
+        writer lock is never held across file system calls.
+        
+        Returns:
+            Number of results deleted
+        """
+        deleted = 0
+        try:
+            while not self._retention_stop.is_set():
+                with self.pool.writer() as conn:
+                    cursor = conn.cursor()
+                    
+                    cursor.execute("SELECT kind, count FROM detection_counts WHERE kind IN ('total', 'bytes')")
+                    totals = dict(cursor.fetchall())
+                    count, result_bytes = totals.get("total", 0), totals.get("bytes", 0)
+                    thumbnail_bytes = self._thumbnail_bytes()
+                    total_bytes = result_bytes + thumbnail_bytes
+                    if not self._over_limit(count, total_bytes):
+                        break
+                    
+                    # Oldest results, enough to satisfy the count limit
+                    cursor.execute('''
+                    SELECT id, timestamp, image_path, annotated_path, result_path,
+                           bird_detected, has_species, species, confidence, file_size
+                    FROM detections
+                    ORDER BY timestamp ASC, id ASC
+                    LIMIT ?
+                    ''', (self.retention_batch_size,))
+                    candidates = cursor.fetchall()
+                    if not candidates:
+                        break
+                    
+                    # Take rows until both limits are met (or the batch is exhausted).
+                    # Each result's thumbnails go with it; assume they hold its share.
+                    thumbnail_share = 1.0 + thumbnail_bytes / result_bytes if result_bytes > 0 else 1.0
+                    batch = []
+                    for row in candidates:
+                        if not self._over_limit(count, total_bytes):
+                            break
+                        batch.append(row)
+                        count -= 1
+                        total_bytes -= (row["file_size"] or 0) * thumbnail_share
                     
-                    # Delete files if they exist
-                    for path in [img_path, ann_path, res_path]:
+                    # Everything up to the newest selected row, in one statement
+                    last = batch[-1]
+                    cursor.execute('''
+                    DELETE FROM detections
+                    WHERE timestamp < ? OR (timestamp = ? AND id <= ?)
+                    ''', (last["timestamp"], last["timestamp"], last["id"]))
+                    if self.fts_enabled:
+                        cursor.executemany('DELETE FROM detections_fts WHERE rowid = ?',
+                                           [(row["id"],) for row in batch])
+                    # Visits that ended before the newest deleted result go with it
+                    cursor.execute('DELETE FROM visits WHERE ended_at <= ?', (last["timestamp"],))
+                    self._update_counters(cursor, [
+                        (row["timestamp"], row["bird_detected"], row["has_species"],
+                         row["species"], row["confidence"], row["file_size"])
+                        for row in batch
+                    ], sign=-1)
+                
+                # Unlink outside the transaction; thumbnails first, their key needs the file
+                for row in batch:
+                    for path in (row["image_path"], row["annotated_path"], row["result_path"]):
                         if path and os.path.exists(path):
                             try:
+                                if self.thumbnails is not None:
+                                    self.thumbnails.delete(path)
                                 os.remove(path)
                             except Exception as e:
                                 logger.warning(f"Could not delete {path}: {str(e)}")
-                    
-                    # Delete database entry
-                    cursor.execute('DELETE FROM detections WHERE id = ?', (result_id,))
                 
-                conn.commit()
-                logger.info(f"Cleaned up {len(old_results)} old results")
+                deleted += len(batch)
             
-            conn.close()
+            if deleted:
+                logger.info(f"Cleaned up {deleted} old results")
             
         except Exception as e:
             logger.error(f"Error cleaning up old results: {str(e)}")
+        
+        return deleted
+    
+    def _filter_conditions(self, bird_only: bool, with_species: bool) -> List[str]:
+        """Build WHERE conditions for the listing filters"""
+        conditions = []
+        if bird_only:
+            conditions.append('bird_detected = 1')
+        if with_species:
+            conditions.append('has_species = 1')
+        return conditions
     
     def get_recent_results(self, limit: int = 100, 
                           bird_only: bool = False, 
-                          with_species: bool = False) -> List[Dict]:
+                          with_species: bool = False,
+                          before: Optional[Tuple[str, int]] = None,
+                          offset: int = 0) -> List[Dict]:
         """
-        Get recent detection results
+        Get recent detection results, newest first
         
         Args:
             limit: Maximum number of results to return
             bird_only: Only include results with birds detected
             with_species: Only include results with species identification
+            before: Keyset cursor (timestamp, id); only results older than it are returned
+            offset: Number of results to skip (ignored when before is given)
             
         Returns:
             List of result dictionaries
         """
         try:
-            conn = sqlite3.connect(self.db_path)
-            conn.row_factory = sqlite3.Row  # Return rows as dictionaries
-            cursor = conn.cursor()
-            
             query = '''
             SELECT * FROM detections
             '''
+            params = []
             
-            conditions = []
-            if bird_only:
-                conditions.append('bird_detected = 1')
-            if with_species:
-                conditions.append('has_species = 1')
-            
+            conditions = self._filter_conditions(bird_only, with_species)
+            if before is not None:
+                # Seek on the (timestamp, id) index instead of skipping rows
+                conditions.append('(timestamp < ? OR (timestamp = ? AND id < ?))')
+                params.extend([before[0], before[0], before[1]])
             if conditions:
                 query += ' WHERE ' + ' AND '.join(conditions)
             
             query += ''' 
-            ORDER BY timestamp DESC
+            ORDER BY timestamp DESC, id DESC
             LIMIT ?
             '''
+            params.append(limit)
+            if offset and before is None:
+                query += ' OFFSET ?'
+                params.append(offset)
             
-            cursor.execute(query, (limit,))
-            results = [dict(row) for row in cursor.fetchall()]
-            
-            conn.close()
-            
-            return results
+            with self.pool.reader() as conn:
+                return [dict(row) for row in conn.execute(query, params).fetchall()]
             
         except Exception as e:
             logger.error(f"Error getting recent results: {str(e)}")
             return []
     
+    def count_results(self, bird_only: bool = False, with_species: bool = False) -> int:
+        """
+        Count detection results matching the listing filters
+        
+        Args:
+            bird_only: Only count results with birds detected
+            with_species: Only count results with species identification
+            
+        Returns:
+            Number of matching results
+        """
+        # A species identification implies a bird detection
+        if with_species:
+            kind = "species_identified"
+        elif bird_only:
+            kind = "bird"
+        else:
+            kind = "total"
+        
+        try:
+            with self.pool.reader() as conn:
+                row = conn.execute('SELECT count FROM detection_counts WHERE kind = ? AND key = ?',
+                                   (kind, "")).fetchone()
+            return row[0] if row else 0
+            
+        except Exception as e:
+            logger.error(f"Error counting results: {str(e)}")
+            return 0
+    
     def get_result_by_id(self, result_id: int) -> Optional[Dict]:
         """
         Get a specific result by its ID
@@ -367,14 +745,8 @@ class ResultStorage:
             Result dictionary or None if not found
         """
         try:
-            conn = sqlite3.connect(self.db_path)
-            conn.row_factory = sqlite3.Row
-            cursor = conn.cursor()
-            
-            cursor.execute('SELECT * FROM detections WHERE id = ?', (result_id,))
-            row = cursor.fetchone()
-            
-            conn.close()
+            with self.pool.reader() as conn:
+                row = conn.execute('SELECT * FROM detections WHERE id = ?', (result_id,)).fetchone()
             
             if row:
                 # Load the full JSON result file if available
@@ -418,17 +790,56 @@ class ResultStorage:
         Returns:
             List of matching result dictionaries
         """
-        try:
-            conn = sqlite3.connect(self.db_path)
-            conn.row_factory = sqlite3.Row
-            cursor = conn.cursor()
+        return self.search_with_facets(query, start_date, end_date, min_confidence,
+                                       species, limit, facets=False)["results"]
+    
+    def search_with_facets(self,
+                           query: str = None,
+                           start_date: str = None,
+                           end_date: str = None,
+                           min_confidence: float = None,
+                           species: str = None,
+                           limit: int = 100,
+                           facets: bool = True) -> Dict:
+        """
+        Search for results and count the matches per species and day
+        
+        Text and species filters go through the FTS5 index when available
+        (word-prefix matching), otherwise through LIKE. Results and facets are
+        read in one read transaction, so they describe the same snapshot.
+        
+        Args:
+            query: Text search query (species, class names, notes, source)
+            start_date: Start date in ISO format
+            end_date: End date in ISO format
+            min_confidence: Minimum confidence threshold
+            species: Species name to search for
+            limit: Maximum number of results to return
+            facets: Whether to compute species x day facet counts
             
+        Returns:
+            Dictionary with "results" (newest first), "facets" (list of
+            {"species", "date", "count"}) and "total" (number of matches)
+        """
+        try:
             query_parts = []
             params = []
             
-            if query:
-                query_parts.append("(species LIKE ? OR source LIKE ?)")
-                params.extend([f"%{query}%", f"%{query}%"])
+            if self.fts_enabled and (query or species):
+                fts_terms = []
+                if query:
+                    fts_terms.append(self._fts_query(query))
+                if species:
+                    fts_terms.append(self._fts_query(species, column="species"))
+                query_parts.append("id IN (SELECT rowid FROM detections_fts WHERE detections_fts MATCH ?)")
+                params.append(" AND ".join(fts_terms))
+            else:
+                if query:
+                    query_parts.append("(species LIKE ? OR source LIKE ?)")
+                    params.extend([f"%{query}%", f"%{query}%"])
+                if species:
+                    query_parts.append("species LIKE ?")
+                    params.append(f"%{species}%")
             
             if start_date:
                 query_parts.append("timestamp >= ?")
@@ -442,27 +853,33 @@ class ResultStorage:
                 query_parts.append("confidence >= ?")
                 params.append(min_confidence)
             
-            if species:
-                query_parts.append("species LIKE ?")
-                params.append(f"%{species}%")
-            
-            base_query = "SELECT * FROM detections"
+            where = ""
             if query_parts:
-                base_query += " WHERE " + " AND ".join(query_parts)
-            
-            base_query += " ORDER BY timestamp DESC LIMIT ?"
-            params.append(limit)
-            
-            cursor.execute(base_query, params)
-            results = [dict(row) for row in cursor.fetchall()]
-            
-            conn.close()
-            
-            return results
+                where = " WHERE " + " AND ".join(query_parts)
+            
+            with self.pool.reader() as conn:
+                # One snapshot for the page and the facets
+                conn.execute("BEGIN")
+                results = [dict(row) for row in conn.execute(
+                    f"SELECT * FROM detections{where} ORDER BY timestamp DESC LIMIT ?",
+                    params + [limit]).fetchall()]
+                
+                facet_counts = []
+                total = len(results)
+                if facets:
+                    rows = conn.execute(
+                        f"SELECT species, substr(timestamp, 1, 10) AS date, COUNT(*) AS count "
+                        f"FROM detections{where} GROUP BY species, date ORDER BY date DESC, count DESC",
+                        params).fetchall()
+                    facet_counts = [{"species": row["species"], "date": row["date"], "count": row["count"]}
+                                    for row in rows]
+                    total = sum(facet["count"] for facet in facet_counts)
+            
+            return {"results": results, "facets": facet_counts, "total": total}
             
         except Exception as e:
             logger.error(f"Error searching results: {str(e)}")
-            return []
+            return {"results": [], "facets": [], "total": 0}
     
     def get_stats(self) -> Dict:
         """
@@ -472,53 +889,50 @@ class ResultStorage:
             Dictionary with statistics
         """
         try:
-            conn = sqlite3.connect(self.db_path)
-            cursor = conn.cursor()
-            
-            stats = {}
-            
-            # Total detections
-            cursor.execute('SELECT COUNT(*) FROM detections')
-            stats["total_detections"] = cursor.fetchone()[0]
-            
-            # Bird detections
-            cursor.execute('SELECT COUNT(*) FROM detections WHERE bird_detected = 1')
-            stats["bird_detections"] = cursor.fetchone()[0]
-            
-            # Species identified
-            cursor.execute('SELECT COUNT(*) FROM detections WHERE has_species = 1')
-            stats["species_identified"] = cursor.fetchone()[0]
-            
-            # Average confidence
-            cursor.execute('SELECT AVG(confidence) FROM detections WHERE bird_detected = 1')
-            avg_confidence = cursor.fetchone()[0]
-            stats["average_confidence"] = avg_confidence if avg_confidence else 0.0
-            
-            # Most common species
-            cursor.execute('''
-            SELECT species, COUNT(*) as count
-            FROM detections
-            WHERE has_species = 1
-            GROUP BY species
-            ORDER BY count DESC
-            LIMIT 5
-            ''')
-            stats["top_species"] = [{"species": row[0], "count": row[1]} for row in cursor.fetchall()]
-            
-            # Detection counts by date
-            cursor.execute('''
-            SELECT substr(timestamp, 1, 10) as date, COUNT(*) as count
-            FROM detections
-            GROUP BY date
-            ORDER BY date DESC
-            LIMIT 7
-            ''')
-            stats["recent_counts"] = [{"date": row[0], "count": row[1]} for row in cursor.fetchall()]
-            
-            conn.close()
+            with self.pool.reader() as conn:
+                cursor = conn.cursor()
+                
+                stats = {}
+                
+                # Totals from the materialized counters
+                cursor.execute('''
+                SELECT kind, count, confidence_sum FROM detection_counts
+                WHERE kind IN ('total', 'bird', 'species_identified')
+                ''')
+                totals = {row[0]: (row[1], row[2]) for row in cursor.fetchall()}
+                birds, confidence_sum = totals.get("bird", (0, 0.0))
+                stats["total_detections"] = totals.get("total", (0, 0.0))[0]
+                stats["bird_detections"] = birds
+                stats["species_identified"] = totals.get("species_identified", (0, 0.0))[0]
+                stats["average_confidence"] = confidence_sum / birds if birds else 0.0
+                
+                # Most common species
+                cursor.execute('''
+                SELECT key, count FROM detection_counts
+                WHERE kind = 'species' AND count > 0
+                ORDER BY count DESC
+                LIMIT 5
+                ''')
+                stats["top_species"] = [{"species": row[0], "count": row[1]} for row in cursor.fetchall()]
+                
+                # Detection counts by date
+                cursor.execute('''
+                SELECT key, count FROM detection_counts
+                WHERE kind = 'day' AND count > 0
+                ORDER BY key DESC
+                LIMIT 7
+                ''')
+                stats["recent_counts"] = [{"date": row[0], "count": row[1]} for row in cursor.fetchall()]
             
             return stats
             
         except Exception as e:
             logger.error(f"Error getting stats: {str(e)}")
-            return {"error": str(e)} 
\ No newline at end of file
+            return {"error": str(e)}
+    
+    def close(self):
+        """Stop the retention thread and close the database connections"""
+        self._retention_stop.set()
+        self._retention_wakeup.set()
+        self._retention_thread.join(timeout=10.0)
+        self.pool.close()
@@ -0,0 +1,296 @@
+"""
+Thumbnail cache for serving downscaled result images.
+Thumbnails are content-addressed by the source file's identity (path, size
+and modification time), so a key doubles as the HTTP ETag and never goes stale.
+The cache is kept under a size cap by evicting the least recently used
+thumbnails (a hit refreshes the file's mtime); evicted ones are regenerated
+on the next request.
+"""
+import os
+import hashlib
+import logging
+import threading
+from contextlib import contextmanager
+from concurrent.futures import ThreadPoolExecutor
+from typing import List, Optional, Sequence, Tuple
+
+import cv2
+
+# Set up logging
+logging.basicConfig(level=logging.INFO,
+                    format='%(asctime)s - %(name)s - %(levelname)s - %(message)s')
+logger = logging.getLogger(__name__)
+
+# Pruning evicts down to this fraction of the cap, so it does not run on every write
+PRUNE_TARGET = 0.9
+
+
+class ThumbnailCache:
+    """On-disk cache of resized images keyed by source content"""
+
+    def __init__(self, cache_dir: str, sizes: Sequence[int] = (320, 960),
+                 image_format: str = "jpg", quality: int = 80,
+                 max_size_mb: Optional[float] = None):
+        """
+        Initialize the thumbnail cache
+
+        Args:
+            cache_dir: Directory for cached thumbnails
+            sizes: Thumbnail widths in pixels; requested widths snap up to one of these
+            image_format: "jpg" or "webp"
+            quality: Encoder quality (0-100)
+            max_size_mb: Evict least recently used thumbnails above this size (None for no cap)
+        """
+        self.cache_dir = os.path.abspath(cache_dir)
+        self.sizes = sorted(sizes)
+        self.image_format = image_format.lower()
+        self.quality = quality
+        self.max_size_bytes = int(max_size_mb * 1024 ** 2) if max_size_mb else None
+        os.makedirs(self.cache_dir, exist_ok=True)
+
+        # Bytes on disk, kept current on every write and delete
+        self._size_lock = threading.Lock()
+        self._total_bytes = sum(size for _, size, _ in self._scan())
+        self._prune_lock = threading.Lock()
+
+        # Resizing runs off the inference and request threads where possible
+        self._executor = ThreadPoolExecutor(max_workers=1, thread_name_prefix="thumbnails")
+        self._locks = {}  # path -> [lock, holders]
+        self._locks_lock = threading.Lock()
+
+    @property
+    def total_bytes(self) -> int:
+        """Size of the cached thumbnails in bytes"""
+        with self._size_lock:
+            return self._total_bytes
+
+    def _add_bytes(self, amount: int):
+        """Adjust the size counter"""
+        with self._size_lock:
+            self._total_bytes = max(0, self._total_bytes + amount)
+
+    @property
+    def mimetype(self) -> str:
+        """MIME type of the cached thumbnails"""
+        return "image/webp" if self.image_format == "webp" else "image/jpeg"
+
+    def content_key(self, source_path: str) -> str:
+        """
+        Get the content key (and ETag) of a file
+
+        Args:
+            source_path: Path to the source image
+
+        Returns:
+            Hex digest identifying the file's current content
+        """
+        stat = os.stat(source_path)
+        identity = f"{os.path.realpath(source_path)}:{stat.st_size}:{stat.st_mtime_ns}"
+        return hashlib.sha1(identity.encode("utf-8")).hexdigest()
+
+    def snap_width(self, width: int) -> Optional[int]:
+        """Snap a requested width to the smallest cached size that covers it (None for full size)"""
+        for size in self.sizes:
+            if width <= size:
+                return size
+        return None
+
+    def _thumbnail_path(self, key: str, width: int) -> str:
+        """Path of a cached thumbnail, sharded by the key's first byte"""
+        return os.path.join(self.cache_dir, key[:2], f"{key}_w{width}.{self.image_format}")
+
+    def get(self, source_path: str, width: int) -> Optional[str]:
+        """
+        Get a thumbnail, generating it on a cache miss
+
+        Args:
+            source_path: Path to the source image
+            width: Requested width in pixels
+
+        Returns:
+            Path to the thumbnail, or None if the full-size image should be served
+        """
+        width = self.snap_width(width)
+        if width is None:
+            return None
+
+        key = self.content_key(source_path)
+        path = self._thumbnail_path(key, width)
+        if os.path.exists(path):
+            self._touch(path)
+            return path
+
+        # One encoder per thumbnail; concurrent requests wait for it
+        with self._path_lock(path):
+            if not os.path.exists(path):
+                self._generate(source_path, key, [width])
+
+        return path if os.path.exists(path) else None
+
+    @contextmanager
+    def _path_lock(self, path: str):
+        """Hold the lock of one thumbnail path; it is dropped once nobody holds or waits for it"""
+        with self._locks_lock:
+            entry = self._locks.get(path)
+            if entry is None:
+                entry = self._locks[path] = [threading.RLock(), 0]
+            entry[1] += 1
+        try:
+            with entry[0]:
+                yield
+        finally:
+            with self._locks_lock:
+                entry[1] -= 1
+                if entry[1] == 0:
+                    del self._locks[path]
+
+    def generate_async(self, source_path: str):
+        """Queue generation of all thumbnail sizes for an image"""
+        self._executor.submit(self._generate_all, source_path)
+
+    def _generate_all(self, source_path: str):
+        """Generate all missing thumbnail sizes for an image"""
+        try:
+            if os.path.exists(source_path):
+                self._generate(source_path, self.content_key(source_path), self.sizes)
+        except Exception as e:
+            logger.error(f"Error generating thumbnails for {source_path}: {str(e)}")
+
+    def _generate(self, source_path: str, key: str, widths: Sequence[int]):
+        """Decode the source once and write the requested thumbnail widths"""
+        missing = [w for w in widths if not os.path.exists(self._thumbnail_path(key, w))]
+        if not missing:
+            return
+
+        image = cv2.imread(source_path)
+        if image is None:
+            logger.warning(f"Could not read image for thumbnails: {source_path}")
+            return
+
+        if self.image_format == "webp":
+            params = [cv2.IMWRITE_WEBP_QUALITY, self.quality]
+        else:
+            params = [cv2.IMWRITE_JPEG_QUALITY, self.quality]
+
+        height, source_width = image.shape[:2]
+        # Largest first, each downscaled from the previous one
+        for width in sorted(missing, reverse=True):
+            if width < source_width:
+                image = cv2.resize(image, (width, max(1, round(height * width / source_width))),
+                                   interpolation=cv2.INTER_AREA)
+                height, source_width = image.shape[:2]
+
+            path = self._thumbnail_path(key, width)
+            with self._path_lock(path):
+                # A request or the background worker may have written it meanwhile
+                if os.path.exists(path):
+                    continue
+
+                ok, buffer = cv2.imencode(f".{self.image_format}", image, params)
+                if not ok:
+                    logger.warning(f"Could not encode {self.image_format} thumbnail for {source_path}")
+                    continue
+
+                os.makedirs(os.path.dirname(path), exist_ok=True)
+                # Write then rename so readers never see a partial file
+                temp_path = f"{path}.{threading.get_ident()}.tmp"
+                data = buffer.tobytes()
+                with open(temp_path, "wb") as f:
+                    f.write(data)
+                os.replace(temp_path, path)
+                self._add_bytes(len(data))
+
+        if self.max_size_bytes is not None and self.total_bytes > self.max_size_bytes:
+            self.prune()
+
+    def _touch(self, path: str):
+        """Mark a thumbnail as recently used"""
+        try:
+            os.utime(path)
+        except OSError:
+            pass
+
+    def _remove(self, path: str) -> int:
+        """Delete one cached file; returns the bytes freed"""
+        try:
+            size = os.path.getsize(path)
+            os.remove(path)
+        except OSError:
+            return 0
+        self._add_bytes(-size)
+        return size
+
+    def _scan(self) -> List[Tuple[str, int, float]]:
+        """List the cached thumbnails as (path, size, mtime)"""
+        entries = []
+        for root, _, files in os.walk(self.cache_dir):
+            for name in files:
+                if name.endswith(".tmp"):
+                    continue
+                path = os.path.join(root, name)
+                try:
+                    stat = os.stat(path)
+                except OSError:
+                    continue
+                entries.append((path, stat.st_size, stat.st_mtime))
+        return entries
+
+    def delete(self, source_path: str) -> int:
+        """
+        Delete every cached thumbnail of an image
+
+        Must be called before the image itself is removed, since the key is
+        derived from the file.
+
+        Args:
+            source_path: Path to the source image
+
+        Returns:
+            Bytes freed
+        """
+        try:
+            key = self.content_key(source_path)
+        except OSError:
+            return 0
+
+        shard = os.path.join(self.cache_dir, key[:2])
+        try:
+            names = os.listdir(shard)
+        except OSError:
+            return 0
+        # Every width, including sizes no longer configured
+        return sum(self._remove(os.path.join(shard, name)) for name in names
+                   if name.startswith(f"{key}_w") and not name.endswith(".tmp"))
+
+    def prune(self) -> int:
+        """
+        Evict the least recently used thumbnails until the cache is back under its cap
+
+        Returns:
+            Number of thumbnails deleted
+        """
+        if self.max_size_bytes is None or not self._prune_lock.acquire(blocking=False):
+            return 0
+        try:
+            # Sizes are re-read from disk, which also corrects any drift in the counter
+            entries = sorted(self._scan(), key=lambda entry: entry[2])
+            with self._size_lock:
+                self._total_bytes = sum(size for _, size, _ in entries)
+
+            target = self.max_size_bytes * PRUNE_TARGET
+            removed = 0
+            for path, _, _ in entries:
+                if self.total_bytes <= target:
+                    break
+                if self._remove(path):
+                    removed += 1
+
+            if removed:
+                logger.info(f"Evicted {removed} thumbnails ({self.total_bytes / 1024 ** 2:.1f} MB cached)")
+            return removed
+        finally:
+            self._prune_lock.release()
+
+    def close(self):
+        """Wait for queued thumbnail jobs"""
+        self._executor.shutdown(wait=True)
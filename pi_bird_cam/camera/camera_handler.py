@@ -3,8 +3,17 @@ import os
 import time
 import logging
 import platform
+import threading
+import subprocess
+from collections import deque
+from queue import Queue
 from datetime import datetime
 
+import numpy as np
+from PIL import Image
+
+from .frame_buffer import FrameRingBuffer
+
 # Configure logging
 logging.basicConfig(level=logging.DEBUG)
 logger = logging.getLogger(__name__)
@@ -14,14 +23,13 @@ IS_RASPBERRY_PI = platform.system() == 'Linux' and os.path.exists('/proc/device-
 
 # Import picamera2 modules
 if IS_RASPBERRY_PI:
-    from picamera2 import Picamera2
-    from picamera2.encoders import JpegEncoder
-    from picamera2.outputs import FileOutput
+    from picamera2 import Picamera2, MappedArray
+    from picamera2.encoders import JpegEncoder, MJPEGEncoder, H264Encoder
+    from picamera2.outputs import FileOutput, Output
 else:
     # For development on non-Raspberry Pi systems
     import sys
     import types
-    from PIL import Image
     import numpy as np
     
     # Create mock modules
@@ -30,14 +38,17 @@ else:
     
     sys.modules['picamera2.encoders'] = types.ModuleType('picamera2.encoders')
     sys.modules['picamera2.encoders'].JpegEncoder = type('JpegEncoder', (), {})
+    sys.modules['picamera2.encoders'].MJPEGEncoder = type('MJPEGEncoder', (), {})
+    sys.modules['picamera2.encoders'].H264Encoder = type('H264Encoder', (), {'__init__': lambda self, *args, **kwargs: None})
     
     sys.modules['picamera2.outputs'] = types.ModuleType('picamera2.outputs')
     sys.modules['picamera2.outputs'].FileOutput = type('FileOutput', (), {'__init__': lambda self, filename: None})
+    sys.modules['picamera2.outputs'].Output = type('Output', (), {'__init__': lambda self, pts=None: None})
     
     # Import our mocks
     from picamera2 import Picamera2
-    from picamera2.encoders import JpegEncoder
-    from picamera2.outputs import FileOutput
+    from picamera2.encoders import JpegEncoder, MJPEGEncoder, H264Encoder
+    from picamera2.outputs import FileOutput, Output
 
 class MockPicamera2:
     """Mock Picamera2 class for development on non-Raspberry Pi systems."""
@@ -76,6 +87,38 @@ class MockPicamera2:
         """Create a still configuration."""
         return {"size": main if main else (1920, 1080)}
         
+    def create_video_configuration(self, main=None, **kwargs):
+        """Create a video configuration."""
+        return {"size": main if main else (1920, 1080), "controls": kwargs.get("controls", {})}
+        
+    def switch_mode(self, config):
+        """Switch to another configuration while running."""
+        self.configure(config)
+        
+    def start_encoder(self, encoder, output, **kwargs):
+        """Feed mock JPEG frames to an output until stop_encoder is called."""
+        import io
+        self._encoding = threading.Event()
+        self._encoding.set()
+        frame_rate = (self.config or {}).get("controls", {}).get("FrameRate", 30)
+        
+        buffer = io.BytesIO()
+        Image.new('RGB', (640, 360), color=(73, 109, 137)).save(buffer, "JPEG")
+        frame = buffer.getvalue()
+        
+        def feed():
+            while self._encoding.is_set():
+                output.outputframe(frame, True, time.monotonic_ns() // 1000)
+                time.sleep(1.0 / frame_rate)
+        
+        self._encoder_thread = threading.Thread(target=feed, daemon=True)
+        self._encoder_thread.start()
+        
+    def stop_encoder(self, *args):
+        """Stop feeding frames to the output."""
+        self._encoding.clear()
+        self._encoder_thread.join()
+        
     def configure(self, config):
         """Configure the camera."""
         self.config = config
@@ -117,6 +160,292 @@ class MockPicamera2:
     def camera_configuration(self):
         """Return camera configuration."""
         return self.camera_config
+    
+    def capture_request(self):
+        """Capture a request holding the buffers of all configured streams."""
+        if not self._is_started:
+            self.start()
+        lores_size = (self.config or {}).get("lores", {}).get("size", (320, 240))
+        return MockCompletedRequest((1920, 1080), lores_size)
+
+
+class MockCompletedRequest:
+    """Mock picamera2 CompletedRequest for development on non-Raspberry Pi systems."""
+    
+    def __init__(self, main_size, lores_size):
+        self.main_size = main_size
+        self.lores_size = lores_size
+    
+    def make_array(self, name):
+        """Return the stream buffer as a numpy array (lores is YUV420 like on the Pi)."""
+        if name == "lores":
+            width, height = self.lores_size
+            return np.full((height * 3 // 2, width), 128, dtype=np.uint8)
+        width, height = self.main_size
+        return np.full((height, width, 3), (73, 109, 137), dtype=np.uint8)
+    
+    def make_image(self, name):
+        """Return the stream buffer as a PIL image."""
+        return Image.fromarray(self.make_array(name))
+    
+    def get_metadata(self):
+        """Return the frame metadata."""
+        return {"SensorTimestamp": time.monotonic_ns()}
+    
+    def release(self):
+        """Return the buffers to the camera."""
+        pass
+
+
+class CapturedFrame:
+    """A frame captured in memory instead of being written straight to a JPEG.
+    
+    Attributes:
+        lores (numpy.ndarray): Low-resolution RGB frame (height, width, 3) for inference
+        image (PIL.Image.Image): Full-resolution image for storage
+        timestamp (float): Capture time (time.time())
+        metadata (dict): Frame metadata reported by the camera
+    """
+    
+    def __init__(self, lores, image, timestamp, metadata=None):
+        self.lores = lores
+        self.image = image
+        self.timestamp = timestamp
+        self.metadata = metadata or {}
+
+
+class BurstOutput(Output):
+    """picamera2 output that hands encoded JPEG frames to a writer queue.
+    
+    The encoder thread only enqueues the frame bytes; files are written by
+    CameraHandler's background writer so disk I/O never stalls the encoder.
+    """
+    
+    def __init__(self, count, on_frame):
+        """Initialize the output.
+        
+        Args:
+            count (int): Number of frames to accept
+            on_frame (callable): Called with (index, jpeg_bytes, timestamp_us) per frame
+        """
+        super().__init__()
+        self.count = count
+        self.on_frame = on_frame
+        self.frames_received = 0
+        self.done = threading.Event()
+    
+    def outputframe(self, frame, keyframe=True, timestamp=None, *args, **kwargs):
+        """Receive one encoded frame from the encoder."""
+        if self.frames_received >= self.count:
+            return
+        self.on_frame(self.frames_received, bytes(frame), timestamp)
+        self.frames_received += 1
+        if self.frames_received >= self.count:
+            self.done.set()
+
+
+class ClipOutput(Output):
+    """picamera2 output that keeps an H.264 pre-roll and records clips from it.
+    
+    The encoder runs continuously. While no clip is recording, encoded frames
+    are kept in memory for the last preroll_seconds, always starting at a
+    keyframe so a clip is decodable from its first frame. start_clip() writes
+    the pre-roll to a raw .h264 file and appends every later frame until
+    stop_clip(). While recording, keyframes (which carry their own SPS/PPS
+    with repeat=True) are handed to a callback at most once per
+    sample_interval, so they can be sent for inference on their own.
+    """
+    
+    def __init__(self, preroll_seconds=3.0, sample_interval=1.0):
+        """Initialize the output.
+        
+        Args:
+            preroll_seconds (float): Seconds of video kept from before a trigger
+            sample_interval (float): Minimum seconds between sampled keyframes
+        """
+        super().__init__()
+        self.preroll_us = int(preroll_seconds * 1e6)
+        self.sample_interval_us = int(sample_interval * 1e6)
+        self._lock = threading.Lock()
+        self._ring = deque()  # (timestamp_us, keyframe, data), oldest first
+        self._ring_keyframes = deque()  # Timestamps of the keyframes in the ring
+        self._file = None
+        self._on_keyframe = None
+        self._first_us = None
+        self._last_us = None
+        self._last_sample_us = None
+        self.clip_path = None
+        self.frames = 0
+        self.keyframes_sampled = 0
+    
+    @property
+    def recording(self):
+        """Whether a clip is being written."""
+        return self._file is not None
+    
+    def outputframe(self, frame, keyframe=True, timestamp=None, *args, **kwargs):
+        """Receive one encoded frame from the encoder."""
+        if timestamp is None:
+            timestamp = time.monotonic_ns() // 1000
+        data = bytes(frame)
+        sample = None
+        with self._lock:
+            if self._file is None:
+                self._buffer(timestamp, keyframe, data)
+                return
+            if self.frames == 0:
+                if not keyframe:
+                    return  # Empty pre-roll: start the clip at the next keyframe
+                self._first_us = timestamp
+            self._file.write(data)
+            self.frames += 1
+            self._last_us = timestamp
+            if keyframe:
+                sample = self._sample(timestamp, data)
+        # Outside the lock: the callback may queue work, the encoder must not wait on it
+        if sample is not None:
+            self._on_keyframe(*sample)
+    
+    def _buffer(self, timestamp, keyframe, data):
+        """Add a frame to the pre-roll and drop what is no longer needed. Caller holds the lock."""
+        if keyframe:
+            self._ring_keyframes.append(timestamp)
+        elif not self._ring:
+            return  # Nothing decodes before the first keyframe
+        self._ring.append((timestamp, keyframe, data))
+        
+        # Start at the newest keyframe that still covers the whole pre-roll
+        while len(self._ring_keyframes) > 1 and timestamp - self._ring_keyframes[1] >= self.preroll_us:
+            self._ring_keyframes.popleft()
+            while self._ring[0][0] < self._ring_keyframes[0]:
+                self._ring.popleft()
+    
+    def _sample(self, timestamp, data):
+        """Return callback arguments if this keyframe is due to be sampled. Caller holds the lock."""
+        if self._on_keyframe is None:
+            return None
+        # 10% slack so encoder timestamp jitter does not skip every other keyframe
+        if (self._last_sample_us is not None
+                and timestamp - self._last_sample_us < 0.9 * self.sample_interval_us):
+            return None
+        self._last_sample_us = timestamp
+        index = self.keyframes_sampled
+        self.keyframes_sampled += 1
+        return data, (timestamp - self._first_us) / 1e6, index
+    
+    def start_clip(self, path, on_keyframe=None):
+        """Write the pre-roll to a new raw H.264 file and keep recording into it.
+        
+        Args:
+            path (str): Path of the raw .h264 file
+            on_keyframe (callable, optional): Called with (keyframe_bytes,
+                offset_seconds, index) for sampled keyframes, starting with the
+                newest keyframe of the pre-roll
+                
+        Returns:
+            bool: False if a clip is already recording
+        """
+        os.makedirs(os.path.dirname(os.path.abspath(path)), exist_ok=True)
+        sample = None
+        with self._lock:
+            if self._file is not None:
+                return False
+            self._file = open(path, "wb")
+            self.clip_path = path
+            self._on_keyframe = on_keyframe
+            self.frames = len(self._ring)
+            self.keyframes_sampled = 0
+            self._last_sample_us = None
+            self._first_us = self._ring[0][0] if self._ring else None
+            self._last_us = self._ring[-1][0] if self._ring else None
+            newest_keyframe = None
+            for timestamp, keyframe, data in self._ring:
+                self._file.write(data)
+                if keyframe:
+                    newest_keyframe = (timestamp, data)
+            self._ring.clear()
+            self._ring_keyframes.clear()
+            if newest_keyframe is not None:
+                sample = self._sample(*newest_keyframe)
+        if sample is not None:
+            self._on_keyframe(*sample)
+        return True
+    
+    def stop_clip(self):
+        """Close the current clip; the pre-roll starts filling again.
+        
+        Returns:
+            dict: path, frames, duration (seconds) and keyframes sampled, or
+                  None if no clip was recording
+        """
+        with self._lock:
+            if self._file is None:
+                return None
+            self._file.close()
+            self._file = None
+            self._on_keyframe = None
+            duration = 0.0
+            if self._first_us is not None and self._last_us is not None:
+                duration = (self._last_us - self._first_us) / 1e6
+            return {"path": self.clip_path, "frames": self.frames, "duration": duration,
+                    "keyframes": self.keyframes_sampled}
+
+
+def remux_h264(h264_path, mp4_path, fps):
+    """Wrap a raw H.264 stream in an MP4 container without re-encoding.
+    
+    Args:
+        h264_path (str): Raw H.264 elementary stream (removed on success)
+        mp4_path (str): MP4 file to write
+        fps (float): Frame rate; raw H.264 carries no timestamps
+        
+    Returns:
+        str: mp4_path, or h264_path if ffmpeg is missing or failed
+    """
+    command = ["ffmpeg", "-y", "-loglevel", "error", "-framerate", str(fps), "-i", h264_path,
+               "-c", "copy", "-movflags", "+faststart", mp4_path]
+    try:
+        subprocess.run(command, check=True, capture_output=True, timeout=120)
+    except (OSError, subprocess.SubprocessError) as e:
+        logger.error(f"Could not remux {h264_path} to MP4, keeping the raw stream: {e}")
+        if os.path.exists(mp4_path):
+            os.remove(mp4_path)
+        return h264_path
+    os.remove(h264_path)
+    return mp4_path
+
+
+def yuv420_to_rgb(yuv, width, height):
+    """Convert a planar YUV420 (I420) buffer to an RGB array.
+    
+    The Pi ISP only produces YUV420 on the lores stream, so the inference frame
+    is converted here (BT.601 full range) on the already downscaled buffer.
+    
+    Args:
+        yuv (numpy.ndarray): Buffer of shape (height * 3 // 2, stride)
+        width (int): Frame width in pixels
+        height (int): Frame height in pixels
+        
+    Returns:
+        numpy.ndarray: uint8 array of shape (height, width, 3)
+    """
+    stride = yuv.shape[1]
+    flat = yuv.reshape(-1)
+    
+    y = yuv[:height, :width].astype(np.float32)
+    chroma_size = (height // 2) * (stride // 2)
+    u = flat[height * stride:height * stride + chroma_size].reshape(height // 2, stride // 2)
+    v = flat[height * stride + chroma_size:height * stride + 2 * chroma_size].reshape(height // 2, stride // 2)
+    
+    # Upsample chroma to full resolution
+    u = u[:, :width // 2].repeat(2, axis=0).repeat(2, axis=1).astype(np.float32) - 128.0
+    v = v[:, :width // 2].repeat(2, axis=0).repeat(2, axis=1).astype(np.float32) - 128.0
+    
+    rgb = np.empty((height, width, 3), dtype=np.float32)
+    rgb[..., 0] = y + 1.402 * v
+    rgb[..., 1] = y - 0.344136 * u - 0.714136 * v
+    rgb[..., 2] = y + 1.772 * u
+    return np.clip(rgb, 0, 255).astype(np.uint8)
 
 class CameraHandler:
     """Class to handle camera operations."""
@@ -125,19 +454,53 @@ class CameraHandler:
     MIN_FOCUS_DISTANCE = 8  # 20cm
     MAX_FOCUS_DISTANCE = float('inf')  # infinity
 
-    def __init__(self, resolution=(1920, 1080), rotation=0, focus_distance_inches=24):
+    def __init__(self, resolution=(1920, 1080), rotation=0, focus_distance_inches=24,
+                 lores_resolution=(320, 240), lean_setup=False):
         """Initialize the camera with specified resolution.
         
         Args:
             resolution (tuple): Camera resolution as (width, height)
             rotation (int): Camera rotation in degrees (0, 90, 180, or 270)
             focus_distance_inches (float): Focus distance in inches (8 inches to infinity)
+            lores_resolution (tuple): Size of the low-resolution stream used for
+                                      in-memory inference frames, as (width, height)
+            lean_setup (bool): Open the camera without logging every control or
+                               waiting for exposure to settle (see setup)
         """
         self.resolution = resolution
         self.rotation = rotation
         self.focus_distance_inches = focus_distance_inches
+        self.lores_resolution = lores_resolution
+        self.lean_setup = lean_setup
         self.camera = None
         self.logger = logging.getLogger(__name__)
+        
+        # Background JPEG writer for frames captured in memory
+        self._write_queue = Queue()
+        self._writer_thread = None
+        
+        # Still configuration, built once and reused by every setup and
+        # restored after a burst or video mode
+        self._still_config = None
+        self._still_config_key = None
+        
+        # Whether the sensor is streaming; False while in standby
+        self._streaming = False
+        
+        # Pre-trigger frame ring buffer (see start_preroll)
+        self.preroll_buffer = None
+        self._preroll_thread = None
+        self._preroll_stop = threading.Event()
+        self._preroll_fps = None
+        self._resume_preroll = None  # (buffer_frames, fps) to restart after standby
+        
+        # Continuous H.264 encoding for clip mode (see start_video_mode)
+        self.clip_output = None
+        self._video_encoder = None
+        self._video_fps = None
+        self._clip_path = None
+        self._remux_thread = None
+        
         self.setup()
         
     def _convert_inches_to_lens_position(self, inches):
@@ -156,8 +519,38 @@ class CameraHandler:
         lens_position = 15.0 * (1.0 - normalized)
         return lens_position
         
-    def setup(self):
-        """Setup the camera."""
+    def _still_configuration(self):
+        """Return the still configuration, creating it only when the streams change.
+        
+        Returns:
+            dict: Still configuration for Picamera2.configure
+        """
+        key = (tuple(self.resolution), tuple(self.lores_resolution))
+        if self._still_config is None or self._still_config_key != key:
+            self._still_config = self.camera.create_still_configuration(
+                main={"size": self.resolution},
+                lores={"size": self.lores_resolution, "format": "YUV420"},
+                controls={
+                    # Only set what you want to override; omit the rest for defaults
+                    "AfMode": 0,  # Manual focus, if you want to control focus
+                    "LensPosition": 1.25,  # Use calculated lens position based on focus distance
+                    "AeEnable": False,  # Auto exposure (optional, usually default)
+                    "ExposureTime": 5000,  # Initial exposure time in microseconds
+                }
+            )
+            self._still_config_key = key
+        return self._still_config
+        
+    def setup(self, lean=None):
+        """Setup the camera.
+        
+        Args:
+            lean (bool, optional): Skip the control dumps and the exposure settle
+                                   delay; defaults to the lean_setup given at init.
+                                   Exposure is manual, so frames are usable as
+                                   soon as the camera starts.
+        """
+        lean = self.lean_setup if lean is None else lean
         self.logger.info(f"Setting up camera with resolution {self.resolution}")
         
         # Clean up any existing camera instance
@@ -167,6 +560,13 @@ class CameraHandler:
         # Initialize the camera
         self.camera = Picamera2()
         
+        if lean:
+            self.camera.configure(self._still_configuration())
+            self.camera.start()
+            self._streaming = True
+            self.logger.info(f"Camera started (focus distance {self.focus_distance_inches} inches)")
+            return
+        
         # Log camera properties and controls before configuration
         self.logger.debug("Camera properties before configuration:")
         self.logger.debug(f"  Properties: {self.camera.camera_properties}")
@@ -179,22 +579,14 @@ class CameraHandler:
         self.logger.info(f"Converting focus distance {self.focus_distance_inches} inches to lens position: {lens_position:.4f}")
         
         # Create and set configuration with controls
-        config = self.camera.create_still_configuration(
-            main={"size": self.resolution},
-            controls={
-                # Only set what you want to override; omit the rest for defaults
-                "AfMode": 0,  # Manual focus, if you want to control focus
-                "LensPosition": 1.25,  # Use calculated lens position based on focus distance
-                "AeEnable": False,  # Auto exposure (optional, usually default)
-                "ExposureTime": 5000,  # Initial exposure time in microseconds
-            }
-        )
+        config = self._still_configuration()
         
         self.logger.info(f"Configuring camera with controls: {config['controls']}")
         self.camera.configure(config)
         
         # Start the camera
         self.camera.start()
+        self._streaming = True
 
         # Allow time for auto exposure to settle
         time.sleep(0.5)
@@ -218,6 +610,55 @@ class CameraHandler:
         for control, value in self.camera.camera_controls.items():
             self.logger.info(f"  {control}: {value}")
         
+    @property
+    def streaming(self):
+        """Whether the camera is open and delivering frames."""
+        return self.camera is not None and self._streaming
+    
+    def standby(self):
+        """Stop streaming but keep the camera open and configured.
+        
+        The sensor stops delivering frames, which saves most of its power,
+        while the configuration stays applied so resume() only restarts it.
+        A running pre-trigger buffer is restarted by resume() as well.
+        
+        Returns:
+            bool: Whether the camera is in standby; never in video mode, whose
+                  encoder pre-roll needs every frame
+        """
+        if self.video_mode:
+            return False
+        if not self.streaming:
+            return self.camera is not None
+        if self._preroll_thread is not None and self._preroll_thread.is_alive():
+            self._resume_preroll = (self.preroll_buffer.capacity, self._preroll_fps)
+            self.stop_preroll()
+        self.camera.stop()
+        self._streaming = False
+        self.logger.info("Camera in standby")
+        return True
+    
+    def resume(self):
+        """Restart streaming after standby().
+        
+        Returns:
+            float: Seconds taken to restart the camera
+        """
+        if self.camera is None:
+            raise RuntimeError("Camera is not open")
+        if self._streaming:
+            return 0.0
+        start = time.monotonic()
+        self.camera.start()
+        self._streaming = True
+        elapsed = time.monotonic() - start
+        if self._resume_preroll is not None:
+            buffer_frames, fps = self._resume_preroll
+            self._resume_preroll = None
+            self.start_preroll(buffer_frames=buffer_frames, fps=fps)
+        self.logger.debug(f"Camera resumed in {elapsed * 1000:.0f} ms")
+        return elapsed
+        
     def take_photo(self, output_path):
         """Take a photo and save it to the specified path.
         
@@ -238,6 +679,348 @@ class CameraHandler:
         self.logger.info(f"Photo saved to {output_path}")
         return output_path
     
+    def capture_frame(self):
+        """Capture a frame into memory without encoding or writing a JPEG.
+        
+        Both streams come from the same sensor frame. The lores buffer is
+        converted to RGB for inference and the full-resolution buffer is copied
+        out so the request can go straight back to the camera.
+        
+        Returns:
+            CapturedFrame: The captured frame
+        """
+        timestamp = time.time()
+        request = self.camera.capture_request()
+        try:
+            lores = request.make_array("lores")
+            image = request.make_image("main")
+            metadata = request.get_metadata()
+        finally:
+            request.release()
+        
+        width, height = self.lores_resolution
+        lores = yuv420_to_rgb(lores, width, height)
+        
+        self.logger.debug(f"Captured in-memory frame ({width}x{height} lores)")
+        return CapturedFrame(lores, image, timestamp, metadata)
+    
+    def save_frame(self, frame, output_path):
+        """Encode a captured frame to JPEG and write it on the calling thread.
+        
+        Args:
+            frame (CapturedFrame or bytes): Frame returned by capture_frame, or
+                                            already encoded JPEG data
+            output_path (str): Path where the photo will be saved
+            
+        Returns:
+            str: Path to the saved photo
+        """
+        os.makedirs(os.path.dirname(os.path.abspath(output_path)), exist_ok=True)
+        if isinstance(frame, bytes):
+            # Already JPEG encoded (burst frames from the hardware encoder)
+            with open(output_path, "wb") as f:
+                f.write(frame)
+        else:
+            frame.image.convert("RGB").save(output_path, "JPEG", quality=90)
+        self.logger.info(f"Photo saved to {output_path}")
+        return output_path
+    
+    def save_frame_async(self, frame, output_path, on_saved=None):
+        """Encode a captured frame to JPEG and write it on a background thread.
+        
+        Args:
+            frame (CapturedFrame or bytes): Frame returned by capture_frame, or
+                                            already encoded JPEG data
+            output_path (str): Path where the photo will be saved
+            on_saved (callable, optional): Called with output_path once the file is written
+            
+        Returns:
+            str: Path the photo will be saved to
+        """
+        if self._writer_thread is None or not self._writer_thread.is_alive():
+            self._writer_thread = threading.Thread(target=self._writer_loop, daemon=True)
+            self._writer_thread.start()
+        
+        self._write_queue.put((frame, output_path, on_saved))
+        return output_path
+    
+    def wait_for_writes(self):
+        """Block until all queued frames have been written to disk."""
+        if self._writer_thread is not None and self._writer_thread.is_alive():
+            self._write_queue.join()
+    
+    def _writer_loop(self):
+        """Write queued frames to disk."""
+        while True:
+            item = self._write_queue.get()
+            if item is None:
+                self._write_queue.task_done()
+                break
+            
+            frame, output_path, on_saved = item
+            try:
+                self.save_frame(frame, output_path)
+                if on_saved:
+                    on_saved(output_path)
+            except Exception as e:
+                self.logger.error(f"Error writing frame to {output_path}: {e}")
+            finally:
+                self._write_queue.task_done()
+    
+    def start_preroll(self, buffer_frames=10, fps=10):
+        """Continuously capture lores frames into a preallocated ring buffer.
+        
+        Frames are copied from the mapped camera buffer straight into the
+        ring's slots, so no memory is allocated per frame.
+        
+        Args:
+            buffer_frames (int): Number of frames kept in the ring
+            fps (float): Capture rate for the ring
+        """
+        if self._preroll_thread is not None and self._preroll_thread.is_alive():
+            return
+        
+        width, height = self.lores_resolution
+        # Raw YUV420 slots; converted to RGB only when frames are dumped
+        self.preroll_buffer = FrameRingBuffer(buffer_frames, (height * 3 // 2, width))
+        self._preroll_fps = fps
+        self._preroll_stop.clear()
+        self._preroll_thread = threading.Thread(target=self._preroll_loop, args=(fps,), daemon=True)
+        self._preroll_thread.start()
+        self.logger.info(f"Pre-trigger buffer started ({buffer_frames} frames at {fps} fps)")
+    
+    def stop_preroll(self):
+        """Stop the pre-trigger capture thread."""
+        if self._preroll_thread is not None:
+            self._preroll_stop.set()
+            self._preroll_thread.join(timeout=2.0)
+            self._preroll_thread = None
+    
+    def _preroll_loop(self, fps):
+        """Capture lores frames into the ring buffer at a fixed rate."""
+        interval = 1.0 / fps
+        width, height = self.lores_resolution
+        next_time = time.monotonic()
+        
+        while not self._preroll_stop.is_set():
+            try:
+                request = self.camera.capture_request()
+                timestamp = time.time()
+                try:
+                    if IS_RASPBERRY_PI:
+                        with MappedArray(request, "lores") as mapped:
+                            self.preroll_buffer.push(mapped.array[:height * 3 // 2, :width], timestamp)
+                    else:
+                        self.preroll_buffer.push(request.make_array("lores")[:height * 3 // 2, :width],
+                                                 timestamp)
+                finally:
+                    request.release()
+            except Exception as e:
+                self.logger.error(f"Error capturing pre-trigger frame: {e}")
+            
+            next_time += interval
+            delay = next_time - time.monotonic()
+            if delay > 0:
+                self._preroll_stop.wait(delay)
+            else:
+                next_time = time.monotonic()
+    
+    def capture_trigger_frames(self, trigger_time=None, pre_frames=5, post_frames=5, timeout=2.0):
+        """Return frames from before and after a trigger from the pre-trigger buffer.
+        
+        Args:
+            trigger_time (float, optional): Trigger time (time.time()), defaults to now
+            pre_frames (int): Frames captured at or before the trigger
+            post_frames (int): Frames captured after the trigger
+            timeout (float): Maximum time to wait for the post-trigger frames
+            
+        Returns:
+            list: CapturedFrame objects, oldest first
+        """
+        if self.preroll_buffer is None:
+            raise RuntimeError("Pre-trigger buffer not started (call start_preroll first)")
+        
+        if trigger_time is None:
+            trigger_time = time.time()
+        
+        frames = self.preroll_buffer.frames_before(trigger_time, pre_frames)
+        frames += self.preroll_buffer.frames_after(trigger_time, post_frames, timeout=timeout)
+        
+        width, height = self.lores_resolution
+        captured = []
+        for timestamp, yuv in frames:
+            rgb = yuv420_to_rgb(yuv, width, height)
+            captured.append(CapturedFrame(rgb, Image.fromarray(rgb), timestamp,
+                                          {"pre_trigger": timestamp <= trigger_time}))
+        return captured
+    
+    def capture_burst(self, output_dir, count=10, fps=15, resolution=(1920, 1080), prefix="burst_"):
+        """Capture a burst of JPEG frames using the hardware MJPEG encoder.
+        
+        The camera is switched to a video configuration running at the burst
+        frame rate and the encoder streams JPEG frames, which are handed to the
+        background writer thread. The still configuration is restored afterwards.
+        Files may still be in flight when this returns; call wait_for_writes()
+        to block until they are on disk.
+        
+        Args:
+            output_dir (str): Directory where the frames will be saved
+            count (int): Number of frames to capture
+            fps (float): Burst frame rate
+            resolution (tuple): Burst frame size as (width, height)
+            prefix (str): Prefix for frame filenames
+            
+        Returns:
+            list: Paths the frames will be saved to
+        """
+        os.makedirs(output_dir, exist_ok=True)
+        timestamp = datetime.now().strftime("%Y%m%d_%H%M%S")
+        photo_paths = []
+        
+        def on_frame(index, data, frame_timestamp):
+            output_path = os.path.join(output_dir, f"{prefix}{timestamp}_{index + 1:03d}.jpg")
+            photo_paths.append(output_path)
+            self.save_frame_async(data, output_path)
+        
+        # The ring buffer's capture_request calls would compete with the encoder
+        preroll_running = self._preroll_thread is not None and self._preroll_thread.is_alive()
+        if preroll_running:
+            self.stop_preroll()
+        
+        config = self.camera.create_video_configuration(
+            main={"size": resolution},
+            controls={"FrameRate": fps}
+        )
+        self.camera.switch_mode(config)
+        
+        # MJPEGEncoder runs on the Pi's hardware video encoder
+        encoder = MJPEGEncoder()
+        output = BurstOutput(count, on_frame)
+        
+        self.logger.info(f"Capturing burst of {count} frames at {fps} fps ({resolution[0]}x{resolution[1]})")
+        start_time = time.monotonic()
+        self.camera.start_encoder(encoder, output)
+        try:
+            if not output.done.wait(timeout=2.0 * count / fps + 1.0):
+                self.logger.warning(f"Burst timed out after {output.frames_received}/{count} frames")
+        finally:
+            self.camera.stop_encoder(encoder)
+            if self._still_config is not None:
+                self.camera.switch_mode(self._still_config)
+            if preroll_running:
+                self.start_preroll(self.preroll_buffer.capacity, self._preroll_fps)
+        
+        elapsed = time.monotonic() - start_time
+        self.logger.info(f"Burst complete, {len(photo_paths)} frames in {elapsed:.2f}s "
+                         f"({len(photo_paths) / elapsed:.1f} fps)")
+        return photo_paths
+    
+    @property
+    def video_mode(self):
+        """Whether the H.264 encoder is running for clip recording."""
+        return self._video_encoder is not None
+    
+    @property
+    def clip_recording(self):
+        """Whether a clip is being recorded."""
+        return self.clip_output is not None and self.clip_output.recording
+    
+    def start_video_mode(self, resolution=(1920, 1080), fps=30, bitrate=4000000,
+                         preroll_seconds=3.0, keyframe_interval=1.0):
+        """Run the hardware H.264 encoder continuously with an in-memory pre-roll.
+        
+        Clips are then cut with start_clip()/stop_clip(). The encoder emits a
+        keyframe every keyframe_interval seconds, which bounds both the extra
+        pre-roll kept and the spacing of the keyframes sampled for inference.
+        
+        Args:
+            resolution (tuple): Video frame size as (width, height)
+            fps (float): Video frame rate
+            bitrate (int): Encoder bitrate in bits per second
+            preroll_seconds (float): Seconds of video kept from before a trigger
+            keyframe_interval (float): Seconds between keyframes
+        """
+        if self.video_mode:
+            return
+        
+        # The ring buffer's capture_request calls would compete with the encoder
+        self.stop_preroll()
+        
+        config = self.camera.create_video_configuration(
+            main={"size": resolution},
+            controls={"FrameRate": fps}
+        )
+        self.camera.switch_mode(config)
+        
+        # repeat=True puts SPS/PPS before every keyframe, so each decodes on its own
+        self._video_encoder = H264Encoder(bitrate=bitrate, repeat=True,
+                                          iperiod=max(1, int(round(fps * keyframe_interval))))
+        self.clip_output = ClipOutput(preroll_seconds, keyframe_interval)
+        self._video_fps = fps
+        self.camera.start_encoder(self._video_encoder, self.clip_output)
+        self.logger.info(f"Video mode started ({resolution[0]}x{resolution[1]} at {fps} fps, "
+                         f"{bitrate // 1000} kbps, {preroll_seconds}s pre-roll)")
+    
+    def stop_video_mode(self):
+        """Stop the encoder (finishing any clip) and restore the still configuration."""
+        if not self.video_mode:
+            return
+        if self.clip_recording:
+            self.stop_clip()
+        self.camera.stop_encoder(self._video_encoder)
+        self._video_encoder = None
+        if self._still_config is not None:
+            self.camera.switch_mode(self._still_config)
+        self.logger.info("Video mode stopped")
+    
+    def start_clip(self, output_path, on_keyframe=None):
+        """Start recording a clip, beginning with the pre-roll.
+        
+        Args:
+            output_path (str): Path of the final MP4 file
+            on_keyframe (callable, optional): Called on the encoder thread with
+                (keyframe_bytes, offset_seconds, index) for sampled keyframes;
+                must return quickly
+                
+        Returns:
+            bool: False if not in video mode or a clip is already recording
+        """
+        if not self.video_mode:
+            return False
+        raw_path = os.path.splitext(output_path)[0] + ".h264"
+        started = self.clip_output.start_clip(raw_path, on_keyframe)
+        if started:
+            self._clip_path = output_path
+            self.logger.info(f"Recording clip to {output_path}")
+        return started
+    
+    def stop_clip(self, on_saved=None):
+        """Stop the current clip and remux it to MP4 on a background thread.
+        
+        Args:
+            on_saved (callable, optional): Called with (path, info) once the MP4
+                (or, if remuxing failed, the raw stream) is on disk
+                
+        Returns:
+            dict: Clip info from ClipOutput.stop_clip, or None if not recording
+        """
+        if self.clip_output is None:
+            return None
+        info = self.clip_output.stop_clip()
+        if info is None:
+            return None
+        
+        def finish(mp4_path=self._clip_path, fps=self._video_fps):
+            path = remux_h264(info["path"], mp4_path, fps)
+            self.logger.info(f"Clip saved to {path} ({info['frames']} frames, "
+                             f"{info['duration']:.1f}s, {info['keyframes']} keyframes sampled)")
+            if on_saved:
+                on_saved(path, info)
+        
+        self._remux_thread = threading.Thread(target=finish, name="clip-remux", daemon=True)
+        self._remux_thread.start()
+        return info
+    
     def take_timelapse_photos(self, output_dir, interval=5, count=10, prefix="timelapse_"):
         """Take a series of photos at regular intervals.
         
@@ -275,6 +1058,21 @@ class CameraHandler:
         
     def cleanup(self):
         """Release camera resources."""
+        self.stop_preroll()
+        if self.video_mode:
+            try:
+                self.stop_video_mode()
+            except Exception as e:
+                self.logger.error(f"Error stopping video mode: {e}")
+        if self._remux_thread is not None:
+            self._remux_thread.join(timeout=30.0)
+        
+        # Flush frames that are still waiting to be written
+        if self._writer_thread is not None and self._writer_thread.is_alive():
+            self._write_queue.put(None)
+            self._writer_thread.join()
+            self._writer_thread = None
+        
         if self.camera:
             self.logger.info("Cleaning up camera resources")
             try:
@@ -284,5 +1082,7 @@ class CameraHandler:
                 self.logger.error(f"Error during camera cleanup: {e}")
             finally:
                 self.camera = None
+                self._streaming = False
+                self._resume_preroll = None
                 # Add a small delay to ensure resources are fully released
                 time.sleep(0.1) 
\ No newline at end of file
@@ -0,0 +1,101 @@
+"""Frame ring buffer module for pre-trigger capture."""
+import threading
+import time
+
+import numpy as np
+
+
+class FrameRingBuffer:
+    """Fixed-size ring of preallocated frame slots.
+
+    Frames are copied into slots that are allocated once, so continuous
+    capture does no per-frame allocation. Frames only leave the buffer through
+    frames_before/frames_after, which copy them out.
+    """
+
+    def __init__(self, capacity, frame_shape, dtype=np.uint8):
+        """Initialize the ring buffer.
+
+        Args:
+            capacity (int): Number of frame slots
+            frame_shape (tuple): Shape of one frame buffer
+            dtype: Frame buffer dtype
+        """
+        self.capacity = capacity
+        self.frame_shape = tuple(frame_shape)
+        self._frames = np.empty((capacity,) + self.frame_shape, dtype=dtype)
+        self._timestamps = np.zeros(capacity, dtype=np.float64)
+        self._count = 0  # Total number of frames pushed
+        self._condition = threading.Condition()
+
+    def __len__(self):
+        """Number of frames currently held."""
+        return min(self._count, self.capacity)
+
+    def push(self, frame, timestamp=None):
+        """Copy a frame into the next slot, overwriting the oldest frame.
+
+        Args:
+            frame (numpy.ndarray): Frame buffer matching frame_shape
+            timestamp (float, optional): Capture time, defaults to time.time()
+        """
+        with self._condition:
+            slot = self._count % self.capacity
+            np.copyto(self._frames[slot], frame)
+            self._timestamps[slot] = time.time() if timestamp is None else timestamp
+            self._count += 1
+            self._condition.notify_all()
+
+    def _snapshot(self, first, last):
+        """Copy out frames with sequence numbers in [first, last). Caller holds the lock."""
+        first = max(first, self._count - self.capacity, 0)
+        frames = []
+        for sequence in range(first, last):
+            slot = sequence % self.capacity
+            frames.append((float(self._timestamps[slot]), self._frames[slot].copy()))
+        return frames
+
+    def frames_before(self, timestamp, count):
+        """Return up to count frames captured at or before timestamp, oldest first.
+
+        Args:
+            timestamp (float): Trigger time
+            count (int): Maximum number of frames
+
+        Returns:
+            list: (timestamp, frame) tuples
+        """
+        with self._condition:
+            last = self._count
+            oldest = max(self._count - self.capacity, 0)
+            while last > oldest and self._timestamps[(last - 1) % self.capacity] > timestamp:
+                last -= 1
+            return self._snapshot(last - count, last)
+
+    def frames_after(self, timestamp, count, timeout=None):
+        """Wait for count frames captured after timestamp and return them, oldest first.
+
+        Args:
+            timestamp (float): Trigger time
+            count (int): Number of frames to wait for
+            timeout (float, optional): Maximum time to wait in seconds
+
+        Returns:
+            list: (timestamp, frame) tuples (fewer than count on timeout)
+        """
+        deadline = None if timeout is None else time.monotonic() + timeout
+
+        with self._condition:
+            # Sequence number of the first frame newer than the trigger
+            first = self._count
+            oldest = max(self._count - self.capacity, 0)
+            while first > oldest and self._timestamps[(first - 1) % self.capacity] > timestamp:
+                first -= 1
+
+            while self._count - first < count:
+                remaining = None if deadline is None else deadline - time.monotonic()
+                if remaining is not None and remaining <= 0:
+                    break
+                self._condition.wait(remaining)
+
+            return self._snapshot(first, min(first + count, self._count))
@@ -0,0 +1,205 @@
+"""Camera lifecycle module: off outside the active hours, standby while idle."""
+import logging
+import time
+from datetime import datetime
+from zoneinfo import ZoneInfo, ZoneInfoNotFoundError
+
+# Abbreviations accepted in active_time_range.timezone, mapped to IANA zones
+# so daylight saving time is followed
+TIMEZONE_ALIASES = {
+    "PST": "America/Los_Angeles", "PDT": "America/Los_Angeles",
+    "MST": "America/Denver", "MDT": "America/Denver",
+    "CST": "America/Chicago", "CDT": "America/Chicago",
+    "EST": "America/New_York", "EDT": "America/New_York",
+}
+
+
+def resolve_timezone(name):
+    """Return the tzinfo for a zone name or abbreviation.
+
+    Args:
+        name (str): IANA zone ("Europe/London") or an abbreviation such as "PST"
+
+    Returns:
+        tzinfo: The zone, or None to use the system's local time
+    """
+    if not name:
+        return None
+    try:
+        return ZoneInfo(TIMEZONE_ALIASES.get(name.upper(), name))
+    except (ZoneInfoNotFoundError, ValueError):
+        logging.getLogger(__name__).warning(f"Unknown timezone {name}, using local time")
+        return None
+
+
+class ActiveSchedule:
+    """Daily time window in which the camera is allowed to run."""
+
+    def __init__(self, start_hour=5, start_minute=0, end_hour=20, end_minute=0, timezone=None):
+        """Initialize the schedule.
+
+        Args:
+            start_hour (int): Hour the window opens (0-23)
+            start_minute (int): Minute the window opens (0-59)
+            end_hour (int): Hour the window closes (0-23); before the start
+                            for a window that crosses midnight
+            end_minute (int): Minute the window closes (0-59)
+            timezone (str, optional): Zone of the hours (see resolve_timezone)
+        """
+        self.start = start_hour * 60 + start_minute
+        self.end = end_hour * 60 + end_minute
+        self.tz = resolve_timezone(timezone)
+
+    @classmethod
+    def from_settings(cls, time_range):
+        """Build a schedule from pir_sensor.active_time_range.
+
+        Args:
+            time_range (dict): Settings with enabled, start/end hour and minute
+                               and timezone
+
+        Returns:
+            ActiveSchedule: The schedule, or None when it is disabled
+        """
+        if not time_range or not time_range.get("enabled", False):
+            return None
+        return cls(time_range.get("start_hour", 0), time_range.get("start_minute", 0),
+                   time_range.get("end_hour", 23), time_range.get("end_minute", 59),
+                   time_range.get("timezone"))
+
+    def is_active(self, now=None):
+        """Check whether a time falls inside the window.
+
+        Args:
+            now (float, optional): Unix time; defaults to the current time
+
+        Returns:
+            bool: True if the camera should be running
+        """
+        moment = datetime.fromtimestamp(time.time() if now is None else now, self.tz)
+        minutes = moment.hour * 60 + moment.minute
+        if self.end < self.start:
+            return minutes >= self.start or minutes < self.end
+        return self.start <= minutes < self.end
+
+
+class CameraLifecycle:
+    """Moves the camera between off, standby and active.
+
+    OFF: outside the active hours the camera is closed and draws nothing.
+    STANDBY: inside the active hours but idle, the camera stays open with its
+    still configuration applied and only stops streaming, so wake() restarts
+    it in well under 100 ms. ACTIVE: the camera is streaming.
+
+    Call update() from the main loop and wake() on every PIR trigger before
+    capturing.
+    """
+
+    OFF = "off"
+    STANDBY = "standby"
+    ACTIVE = "active"
+
+    def __init__(self, camera, schedule=None, standby_after=30.0, check_interval=60.0,
+                 on_open=None):
+        """Initialize the lifecycle for an open, streaming camera.
+
+        Args:
+            camera (CameraHandler): Camera to manage
+            schedule (ActiveSchedule, optional): Active hours; None keeps the
+                                                 camera on around the clock
+            standby_after (float): Idle seconds before standby; 0 or None
+                                   keeps the camera streaming
+            check_interval (float): Seconds between checks of the schedule
+            on_open (callable, optional): Called after the camera is reopened
+                                          at the start of the active hours
+        """
+        self.camera = camera
+        self.schedule = schedule
+        self.standby_after = standby_after
+        self.check_interval = check_interval
+        self.on_open = on_open
+        self.logger = logging.getLogger(__name__)
+        self.state = self.ACTIVE if camera.streaming else self.OFF
+        self._in_schedule = True
+        self._last_check = None
+        self._last_activity = time.monotonic()
+
+    @property
+    def in_schedule(self):
+        """Whether the last schedule check found the active hours."""
+        return self._in_schedule
+
+    def wake(self):
+        """Make sure the camera is streaming for a capture.
+
+        Returns:
+            float: Seconds spent resuming from standby (0.0 if already active),
+                   or None if the camera is off
+        """
+        self._last_activity = time.monotonic()
+        if self.state == self.ACTIVE:
+            return 0.0
+        if self.state == self.OFF:
+            return None
+        try:
+            elapsed = self.camera.resume()
+        except Exception as e:
+            self.logger.error(f"Failed to resume camera: {e}")
+            return None
+        self.state = self.ACTIVE
+        return elapsed
+
+    def update(self):
+        """Apply the schedule and the idle timeout.
+
+        Returns:
+            str: The new state if it changed, otherwise None
+        """
+        now = time.monotonic()
+        if self._last_check is None or now - self._last_check >= self.check_interval:
+            self._last_check = now
+            self._in_schedule = self.schedule is None or self.schedule.is_active()
+
+        # Never interrupt a clip; it ends on its own within max_clip_seconds
+        if self.camera.clip_recording:
+            return None
+
+        target = self.state
+        if not self._in_schedule:
+            target = self.OFF
+        elif self.state == self.OFF:
+            target = self.ACTIVE
+        elif (self.state == self.ACTIVE and self.standby_after
+                and now - self._last_activity >= self.standby_after
+                and not self.camera.video_mode):
+            target = self.STANDBY
+        if target == self.state:
+            return None
+        return self._enter(target)
+
+    def _enter(self, target):
+        """Switch the camera to a state; on failure the state is kept."""
+        try:
+            if target == self.OFF:
+                self.camera.cleanup()
+            elif target == self.STANDBY:
+                if not self.camera.standby():
+                    return None
+            elif self.state == self.OFF:
+                self.camera.setup(lean=True)
+            else:
+                self.camera.resume()
+        except Exception as e:
+            self.logger.error(f"Failed to switch camera from {self.state} to {target}: {e}")
+            return None
+
+        previous, self.state = self.state, target
+        self._last_activity = time.monotonic()
+        self.logger.info(f"Camera {previous} -> {target}")
+
+        if previous == self.OFF and self.on_open:
+            try:
+                self.on_open()
+            except Exception as e:
+                self.logger.error(f"Error after reopening camera: {e}")
+        return target
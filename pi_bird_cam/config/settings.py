@@ -11,6 +11,8 @@ class Settings:
         "pir_sensor": {
             "pin": 4,
             "trigger_cooldown": 0.8,  # seconds
+            "edge_detection": True,  # Interrupt-driven edges instead of 100 ms polling
+            "backend": "rpi_gpio",  # Edge source: "rpi_gpio" or "pigpio" (requires pigpiod)
             "active_time_range": {
                 "enabled": True,
                 "start_hour": 5,
@@ -23,21 +25,77 @@ class Settings:
         "camera": {
             "resolution": [1920, 1080],
             "rotation": 0,
-            "focus_distance_inches": 8  # Focus distance in inches (8 inches to infinity)
+            "focus_distance_inches": 8,  # Focus distance in inches (8 inches to infinity)
+            "lores_resolution": [320, 240],  # Low-resolution stream used for inference
+            "in_memory_capture": True,  # Run inference on the frame buffer, write the JPEG afterwards
+            "lean_setup": True,  # Open the camera without dumping its controls (except with --debug)
+            "standby_after": 30.0  # Idle seconds before the sensor stops streaming (0 disables)
         },
         "storage": {
             "base_dir": "photos",
-            "max_photos": 1000
+            "max_photos": 1000,
+            "journal_sync_interval": 5.0,  # Max seconds between metadata journal fsyncs
+            "journal_compact_threshold": 1000  # Journal records before rewriting the metadata file
         },
         "uploader": {
-            "service": "s3",
+            "service": "s3",  # "stream" sends photos to the Nano over a persistent connection
             "bucket": "bird-photos",
-            "auto_upload": True
+            "auto_upload": True,
+            "s3": {
+                "prefix": "",  # Key prefix inside the bucket
+                "outbox_path": "data/upload_outbox.db",  # Queued uploads survive restarts
+                "workers": 2,  # Concurrent upload connections
+                "max_bandwidth_kbps": 256,  # Shared cap so uploads leave room for the Jetson link
+                "multipart_threshold_mb": 8,
+                "max_attempts": 8,  # Retries back off exponentially up to 15 minutes
+                "nice": 10,  # Upload threads yield the CPU to the camera
+                "keep_done_days": 7  # Completed uploads are pruned from the outbox after this
+            },
+            "stream": {
+                "host": "jetson.local",  # Nano running the stream ingest server
+                "port": 5001,
+                "window": 4  # Photos in flight before waiting for acknowledgements
+            }
         },
         "inference": {
             "model_path": "models/bird_detector.onnx",
             "confidence_threshold": 0.5,
-            "auto_classify": True
+            "auto_classify": True,
+            "gate_enabled": True,  # Drop frames without a bird before storing/uploading
+            "num_threads": 2,  # CPU threads for inference
+            "precision": "int8"  # fp32, fp16 or int8 (models/<name>.int8.onnx, falls back to fp32)
+        },
+        "pipeline": {
+            # Bounded queues between the capture, classify, store and upload stages
+            "classify_queue_size": 4,  # Drops the oldest frame when inference falls behind
+            "store_queue_size": 8,  # Blocks the classify stage when the disk falls behind
+            "upload_queue_size": 64  # Drops the oldest upload (photo stays on disk)
+        },
+        "dedup": {
+            # Near-identical frames (a bird sitting on the feeder) are collapsed
+            # into one visit; only its first frame is classified and stored
+            "enabled": True,
+            "max_distance": 5,  # Max differing dHash bits (of 64) for a duplicate
+            "visit_gap": 30.0,  # Seconds without a matching frame that end a visit
+            "max_visit_duration": 300.0  # Long visits are split to send a fresh frame
+        },
+        "metrics": {
+            "enabled": True,  # Prometheus stage timings on http://<pi>:<port>/metrics
+            "port": 9102
+        },
+        "video": {
+            # Record PIR-triggered H.264 clips instead of stills; only sampled
+            # keyframes go through the pipeline and to the Nano
+            "enabled": False,
+            "resolution": [1920, 1080],
+            "fps": 30,
+            "bitrate": 4000000,  # Hardware encoder bitrate (bits per second)
+            "keyframe_interval": 1.0,  # Seconds between keyframes (and sampled keyframes)
+            "preroll_seconds": 3.0,  # Video kept from before the trigger
+            "postroll_seconds": 5.0,  # Recording continues this long after the last trigger
+            "max_clip_seconds": 60.0,  # Long visits are split into several clips
+            "clips_dir": "clips",
+            "max_clips": 200
         }
     }
 
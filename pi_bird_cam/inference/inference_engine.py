@@ -1,44 +1,239 @@
 """Inference engine module for bird detection and classification."""
+import os
+import logging
+
+import numpy as np
+from PIL import Image
+
+try:
+    import onnxruntime as ort
+except ImportError:
+    ort = None
 
 
 class InferenceEngine:
-    """Class to handle image inference operations."""
+    """Class to handle image inference operations.
+
+    Runs the bird classifier (ONNX) on the CPU as a lightweight bird/no-bird
+    gate. Reduced precision variants built by scripts/build_quantized_models.py
+    (``<model>.int8.onnx``, ``<model>.fp16.onnx``) are used when they exist
+    next to the model file.
+    """
 
-    def __init__(self, model_path=None, confidence_threshold=0.5):
+    # Suffixes of the reduced precision model variants
+    PRECISION_SUFFIXES = {"fp16": ".fp16.onnx", "int8": ".int8.onnx"}
+
+    def __init__(self, model_path=None, confidence_threshold=0.5, num_threads=2,
+                 precision="int8"):
         """Initialize inference engine with model and threshold.
-        
+
         Args:
             model_path (str): Path to the model file
             confidence_threshold (float): Minimum confidence threshold for detections
+            num_threads (int): CPU threads used for inference (leave cores for the camera)
+            precision (str): Model variant to load ("fp32", "fp16" or "int8"),
+                falling back to the fp32 model if the variant does not exist
         """
         self.model_path = model_path
         self.confidence_threshold = confidence_threshold
+        self.num_threads = num_threads
+        self.precision = precision
         self.model = None
+        self.input_name = None
+        self.input_size = (224, 224)  # (width, height)
+        self.input_layout = "nhwc"
+        self.class_names = []
+        self.logger = logging.getLogger(__name__)
         self.setup()
-        
+
     def setup(self):
         """Load the model."""
-        pass
-        
-    def detect(self, image_path):
+        if ort is None:
+            self.logger.warning("ONNX Runtime not available, bird gate disabled")
+            return
+
+        model_path = self._resolve_model_path()
+        if model_path is None:
+            self.logger.warning(f"Model file not found at {self.model_path}, bird gate disabled")
+            return
+
+        options = ort.SessionOptions()
+        options.intra_op_num_threads = self.num_threads
+        options.graph_optimization_level = ort.GraphOptimizationLevel.ORT_ENABLE_ALL
+
+        # XNNPACK has optimized int8/fp32 kernels for the Pi's ARM cores
+        providers = []
+        if "XnnpackExecutionProvider" in ort.get_available_providers():
+            providers.append(("XnnpackExecutionProvider", {"intra_op_num_threads": self.num_threads}))
+        providers.append("CPUExecutionProvider")
+
+        self.logger.info(f"Loading {self.precision} inference model from {model_path}")
+        self.model = ort.InferenceSession(model_path, sess_options=options, providers=providers)
+
+        model_input = self.model.get_inputs()[0]
+        self.input_name = model_input.name
+        shape = model_input.shape
+        if len(shape) == 4:
+            if shape[1] == 3:
+                self.input_layout = "nchw"
+                height, width = shape[2], shape[3]
+            else:
+                height, width = shape[1], shape[2]
+            if isinstance(height, int) and isinstance(width, int):
+                self.input_size = (width, height)
+
+        self._load_labels()
+        self.logger.info(f"Inference model loaded (input {self.input_size}, {self.input_layout})")
+
+    def _resolve_model_path(self):
+        """Return the model file to load for the configured precision."""
+        if not self.model_path:
+            return None
+
+        suffix = self.PRECISION_SUFFIXES.get(self.precision)
+        if suffix:
+            variant_path = os.path.splitext(self.model_path)[0] + suffix
+            if os.path.exists(variant_path):
+                return variant_path
+            self.logger.warning(f"No {self.precision} variant at {variant_path}, using the fp32 model")
+
+        if os.path.exists(self.model_path):
+            self.precision = "fp32"
+            return self.model_path
+        return None
+
+    def _load_labels(self):
+        """Load class names from a labels file next to the model."""
+        base_path = os.path.splitext(self.model_path)[0]
+        for ext in ['.txt', '.labels', '_labels.txt', '_classes.txt']:
+            labels_path = base_path + ext
+            if os.path.exists(labels_path):
+                with open(labels_path, 'r') as f:
+                    self.class_names = [line.strip() for line in f.readlines()]
+                self.logger.info(f"Loaded {len(self.class_names)} class names from {labels_path}")
+                break
+
+    def _load_image(self, image):
+        """Return an RGB PIL image from a path, RGB array or PIL image."""
+        if isinstance(image, np.ndarray):
+            return Image.fromarray(image)
+        if isinstance(image, Image.Image):
+            return image.convert("RGB")
+        with Image.open(image) as img:
+            return img.convert("RGB")
+
+    def _predict(self, image):
+        """Run the classifier and return the class probabilities."""
+        image = image.resize(self.input_size, Image.BILINEAR)
+        tensor = np.asarray(image, dtype=np.float32)
+        tensor *= 1.0 / 255.0
+        if self.input_layout == "nchw":
+            tensor = tensor.transpose(2, 0, 1)
+        tensor = np.ascontiguousarray(tensor[np.newaxis])
+
+        outputs = self.model.run(None, {self.input_name: tensor})
+        return outputs[0][0]
+
+    def _class_name(self, class_id):
+        """Return the name for a class ID."""
+        if class_id < len(self.class_names):
+            return self.class_names[class_id]
+        return f"Class {class_id}"
+
+    def bird_score(self, image):
+        """Score how likely an image contains a bird.
+
+        Args:
+            image: Path to the image, RGB numpy array (e.g. a lores frame) or PIL image
+
+        Returns:
+            float: Bird probability, or None if no model is loaded
+        """
+        if self.model is None:
+            return None
+
+        probabilities = self._predict(self._load_image(image))
+
+        # Binary models output (not bird, bird); species classifiers are
+        # scored by their top class
+        if len(probabilities) == 2:
+            return float(probabilities[1])
+        return float(np.max(probabilities))
+
+    def is_bird(self, image):
+        """Decide whether a frame should be kept.
+
+        Frames are kept when no model is loaded so a missing model never
+        drops photos.
+
+        Args:
+            image: Path to the image, RGB numpy array or PIL image
+
+        Returns:
+            bool: True if the frame passes the bird gate
+        """
+        score = self.bird_score(image)
+        return score is None or score >= self.confidence_threshold
+
+    def detect(self, image_path, image_size=None):
         """Detect birds in an image.
-        
+
         Args:
-            image_path (str): Path to the image
-            
+            image_path (str or numpy.ndarray): Path to the image, or an RGB frame
+            image_size (tuple, optional): (width, height) of the stored image the boxes
+                should refer to, when inference runs on a downscaled (lores) frame
+
         Returns:
             list: List of detections with bounding boxes and confidence scores
         """
-        pass
-        
+        if self.model is None:
+            return []
+
+        image = self._load_image(image_path)
+        probabilities = self._predict(image)
+        width, height = image_size or image.size
+
+        if len(probabilities) == 2:
+            confidence = float(probabilities[1])
+            species = None
+        else:
+            class_id = int(np.argmax(probabilities))
+            confidence = float(probabilities[class_id])
+            species = self._class_name(class_id)
+
+        if confidence < self.confidence_threshold:
+            return []
+
+        detection = {
+            'bbox': [0, 0, width, height],
+            'confidence': confidence,
+            'class': 'bird'
+        }
+        if species:
+            detection['species'] = species
+        return [detection]
+
     def classify(self, image_path, bbox=None):
         """Classify bird species in an image or region.
-        
+
         Args:
-            image_path (str): Path to the image
+            image_path (str or numpy.ndarray): Path to the image, or an RGB frame
             bbox (tuple, optional): Bounding box (x, y, w, h) for the region to classify
-            
+
         Returns:
             dict: Classification results with species and confidence
         """
-        pass 
\ No newline at end of file
+        if self.model is None:
+            return None
+
+        image = self._load_image(image_path)
+        if bbox is not None:
+            x, y, w, h = bbox
+            image = image.crop((x, y, x + w, y + h))
+
+        probabilities = self._predict(image)
+        class_id = int(np.argmax(probabilities))
+        return {
+            'species': self._class_name(class_id),
+            'confidence': float(probabilities[class_id])
+        }
@@ -6,10 +6,14 @@ import signal
 import sys
 from sensors.pir_sensor import PIRSensor
 from camera.camera_handler import CameraHandler
+from camera.lifecycle import ActiveSchedule, CameraLifecycle
 from storage.photo_storage import PhotoStorage
 from uploader.uploader import Uploader
 from inference.inference_engine import InferenceEngine
 from config.settings import Settings
+from pipeline.stage import Pipeline, PipelineStage
+from pipeline.visits import VisitTracker, dhash, file_dhash
+from pipeline import metrics
 
 
 # Flag to indicate if shutdown is requested
@@ -47,9 +51,11 @@ def setup_logging(debug=False):
     )
     
     # Set logging level for specific components
-    for component in ['sensors.pir_sensor', 'camera.camera_handler', 
+    for component in ['sensors.pir_sensor', 'camera.camera_handler', 'camera.lifecycle',
                      'storage.photo_storage', 'uploader.uploader',
-                     'inference.inference_engine']:
+                     'uploader.stream_client', 'uploader.s3_uploader',
+                     'inference.inference_engine',
+                     'pipeline.stage', 'pipeline.visits', 'pipeline.metrics']:
         logging.getLogger(component).setLevel(log_level)
 
 
@@ -85,20 +91,26 @@ def main():
             # Initialize PIR sensor
             pir_sensor = PIRSensor(
                 pin=settings.get("pir_sensor", "pin"),
-                cooldown_time=settings.get("pir_sensor", "trigger_cooldown")
+                cooldown_time=settings.get("pir_sensor", "trigger_cooldown"),
+                edge_detection=settings.get("pir_sensor", "edge_detection"),
+                backend=settings.get("pir_sensor", "backend")
             )
             
             # Initialize camera
             camera = CameraHandler(
                 resolution=tuple(settings.get("camera", "resolution")),
                 rotation=settings.get("camera", "rotation"),
-                focus_distance_inches=settings.get("camera", "focus_distance_inches")
+                focus_distance_inches=settings.get("camera", "focus_distance_inches"),
+                lores_resolution=tuple(settings.get("camera", "lores_resolution")),
+                lean_setup=settings.get("camera", "lean_setup") and not debug_mode
             )
             
             # Initialize storage
             storage = PhotoStorage(
                 base_dir=settings.get("storage", "base_dir"),
-                max_photos=settings.get("storage", "max_photos")
+                max_photos=settings.get("storage", "max_photos"),
+                sync_interval=settings.get("storage", "journal_sync_interval"),
+                compact_threshold=settings.get("storage", "journal_compact_threshold")
             )
             
             # Break out of retry loop if successful
@@ -122,7 +134,8 @@ def main():
         try:
             uploader = Uploader(
                 service_type=settings.get("uploader", "service"),
-                credentials=None  # TODO: Add credentials handling
+                credentials=None,  # TODO: Add credentials handling
+                config=settings.get("uploader")
             )
             logger.info("Uploader initialized")
         except Exception as e:
@@ -133,64 +146,334 @@ def main():
         try:
             inference = InferenceEngine(
                 model_path=settings.get("inference", "model_path"),
-                confidence_threshold=settings.get("inference", "confidence_threshold")
+                confidence_threshold=settings.get("inference", "confidence_threshold"),
+                num_threads=settings.get("inference", "num_threads"),
+                precision=settings.get("inference", "precision")
             )
             logger.info("Inference engine initialized")
         except Exception as e:
             logger.warning(f"Failed to initialize inference engine: {e}")
     
+    def mark(item, event, stage=None, since=None):
+        """Timestamp an event in the photo's trace and record the span leading to it."""
+        now = time.time()
+        trace = item["metadata"]["trace"]
+        trace[event] = now
+        if stage:
+            metrics.observe_stage(stage, now - trace[since])
+        return now
+    
+    def classify_frame(item):
+        """Classify stage: run inference and drop empty triggers."""
+        metrics.observe_stage("classify_queue", time.time() - item["metadata"]["trace"]["submitted"])
+        detections = None
+        # Clip keyframes (image None) are not decoded here; the Nano classifies them
+        if inference and item["image"] is not None:
+            try:
+                # In-memory captures run on the lores frame; boxes refer to the stored JPEG
+                image_size = item["frame"].image.size if item["frame"] is not None else None
+                with metrics.Timer("inference"):
+                    detections = inference.detect(item["image"], image_size=image_size)
+                if detections:
+                    logger.info(f"Bird detection results: {detections}")
+                    item["metadata"]["detections"] = detections
+            except Exception as e:
+                logger.error(f"Error during inference: {e}")
+        
+        # Bird gate: drop empty triggers (wind, shadows) before
+        # they are written, stored or uploaded
+        if (inference and inference.model is not None and detections == []
+                and settings.get("inference", "gate_enabled")):
+            logger.info("No bird detected, discarding frame")
+            metrics.count_event("gated")
+            if item["frame"] is None and os.path.exists(item["photo_path"]):
+                os.remove(item["photo_path"])
+            return None
+        mark(item, "classified")
+        return item
+    
+    def store_frame(item):
+        """Store stage: write the JPEG (in-memory captures) and save metadata."""
+        metrics.observe_stage("store_queue", time.time() - item["metadata"]["trace"]["classified"])
+        if item["frame"] is not None:
+            with metrics.Timer("encode"):
+                camera.save_frame(item["frame"], item["photo_path"])
+            # Release the full-resolution buffer before the upload stage
+            item["frame"] = item["image"] = None
+        # Stamped before saving so the stored metadata carries it
+        stored_at = mark(item, "stored")
+        storage.save_photo(item["photo_path"], item["filename"], item["metadata"])
+        metrics.observe_stage("store", time.time() - stored_at)
+        metrics.observe_stage("pir_to_stored", time.time() - item["metadata"]["trace"]["pir_edge"])
+        metrics.count_event("stored")
+        if uploader and settings.get("uploader", "auto_upload"):
+            return item
+        return None
+    
+    def upload_frame(item):
+        """Upload stage: hand the photo to the uploader (queued or streamed)."""
+        metrics.observe_stage("upload_queue", time.time() - item["metadata"]["trace"]["stored"])
+        remote_path = os.path.basename(item["photo_path"])
+        with metrics.Timer("upload_handoff"):
+            ticket = uploader.upload_photo(item["photo_path"], remote_path, metadata=item["metadata"])
+        metrics.count_event("upload_queued")
+        logger.info(f"Photo queued for upload: {ticket}")
+        return None
+    
+    # Near-duplicate suppression ahead of the pipeline
+    dedup_settings = settings.get("dedup")
+    visits = None
+    if dedup_settings["enabled"]:
+        visits = VisitTracker(
+            max_distance=dedup_settings["max_distance"],
+            visit_gap=dedup_settings["visit_gap"],
+            max_visit_duration=dedup_settings["max_visit_duration"]
+        )
+    
+    def record_visit(visit):
+        """Store the summary of an ended visit with its representative photo."""
+        if visit is None or visit.representative is None:
+            return
+        if visit.frames > 1:
+            logger.info(f"Visit {visit.visit_id} ended: {visit.frames} frames, "
+                        f"{visit.frames - 1} suppressed")
+        if not storage.update_photo_metadata(visit.representative, {"visit": visit.to_dict()}):
+            # The representative was discarded by the bird gate
+            logger.debug(f"No stored photo for visit {visit.visit_id}")
+    
+    pipeline_settings = settings.get("pipeline")
+    stages = [
+        PipelineStage("classify", classify_frame,
+                      max_queue_size=pipeline_settings["classify_queue_size"],
+                      overflow=PipelineStage.DROP_OLDEST),
+        PipelineStage("store", store_frame,
+                      max_queue_size=pipeline_settings["store_queue_size"],
+                      overflow=PipelineStage.BLOCK)
+    ]
+    if uploader:
+        stages.append(PipelineStage("upload", upload_frame,
+                                    max_queue_size=pipeline_settings["upload_queue_size"],
+                                    overflow=PipelineStage.DROP_OLDEST))
+    pipeline = Pipeline(stages)
+    pipeline.start()
+    
+    # Clip mode: the encoder runs continuously and PIR triggers cut clips from it
+    video_settings = settings.get("video")
+    clip_storage = None
+    clip_state = {"deadline": 0.0, "started": 0.0, "pir_edge": None}
+    
+    def start_video_mode():
+        """Start the encoder for clip mode (again whenever the camera is reopened)."""
+        camera.start_video_mode(
+            resolution=tuple(video_settings["resolution"]),
+            fps=video_settings["fps"],
+            bitrate=video_settings["bitrate"],
+            preroll_seconds=video_settings["preroll_seconds"],
+            keyframe_interval=video_settings["keyframe_interval"]
+        )
+    
+    if video_settings["enabled"]:
+        try:
+            clip_storage = PhotoStorage(
+                base_dir=video_settings["clips_dir"],
+                max_photos=video_settings["max_clips"],
+                metadata_file="clip_metadata.json"
+            )
+            start_video_mode()
+        except Exception as e:
+            logger.error(f"Failed to start clip mode, taking stills instead: {e}")
+            clip_storage = None
+    
+    def submit_keyframe(clip_id, edge_time, data, offset, index):
+        """Queue a sampled clip keyframe like a photo (runs on the encoder thread)."""
+        filename = f"{clip_id}_kf{index:03d}.h264"
+        now = time.time()
+        metrics.count_event("keyframe")
+        pipeline.submit({
+            "filename": filename,
+            "photo_path": storage.get_photo_path(filename),
+            "metadata": {
+                "trigger": "motion_detection",
+                "visit": {"id": clip_id},
+                "clip": {"id": clip_id, "keyframe": index, "offset_s": round(offset, 3)},
+                "trace": {"id": metrics.new_trace_id(), "pir_edge": edge_time,
+                          "captured": now, "submitted": now}
+            },
+            "frame": data,
+            "image": None
+        })
+    
+    def start_clip(edge_time):
+        """Start a clip for a PIR trigger, or extend the one recording."""
+        clip_state["deadline"] = time.time() + video_settings["postroll_seconds"]
+        if camera.clip_recording:
+            return
+        clip_id = "clip_" + os.path.splitext(storage.generate_filename())[0]
+        clip_path = clip_storage.get_photo_path(f"{clip_id}.mp4")
+        on_keyframe = lambda data, offset, index: submit_keyframe(clip_id, edge_time, data, offset, index)
+        if camera.start_clip(clip_path, on_keyframe=on_keyframe):
+            clip_state["started"] = time.time()
+            clip_state["pir_edge"] = edge_time
+            metrics.observe_stage("pir_to_capture", clip_state["started"] - edge_time)
+            metrics.count_event("clip_started")
+    
+    def stop_clip():
+        """Finish the current clip; it is indexed once remuxed."""
+        pir_edge = clip_state["pir_edge"]
+        camera.stop_clip(on_saved=lambda path, info: clip_saved(path, info, pir_edge))
+    
+    def clip_saved(path, info, pir_edge):
+        """Index a finished clip so the oldest are removed past max_clips."""
+        # The dated path is passed on as is: a clip can end after midnight
+        filename = os.path.relpath(path, video_settings["clips_dir"])
+        clip_storage.save_photo(path, filename, {
+            "trigger": "motion_detection",
+            "pir_edge": pir_edge,
+            "frames": info["frames"],
+            "duration": info["duration"],
+            "keyframes": info["keyframes"]
+        })
+        metrics.count_event("clip_saved")
+    
+    def capture_photo():
+        """Capture a still for a PIR trigger and submit it to the pipeline."""
+        try:
+            # Edge time from the PIR interrupt (now when polling)
+            edge_time = pir_sensor.last_edge_time or time.time()
+            capture_start = time.time()
+            metrics.observe_stage("pir_to_capture", capture_start - edge_time)
+            
+            # Generate a filename based on timestamp
+            filename = storage.generate_filename()
+            # Use the get_photo_path method to get the full path with date directory
+            photo_path = storage.get_photo_path(filename)
+            
+            # Store photo metadata; the trace ID and timestamps
+            # travel with the photo to the Nano
+            metadata = {
+                "trigger": "motion_detection",
+                "trace": {"id": metrics.new_trace_id(), "pir_edge": edge_time}
+            }
+            
+            if settings.get("camera", "in_memory_capture"):
+                # Inference runs on the in-memory frame; the JPEG is
+                # encoded and written by the store stage afterwards
+                frame = camera.capture_frame()
+                image = frame.lores
+            else:
+                # Take a photo
+                photo_path = camera.take_photo(photo_path)
+                logger.info(f"Photo captured: {photo_path}")
+                frame = None
+                image = photo_path
+            metadata["trace"]["captured"] = time.time()
+            metrics.observe_stage("capture", metadata["trace"]["captured"] - capture_start)
+            metrics.count_event("captured")
+            
+            if visits:
+                with metrics.Timer("dedup"):
+                    if frame is not None:
+                        frame_hash = dhash(frame.lores)
+                    else:
+                        frame_hash = file_dhash(photo_path)
+                if frame_hash is not None:
+                    visit, is_new, ended = visits.observe(frame_hash)
+                    record_visit(ended)
+                    if not is_new:
+                        metrics.count_event("duplicate")
+                        logger.info(f"Near-duplicate of visit {visit.visit_id} "
+                                    f"({visit.frames} frames), skipping")
+                        if frame is None and os.path.exists(photo_path):
+                            os.remove(photo_path)
+                        return
+                    visit.representative = filename
+                    metadata["visit"] = {"id": visit.visit_id,
+                                         "phash": f"{frame_hash:016x}"}
+            
+            metadata["trace"]["submitted"] = time.time()
+            pipeline.submit({
+                "filename": filename,
+                "photo_path": photo_path,
+                "metadata": metadata,
+                "frame": frame,
+                "image": image
+            })
+            
+        except Exception as e:
+            logger.exception(f"Error processing motion event: {e}")
+    
+    # Off outside the active hours, standby while idle (clip mode keeps streaming)
+    lifecycle = CameraLifecycle(
+        camera,
+        schedule=ActiveSchedule.from_settings(settings.get("pir_sensor", "active_time_range")),
+        standby_after=settings.get("camera", "standby_after"),
+        on_open=start_video_mode if clip_storage else None
+    )
+    
+    # Prometheus endpoint; spans are recorded with or without it
+    metrics_server = None
+    metrics_settings = settings.get("metrics")
+    if metrics_settings["enabled"]:
+        metrics.REGISTRY.gauge(
+            "birdcam_queue_depth", "Items waiting in each pipeline stage",
+            lambda: {(("stage", name),): stats["queue_depth"]
+                     for name, stats in pipeline.get_stats().items()})
+        try:
+            metrics_server = metrics.MetricsServer(port=metrics_settings["port"])
+            metrics_server.start()
+        except OSError as e:
+            logger.warning(f"Failed to start metrics server: {e}")
+            metrics_server = None
+    
     try:
         logger.info("Entering main loop")
+        last_stats_time = time.time()
         
-        # Main loop
+        # Main loop: capture only, everything else runs in the pipeline stages
         while not shutdown_requested:
             try:
                 logger.debug("Waiting for motion...")
                 
                 # Wait for motion detection
-                if pir_sensor.wait_for_motion(timeout=1.0):
+                motion = pir_sensor.wait_for_motion(timeout=1.0)
+                if motion:
+                    wake_seconds = lifecycle.wake()
+                    if wake_seconds is None:
+                        logger.debug("Motion outside the active hours, ignoring")
+                        metrics.count_event("outside_schedule")
+                        motion = False
+                    elif wake_seconds:
+                        metrics.observe_stage("camera_wake", wake_seconds)
+                if motion and camera.video_mode:
+                    logger.info("Motion detected! Recording clip...")
+                    start_clip(pir_sensor.last_edge_time or time.time())
+                elif motion:
                     logger.info("Motion detected! Taking photo...")
-                    
-                    try:
-                        # Generate a filename based on timestamp
-                        filename = storage.generate_filename()
-                        # Use the get_photo_path method to get the full path with date directory
-                        photo_path = storage.get_photo_path(filename)
-                        
-                        # Take a photo
-                        photo_path = camera.take_photo(photo_path)
-                        logger.info(f"Photo captured: {photo_path}")
-                        
-                        # Store photo metadata
-                        metadata = {"trigger": "motion_detection"}
-                        
-                        # Run inference if available
-                        if inference:
-                            try:
-                                detections = inference.detect(photo_path)
-                                if detections:
-                                    logger.info(f"Bird detection results: {detections}")
-                                    metadata["detections"] = detections
-                            except Exception as e:
-                                logger.error(f"Error during inference: {e}")
-                        
-                        # Save metadata
-                        storage.save_photo(photo_path, filename, metadata)
-                        
-                        # Upload if available
-                        if uploader and settings.get("uploader", "auto_upload"):
-                            try:
-                                remote_path = os.path.basename(photo_path)
-                                url = uploader.upload_photo(photo_path, remote_path)
-                                logger.info(f"Photo uploaded: {url}")
-                            except Exception as e:
-                                logger.error(f"Error during upload: {e}")
-                        
-                    except Exception as e:
-                        logger.exception(f"Error processing motion event: {e}")
+                    capture_photo()
+                
+                # Housekeeping runs every iteration, also under steady motion
+                if visits:
+                    record_visit(visits.expire())
+                
+                # End the clip once motion stops or it reaches its maximum length
+                if camera.clip_recording:
+                    now = time.time()
+                    if (now >= clip_state["deadline"]
+                            or now - clip_state["started"] >= video_settings["max_clip_seconds"]):
+                        stop_clip()
                 
-                # Small sleep to prevent CPU hogging
-                time.sleep(0.1)
+                lifecycle.update()
+                
+                # Log queue depths periodically
+                if time.time() - last_stats_time >= 60:
+                    last_stats_time = time.time()
+                    if visits:
+                        logger.info(f"Visits: {visits.visits}, near-duplicate frames suppressed: "
+                                    f"{visits.suppressed}")
+                    for name, stats in pipeline.get_stats().items():
+                        logger.info(f"Stage {name}: depth {stats['queue_depth']}/{stats['queue_size']}, "
+                                    f"processed {stats['processed']}, dropped {stats['dropped']}, "
+                                    f"avg latency {stats['avg_latency_ms']:.0f} ms")
                 
             except Exception as e:
                 logger.exception(f"Error in main loop iteration: {e}")
@@ -204,16 +487,40 @@ def main():
     finally:
         # Clean up resources
         logger.info("Cleaning up resources")
+        try:
+            pipeline.stop(drain=True)
+        except Exception as e:
+            logger.error(f"Error stopping pipeline: {e}")
+        
+        if visits:
+            record_visit(visits.close())
+        
+        if metrics_server:
+            metrics_server.stop()
+        
+        if uploader:
+            try:
+                uploader.close()
+            except Exception as e:
+                logger.error(f"Error closing uploader: {e}")
+        
         try:
             pir_sensor.cleanup()
         except Exception as e:
             logger.error(f"Error cleaning up PIR sensor: {e}")
         
         try:
+            if camera.clip_recording:
+                stop_clip()
             camera.cleanup()
         except Exception as e:
             logger.error(f"Error cleaning up camera: {e}")
         
+        if clip_storage:
+            clip_storage.close()
+        
+        storage.close()
+        
         logger.info("Application shutdown complete")
 
 
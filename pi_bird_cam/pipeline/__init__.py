@@ -0,0 +1 @@
+"""Staged capture/classify/store/upload pipeline for the Bird Camera System."""
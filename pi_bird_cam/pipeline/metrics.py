@@ -0,0 +1,329 @@
+"""Metrics module with per-thread counter shards and a Prometheus endpoint."""
+import bisect
+import logging
+import threading
+import time
+import uuid
+from http.server import BaseHTTPRequestHandler, ThreadingHTTPServer
+
+# Upper bounds in seconds; spans range from sub-millisecond hashes to uploads
+DEFAULT_BUCKETS = (0.001, 0.0025, 0.005, 0.01, 0.025, 0.05, 0.1, 0.25, 0.5,
+                   1.0, 2.5, 5.0, 10.0, 30.0)
+
+
+def new_trace_id():
+    """Return a new ID that follows one photo through both devices."""
+    return uuid.uuid4().hex[:16]
+
+
+class _ShardedValues:
+    """Fixed-size vector of floats with one shard per writing thread.
+
+    Each thread only ever writes its own shard, so recording takes no lock;
+    readers sum the shards. Shards of finished threads are folded into a
+    retired total so short-lived threads do not accumulate.
+    """
+
+    def __init__(self, size):
+        self.size = size
+        self._local = threading.local()
+        self._shards = []  # (thread, values)
+        self._retired = [0.0] * size
+        self._lock = threading.Lock()  # Only taken to add or fold shards
+
+    def shard(self):
+        """Return the calling thread's shard."""
+        values = getattr(self._local, "values", None)
+        if values is None:
+            values = [0.0] * self.size
+            with self._lock:
+                if len(self._shards) >= 64:
+                    self._fold()
+                self._shards.append((threading.current_thread(), values))
+            self._local.values = values
+        return values
+
+    def _fold(self):
+        """Merge the shards of finished threads into the retired total. Caller holds the lock."""
+        live = []
+        for thread, values in self._shards:
+            if thread.is_alive():
+                live.append((thread, values))
+            else:
+                self._retired = [a + b for a, b in zip(self._retired, values)]
+        self._shards = live
+
+    def snapshot(self):
+        """Return the sum over all shards."""
+        with self._lock:
+            self._fold()
+            total = list(self._retired)
+            for _, values in self._shards:
+                total = [a + b for a, b in zip(total, values)]
+        return total
+
+
+class Counter:
+    """Monotonic counter."""
+
+    def __init__(self):
+        self._values = _ShardedValues(1)
+
+    def inc(self, amount=1.0):
+        """Add amount to the counter."""
+        self._values.shard()[0] += amount
+
+    def value(self):
+        """Current total."""
+        return self._values.snapshot()[0]
+
+
+class Histogram:
+    """Cumulative-bucket histogram (Prometheus semantics)."""
+
+    def __init__(self, buckets=DEFAULT_BUCKETS):
+        self.buckets = tuple(sorted(buckets))
+        # Per-bucket counts, then +Inf, sum and count
+        self._values = _ShardedValues(len(self.buckets) + 3)
+
+    def observe(self, value):
+        """Record one observation."""
+        shard = self._values.shard()
+        shard[bisect.bisect_left(self.buckets, value)] += 1
+        shard[-2] += value
+        shard[-1] += 1
+
+    def snapshot(self):
+        """Return (cumulative bucket counts including +Inf, sum, count)."""
+        values = self._values.snapshot()
+        cumulative = []
+        running = 0.0
+        for count in values[:len(self.buckets) + 1]:
+            running += count
+            cumulative.append(running)
+        return cumulative, values[-2], values[-1]
+
+
+class _Family:
+    """A named metric with one child per label value combination."""
+
+    def __init__(self, kind, name, documentation, labelnames, factory):
+        self.kind = kind
+        self.name = name
+        self.documentation = documentation
+        self.labelnames = tuple(labelnames)
+        self._factory = factory
+        self._children = {}
+        self._lock = threading.Lock()
+
+    def labels(self, *values):
+        """Return the child for these label values, creating it on first use."""
+        child = self._children.get(values)
+        if child is None:
+            if len(values) != len(self.labelnames):
+                raise ValueError(f"{self.name} expects labels {self.labelnames}")
+            with self._lock:
+                child = self._children.setdefault(values, self._factory())
+        return child
+
+    def children(self):
+        """Return (label values, child) pairs."""
+        with self._lock:
+            return list(self._children.items())
+
+
+class MetricsRegistry:
+    """Holds counters, histograms and gauges and renders them for Prometheus."""
+
+    def __init__(self):
+        self._families = {}
+        self._gauges = {}  # name -> (documentation, callable returning {labels: value})
+        self._lock = threading.Lock()
+
+    def _family(self, kind, name, documentation, labelnames, factory):
+        with self._lock:
+            family = self._families.get(name)
+            if family is None:
+                family = _Family(kind, name, documentation, labelnames, factory)
+                self._families[name] = family
+            return family
+
+    def counter(self, name, documentation, labelnames=()):
+        """Get or create a counter family.
+
+        Args:
+            name (str): Metric name
+            documentation (str): HELP text
+            labelnames (tuple): Label names; use .labels(...) to get a counter
+
+        Returns:
+            _Family: Counter family
+        """
+        return self._family("counter", name, documentation, labelnames, Counter)
+
+    def histogram(self, name, documentation, labelnames=(), buckets=DEFAULT_BUCKETS):
+        """Get or create a histogram family.
+
+        Args:
+            name (str): Metric name
+            documentation (str): HELP text
+            labelnames (tuple): Label names; use .labels(...) to get a histogram
+            buckets (tuple): Bucket upper bounds
+
+        Returns:
+            _Family: Histogram family
+        """
+        return self._family("histogram", name, documentation, labelnames,
+                            lambda: Histogram(buckets))
+
+    def gauge(self, name, documentation, read):
+        """Register a gauge read when metrics are rendered.
+
+        Args:
+            name (str): Metric name
+            documentation (str): HELP text
+            read (callable): Returns a number, or a dict of {label dict (as tuple of
+                             pairs): number}
+        """
+        with self._lock:
+            self._gauges[name] = (documentation, read)
+
+    def render(self):
+        """Render all metrics in the Prometheus text exposition format."""
+        lines = []
+        with self._lock:
+            families = list(self._families.values())
+            gauges = list(self._gauges.items())
+
+        for family in families:
+            lines.append(f"# HELP {family.name} {family.documentation}")
+            lines.append(f"# TYPE {family.name} {family.kind}")
+            for values, child in family.children():
+                labels = list(zip(family.labelnames, values))
+                if family.kind == "counter":
+                    lines.append(f"{family.name}{_labels(labels)} {child.value():g}")
+                    continue
+                cumulative, total, count = child.snapshot()
+                bounds = [f"{bound:g}" for bound in child.buckets] + ["+Inf"]
+                for bound, bucket_count in zip(bounds, cumulative):
+                    lines.append(f"{family.name}_bucket{_labels(labels + [('le', bound)])} "
+                                 f"{bucket_count:g}")
+                lines.append(f"{family.name}_sum{_labels(labels)} {total:g}")
+                lines.append(f"{family.name}_count{_labels(labels)} {count:g}")
+
+        for name, (documentation, read) in gauges:
+            try:
+                value = read()
+            except Exception as e:
+                logging.getLogger(__name__).warning(f"Could not read gauge {name}: {e}")
+                continue
+            lines.append(f"# HELP {name} {documentation}")
+            lines.append(f"# TYPE {name} gauge")
+            samples = value.items() if isinstance(value, dict) else [((), value)]
+            for labels, sample in samples:
+                lines.append(f"{name}{_labels(list(labels))} {float(sample):g}")
+
+        return "\n".join(lines) + "\n"
+
+
+def _labels(pairs):
+    """Format label pairs as {a="b",...}."""
+    if not pairs:
+        return ""
+    escaped = [(key, str(value).replace("\\", "\\\\").replace('"', '\\"')) for key, value in pairs]
+    return "{" + ",".join(f'{key}="{value}"' for key, value in escaped) + "}"
+
+
+# Process-wide registry and the span histogram every stage records into
+REGISTRY = MetricsRegistry()
+STAGE_SECONDS = REGISTRY.histogram(
+    "birdcam_stage_seconds", "Time spent in each capture pipeline stage", ("stage",))
+EVENTS = REGISTRY.counter(
+    "birdcam_events_total", "Capture pipeline events by outcome", ("event",))
+
+
+def observe_stage(stage, seconds):
+    """Record the duration of one pipeline stage.
+
+    Args:
+        stage (str): Stage name, e.g. "capture" or "inference"
+        seconds (float): Duration
+    """
+    STAGE_SECONDS.labels(stage).observe(max(0.0, seconds))
+
+
+def count_event(event, amount=1):
+    """Count a pipeline event, e.g. "captured" or "gated"."""
+    EVENTS.labels(event).inc(amount)
+
+
+class _MetricsHandler(BaseHTTPRequestHandler):
+    """Serves GET /metrics."""
+
+    def do_GET(self):
+        if self.path.split("?", 1)[0] != "/metrics":
+            self.send_error(404)
+            return
+        body = self.server.registry.render().encode("utf-8")
+        self.send_response(200)
+        self.send_header("Content-Type", "text/plain; version=0.0.4; charset=utf-8")
+        self.send_header("Content-Length", str(len(body)))
+        self.end_headers()
+        self.wfile.write(body)
+
+    def log_message(self, format, *args):
+        """Scrapes are not worth a log line each."""
+
+
+class MetricsServer:
+    """Serves a registry on http://host:port/metrics from a background thread."""
+
+    def __init__(self, registry=REGISTRY, host="0.0.0.0", port=9102):
+        """Initialize the server.
+
+        Args:
+            registry (MetricsRegistry): Metrics to serve
+            host (str): Address to listen on
+            port (int): TCP port to listen on
+        """
+        self.registry = registry
+        self.host = host
+        self.port = port
+        self.logger = logging.getLogger(__name__)
+        self._server = None
+        self._thread = None
+
+    def start(self):
+        """Start listening."""
+        self._server = ThreadingHTTPServer((self.host, self.port), _MetricsHandler)
+        self._server.daemon_threads = True
+        self._server.registry = self.registry
+        self._thread = threading.Thread(target=self._server.serve_forever, name="metrics-server")
+        self._thread.daemon = True
+        self._thread.start()
+        self.logger.info(f"Metrics available on http://{self.host}:{self.port}/metrics")
+
+    def stop(self):
+        """Stop listening."""
+        if self._server:
+            self._server.shutdown()
+            self._server.server_close()
+            self._server = None
+
+
+class Timer:
+    """Context manager recording a block's duration as a stage span."""
+
+    def __init__(self, stage):
+        self.stage = stage
+        self.start = None
+        self.elapsed = None
+
+    def __enter__(self):
+        self.start = time.monotonic()
+        return self
+
+    def __exit__(self, *exc):
+        self.elapsed = time.monotonic() - self.start
+        observe_stage(self.stage, self.elapsed)
+        return False
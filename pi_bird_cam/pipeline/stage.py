@@ -0,0 +1,236 @@
+"""Pipeline stage module with bounded queues and per-stage workers."""
+import time
+import logging
+import threading
+from collections import deque
+
+
+class PipelineStage:
+    """A pipeline stage with a bounded input queue and dedicated worker threads.
+
+    Each item is passed to the stage's handler; a non-None return value is
+    forwarded to the next stage. When the queue is full the stage either
+    drops its oldest item ("drop_oldest") or makes the producer wait
+    ("block"), which pushes backpressure to the previous stage.
+    """
+
+    DROP_OLDEST = "drop_oldest"
+    BLOCK = "block"
+
+    def __init__(self, name, handler, max_queue_size=8, overflow=DROP_OLDEST,
+                 next_stage=None, num_workers=1):
+        """Initialize the stage.
+
+        Args:
+            name (str): Stage name used in logs and metrics
+            handler (callable): Called with each item, returns the item for the
+                                next stage or None to stop processing it
+            max_queue_size (int): Maximum number of queued items
+            overflow (str): "drop_oldest" or "block" when the queue is full
+            next_stage (PipelineStage, optional): Stage receiving handler results
+            num_workers (int): Number of worker threads
+        """
+        if overflow not in (self.DROP_OLDEST, self.BLOCK):
+            raise ValueError(f"Unsupported overflow policy: {overflow}")
+
+        self.name = name
+        self.handler = handler
+        self.max_queue_size = max_queue_size
+        self.overflow = overflow
+        self.next_stage = next_stage
+        self.num_workers = num_workers
+        self.logger = logging.getLogger(__name__)
+
+        self._queue = deque()
+        self._condition = threading.Condition()
+        self._running = False
+        self._workers = []
+        self._busy = 0
+
+        # Metrics
+        self.submitted = 0
+        self.processed = 0
+        self.dropped = 0
+        self.errors = 0
+        self.max_queue_depth = 0
+        self._total_latency = 0.0  # Time from submit to handler completion
+        self._max_latency = 0.0
+
+    def start(self):
+        """Start the worker threads."""
+        with self._condition:
+            if self._running:
+                return
+            self._running = True
+
+        for i in range(self.num_workers):
+            worker = threading.Thread(target=self._worker_loop, name=f"{self.name}-{i}", daemon=True)
+            worker.start()
+            self._workers.append(worker)
+        self.logger.info(f"Pipeline stage '{self.name}' started ({self.num_workers} worker(s), "
+                         f"queue size {self.max_queue_size}, {self.overflow})")
+
+    def stop(self, drain=True, timeout=10.0):
+        """Stop the worker threads.
+
+        Args:
+            drain (bool): Process the items still queued before stopping
+            timeout (float): Maximum time to wait for the workers
+        """
+        if drain:
+            self.join(timeout)
+
+        with self._condition:
+            self._running = False
+            if not drain:
+                self.dropped += len(self._queue)
+                self._queue.clear()
+            self._condition.notify_all()
+
+        for worker in self._workers:
+            worker.join(timeout)
+        self._workers = []
+
+    def put(self, item, timeout=None):
+        """Queue an item for the stage.
+
+        Args:
+            item: Item to process
+            timeout (float, optional): Maximum wait when the overflow policy is "block"
+
+        Returns:
+            bool: True if the item was queued without dropping anything
+        """
+        with self._condition:
+            accepted = True
+            if len(self._queue) >= self.max_queue_size:
+                if self.overflow == self.BLOCK:
+                    if not self._condition.wait_for(lambda: len(self._queue) < self.max_queue_size, timeout):
+                        self.dropped += 1
+                        self.logger.warning(f"Stage '{self.name}' full, dropping new item")
+                        return False
+                else:
+                    self._queue.popleft()
+                    self.dropped += 1
+                    accepted = False
+                    self.logger.warning(f"Stage '{self.name}' falling behind, dropped oldest item")
+
+            self._queue.append((time.monotonic(), item))
+            self.submitted += 1
+            self.max_queue_depth = max(self.max_queue_depth, len(self._queue))
+            self._condition.notify_all()
+            return accepted
+
+    def join(self, timeout=None):
+        """Wait until the queue is empty and no item is being processed.
+
+        Args:
+            timeout (float, optional): Maximum time to wait
+
+        Returns:
+            bool: True if the stage is idle
+        """
+        with self._condition:
+            return self._condition.wait_for(lambda: not self._queue and self._busy == 0, timeout)
+
+    def _worker_loop(self):
+        """Process queued items until the stage is stopped."""
+        while True:
+            with self._condition:
+                self._condition.wait_for(lambda: self._queue or not self._running)
+                if not self._queue:
+                    return
+                submitted_at, item = self._queue.popleft()
+                self._busy += 1
+                # Wake producers blocked on a full queue
+                self._condition.notify_all()
+
+            result = None
+            failed = False
+            try:
+                result = self.handler(item)
+            except Exception as e:
+                failed = True
+                self.logger.exception(f"Error in pipeline stage '{self.name}': {e}")
+
+            latency = time.monotonic() - submitted_at
+            with self._condition:
+                self._busy -= 1
+                if failed:
+                    self.errors += 1
+                else:
+                    self.processed += 1
+                self._total_latency += latency
+                self._max_latency = max(self._max_latency, latency)
+                self._condition.notify_all()
+
+            if result is not None and self.next_stage is not None:
+                self.next_stage.put(result)
+
+    def queue_depth(self):
+        """Return the number of queued items."""
+        with self._condition:
+            return len(self._queue)
+
+    def get_stats(self):
+        """Get stage metrics.
+
+        Returns:
+            dict: Queue depth, counters and latency for the stage
+        """
+        with self._condition:
+            completed = self.processed + self.errors
+            return {
+                "name": self.name,
+                "queue_depth": len(self._queue),
+                "max_queue_depth": self.max_queue_depth,
+                "queue_size": self.max_queue_size,
+                "in_flight": self._busy,
+                "submitted": self.submitted,
+                "processed": self.processed,
+                "dropped": self.dropped,
+                "errors": self.errors,
+                "avg_latency_ms": (self._total_latency / completed * 1000.0) if completed else 0.0,
+                "max_latency_ms": self._max_latency * 1000.0
+            }
+
+
+class Pipeline:
+    """A chain of pipeline stages fed by the capture loop."""
+
+    def __init__(self, stages):
+        """Initialize the pipeline and link the stages in order.
+
+        Args:
+            stages (list): PipelineStage objects, first stage receives submitted items
+        """
+        self.stages = stages
+        self.logger = logging.getLogger(__name__)
+        for stage, next_stage in zip(stages, stages[1:]):
+            stage.next_stage = next_stage
+
+    def start(self):
+        """Start all stages."""
+        for stage in self.stages:
+            stage.start()
+
+    def submit(self, item):
+        """Submit an item to the first stage without waiting.
+
+        Returns:
+            bool: True if the item was queued without dropping anything
+        """
+        return self.stages[0].put(item, timeout=0)
+
+    def stop(self, drain=True, timeout=10.0):
+        """Stop all stages, draining each before the next one."""
+        for stage in self.stages:
+            stage.stop(drain=drain, timeout=timeout)
+
+    def get_stats(self):
+        """Get metrics for all stages.
+
+        Returns:
+            dict: Stage metrics keyed by stage name
+        """
+        return {stage.name: stage.get_stats() for stage in self.stages}
@@ -0,0 +1,186 @@
+"""Near-duplicate frame suppression module using perceptual hashes."""
+import time
+import logging
+
+import numpy as np
+
+# ITU-R BT.601 luma weights for RGB frames
+_LUMA = np.array([0.299, 0.587, 0.114], dtype=np.float32)
+
+
+def dhash(image, hash_size=8):
+    """Compute the difference hash (dHash) of a frame.
+
+    The frame is reduced to hash_size x (hash_size + 1) block means of its
+    luminance; each bit says whether a block is brighter than its left
+    neighbour. Small changes (sensor noise, a feather moving) flip few bits,
+    a different scene flips many.
+
+    Args:
+        image (numpy.ndarray): Grayscale (H, W) or RGB (H, W, 3) frame,
+                               e.g. the lores inference frame
+        hash_size (int): Hash is hash_size * hash_size bits
+
+    Returns:
+        int: The hash
+    """
+    gray = np.asarray(image, dtype=np.float32)
+    if gray.ndim == 3:
+        gray = gray[..., :3] @ _LUMA
+
+    # Block means via reduceat, no resize dependency
+    height, width = gray.shape
+    rows = np.linspace(0, height, hash_size + 1).astype(np.intp)
+    cols = np.linspace(0, width, hash_size + 2).astype(np.intp)
+    sums = np.add.reduceat(np.add.reduceat(gray, rows[:-1], axis=0), cols[:-1], axis=1)
+    blocks = sums / np.outer(np.diff(rows), np.diff(cols))
+
+    value = 0
+    for bit in (blocks[:, 1:] > blocks[:, :-1]).ravel():
+        value = (value << 1) | int(bit)
+    return value
+
+
+def file_dhash(path, hash_size=8):
+    """Compute the dHash of a JPEG file, decoding it at reduced size.
+
+    Args:
+        path (str): Image file path
+        hash_size (int): Hash is hash_size * hash_size bits
+
+    Returns:
+        int: The hash, or None if the file cannot be read
+    """
+    try:
+        from PIL import Image
+
+        with Image.open(path) as img:
+            # Lets the JPEG decoder scale down by up to 8x in the DCT domain
+            img.draft("L", (img.width // 8, img.height // 8))
+            return dhash(np.asarray(img.convert("L")), hash_size)
+    except Exception as e:
+        logging.getLogger(__name__).warning(f"Could not hash {path}: {e}")
+        return None
+
+
+def hamming_distance(a, b):
+    """Number of differing bits between two hashes.
+
+    Args:
+        a (int): First hash
+        b (int): Second hash
+
+    Returns:
+        int: Hamming distance
+    """
+    return bin(a ^ b).count("1")
+
+
+class Visit:
+    """A run of near-identical frames, represented by its first frame."""
+
+    def __init__(self, visit_id, frame_hash, timestamp):
+        """Initialize the visit.
+
+        Args:
+            visit_id (str): Unique visit identifier
+            frame_hash (int): Hash of the first frame
+            timestamp (float): Capture time of the first frame
+        """
+        self.visit_id = visit_id
+        self.phash = frame_hash  # Representative frame hash
+        self.last_hash = frame_hash  # Latest frame, so slow movement stays in the visit
+        self.started_at = timestamp
+        self.last_seen = timestamp
+        self.frames = 1
+        self.representative = None  # Filename of the stored frame
+
+    def to_dict(self):
+        """Return the visit record stored with the representative photo."""
+        return {
+            "id": self.visit_id,
+            "phash": f"{self.phash:016x}",
+            "started_at": self.started_at,
+            "ended_at": self.last_seen,
+            "frames": self.frames,
+            "suppressed": self.frames - 1
+        }
+
+
+class VisitTracker:
+    """Groups consecutive near-duplicate frames into visits.
+
+    A frame joins the current visit when its hash is within max_distance bits
+    of the visit's latest frame and it arrives within visit_gap seconds of it.
+    Only the first frame of each visit is classified, stored and uploaded;
+    later frames just extend the visit.
+    """
+
+    def __init__(self, max_distance=5, visit_gap=30.0, max_visit_duration=300.0):
+        """Initialize the tracker.
+
+        Args:
+            max_distance (int): Maximum Hamming distance (of 64 bits) for a duplicate
+            visit_gap (float): Seconds without a matching frame that end a visit
+            max_visit_duration (float): Visits are split after this many seconds,
+                                        so a long stay still yields fresh frames
+        """
+        self.max_distance = max_distance
+        self.visit_gap = visit_gap
+        self.max_visit_duration = max_visit_duration
+        self.logger = logging.getLogger(__name__)
+
+        self.current = None
+        self.visits = 0
+        self.suppressed = 0
+        self._sequence = 0
+
+    def observe(self, frame_hash, timestamp=None):
+        """Assign a frame to the current visit or start a new one.
+
+        Args:
+            frame_hash (int): Hash of the frame
+            timestamp (float, optional): Capture time, defaults to time.time()
+
+        Returns:
+            tuple: (visit, is_new, ended) where ended is the visit that the
+                   frame closed, or None
+        """
+        now = time.time() if timestamp is None else timestamp
+        visit = self.current
+
+        if (visit is not None
+                and now - visit.last_seen <= self.visit_gap
+                and now - visit.started_at <= self.max_visit_duration
+                and hamming_distance(frame_hash, visit.last_hash) <= self.max_distance):
+            visit.last_hash = frame_hash
+            visit.last_seen = now
+            visit.frames += 1
+            self.suppressed += 1
+            return visit, False, None
+
+        self._sequence += 1
+        self.current = Visit(f"{int(now)}-{self._sequence}", frame_hash, now)
+        self.visits += 1
+        return self.current, True, visit
+
+    def expire(self, now=None):
+        """End the current visit if no frame arrived within visit_gap.
+
+        Args:
+            now (float, optional): Current time, defaults to time.time()
+
+        Returns:
+            Visit: The ended visit, or None
+        """
+        now = time.time() if now is None else now
+        visit = self.current
+        if visit is not None and now - visit.last_seen > self.visit_gap:
+            self.current = None
+            return visit
+        return None
+
+    def close(self):
+        """End and return the current visit (on shutdown)."""
+        visit, self.current = self.current, None
+        return visit
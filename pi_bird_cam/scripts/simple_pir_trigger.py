@@ -5,7 +5,9 @@ Smart PIR-Triggered Bird Camera
 Takes high-resolution photos when motion is detected by the PIR sensor.
 Features:
 - Always-active camera for fastest response time
-- Burst mode: Captures multiple photos when motion is detected
+- Burst mode: Saves frames from before and after the moment motion is detected
+  (pre-trigger ring buffer) plus a full-resolution photo or a hardware-encoded
+  1080p burst
 - Configurable PIR sampling rate for adjustable sensitivity
 - Comprehensive logging system
 - Time-based activation (only active during specified hours)
@@ -69,12 +71,15 @@ setup_logging()
 # Default settings
 DEFAULT_OUTPUT_DIR = "data/photos"
 DEFAULT_PIR_PIN = 4
-# Cooldown = (BURST_COUNT × BURST_DELAY) + SAFETY_BUFFER
-# Example: (5 × 0.3) + 0.2 = 1.7 seconds
-DEFAULT_BURST_COUNT = 5  # number of photos in burst
-DEFAULT_BURST_DELAY = 0.3  # seconds between burst photos
+# Cooldown = (POST_FRAMES / PREROLL_FPS) + SAFETY_BUFFER
+# Example: (5 / 10) + 0.2 = 0.7 seconds
+DEFAULT_PRE_FRAMES = 5  # buffered frames saved from before the trigger
+DEFAULT_POST_FRAMES = 5  # frames saved after the trigger
+DEFAULT_PREROLL_FPS = 10  # capture rate of the pre-trigger ring buffer
+DEFAULT_BURST_COUNT = 0  # 1080p frames from the hardware encoder after the trigger (0 = one full-res photo)
+DEFAULT_BURST_FPS = 15  # frame rate of the hardware-encoded burst
 DEFAULT_SAMPLING_RATE = 0.1  # seconds between PIR sensor checks
-DEFAULT_COOLDOWN = (DEFAULT_BURST_COUNT * DEFAULT_BURST_DELAY) + 0.2  # seconds between motion triggers
+DEFAULT_COOLDOWN = (DEFAULT_POST_FRAMES / DEFAULT_PREROLL_FPS) + 0.2  # seconds between motion triggers
 # Default time range (5am to 9am PST)
 DEFAULT_TIME_RANGE_ENABLED = True
 DEFAULT_START_HOUR = 5
@@ -85,8 +90,9 @@ DEFAULT_END_MINUTE = 0
 # Global camera variable
 camera = None
 
-def initialize_camera():
-    """Initialize the camera and keep it active"""
+def initialize_camera(pre_frames=DEFAULT_PRE_FRAMES, post_frames=DEFAULT_POST_FRAMES,
+                      preroll_fps=DEFAULT_PREROLL_FPS):
+    """Initialize the camera, keep it active and start the pre-trigger buffer"""
     global camera
     try:
         # Clean up any existing camera instance
@@ -95,12 +101,16 @@ def initialize_camera():
             camera = None
             time.sleep(0.5)  # Give time for resources to be fully released
             
+        # The constructor opens the camera; the lean path skips the control dump
+        # and settle delay so reinitializing after an error is quick
         camera = CameraHandler(
             resolution=(4056, 3040),
             rotation=0,
-            focus_distance_inches=13.5  # Default focus distance
+            focus_distance_inches=13.5,  # Default focus distance
+            lean_setup=True
         )
-        camera.setup()
+        # Ring holds the pre-trigger frames plus headroom for the post-trigger ones
+        camera.start_preroll(buffer_frames=pre_frames + post_frames, fps=preroll_fps)
         logging.info("Camera initialized and active")
         return True
     except Exception as e:
@@ -154,31 +164,60 @@ def capture_photo(output_dir, filename):
             pass
         return False
 
-def capture_burst(output_dir, base_filename, count, delay):
-    """Capture a burst of photos in sequence"""
+def capture_burst(output_dir, base_filename, pre_frames, post_frames, trigger_time=None,
+                  burst_count=0, burst_fps=DEFAULT_BURST_FPS):
+    """Save buffered frames from around the trigger plus a full-resolution photo
+    
+    Frames come from the camera's pre-trigger ring buffer, so the burst
+    includes the moment of motion instead of starting after it. With
+    burst_count > 0 the full-resolution photo is replaced by a 1080p burst
+    streamed from the hardware JPEG encoder.
+    """
+    global camera
     successful_captures = 0
     
+    if trigger_time is None:
+        trigger_time = time.time()
+    
     # Use timestamp as the base for all files in burst
-    timestamp = datetime.datetime.now().strftime("%Y%m%d_%H%M%S")
+    timestamp = datetime.datetime.fromtimestamp(trigger_time).strftime("%Y%m%d_%H%M%S")
     
     # Create date-based directory name
-    date_dir = datetime.datetime.now().strftime("%Y%m%d")
+    date_dir = datetime.datetime.fromtimestamp(trigger_time).strftime("%Y%m%d")
     date_dir_path = os.path.join(output_dir, date_dir)
     
     # Ensure date directory exists
     os.makedirs(date_dir_path, exist_ok=True)
     
-    for i in range(count):
-        # Create filename with burst index
-        filename = f"{timestamp}_burst{i+1}.jpg"
-            
-        # Capture the photo
-        if capture_photo(output_dir, filename):
+    # Make sure camera is initialized
+    if camera is None:
+        if not initialize_camera(pre_frames, post_frames):
+            return 0
+    
+    try:
+        frames = camera.capture_trigger_frames(trigger_time, pre_frames, post_frames)
+        
+        for i, frame in enumerate(frames):
+            # Negative offsets are frames from before the trigger
+            offset_ms = int((frame.timestamp - trigger_time) * 1000)
+            filename = f"{timestamp}_{base_filename}_burst{i+1}_{offset_ms:+d}ms.jpg"
+            camera.save_frame_async(frame, os.path.join(date_dir_path, filename))
             successful_captures += 1
         
-        # Wait between burst photos, but not after the last one
-        if i < count - 1:
-            time.sleep(delay)
+        logging.info(f"Saved {successful_captures} buffered frames around the trigger")
+    except Exception as e:
+        logging.error(f"Exception while saving buffered frames: {e}")
+    
+    if burst_count > 0:
+        try:
+            burst_paths = camera.capture_burst(date_dir_path, count=burst_count, fps=burst_fps,
+                                               prefix=f"{base_filename}_hw_")
+            successful_captures += len(burst_paths)
+        except Exception as e:
+            logging.error(f"Exception while capturing hardware burst: {e}")
+    elif capture_photo(output_dir, f"{timestamp}_{base_filename}_full.jpg"):
+        # Full-resolution photo straight after the buffered frames
+        successful_captures += 1
     
     return successful_captures
 
@@ -236,10 +275,17 @@ def main():
                         help=f"GPIO pin number for PIR sensor (default: {DEFAULT_PIR_PIN})")
     parser.add_argument("--cooldown", "-c", type=float, default=DEFAULT_COOLDOWN,
                         help=f"Cooldown time between motion triggers in seconds (default: {DEFAULT_COOLDOWN}s)")
-    parser.add_argument("--burst", "-b", type=int, default=DEFAULT_BURST_COUNT,
-                        help=f"Number of photos to take in burst mode (default: {DEFAULT_BURST_COUNT})")
-    parser.add_argument("--burst-delay", "-bd", type=float, default=DEFAULT_BURST_DELAY,
-                        help=f"Delay between burst photos in seconds (default: {DEFAULT_BURST_DELAY}s)")
+    parser.add_argument("--pre-frames", type=int, default=DEFAULT_PRE_FRAMES,
+                        help=f"Buffered frames to save from before the trigger (default: {DEFAULT_PRE_FRAMES})")
+    parser.add_argument("--post-frames", type=int, default=DEFAULT_POST_FRAMES,
+                        help=f"Frames to save after the trigger (default: {DEFAULT_POST_FRAMES})")
+    parser.add_argument("--preroll-fps", type=float, default=DEFAULT_PREROLL_FPS,
+                        help=f"Capture rate of the pre-trigger buffer (default: {DEFAULT_PREROLL_FPS})")
+    parser.add_argument("--burst-count", type=int, default=DEFAULT_BURST_COUNT,
+                        help="1080p frames to capture with the hardware encoder after the trigger "
+                             f"(default: {DEFAULT_BURST_COUNT}, one full-resolution photo instead)")
+    parser.add_argument("--burst-fps", type=float, default=DEFAULT_BURST_FPS,
+                        help=f"Frame rate of the hardware-encoded burst (default: {DEFAULT_BURST_FPS})")
     parser.add_argument("--sampling-rate", "-sr", type=float, default=DEFAULT_SAMPLING_RATE,
                         help=f"How often to check PIR sensor in seconds (default: {DEFAULT_SAMPLING_RATE}s)")
     parser.add_argument("--test", action="store_true",
@@ -278,8 +324,13 @@ def main():
     
     # Take a test photo if requested
     if args.test:
-        logging.info(f"Taking test burst of {args.burst} photos...")
-        capture_burst(args.output, "test", args.burst, args.burst_delay)
+        logging.info(f"Taking test burst ({args.pre_frames} pre + {args.post_frames} post frames)...")
+        initialize_camera(args.pre_frames, args.post_frames, args.preroll_fps)
+        # Let the ring buffer fill before triggering
+        time.sleep(args.pre_frames / args.preroll_fps)
+        capture_burst(args.output, "test", args.pre_frames, args.post_frames,
+                      burst_count=args.burst_count, burst_fps=args.burst_fps)
+        cleanup()
         logging.info(f"Test photos saved to {os.path.abspath(args.output)}")
         return
     
@@ -305,7 +356,8 @@ def main():
     logging.info(f"Using pin GPIO{args.pin} for motion detection")
     logging.info(f"Photos will be saved to: {os.path.abspath(args.output)}")
     logging.info(f"Maximum resolution photos (4056x3040)")
-    logging.info(f"Burst mode: {args.burst} photos with {args.burst_delay}s delay")
+    logging.info(f"Burst mode: {args.pre_frames} pre-trigger + {args.post_frames} post-trigger frames "
+                 f"at {args.preroll_fps} fps")
     logging.info(f"Cooldown between triggers: {args.cooldown}s")
     logging.info(f"PIR sensor sampling rate: {args.sampling_rate}s")
     
@@ -326,7 +378,7 @@ def main():
     
     try:
         # Initialize camera and keep it active
-        initialize_camera()
+        initialize_camera(args.pre_frames, args.post_frames, args.preroll_fps)
         
         while True:
             current_time = time.time()
@@ -357,14 +409,16 @@ def main():
                 # Check if motion was detected (rising edge: 0->1) and past cooldown period
                 if current_state == 1 and last_state == 0 and (current_time - last_motion_time > args.cooldown):
                     # Motion detected, take a burst of photos
-                    logging.info(f"Motion detected! Capturing burst of {args.burst} photos...")
+                    logging.info("Motion detected! Saving frames around the trigger...")
                     
                     # Capture the burst
-                    successful = capture_burst(args.output, "motion", args.burst, args.burst_delay)
+                    successful = capture_burst(args.output, "motion", args.pre_frames, args.post_frames,
+                                               trigger_time=current_time, burst_count=args.burst_count,
+                                               burst_fps=args.burst_fps)
                     photo_count += successful
                     
                     if successful > 0:
-                        logging.info(f"Burst complete: {successful}/{args.burst} photos captured")
+                        logging.info(f"Burst complete: {successful} photos captured")
                         last_motion_time = current_time
                     else:
                         logging.error("Failed to capture any photos in burst")
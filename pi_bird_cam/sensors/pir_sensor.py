@@ -1,6 +1,8 @@
 """PIR Motion Sensor Module for detecting movement."""
 import time
 import logging
+import threading
+from collections import deque
 try:
     import RPi.GPIO as GPIO
 except ImportError:
@@ -13,6 +15,7 @@ except ImportError:
         BCM = "BCM"
         IN = "IN"
         PUD_DOWN = "PUD_DOWN"
+        RISING = "RISING"
         
         def __init__(self):
             self.pins = {}
@@ -31,7 +34,13 @@ except ImportError:
             detected = random.random() < 0.2
             return detected
             
-        def cleanup(self):
+        def add_event_detect(self, pin, edge, callback=None, bouncetime=None):
+            self.pins[pin] = callback
+            
+        def remove_event_detect(self, pin):
+            self.pins[pin] = False
+            
+        def cleanup(self, pin=None):
             self.pins = {}
     
     # Create mock GPIO module
@@ -43,25 +52,87 @@ except ImportError:
 class PIRSensor:
     """Class to handle PIR motion sensor operations."""
 
-    def __init__(self, pin, cooldown_time=1.0):
+    def __init__(self, pin, cooldown_time=1.0, edge_detection=False, backend="rpi_gpio",
+                 bouncetime_ms=10, edge_buffer_size=32):
         """Initialize the PIR sensor with GPIO pin.
         
         Args:
             pin (int): GPIO pin number connected to the PIR sensor
             cooldown_time (float): Time in seconds to wait between motion checks
+            edge_detection (bool): Use rising-edge interrupts instead of polling
+            backend (str): Interrupt source, "rpi_gpio" or "pigpio" (needs pigpiod)
+            bouncetime_ms (int): Debounce time for RPi.GPIO edge detection
+            edge_buffer_size (int): Number of pending edges kept; the oldest are dropped
         """
         self.pin = pin
         self.cooldown_time = cooldown_time
+        self.edge_detection = edge_detection
+        self.backend = backend
+        self.bouncetime_ms = bouncetime_ms
         self.logger = logging.getLogger(__name__)
         self.last_detection_time = 0
+        
+        # Time of the rising edge that produced the last detection
+        self.last_edge_time = None
+        
+        # Edge timestamps pushed from the interrupt callback. deque append and
+        # popleft are atomic, so the callback never takes a lock; a full buffer
+        # drops the oldest edge.
+        self._edges = deque(maxlen=edge_buffer_size)
+        self._edge_event = threading.Event()
+        self._pi = None
+        self._pigpio_callback = None
+        self._tick_offset = 0.0
         self.setup()
         
     def setup(self):
         """Setup GPIO pin for PIR sensor."""
         self.logger.info(f"Setting up PIR sensor on GPIO pin {self.pin}")
+        if self.edge_detection and self.backend == "pigpio":
+            self._setup_pigpio()
+            return
+        
         GPIO.setmode(GPIO.BCM)
         GPIO.setup(self.pin, GPIO.IN, pull_up_down=GPIO.PUD_DOWN)
         
+        if self.edge_detection:
+            self.logger.info("Using edge-triggered PIR detection (RPi.GPIO)")
+            GPIO.add_event_detect(self.pin, GPIO.RISING, callback=self._on_edge,
+                                  bouncetime=self.bouncetime_ms)
+    
+    def _setup_pigpio(self):
+        """Register a pigpio rising-edge callback (timestamps come from the daemon)."""
+        import pigpio
+        
+        self._pi = pigpio.pi()
+        if not self._pi.connected:
+            raise RuntimeError("Failed to connect to pigpio daemon (is pigpiod running?)")
+        
+        self._pi.set_mode(self.pin, pigpio.INPUT)
+        self._pi.set_pull_up_down(self.pin, pigpio.PUD_DOWN)
+        
+        # pigpio ticks are microseconds since boot; map them to wall-clock time
+        self._tick_offset = time.time() - self._pi.get_current_tick() / 1e6
+        self._pigpio_callback = self._pi.callback(self.pin, pigpio.RISING_EDGE, self._on_pigpio_edge)
+        self.logger.info("Using edge-triggered PIR detection (pigpio)")
+    
+    def _on_edge(self, channel):
+        """RPi.GPIO interrupt callback: timestamp the edge and wake the waiter."""
+        self._edges.append(time.time())
+        self._edge_event.set()
+    
+    def _on_pigpio_edge(self, gpio, level, tick):
+        """pigpio interrupt callback: use the daemon's edge tick as timestamp."""
+        edge_time = self._tick_offset + tick / 1e6
+        
+        # The 32-bit tick wraps every ~72 minutes; re-anchor when it does
+        if edge_time < time.time() - 60:
+            self._tick_offset = time.time() - tick / 1e6
+            edge_time = time.time()
+        
+        self._edges.append(edge_time)
+        self._edge_event.set()
+        
     def detect_motion(self):
         """Detect motion from the PIR sensor.
         
@@ -91,6 +162,9 @@ class PIRSensor:
         Returns:
             bool: True if motion was detected, False if timeout occurred
         """
+        if self.edge_detection:
+            return self._wait_for_edge(timeout)
+        
         self.logger.info(f"Waiting for motion (timeout: {timeout if timeout else 'none'})")
         
         start_time = time.time()
@@ -102,9 +176,49 @@ class PIRSensor:
         self.logger.info("Timeout occurred while waiting for motion")
         return False
         
+    def _wait_for_edge(self, timeout=None):
+        """Block until an interrupt-timestamped edge outside the cooldown arrives.
+        
+        Args:
+            timeout (float, optional): Maximum time to wait in seconds.
+            
+        Returns:
+            bool: True if motion was detected, False if timeout occurred
+        """
+        deadline = None if timeout is None else time.monotonic() + timeout
+        
+        while True:
+            while self._edges:
+                edge_time = self._edges.popleft()
+                if edge_time - self.last_detection_time >= self.cooldown_time:
+                    self.last_detection_time = edge_time
+                    self.last_edge_time = edge_time
+                    self.logger.info("Motion detected by PIR sensor")
+                    return True
+            
+            self._edge_event.clear()
+            # An edge may have arrived between draining and clearing the event
+            if self._edges:
+                continue
+            
+            remaining = None if deadline is None else deadline - time.monotonic()
+            if remaining is not None and remaining <= 0:
+                return False
+            
+            self._edge_event.wait(remaining)
+        
     def cleanup(self):
         """Clean up GPIO resources."""
         self.logger.info("Cleaning up PIR sensor GPIO resources")
+        if self._pigpio_callback is not None:
+            self._pigpio_callback.cancel()
+            self._pi.stop()
+            self._pigpio_callback = None
+            return
+        
+        if self.edge_detection:
+            GPIO.remove_event_detect(self.pin)
+        
         # Only clean up the specific pin we used
         # This is safer than GPIO.cleanup() which cleans up all pins
         GPIO.cleanup(self.pin) 
\ No newline at end of file
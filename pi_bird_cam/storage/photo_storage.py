@@ -1,27 +1,67 @@
 """Photo storage module for managing captured images."""
 import os
+import time
 import shutil
 import logging
+import bisect
+import threading
+from collections import deque
 from datetime import datetime
 import json
 
 
 class PhotoStorage:
-    """Class to handle photo storage operations."""
+    """Class to handle photo storage operations.
 
-    def __init__(self, base_dir="photos", max_photos=1000, metadata_file="photo_metadata.json"):
+    Stored photos are tracked in an in-memory index ordered by capture time,
+    so enforcing max_photos evicts from the front of the index instead of
+    rescanning the date directories. The index is rebuilt from the persisted
+    metadata on startup; call reconcile() to rescan the disk explicitly.
+
+    Metadata changes are appended to a JSON-lines journal next to the metadata
+    file instead of rewriting it; the journal is fsynced in batches and
+    compacted into the metadata file once it grows past compact_threshold.
+
+    The metadata, journal and index are guarded by one lock, so photos can be
+    saved from the store stage while visit summaries are recorded elsewhere.
+    """
+
+    # .h264 keyframes and .mp4 clips come from the camera's clip mode
+    IMAGE_EXTENSIONS = ('.jpg', '.jpeg', '.png', '.gif', '.h264', '.mp4')
+
+    JOURNAL_SUFFIX = ".journal"
+
+    def __init__(self, base_dir="photos", max_photos=1000, metadata_file="photo_metadata.json",
+                 sync_interval=5.0, sync_batch_size=16, compact_threshold=1000):
         """Initialize photo storage with base directory.
         
         Args:
             base_dir (str): Base directory for storing photos
             max_photos (int): Maximum number of photos to keep
             metadata_file (str): Filename for metadata storage
+            sync_interval (float): Maximum seconds between journal fsyncs
+            sync_batch_size (int): Journal records written before an fsync is forced
+            compact_threshold (int): Journal records before compacting into the metadata file
         """
         self.base_dir = base_dir
         self.max_photos = max_photos
         self.metadata_file = os.path.join(base_dir, metadata_file)
+        self.journal_file = os.path.splitext(self.metadata_file)[0] + self.JOURNAL_SUFFIX
+        self.sync_interval = sync_interval
+        self.sync_batch_size = sync_batch_size
+        self.compact_threshold = compact_threshold
+        self._journal = None
+        self._journal_records = 0  # Records in the journal since the last compaction
+        self._unsynced_records = 0
+        self._last_sync = time.monotonic()
         self.logger = logging.getLogger(__name__)
         self.metadata = {}
+        # Time-ordered (capture_time, relative_path) entries; entries whose path
+        # is no longer in _index_times (or has a newer time) are stale and skipped
+        self._index = deque()
+        self._index_times = {}
+        # Reentrant: saving a photo can compact the journal and evict photos
+        self._lock = threading.RLock()
         self.setup()
         
     def setup(self):
@@ -30,11 +70,14 @@ class PhotoStorage:
         os.makedirs(self.base_dir, exist_ok=True)
         
         # Load existing metadata if it exists
-        if os.path.exists(self.metadata_file):
+        if os.path.exists(self.metadata_file) or os.path.exists(self.journal_file):
             self.load_metadata()
+            self._build_index_from_metadata()
+        else:
+            self.reconcile()
         
     def load_metadata(self):
-        """Load metadata from the metadata file."""
+        """Load metadata from the metadata file and replay the journal."""
         try:
             with open(self.metadata_file, 'r') as f:
                 self.metadata = json.load(f)
@@ -42,16 +85,193 @@ class PhotoStorage:
         except (json.JSONDecodeError, FileNotFoundError) as e:
             self.logger.warning(f"Failed to load metadata: {str(e)}")
             self.metadata = {}
+        
+        self._replay_journal()
+    
+    def _replay_journal(self):
+        """Apply the journal records written since the last compaction."""
+        self._journal_records = 0
+        if not os.path.exists(self.journal_file):
+            return
+        
+        with open(self.journal_file, 'r') as f:
+            for line in f:
+                try:
+                    record = json.loads(line)
+                except json.JSONDecodeError:
+                    # Torn final record from a crash mid-write
+                    self.logger.warning("Ignoring truncated metadata journal record")
+                    break
+                
+                if record.get('op') == 'put':
+                    self.metadata[record['key']] = record['value']
+                elif record.get('op') == 'del':
+                    self.metadata.pop(record['key'], None)
+                self._journal_records += 1
+        
+        if self._journal_records:
+            self.logger.info(f"Replayed {self._journal_records} metadata journal records")
             
     def save_metadata(self):
-        """Save metadata to the metadata file."""
+        """Save a full metadata snapshot and truncate the journal (compaction)."""
+        with self._lock:
+            self._save_metadata()
+    
+    def _save_metadata(self):
+        """Write the snapshot and truncate the journal. Caller holds the lock."""
+        temp_file = self.metadata_file + ".tmp"
         try:
-            with open(self.metadata_file, 'w') as f:
+            # Write the snapshot next to the old one and swap it in atomically
+            with open(temp_file, 'w') as f:
                 json.dump(self.metadata, f, indent=2)
+                f.flush()
+                os.fsync(f.fileno())
+            os.replace(temp_file, self.metadata_file)
+            
+            # The snapshot now contains every journaled change
+            self._close_journal()
+            with open(self.journal_file, 'w'):
+                pass
+            self._journal_records = 0
             self.logger.info(f"Saved metadata for {len(self.metadata)} photos")
         except Exception as e:
             self.logger.error(f"Failed to save metadata: {str(e)}")
     
+    def _append_journal(self, op, key, value=None):
+        """Append a metadata change to the journal, fsyncing in batches."""
+        record = {'op': op, 'key': key}
+        if value is not None:
+            record['value'] = value
+        
+        try:
+            if self._journal is None:
+                self._journal = open(self.journal_file, 'a')
+            self._journal.write(json.dumps(record, separators=(',', ':')) + "\n")
+            # Hand the record to the OS right away; fsync is what gets batched
+            self._journal.flush()
+            self._journal_records += 1
+            self._unsynced_records += 1
+            
+            if (self._unsynced_records >= self.sync_batch_size or
+                    time.monotonic() - self._last_sync >= self.sync_interval):
+                self.flush()
+        except Exception as e:
+            self.logger.error(f"Failed to append metadata journal: {str(e)}")
+            return
+        
+        if self._journal_records >= self.compact_threshold:
+            self.logger.info(f"Compacting metadata journal ({self._journal_records} records)")
+            self._save_metadata()
+    
+    def flush(self):
+        """Fsync journal records written since the last sync."""
+        with self._lock:
+            if self._journal is not None and self._unsynced_records:
+                os.fsync(self._journal.fileno())
+            self._unsynced_records = 0
+            self._last_sync = time.monotonic()
+    
+    def _close_journal(self):
+        """Fsync and close the journal file."""
+        if self._journal is not None:
+            self.flush()
+            self._journal.close()
+            self._journal = None
+    
+    def close(self):
+        """Flush pending metadata changes to disk."""
+        try:
+            with self._lock:
+                self._close_journal()
+        except Exception as e:
+            self.logger.error(f"Failed to close metadata journal: {str(e)}")
+    
+    def _relative_path(self, path):
+        """Return a photo path relative to the base directory."""
+        return os.path.relpath(path, self.base_dir)
+    
+    def _index_add(self, relative_path, capture_time):
+        """Add a photo to the time-ordered index."""
+        self._index_times[relative_path] = capture_time
+        entry = (capture_time, relative_path)
+        if not self._index or capture_time >= self._index[-1][0]:
+            self._index.append(entry)
+        else:
+            # Out-of-order capture time (e.g. clock adjustment), rare
+            self._index.insert(bisect.bisect_right(self._index, entry), entry)
+    
+    def _index_remove(self, relative_path):
+        """Remove a photo from the index; its deque entry is skipped lazily."""
+        self._index_times.pop(relative_path, None)
+        
+        # Compact once most entries are stale
+        if len(self._index) > 2 * len(self._index_times) + 64:
+            self._index = deque(entry for entry in self._index
+                                if self._index_times.get(entry[1]) == entry[0])
+    
+    def _build_index_from_metadata(self):
+        """Build the index from the persisted metadata without touching the disk."""
+        entries = []
+        for filename, photo_metadata in self.metadata.items():
+            path = photo_metadata.get('path')
+            if not path:
+                continue
+            capture_time = photo_metadata.get('capture_time')
+            if capture_time is None:
+                try:
+                    capture_time = datetime.fromisoformat(photo_metadata['timestamp']).timestamp()
+                except (KeyError, TypeError, ValueError):
+                    capture_time = 0.0
+            entries.append((capture_time, self._relative_path(path)))
+        
+        entries.sort()
+        self._index = deque(entries)
+        self._index_times = {relative_path: capture_time for capture_time, relative_path in entries}
+        self.logger.info(f"Indexed {len(self._index_times)} photos from metadata")
+    
+    def reconcile(self):
+        """Rebuild the index from a full rescan of the storage directories.
+        
+        Photos are ordered by their metadata capture time when known, otherwise
+        by file modification time.
+        
+        Returns:
+            int: Number of indexed photos
+        """
+        with self._lock:
+            return self._reconcile()
+    
+    def _reconcile(self):
+        """Rescan and rebuild the index. Caller holds the lock."""
+        metadata_times = {}
+        for photo_metadata in self.metadata.values():
+            if photo_metadata.get('path') and photo_metadata.get('capture_time') is not None:
+                metadata_times[self._relative_path(photo_metadata['path'])] = photo_metadata['capture_time']
+        
+        entries = []
+        for relative_path in self.list_photos():
+            capture_time = metadata_times.get(relative_path)
+            if capture_time is None:
+                try:
+                    capture_time = os.path.getmtime(os.path.join(self.base_dir, relative_path))
+                except OSError:
+                    continue
+            entries.append((capture_time, relative_path))
+        
+        entries.sort()
+        self._index = deque(entries)
+        self._index_times = {relative_path: capture_time for capture_time, relative_path in entries}
+        self.logger.info(f"Reconciled photo index: {len(self._index_times)} photos")
+        return len(self._index_times)
+    
+    def photo_count(self):
+        """Get the number of indexed photos.
+        
+        Returns:
+            int: Number of photos in the index
+        """
+        return len(self._index_times)
+    
     def get_date_directory(self, date=None):
         """Get the date directory name in YYYYMMDD format.
         
@@ -106,7 +326,9 @@ class PhotoStorage:
             # If photo_data is a file path, copy the file
             try:
                 if os.path.exists(photo_data):
-                    shutil.copy2(photo_data, full_path)
+                    # Photos written in place (e.g. by the camera) need no copy
+                    if os.path.abspath(photo_data) != os.path.abspath(full_path):
+                        shutil.copy2(photo_data, full_path)
                 else:
                     # Assume it's a file-like object
                     with open(full_path, 'wb') as f:
@@ -120,33 +342,40 @@ class PhotoStorage:
         if metadata is None:
             metadata = {}
             
+        capture_time = time.time()
         metadata['timestamp'] = datetime.now().isoformat()
+        metadata['capture_time'] = capture_time
         metadata['filename'] = filename
         metadata['path'] = full_path
         
-        self.metadata[filename] = metadata
-        self.save_metadata()
-        
-        # Enforce max photos limit
-        self._enforce_max_photos()
+        # Keyed by the bare filename, as every lookup and delete is
+        base_filename = os.path.basename(filename)
+        with self._lock:
+            self.metadata[base_filename] = metadata
+            self._append_journal('put', base_filename, metadata)
+            self._index_add(self._relative_path(full_path), capture_time)
+            
+            # Enforce max photos limit
+            self._enforce_max_photos()
         
         return full_path
     
     def _enforce_max_photos(self):
         """Enforce the maximum number of photos by deleting the oldest ones."""
-        photo_files = self.list_photos()
+        num_to_delete = len(self._index_times) - self.max_photos
+        if num_to_delete <= 0:
+            return
         
-        if len(photo_files) > self.max_photos:
-            # Sort by creation time (oldest first)
-            photo_files.sort(key=lambda f: os.path.getctime(self.get_photo_path(f)))
+        self.logger.info(f"Enforcing max photos limit, deleting {num_to_delete} oldest photos")
+        while len(self._index_times) > self.max_photos and self._index:
+            capture_time, relative_path = self._index.popleft()
+            if self._index_times.get(relative_path) != capture_time:
+                continue  # Stale entry for a deleted or re-saved photo
             
-            # Calculate how many to delete
-            num_to_delete = len(photo_files) - self.max_photos
-            self.logger.info(f"Enforcing max photos limit, deleting {num_to_delete} oldest photos")
-            
-            # Delete oldest photos
-            for i in range(num_to_delete):
-                self.delete_photo(photo_files[i])
+            # Index paths are exact, unlike bare filenames passed to delete_photo
+            if not self._delete_file(os.path.join(self.base_dir, relative_path), relative_path):
+                # Already gone from disk; drop it from the index anyway
+                self._index_remove(relative_path)
         
     def list_photos(self):
         """List all saved photos.
@@ -179,7 +408,7 @@ class PhotoStorage:
                 
                 # Filter for image files
                 for f in dir_files:
-                    if (f.lower().endswith(('.jpg', '.jpeg', '.png', '.gif')) and
+                    if (f.lower().endswith(self.IMAGE_EXTENSIONS) and
                         os.path.isfile(os.path.join(dir_path, f))):
                         # Store as dir_name/filename if in a subdirectory
                         if dir_name:
@@ -226,8 +455,29 @@ class PhotoStorage:
         """
         # Extract just the filename without directory for metadata lookup
         base_filename = os.path.basename(filename)
-        return self.metadata.get(base_filename, {})
+        with self._lock:
+            return dict(self.metadata.get(base_filename, {}))
     
+    def update_photo_metadata(self, filename, updates):
+        """Merge fields into the metadata of a stored photo.
+
+        Args:
+            filename (str): Filename of the photo
+            updates (dict): Fields to set
+
+        Returns:
+            bool: True if the photo was found, False otherwise
+        """
+        base_filename = os.path.basename(filename)
+        with self._lock:
+            photo_metadata = self.metadata.get(base_filename)
+            if photo_metadata is None:
+                return False
+
+            photo_metadata.update(updates)
+            self._append_journal('put', base_filename, photo_metadata)
+        return True
+
     def delete_photo(self, filename):
         """Delete a photo.
         
@@ -237,17 +487,21 @@ class PhotoStorage:
         Returns:
             bool: True if deletion was successful, False otherwise
         """
-        path = self.get_photo_path(filename)
-        
+        with self._lock:
+            return self._delete_file(self.get_photo_path(filename), filename)
+    
+    def _delete_file(self, path, filename):
+        """Delete a photo file and drop it from the index and metadata."""
         if os.path.exists(path):
             try:
                 os.remove(path)
+                self._index_remove(self._relative_path(path))
                 
                 # Remove from metadata
                 base_filename = os.path.basename(filename)
                 if base_filename in self.metadata:
                     del self.metadata[base_filename]
-                    self.save_metadata()
+                    self._append_journal('del', base_filename)
                 
                 self.logger.info(f"Deleted photo: {filename}")
                 return True
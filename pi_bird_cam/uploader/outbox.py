@@ -0,0 +1,201 @@
+"""Persistent upload outbox module backed by SQLite."""
+import json
+import time
+import sqlite3
+import logging
+import threading
+
+
+class UploadOutbox:
+    """On-disk queue of photos waiting to be uploaded.
+
+    Every queued upload is a row that survives restarts and power loss.
+    Workers claim pending rows, and each upload finishes as done, is
+    rescheduled with a backoff, or fails permanently. Rows that were
+    uploading when the process stopped are pending again on the next start.
+    """
+
+    PENDING = "pending"
+    UPLOADING = "uploading"
+    DONE = "done"
+    FAILED = "failed"
+
+    def __init__(self, db_path):
+        """Open (or create) the outbox database.
+
+        Args:
+            db_path (str): Path to the SQLite database file
+        """
+        self.db_path = db_path
+        self.logger = logging.getLogger(__name__)
+        self._lock = threading.Lock()
+        self._conn = sqlite3.connect(db_path, check_same_thread=False, isolation_level=None)
+        self._conn.row_factory = sqlite3.Row
+        # WAL keeps enqueues cheap on the SD card; NORMAL only risks the last
+        # transaction on power loss, and an upload is just retried
+        self._conn.execute("PRAGMA journal_mode=WAL")
+        self._conn.execute("PRAGMA synchronous=NORMAL")
+        self._conn.execute("""
+            CREATE TABLE IF NOT EXISTS uploads (
+                id INTEGER PRIMARY KEY AUTOINCREMENT,
+                file_path TEXT NOT NULL,
+                remote_key TEXT NOT NULL,
+                metadata TEXT,
+                status TEXT NOT NULL,
+                attempts INTEGER NOT NULL DEFAULT 0,
+                next_attempt REAL NOT NULL DEFAULT 0,
+                created REAL NOT NULL,
+                completed REAL,
+                url TEXT,
+                error TEXT
+            )
+        """)
+        self._conn.execute(
+            "CREATE INDEX IF NOT EXISTS idx_uploads_status ON uploads (status, next_attempt)"
+        )
+        recovered = self._conn.execute(
+            "UPDATE uploads SET status = ? WHERE status = ?", (self.PENDING, self.UPLOADING)
+        ).rowcount
+        if recovered:
+            self.logger.info(f"Requeued {recovered} interrupted uploads")
+
+    def enqueue(self, file_path, remote_key, metadata=None):
+        """Add an upload to the outbox.
+
+        Args:
+            file_path (str): Local file to upload
+            remote_key (str): Destination key
+            metadata (dict, optional): Metadata stored with the upload
+
+        Returns:
+            int: Ticket identifying the upload
+        """
+        with self._lock:
+            cursor = self._conn.execute(
+                "INSERT INTO uploads (file_path, remote_key, metadata, status, created) "
+                "VALUES (?, ?, ?, ?, ?)",
+                (file_path, remote_key, json.dumps(metadata, default=str) if metadata else None,
+                 self.PENDING, time.time())
+            )
+            return cursor.lastrowid
+
+    def claim(self):
+        """Claim the oldest upload that is due.
+
+        Returns:
+            dict: The claimed upload, or None if nothing is due
+        """
+        with self._lock:
+            self._conn.execute("BEGIN IMMEDIATE")
+            try:
+                row = self._conn.execute(
+                    "SELECT * FROM uploads WHERE status = ? AND next_attempt <= ? "
+                    "ORDER BY id LIMIT 1",
+                    (self.PENDING, time.time())
+                ).fetchone()
+                if row is not None:
+                    self._conn.execute("UPDATE uploads SET status = ? WHERE id = ?",
+                                       (self.UPLOADING, row["id"]))
+                self._conn.execute("COMMIT")
+            except Exception:
+                self._conn.execute("ROLLBACK")
+                raise
+        return dict(row) if row is not None else None
+
+    def next_due(self):
+        """Return the earliest next_attempt time among pending uploads, or None."""
+        with self._lock:
+            row = self._conn.execute(
+                "SELECT MIN(next_attempt) FROM uploads WHERE status = ?", (self.PENDING,)
+            ).fetchone()
+        return row[0]
+
+    def complete(self, ticket, url):
+        """Mark an upload as done.
+
+        Args:
+            ticket (int): Upload ticket
+            url (str): Location of the uploaded object
+        """
+        with self._lock:
+            self._conn.execute(
+                "UPDATE uploads SET status = ?, completed = ?, url = ?, error = NULL WHERE id = ?",
+                (self.DONE, time.time(), url, ticket)
+            )
+
+    def retry(self, ticket, delay, error):
+        """Return an upload to the queue after a delay.
+
+        Args:
+            ticket (int): Upload ticket
+            delay (float): Seconds before the upload is due again
+            error (str): Reason for the retry
+        """
+        with self._lock:
+            self._conn.execute(
+                "UPDATE uploads SET status = ?, attempts = attempts + 1, next_attempt = ?, "
+                "error = ? WHERE id = ?",
+                (self.PENDING, time.time() + delay, error, ticket)
+            )
+
+    def fail(self, ticket, error):
+        """Mark an upload as permanently failed.
+
+        Args:
+            ticket (int): Upload ticket
+            error (str): Reason for the failure
+        """
+        with self._lock:
+            self._conn.execute(
+                "UPDATE uploads SET status = ?, attempts = attempts + 1, error = ? WHERE id = ?",
+                (self.FAILED, error, ticket)
+            )
+
+    def get(self, ticket):
+        """Return an upload by ticket, or None if unknown."""
+        with self._lock:
+            row = self._conn.execute("SELECT * FROM uploads WHERE id = ?", (ticket,)).fetchone()
+        return dict(row) if row is not None else None
+
+    def list_done(self, limit=100):
+        """Return the URLs of the most recent completed uploads.
+
+        Args:
+            limit (int): Maximum number of URLs
+
+        Returns:
+            list: URLs, newest first
+        """
+        with self._lock:
+            rows = self._conn.execute(
+                "SELECT url FROM uploads WHERE status = ? ORDER BY completed DESC LIMIT ?",
+                (self.DONE, limit)
+            ).fetchall()
+        return [row["url"] for row in rows]
+
+    def counts(self):
+        """Return the number of uploads in each status."""
+        with self._lock:
+            rows = self._conn.execute(
+                "SELECT status, COUNT(*) AS count FROM uploads GROUP BY status"
+            ).fetchall()
+        counts = {status: 0 for status in (self.PENDING, self.UPLOADING, self.DONE, self.FAILED)}
+        counts.update({row["status"]: row["count"] for row in rows})
+        return counts
+
+    def prune(self, max_age_days=7):
+        """Delete completed uploads older than max_age_days.
+
+        Returns:
+            int: Number of rows deleted
+        """
+        with self._lock:
+            return self._conn.execute(
+                "DELETE FROM uploads WHERE status = ? AND completed < ?",
+                (self.DONE, time.time() - max_age_days * 86400)
+            ).rowcount
+
+    def close(self):
+        """Close the database."""
+        with self._lock:
+            self._conn.close()
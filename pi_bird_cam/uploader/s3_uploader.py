@@ -0,0 +1,254 @@
+"""Asynchronous S3 uploader module with a persistent outbox."""
+import os
+import time
+import random
+import logging
+import threading
+
+from .outbox import UploadOutbox
+from .throttle import TokenBucket
+
+try:
+    import boto3
+    from boto3.exceptions import S3UploadFailedError
+    from boto3.s3.transfer import TransferConfig
+    from botocore.exceptions import BotoCoreError, ClientError
+except ImportError:
+    boto3 = None
+    TransferConfig = None
+    BotoCoreError = ClientError = S3UploadFailedError = OSError
+
+# upload_file wraps ClientError (403, 5xx, SlowDown) in S3UploadFailedError
+UPLOAD_ERRORS = (BotoCoreError, ClientError, S3UploadFailedError, OSError)
+
+
+class S3Uploader:
+    """Uploads photos to S3 from a small pool of background workers.
+
+    Photos are queued in a SQLite outbox and ``enqueue`` returns a ticket
+    immediately. Workers run at a lower CPU priority than the camera, share
+    one bandwidth cap, use multipart uploads for large files and retry
+    failures with exponential backoff.
+    """
+
+    def __init__(self, bucket, outbox_path, credentials=None, region=None, prefix="",
+                 workers=2, max_bandwidth_kbps=None, multipart_threshold_mb=8,
+                 multipart_chunk_mb=8, max_attempts=8, base_backoff=2.0,
+                 max_backoff=900.0, nice=10, keep_done_days=7, prune_interval=3600.0):
+        """Initialize the uploader and start its workers.
+
+        Args:
+            bucket (str): Destination bucket
+            outbox_path (str): Path to the outbox database
+            credentials (dict, optional): access_key/secret_key (defaults to the AWS credential chain)
+            region (str, optional): AWS region
+            prefix (str): Prefix prepended to every key
+            workers (int): Concurrent upload connections
+            max_bandwidth_kbps (float, optional): Total upload cap in kilobytes per second
+            multipart_threshold_mb (int): File size above which multipart upload is used
+            multipart_chunk_mb (int): Multipart part size
+            max_attempts (int): Attempts before an upload is marked failed
+            base_backoff (float): First retry delay in seconds, doubled per attempt
+            max_backoff (float): Maximum retry delay in seconds
+            nice (int): Niceness added to the worker threads
+            keep_done_days (float): Days completed uploads stay in the outbox
+            prune_interval (float): Seconds between prunes of completed uploads
+        """
+        self.bucket = bucket
+        self.prefix = prefix
+        self.num_workers = workers
+        self.max_attempts = max_attempts
+        self.base_backoff = base_backoff
+        self.max_backoff = max_backoff
+        self.nice = nice
+        self.keep_done_days = keep_done_days
+        self.prune_interval = prune_interval
+        self._next_prune = 0.0  # First prune when a worker starts
+        self.logger = logging.getLogger(__name__)
+
+        os.makedirs(os.path.dirname(os.path.abspath(outbox_path)), exist_ok=True)
+        self.outbox = UploadOutbox(outbox_path)
+        self.throttle = TokenBucket(max_bandwidth_kbps * 1024 if max_bandwidth_kbps else None)
+
+        self._wakeup = threading.Condition()
+        self._enqueued = 0  # Lets idle workers notice enqueues that raced their claim
+        self._stop = False
+        self._workers = []
+        self.client = None
+
+        if boto3 is None:
+            self.logger.warning("boto3 not available, uploads stay queued in the outbox")
+            return
+
+        credentials = credentials or {}
+        self.client = boto3.client(
+            "s3",
+            region_name=region,
+            aws_access_key_id=credentials.get("access_key"),
+            aws_secret_access_key=credentials.get("secret_key")
+        )
+        # Each worker is one connection; no extra transfer threads per file
+        self.transfer_config = TransferConfig(
+            multipart_threshold=multipart_threshold_mb * 1024 * 1024,
+            multipart_chunksize=multipart_chunk_mb * 1024 * 1024,
+            max_concurrency=1,
+            use_threads=False
+        )
+        self.start()
+
+    def start(self):
+        """Start the worker threads."""
+        self._stop = False
+        for i in range(self.num_workers):
+            worker = threading.Thread(target=self._worker_loop, name=f"s3-upload-{i}")
+            worker.daemon = True
+            worker.start()
+            self._workers.append(worker)
+        self.logger.info(f"S3 uploader started with {self.num_workers} workers "
+                         f"(bucket {self.bucket}), {self.outbox.counts()[UploadOutbox.PENDING]} queued")
+
+    def enqueue(self, file_path, remote_path=None, metadata=None):
+        """Queue a file for upload without waiting for it.
+
+        Args:
+            file_path (str): Local file to upload
+            remote_path (str, optional): Key below the prefix (defaults to the basename)
+            metadata (dict, optional): Metadata recorded with the upload
+
+        Returns:
+            int: Ticket for upload_status
+        """
+        key = self.prefix + (remote_path or os.path.basename(file_path))
+        ticket = self.outbox.enqueue(file_path, key, metadata)
+        with self._wakeup:
+            self._enqueued += 1
+            self._wakeup.notify()
+        return ticket
+
+    def _lower_priority(self):
+        """Lower the calling thread's CPU priority (per-thread on Linux)."""
+        if not self.nice or not hasattr(os, "setpriority"):
+            return
+        try:
+            thread_id = threading.get_native_id()
+            os.setpriority(os.PRIO_PROCESS, thread_id,
+                           os.getpriority(os.PRIO_PROCESS, thread_id) + self.nice)
+        except (OSError, AttributeError) as e:
+            self.logger.debug(f"Could not lower upload thread priority: {e}")
+
+    def _worker_loop(self):
+        """Claim and upload due items until stopped."""
+        self._lower_priority()
+        while not self._stop:
+            self._maybe_prune()
+            with self._wakeup:
+                enqueued = self._enqueued
+            item = self.outbox.claim()
+            if item is None:
+                # Sleep until new work arrives or the next retry is due
+                next_due = self.outbox.next_due()
+                with self._wakeup:
+                    if self._stop or self._enqueued != enqueued:
+                        continue
+                    timeout = 60.0
+                    if next_due is not None:
+                        timeout = min(timeout, max(0.1, next_due - time.time()))
+                    self._wakeup.wait(timeout)
+                continue
+            try:
+                self._upload(item)
+            except Exception as e:
+                # Never lose a worker (and leave the row claimed) to an unexpected error
+                self.logger.exception(f"Unexpected error uploading {item['file_path']}")
+                self._record_failure(item, e)
+
+    def _maybe_prune(self):
+        """Delete old completed uploads once per prune_interval (whichever worker gets there)."""
+        with self._wakeup:
+            now = time.time()
+            if now < self._next_prune:
+                return
+            self._next_prune = now + self.prune_interval
+        try:
+            removed = self.outbox.prune(self.keep_done_days)
+        except Exception as e:
+            self.logger.warning(f"Could not prune the upload outbox: {e}")
+            return
+        if removed:
+            self.logger.info(f"Pruned {removed} completed uploads from the outbox")
+
+    def _record_failure(self, item, error):
+        """Schedule a retry with backoff, or mark the upload failed after max_attempts."""
+        ticket = item["id"]
+        attempts = item["attempts"] + 1
+        if attempts >= self.max_attempts:
+            self.logger.error(f"Upload {ticket} of {item['file_path']} failed after {attempts} attempts: {error}")
+            self.outbox.fail(ticket, str(error))
+            return
+        # Exponential backoff with jitter so workers don't retry in lockstep
+        delay = min(self.max_backoff, self.base_backoff * 2 ** (attempts - 1))
+        delay *= random.uniform(0.5, 1.0)
+        self.logger.warning(f"Upload {ticket} failed ({error}), retrying in {delay:.0f}s")
+        self.outbox.retry(ticket, delay, str(error))
+
+    def _upload(self, item):
+        """Upload one outbox item and record the outcome."""
+        ticket = item["id"]
+        file_path = item["file_path"]
+        if not os.path.exists(file_path):
+            # Evicted by storage before it could be uploaded
+            self.logger.warning(f"Upload {ticket}: {file_path} no longer exists")
+            self.outbox.fail(ticket, "file missing")
+            return
+
+        try:
+            self.client.upload_file(
+                file_path, self.bucket, item["remote_key"],
+                Config=self.transfer_config,
+                Callback=self.throttle.consume
+            )
+        except UPLOAD_ERRORS as e:
+            self._record_failure(item, e)
+            return
+
+        url = f"s3://{self.bucket}/{item['remote_key']}"
+        self.outbox.complete(ticket, url)
+        self.logger.info(f"Uploaded {file_path} to {url}")
+
+    def upload_status(self, ticket):
+        """Return the state of an upload.
+
+        Args:
+            ticket (int): Ticket returned by enqueue
+
+        Returns:
+            dict: status, attempts, url and error, or None if unknown
+        """
+        item = self.outbox.get(ticket)
+        if item is None:
+            return None
+        return {key: item[key] for key in ("status", "attempts", "url", "error")}
+
+    def list_uploaded(self, limit=100):
+        """Return the URLs of the most recent completed uploads."""
+        return self.outbox.list_done(limit)
+
+    def get_stats(self):
+        """Return outbox counts by status."""
+        return self.outbox.counts()
+
+    def close(self, timeout=5.0):
+        """Stop the workers and close the outbox; queued uploads resume on the next start.
+
+        Args:
+            timeout (float): Maximum time to wait for each worker's current upload
+        """
+        self._stop = True
+        with self._wakeup:
+            self._wakeup.notify_all()
+        for worker in self._workers:
+            worker.join(timeout)
+        # Leave the database open if an upload is still finishing
+        if not any(worker.is_alive() for worker in self._workers):
+            self.outbox.close()
+        self._workers = []
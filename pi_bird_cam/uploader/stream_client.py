@@ -0,0 +1,437 @@
+"""Streaming upload client for sending photos to the Nano inference server."""
+import os
+import json
+import time
+import socket
+import struct
+import hashlib
+import logging
+import threading
+from collections import OrderedDict
+
+# Framing shared with nano_inference_server/ingest/stream_server.py: a 4-byte
+# big-endian header length, a JSON header, then header["size"] payload bytes
+_LENGTH = struct.Struct(">I")
+MAX_HEADER_SIZE = 64 * 1024
+
+
+def _send_message(sock, header, payload=b""):
+    """Send one framed message."""
+    header = dict(header, size=len(payload))
+    encoded = json.dumps(header, separators=(",", ":"), default=str).encode("utf-8")
+    sock.sendall(_LENGTH.pack(len(encoded)) + encoded + payload)
+
+
+def _read_exact(stream, size):
+    """Read exactly size bytes, raising EOFError if the peer disconnects."""
+    data = stream.read(size)
+    if data is None or len(data) < size:
+        raise EOFError("Connection closed")
+    return data
+
+
+def _recv_message(stream):
+    """Receive one framed message and return (header, payload)."""
+    (length,) = _LENGTH.unpack(_read_exact(stream, _LENGTH.size))
+    if length > MAX_HEADER_SIZE:
+        raise ConnectionError(f"Header too large: {length} bytes")
+    header = json.loads(_read_exact(stream, length).decode("utf-8"))
+    size = int(header.get("size", 0))
+    return header, _read_exact(stream, size) if size else b""
+
+
+class ServerNotReady(ConnectionError):
+    """The ingest server is up but its model is still warming up."""
+
+    def __init__(self, message, retry_after):
+        super().__init__(message)
+        self.retry_after = retry_after
+
+
+class StreamClient:
+    """Client for the Nano's streaming ingest protocol.
+
+    Photos are sent over one persistent TCP connection as length-prefixed
+    messages. Up to ``window`` photos may be awaiting the server's
+    verification at once, so the link stays busy while the Nano hashes and
+    stores earlier photos. Photos are identified by their SHA-256: retries of
+    a photo the server already stored are acknowledged without resending, and
+    a photo interrupted by a dropped connection resumes from the last byte
+    the server received. While the server's model is warming up, photos are
+    buffered and sent automatically once it reports ready.
+    """
+
+    def __init__(self, host, port=5001, window=4, access_key=None,
+                 chunk_size=256 * 1024, ack_timeout=30.0, connect_timeout=5.0,
+                 max_retries=3, max_pending=1000, client_name=None):
+        """Initialize the client. The connection is opened on first send.
+
+        Args:
+            host (str): Nano hostname or address
+            port (int): Ingest server port
+            window (int): Maximum photos sent but not yet acknowledged
+            access_key (str, optional): Key presented to the server
+            chunk_size (int): Payload bytes per data message
+            ack_timeout (float): Seconds to wait for a server reply before reconnecting
+            connect_timeout (float): Seconds to wait when connecting
+            max_retries (int): Reconnect attempts per send before giving up
+            max_pending (int): Maximum photos kept for resending after failures
+            client_name (str, optional): Name reported to the server (defaults to hostname)
+        """
+        self.host = host
+        self.port = port
+        self.window = window
+        self.access_key = access_key
+        self.chunk_size = chunk_size
+        self.ack_timeout = ack_timeout
+        self.connect_timeout = connect_timeout
+        self.max_retries = max_retries
+        self.max_pending = max_pending
+        self.client_name = client_name or socket.gethostname()
+        self.logger = logging.getLogger(__name__)
+
+        self._sock = None
+        self._reader_thread = None
+        self._condition = threading.Condition()
+        self._send_lock = threading.Lock()  # Serializes writes to the socket
+        self._pending = OrderedDict()  # seq -> transfer, until the server acknowledges it
+        self._next_seq = 0
+        self._closed = False
+        self._connected_once = False
+        self._not_ready_until = 0.0  # Monotonic time before which the server is not retried
+        self._retry_timer = None
+
+        # Metrics
+        self.sent = 0
+        self.duplicates = 0
+        self.resumed = 0
+        self.reconnects = 0
+
+    @staticmethod
+    def file_sha256(file_path):
+        """Return the SHA-256 hex digest of a file.
+
+        Args:
+            file_path (str): Path to the file
+
+        Returns:
+            str: Hex digest
+        """
+        digest = hashlib.sha256()
+        with open(file_path, "rb") as f:
+            for chunk in iter(lambda: f.read(1024 * 1024), b""):
+                digest.update(chunk)
+        return digest.hexdigest()
+
+    def send(self, file_path, name=None, metadata=None):
+        """Queue a photo and send it, waiting only while the window is full.
+
+        Args:
+            file_path (str): Path to the photo
+            name (str, optional): File name on the server (defaults to the basename)
+            metadata (dict, optional): JSON-serializable metadata sent with the photo
+
+        Returns:
+            str: SHA-256 of the photo, which identifies it on the server (also
+                when it was buffered because the server is still warming up)
+
+        Raises:
+            ConnectionError: If the server could not be reached; the photo stays
+                queued and is resent with the next successful send
+        """
+        transfer = {
+            "path": file_path,
+            "name": name or os.path.basename(file_path),
+            "size": os.path.getsize(file_path),
+            "sha256": self.file_sha256(file_path),
+            "metadata": metadata,
+            "sent": False,
+            "accept": None,
+            "attempts": 0
+        }
+
+        with self._condition:
+            seq = self._next_seq
+            self._next_seq += 1
+            self._pending[seq] = transfer
+            while len(self._pending) > self.max_pending:
+                _, dropped = self._pending.popitem(last=False)
+                self.logger.warning(f"Upload backlog full, dropping {dropped['name']}")
+
+        if time.monotonic() < self._not_ready_until:
+            # Buffered; the retry timer sends it once the server is ready
+            return transfer["sha256"]
+
+        for attempt in range(self.max_retries + 1):
+            if self._closed:
+                break
+            try:
+                self._pump()
+                return transfer["sha256"]
+            except ServerNotReady as e:
+                self.logger.info(f"Ingest server warming up, buffering {len(self._pending)} photos")
+                self._schedule_retry(e.retry_after)
+                return transfer["sha256"]
+            except (OSError, EOFError) as e:
+                self.logger.warning(f"Stream upload interrupted: {e}")
+                self._disconnect()
+                if attempt < self.max_retries:
+                    time.sleep(min(2 ** attempt, 30))
+
+        raise ConnectionError(f"Could not reach ingest server {self.host}:{self.port}")
+
+    def _pump(self):
+        """Connect if needed and send every pending photo not yet sent."""
+        with self._send_lock:
+            if self._sock is None:
+                self._connect()
+
+            for seq in list(self._pending):
+                with self._condition:
+                    transfer = self._pending.get(seq)
+                    if transfer is None or transfer["sent"]:
+                        continue
+                    # Wait for a free slot in the window
+                    deadline = time.monotonic() + self.ack_timeout
+                    while self._in_flight() >= self.window:
+                        remaining = deadline - time.monotonic()
+                        if self._sock is None:
+                            raise ConnectionError("Connection lost")
+                        if remaining <= 0:
+                            raise TimeoutError("Timed out waiting for acknowledgements")
+                        self._condition.wait(remaining)
+                    sock = self._sock
+                    if sock is None:
+                        raise ConnectionError("Connection lost")
+                self._transmit(sock, seq, transfer)
+
+    def _schedule_retry(self, delay, not_ready=True):
+        """Send the buffered photos after delay seconds.
+
+        Args:
+            delay (float): Seconds to wait
+            not_ready (bool): The server asked us to wait; sends until then only buffer
+        """
+        with self._condition:
+            if not_ready:
+                self._not_ready_until = time.monotonic() + delay
+            if self._retry_timer is not None or self._closed:
+                return
+            self._retry_timer = threading.Timer(delay, self._retry_pending)
+            self._retry_timer.daemon = True
+            self._retry_timer.start()
+
+    def _retry_pending(self):
+        """Timer callback: try the buffered photos again."""
+        with self._condition:
+            self._retry_timer = None
+            if self._closed or not self._pending:
+                return
+        try:
+            self._pump()
+        except ServerNotReady as e:
+            self._schedule_retry(e.retry_after)
+        except (OSError, EOFError) as e:
+            self.logger.warning(f"Sending buffered photos failed: {e}")
+            self._disconnect()
+            self._schedule_retry(min(self.ack_timeout, 30.0), not_ready=False)
+
+    def _in_flight(self):
+        """Number of photos sent but not acknowledged. Caller holds the condition."""
+        return sum(1 for transfer in self._pending.values() if transfer["sent"])
+
+    def _connect(self):
+        """Open the connection, say hello and start the reader thread."""
+        sock = socket.create_connection((self.host, self.port), timeout=self.connect_timeout)
+        sock.setsockopt(socket.IPPROTO_TCP, socket.TCP_NODELAY, 1)
+        sock.settimeout(self.ack_timeout)
+        stream = sock.makefile("rb")
+
+        _send_message(sock, {"type": "hello", "client": self.client_name,
+                             "access_key": self.access_key})
+        header, _ = _recv_message(stream)
+        if header.get("type") == "not_ready":
+            sock.close()
+            raise ServerNotReady(header.get("message", "Server not ready"),
+                                 float(header.get("retry_after", 5.0)))
+        if header.get("type") != "welcome":
+            sock.close()
+            raise ConnectionError(f"Ingest server refused connection: {header.get('message')}")
+
+        # The server may allow a smaller window than configured
+        self.window = max(1, min(self.window, int(header.get("window", self.window))))
+        # The reader blocks until replies arrive; timeouts are enforced by the waiters
+        sock.settimeout(None)
+
+        with self._condition:
+            if self._connected_once:
+                self.reconnects += 1
+            self._connected_once = True
+            self._sock = sock
+        self._reader_thread = threading.Thread(target=self._reader_loop, args=(sock, stream),
+                                               name="stream-upload-reader")
+        self._reader_thread.daemon = True
+        self._reader_thread.start()
+        self.logger.info(f"Connected to ingest server {self.host}:{self.port}")
+
+    def _disconnect(self):
+        """Close the connection and mark all pending photos for resending."""
+        with self._condition:
+            sock, self._sock = self._sock, None
+            for transfer in self._pending.values():
+                transfer["sent"] = False
+                transfer["accept"] = None
+            self._condition.notify_all()
+        if sock is not None:
+            try:
+                sock.shutdown(socket.SHUT_RDWR)
+            except OSError:
+                pass
+            sock.close()
+
+    def _transmit(self, sock, seq, transfer):
+        """Offer one photo and send it from the offset the server asks for."""
+        _send_message(sock, {
+            "type": "offer", "seq": seq, "sha256": transfer["sha256"],
+            "name": transfer["name"], "size_bytes": transfer["size"],
+            "metadata": transfer["metadata"]
+        })
+
+        with self._condition:
+            deadline = time.monotonic() + self.ack_timeout
+            while transfer["accept"] is None:
+                remaining = deadline - time.monotonic()
+                if self._sock is None:
+                    raise ConnectionError("Connection lost")
+                if remaining <= 0:
+                    raise TimeoutError(f"No reply to offer of {transfer['name']}")
+                self._condition.wait(remaining)
+            accept, transfer["accept"] = transfer["accept"], None
+
+        status = accept.get("status")
+        if status == "duplicate":
+            # Already stored by an earlier attempt
+            with self._condition:
+                self._pending.pop(seq, None)
+                self.duplicates += 1
+                self._condition.notify_all()
+            return
+        if status == "too_large":
+            # Over the server's size limit; resending would be refused again
+            self.logger.error(f"Server refused {transfer['name']}: too large")
+            with self._condition:
+                self._pending.pop(seq, None)
+                self._condition.notify_all()
+            return
+        if status != "send":
+            # Still held by a stale connection on the server; retried on the next pump
+            self.logger.debug(f"Server busy with {transfer['name']}, retrying later")
+            return
+
+        offset = int(accept.get("offset", 0))
+        if offset:
+            self.resumed += 1
+            self.logger.info(f"Resuming upload of {transfer['name']} at byte {offset}")
+
+        with open(transfer["path"], "rb") as f:
+            f.seek(offset)
+            while True:
+                chunk = f.read(self.chunk_size)
+                if not chunk:
+                    break
+                _send_message(sock, {"type": "data", "seq": seq, "offset": offset}, chunk)
+                offset += len(chunk)
+        _send_message(sock, {"type": "end", "seq": seq})
+
+        with self._condition:
+            transfer["sent"] = True
+            transfer["attempts"] += 1
+
+    def _reader_loop(self, sock, stream):
+        """Handle server replies until the connection closes."""
+        try:
+            while True:
+                header, _ = _recv_message(stream)
+                kind = header.get("type")
+                with self._condition:
+                    transfer = self._pending.get(header.get("seq"))
+                    if transfer is None:
+                        continue
+                    if kind == "accept":
+                        transfer["accept"] = header
+                    elif kind == "done":
+                        if header.get("status") == "corrupt" and transfer["attempts"] < 3:
+                            # The server discarded it; resend from the start
+                            self.logger.warning(f"Server rejected {transfer['name']}, resending")
+                            transfer["sent"] = False
+                            transfer["sha256"] = self.file_sha256(transfer["path"])
+                            transfer["size"] = os.path.getsize(transfer["path"])
+                        else:
+                            if header.get("status") == "corrupt":
+                                self.logger.error(f"Giving up on {transfer['name']} after repeated rejections")
+                            else:
+                                self.sent += 1
+                            self._pending.pop(header["seq"], None)
+                    self._condition.notify_all()
+        except (OSError, EOFError, ValueError) as e:
+            with self._condition:
+                if self._sock is sock:
+                    self.logger.warning(f"Ingest connection lost: {e}")
+                    self._sock = None
+                    for transfer in self._pending.values():
+                        transfer["sent"] = False
+                        transfer["accept"] = None
+                self._condition.notify_all()
+
+    def flush(self, timeout=10.0):
+        """Wait for all sent photos to be acknowledged.
+
+        Args:
+            timeout (float): Maximum time to wait in seconds
+
+        Returns:
+            bool: True if nothing is pending
+        """
+        deadline = time.monotonic() + timeout
+        with self._condition:
+            while self._pending and self._sock is not None:
+                remaining = deadline - time.monotonic()
+                if remaining <= 0:
+                    break
+                self._condition.wait(remaining)
+            return not self._pending
+
+    def get_stats(self):
+        """Return upload counters.
+
+        Returns:
+            dict: Sent, duplicate, resumed and pending counts
+        """
+        with self._condition:
+            return {
+                "connected": self._sock is not None,
+                "window": self.window,
+                "pending": len(self._pending),
+                "in_flight": self._in_flight(),
+                "sent": self.sent,
+                "duplicates": self.duplicates,
+                "resumed": self.resumed,
+                "reconnects": self.reconnects
+            }
+
+    def close(self, timeout=10.0):
+        """Wait briefly for acknowledgements, then close the connection.
+
+        Args:
+            timeout (float): Maximum time to wait for pending photos
+        """
+        self.flush(timeout)
+        self._closed = True
+        with self._condition:
+            if self._retry_timer is not None:
+                self._retry_timer.cancel()
+                self._retry_timer = None
+        with self._condition:
+            if self._pending:
+                self.logger.warning(f"{len(self._pending)} photos not acknowledged by the ingest server")
+        self._disconnect()
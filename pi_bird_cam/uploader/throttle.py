@@ -0,0 +1,46 @@
+"""Bandwidth throttling module for uploads."""
+import time
+import threading
+
+
+class TokenBucket:
+    """Token bucket limiting the byte rate shared by all upload workers.
+
+    Callers take tokens for the bytes they are about to send (or just sent)
+    and sleep while the bucket is empty, so the long-run rate never exceeds
+    ``rate`` bytes per second, with bursts of up to ``burst`` bytes.
+    """
+
+    def __init__(self, rate, burst=None):
+        """Initialize the bucket.
+
+        Args:
+            rate (float): Bytes per second, or None/0 for no limit
+            burst (float, optional): Bucket capacity in bytes (defaults to one second of rate)
+        """
+        self.rate = rate
+        self.capacity = burst or rate
+        self._tokens = self.capacity
+        self._last = time.monotonic()
+        self._lock = threading.Lock()
+
+    def consume(self, amount):
+        """Take tokens for amount bytes, sleeping until they are available.
+
+        Args:
+            amount (int): Number of bytes
+        """
+        if not self.rate or amount <= 0:
+            return
+
+        with self._lock:
+            now = time.monotonic()
+            self._tokens = min(self.capacity, self._tokens + (now - self._last) * self.rate)
+            self._last = now
+            # Go into debt rather than splitting large chunks; the next
+            # caller waits for the debt to be repaid
+            self._tokens -= amount
+            wait = -self._tokens / self.rate if self._tokens < 0 else 0.0
+
+        if wait > 0:
+            time.sleep(wait)
@@ -1,35 +1,92 @@
 """Photo uploader module for uploading captured images to cloud storage."""
+import logging
+
+from .stream_client import StreamClient
+from .s3_uploader import S3Uploader
 
 
 class Uploader:
-    """Class to handle photo upload operations."""
+    """Class to handle photo upload operations.
+
+    The "s3" service queues photos in an on-disk outbox and uploads them in
+    the background (see S3Uploader). The "stream" service sends photos to
+    the Nano inference server over a persistent connection (see StreamClient).
+    """
 
-    def __init__(self, service_type="s3", credentials=None):
+    def __init__(self, service_type="s3", credentials=None, config=None):
         """Initialize uploader with service type and credentials.
         
         Args:
-            service_type (str): Type of storage service (s3, dropbox, etc.)
+            service_type (str): Type of storage service (stream, s3, dropbox, etc.)
             credentials (dict): Credentials for the storage service
+            config (dict, optional): Uploader settings section (service options)
         """
         self.service_type = service_type
         self.credentials = credentials
+        self.config = config or {}
+        self.client = None
+        self.s3 = None
+        self.logger = logging.getLogger(__name__)
         self.setup()
         
     def setup(self):
         """Setup uploader with appropriate credentials."""
-        pass
+        if self.service_type == "s3":
+            options = self.config.get("s3", {})
+            self.s3 = S3Uploader(
+                bucket=self.config.get("bucket", "bird-photos"),
+                outbox_path=options.get("outbox_path", "data/upload_outbox.db"),
+                credentials=self.credentials,
+                region=options.get("region"),
+                prefix=options.get("prefix", ""),
+                workers=options.get("workers", 2),
+                max_bandwidth_kbps=options.get("max_bandwidth_kbps"),
+                multipart_threshold_mb=options.get("multipart_threshold_mb", 8),
+                max_attempts=options.get("max_attempts", 8),
+                nice=options.get("nice", 10),
+                keep_done_days=options.get("keep_done_days", 7)
+            )
+        elif self.service_type == "stream":
+            options = self.config.get("stream", {})
+            self.client = StreamClient(
+                host=options.get("host", "jetson.local"),
+                port=options.get("port", 5001),
+                window=options.get("window", 4),
+                access_key=(self.credentials or {}).get("access_key", options.get("access_key")),
+                chunk_size=options.get("chunk_size", 256 * 1024)
+            )
         
-    def upload_photo(self, file_path, remote_path=None):
+    def upload_photo(self, file_path, remote_path=None, metadata=None):
         """Upload a photo to the cloud storage.
         
         Args:
             file_path (str): Path to the file to upload
             remote_path (str, optional): Custom path in the cloud storage
+            metadata (dict, optional): Photo metadata sent along with it
             
         Returns:
-            str: URL or identifier for the uploaded file
+            str: URL or identifier for the uploaded file; for s3 this is the
+                outbox ticket, returned before the upload starts (see upload_status)
         """
-        pass
+        if self.service_type == "s3":
+            return str(self.s3.enqueue(file_path, remote_path, metadata))
+        if self.service_type == "stream":
+            sha256 = self.client.send(file_path, name=remote_path, metadata=metadata)
+            return f"stream://{self.client.host}:{self.client.port}/{sha256}"
+        return None
+        
+    def upload_status(self, ticket):
+        """Get the state of a queued upload.
+        
+        Args:
+            ticket (str): Ticket returned by upload_photo
+            
+        Returns:
+            dict: status ("pending", "uploading", "done", "failed"), attempts, url and error
+        """
+        if self.s3:
+            return self.s3.upload_status(int(ticket))
+        return None
         
     def list_uploaded_photos(self):
         """List all uploaded photos.
@@ -37,4 +94,13 @@ class Uploader:
         Returns:
             list: List of uploaded photo identifiers
         """
-        pass 
\ No newline at end of file
+        if self.s3:
+            return self.s3.list_uploaded()
+        return []
+
+    def close(self):
+        """Flush pending uploads and close connections."""
+        if self.client:
+            self.client.close()
+        if self.s3:
+            self.s3.close()
@@ -0,0 +1,473 @@
+#!/usr/bin/env python3
+"""
+Benchmarks for the inference and storage hot paths.
+
+Suites (all run by default, pick some with --suites):
+  preprocess  ModelHandler.preprocess_image per layout and input size
+  model       detect_batch() of each backend at batch sizes 1/4/8
+  storage     ResultStorage.save_result / get_recent_results at 10k-1M rows
+  photos      PhotoStorage startup and save_photo with 1k-100k existing files
+  detect      /detect throughput of a running jetson_server.py under 1/4/8
+              concurrent clients
+
+Images are replayed from test_images/ in sorted order and synthetic database
+rows and files are generated from a fixed seed, so two runs on the same
+machine measure the same work. Results are written as JSON; pass an earlier
+file to --compare to print the change of every latency and throughput.
+
+Suites whose dependencies are missing (cv2 on the Pi, a model backend, a
+running server) are recorded as skipped instead of failing the run.
+
+Usage:
+  python3 scripts/benchmark.py [--suites preprocess model storage photos detect]
+      [--images test_images] [--output build/benchmark.json] [--quick]
+      [--backends onnx:cpu:fp32 onnx:cuda:fp16] [--url http://localhost:5000]
+      [--compare build/benchmark_previous.json]
+"""
+
+import argparse
+import glob
+import itertools
+import json
+import logging
+import os
+import platform
+import random
+import shutil
+import subprocess
+import sys
+import tempfile
+import time
+from concurrent.futures import ThreadPoolExecutor
+
+REPO_ROOT = os.path.abspath(os.path.join(os.path.dirname(__file__), '..'))
+sys.path.insert(0, REPO_ROOT)
+
+from bird_classes import BIRD_CLASSES
+
+SUITES = ("preprocess", "model", "storage", "photos", "detect")
+IMAGE_PATTERNS = ("*.jpg", "*.jpeg", "*.png")
+SEED = 1234
+
+
+def list_images(directory):
+    """Return the image files in a directory, sorted"""
+    paths = []
+    for pattern in IMAGE_PATTERNS:
+        paths.extend(glob.glob(os.path.join(directory, pattern)))
+    return sorted(paths)
+
+
+def percentile(ordered, fraction):
+    """Nearest-rank percentile of an already sorted list"""
+    index = min(len(ordered) - 1, max(0, int(round(fraction * len(ordered) + 0.5)) - 1))
+    return ordered[index]
+
+
+def summarize(samples, items_per_call=1):
+    """Latency summary in milliseconds of per-call durations in seconds"""
+    ordered = sorted(samples)
+    total = sum(ordered)
+    return {
+        "runs": len(ordered),
+        "mean_ms": round(1000.0 * total / len(ordered), 3),
+        "p50_ms": round(1000.0 * percentile(ordered, 0.50), 3),
+        "p95_ms": round(1000.0 * percentile(ordered, 0.95), 3),
+        "min_ms": round(1000.0 * ordered[0], 3),
+        "items_per_s": round(items_per_call * len(ordered) / total, 2) if total > 0 else None
+    }
+
+
+def time_calls(fn, runs, warmup=2, items_per_call=1):
+    """Call fn() warmup + runs times and summarize the timed runs"""
+    for _ in range(warmup):
+        fn()
+    samples = []
+    for _ in range(runs):
+        start = time.perf_counter()
+        fn()
+        samples.append(time.perf_counter() - start)
+    return summarize(samples, items_per_call)
+
+
+def environment():
+    """Machine and library versions, so results are only compared like for like"""
+    env = {
+        "timestamp": time.strftime("%Y-%m-%dT%H:%M:%S"),
+        "platform": platform.platform(),
+        "machine": platform.machine(),
+        "python": platform.python_version(),
+        "cpu_count": os.cpu_count()
+    }
+    try:
+        env["git_commit"] = subprocess.check_output(
+            ["git", "rev-parse", "--short", "HEAD"], cwd=REPO_ROOT,
+            stderr=subprocess.DEVNULL).decode().strip()
+    except (OSError, subprocess.CalledProcessError):
+        env["git_commit"] = None
+    for module in ("numpy", "cv2", "onnxruntime"):
+        try:
+            env[module] = __import__(module).__version__
+        except Exception:
+            env[module] = None
+    try:
+        import onnxruntime as ort
+        env["onnxruntime_providers"] = ort.get_available_providers()
+    except Exception:
+        pass
+    return env
+
+
+def load_frames(paths):
+    """Decode the replayed images once, outside the timed loops"""
+    import cv2
+    frames = [cv2.imread(path) for path in paths]
+    return [frame for frame in frames if frame is not None]
+
+
+def bench_preprocess(args, paths):
+    """preprocess_image from a decoded frame and from a file, per layout and size"""
+    from nano_inference_server.inference.model import ModelHandler
+
+    frames = load_frames(paths)
+    handler = ModelHandler(model_path="", development_mode=True)
+    frame_cycle = itertools.cycle(frames)
+    path_cycle = itertools.cycle(paths)
+
+    results = {}
+    for layout in ("nhwc", "nchw"):
+        for size in args.input_sizes:
+            handler.input_layout = layout
+            handler.input_shape = (size, size)
+            results[f"{layout}_{size}"] = {
+                "frame": time_calls(lambda: handler.preprocess_image(next(frame_cycle)), args.runs),
+                "file": time_calls(lambda: handler.preprocess_image(next(path_cycle)), args.runs)
+            }
+    return results
+
+
+def bench_model(args, paths):
+    """detect_batch() of each backend ("type:device:precision") at each batch size"""
+    from nano_inference_server.inference.model import ModelHandler
+
+    frames = load_frames(paths)
+    results = {}
+    for spec in args.backends:
+        model_type, device, precision = (spec.split(":") + ["cpu", "fp32"])[:3]
+        model_path = args.keras_model if model_type == "keras" else args.model
+        try:
+            start = time.perf_counter()
+            handler = ModelHandler(model_path=model_path, model_type=model_type,
+                                   device=device, precision=precision)
+            if handler.model is None:
+                raise RuntimeError(f"{model_type} model could not be loaded from {model_path}")
+            load_s = time.perf_counter() - start
+            warmup_s = handler.warmup(batch_sizes=tuple(args.batch_sizes))
+        except Exception as e:
+            results[spec] = {"skipped": str(e)}
+            continue
+
+        backend = {"model_path": model_path, "load_s": round(load_s, 3),
+                   "warmup_s": round(warmup_s, 3), "batches": {}}
+        frame_cycle = itertools.cycle(frames)
+        for batch_size in args.batch_sizes:
+            batch = lambda: handler.detect_batch([next(frame_cycle) for _ in range(batch_size)])
+            backend["batches"][str(batch_size)] = time_calls(batch, args.runs,
+                                                              items_per_call=batch_size)
+        results[spec] = backend
+    return results
+
+
+def seed_results(storage, rows):
+    """Bulk-insert synthetic detection rows, oldest first, one per ~30 seconds"""
+    rng = random.Random(SEED)
+    start = time.time() - 30.0 * rows
+    chunk = 50000
+    for offset in range(0, rows, chunk):
+        batch = []
+        for index in range(offset, min(rows, offset + chunk)):
+            timestamp = time.strftime("%Y-%m-%dT%H:%M:%S", time.localtime(start + 30.0 * index))
+            bird = rng.random() < 0.6
+            species = rng.choice(BIRD_CLASSES) if bird and rng.random() < 0.8 else ""
+            batch.append((
+                f"{timestamp}.{index % 1000000:06d}", f"/data/{index}.jpg", None,
+                f"/data/{index}.json", bird, int(bird), bool(species), species,
+                rng.random() if bird else 0.0, 0.05, "directory_monitor", 60000
+            ))
+        with storage.pool.writer() as conn:
+            cursor = conn.cursor()
+            first_id = cursor.execute("SELECT COALESCE(MAX(id), 0) FROM detections").fetchone()[0] + 1
+            cursor.executemany(storage._INSERT_DETECTION, batch)
+            if storage.fts_enabled:
+                cursor.executemany(storage._INSERT_FTS, [
+                    (first_id + i, row[7], "bird" if row[4] else "", "", row[10])
+                    for i, row in enumerate(batch)
+                ])
+    with storage.pool.writer() as conn:
+        storage._rebuild_counters(conn.cursor())
+
+
+def bench_storage(args, paths):
+    """save_result and the gallery queries against a database of each size"""
+    from nano_inference_server.storage.result_storage import ResultStorage
+
+    detections = [{"class_id": 0, "class_name": "bird", "confidence": 0.9,
+                   "bbox": [10, 20, 100, 80], "species": BIRD_CLASSES[0]}]
+    results = {}
+    for rows in args.result_rows:
+        base_dir = tempfile.mkdtemp(prefix="bench_results_")
+        storage = ResultStorage(base_dir=base_dir, max_results=rows * 10,
+                                retention_interval=3600.0)
+        try:
+            start = time.perf_counter()
+            seed_results(storage, rows)
+            seed_s = time.perf_counter() - start
+
+            # Cursor into the middle of the history, as a deep gallery page
+            with storage.pool.reader() as conn:
+                middle = conn.execute("SELECT timestamp, id FROM detections WHERE id = ?",
+                                      (rows // 2,)).fetchone()
+            image_cycle = itertools.cycle(paths)
+            results[str(rows)] = {
+                "seed_s": round(seed_s, 2),
+                "save_result": time_calls(lambda: storage.save_result(
+                    image_path=next(image_cycle), detections=detections,
+                    metadata={"source": "benchmark"}, processing_time=0.05), args.runs),
+                "recent_first_page": time_calls(
+                    lambda: storage.get_recent_results(limit=50), args.runs),
+                "recent_bird_only": time_calls(
+                    lambda: storage.get_recent_results(limit=50, bird_only=True), args.runs),
+                "recent_cursor_deep": time_calls(
+                    lambda: storage.get_recent_results(limit=50, before=tuple(middle)), args.runs),
+                "recent_offset_deep": time_calls(
+                    lambda: storage.get_recent_results(limit=50, offset=rows // 2),
+                    max(1, args.runs // 10), warmup=1),
+                "count_results": time_calls(lambda: storage.count_results(), args.runs)
+            }
+        finally:
+            storage.close()
+            shutil.rmtree(base_dir, ignore_errors=True)
+    return results
+
+
+def seed_photos(base_dir, count):
+    """Create count empty photos in date directories, one per minute up to now"""
+    start = time.time() - 60.0 * count
+    date_dir = None
+    for index in range(count):
+        capture_time = start + 60.0 * index
+        path_dir = os.path.join(base_dir, time.strftime("%Y%m%d", time.localtime(capture_time)))
+        if path_dir != date_dir:
+            date_dir = path_dir
+            os.makedirs(date_dir, exist_ok=True)
+        path = os.path.join(date_dir, f"seed_{index:07d}.jpg")
+        with open(path, "wb"):
+            pass
+        os.utime(path, (capture_time, capture_time))
+
+
+def bench_photos(args, paths):
+    """PhotoStorage startup (rescan and metadata) and save_photo at the photo limit"""
+    from pi_bird_cam.storage.photo_storage import PhotoStorage
+
+    with open(paths[0], "rb") as f:
+        photo_data = f.read()
+
+    results = {}
+    for count in args.photo_counts:
+        base_dir = tempfile.mkdtemp(prefix="bench_photos_")
+        try:
+            start = time.perf_counter()
+            seed_photos(base_dir, count)
+            seed_s = time.perf_counter() - start
+
+            # No metadata yet: the index is built from a directory rescan
+            start = time.perf_counter()
+            storage = PhotoStorage(base_dir=base_dir, max_photos=count)
+            rescan_s = time.perf_counter() - start
+            storage.save_metadata()
+            storage.close()
+
+            start = time.perf_counter()
+            storage = PhotoStorage(base_dir=base_dir, max_photos=count)
+            metadata_s = time.perf_counter() - start
+
+            # At the limit every save also evicts the oldest photo
+            names = (f"bench_{index:07d}.jpg" for index in itertools.count())
+            results[str(count)] = {
+                "seed_s": round(seed_s, 2),
+                "startup_rescan_s": round(rescan_s, 3),
+                "startup_metadata_s": round(metadata_s, 3),
+                "save_photo": time_calls(
+                    lambda: storage.save_photo(photo_data, filename=next(names),
+                                               metadata={"trigger": "benchmark"}), args.runs)
+            }
+            storage.close()
+        finally:
+            shutil.rmtree(base_dir, ignore_errors=True)
+    return results
+
+
+def bench_detect(args, paths):
+    """Requests per second and latency of POST /detect under concurrent clients"""
+    import requests
+
+    health = requests.get(f"{args.url}/health", timeout=5)
+    if health.status_code != 200:
+        return {"skipped": f"server not ready: {health.status_code} {health.text[:200]}"}
+
+    images = []
+    for path in paths:
+        with open(path, "rb") as f:
+            images.append((os.path.basename(path), f.read()))
+
+    def post(index):
+        name, data = images[index % len(images)]
+        start = time.perf_counter()
+        response = requests.post(f"{args.url}/detect", files={"image": (name, data, "image/jpeg")},
+                                 timeout=60)
+        return time.perf_counter() - start, response.status_code
+
+    results = {"url": args.url, "clients": {}}
+    for clients in args.concurrency:
+        # Warm the connection and the model once per level
+        post(0)
+        start = time.perf_counter()
+        with ThreadPoolExecutor(max_workers=clients) as pool:
+            outcomes = list(pool.map(post, range(args.detect_requests)))
+        wall_s = time.perf_counter() - start
+
+        statuses = {}
+        for _, status in outcomes:
+            statuses[str(status)] = statuses.get(str(status), 0) + 1
+        ok = [latency for latency, status in outcomes if status == 200]
+        level = {"requests": len(outcomes), "wall_s": round(wall_s, 3),
+                 "requests_per_s": round(len(ok) / wall_s, 2), "status_codes": statuses}
+        if ok:
+            level["latency"] = summarize(ok)
+        results["clients"][str(clients)] = level
+    return results
+
+
+def flatten(results, prefix=""):
+    """Flatten nested results into {"suite.case.metric": number}"""
+    flat = {}
+    for key, value in results.items():
+        name = f"{prefix}.{key}" if prefix else key
+        if isinstance(value, dict):
+            flat.update(flatten(value, name))
+        elif isinstance(value, (int, float)) and not isinstance(value, bool):
+            flat[name] = value
+    return flat
+
+
+def compare(previous, current):
+    """Print the change of every latency and throughput between two result files"""
+    old = flatten(previous.get("results", {}))
+    new = flatten(current.get("results", {}))
+    print(f"\nCompared with {previous.get('environment', {}).get('git_commit')} "
+          f"({previous.get('environment', {}).get('timestamp')})")
+    print(f"{'Metric':<70} {'Before':>12} {'After':>12} {'Change':>9}")
+    for name in sorted(set(old) & set(new)):
+        if not name.endswith(("_ms", "_s", "_per_s")) or not old[name]:
+            continue
+        change = 100.0 * (new[name] - old[name]) / old[name]
+        # Positive is worse for latencies, better for throughput
+        marker = ""
+        if abs(change) >= 10.0:
+            worse = change < 0 if name.endswith("_per_s") else change > 0
+            marker = " worse" if worse else " better"
+        print(f"{name:<70} {old[name]:>12.3f} {new[name]:>12.3f} {change:>+8.1f}%{marker}")
+
+
+def main():
+    parser = argparse.ArgumentParser(description='Benchmark the inference and storage hot paths')
+    parser.add_argument('--suites', nargs='+', choices=SUITES, default=list(SUITES),
+                        help='Suites to run (default: all)')
+    parser.add_argument('--images', default='test_images',
+                        help='Directory of images to replay (default: test_images)')
+    parser.add_argument('--output', default='build/benchmark.json',
+                        help='JSON results file (default: build/benchmark.json)')
+    parser.add_argument('--compare', default=None,
+                        help='Earlier results file to compare against')
+    parser.add_argument('--quick', action='store_true',
+                        help='Smallest sizes and fewer runs, for a smoke test')
+    parser.add_argument('--runs', type=int, default=50,
+                        help='Timed calls per case (default: 50)')
+    parser.add_argument('--model', default='common/models/bird_model.onnx',
+                        help='Model for the onnx/tensorrt backends')
+    parser.add_argument('--keras-model', default='common/models/bird_mobilenet_v5data.keras',
+                        help='Model for the keras backend')
+    parser.add_argument('--backends', nargs='+', default=['onnx:cpu:fp32'],
+                        help='Backends as type:device:precision, e.g. onnx:cuda:fp16 '
+                             'tensorrt:cuda:int8 keras:cpu:fp32 (default: onnx:cpu:fp32)')
+    parser.add_argument('--batch-sizes', nargs='+', type=int, default=[1, 4, 8],
+                        help='Batch sizes for the model suite (default: 1 4 8)')
+    parser.add_argument('--input-sizes', nargs='+', type=int, default=[224, 640],
+                        help='Square input sizes for the preprocess suite (default: 224 640)')
+    parser.add_argument('--result-rows', nargs='+', type=int, default=[10000, 100000, 1000000],
+                        help='Database sizes for the storage suite')
+    parser.add_argument('--photo-counts', nargs='+', type=int, default=[1000, 10000, 100000],
+                        help='Existing photo counts for the photos suite')
+    parser.add_argument('--url', default='http://localhost:5000',
+                        help='jetson_server.py base URL for the detect suite')
+    parser.add_argument('--concurrency', nargs='+', type=int, default=[1, 4, 8],
+                        help='Concurrent clients for the detect suite (default: 1 4 8)')
+    parser.add_argument('--detect-requests', type=int, default=200,
+                        help='Requests per concurrency level (default: 200)')
+    args = parser.parse_args()
+
+    if args.quick:
+        args.runs = min(args.runs, 10)
+        args.result_rows = args.result_rows[:1]
+        args.photo_counts = args.photo_counts[:1]
+        args.detect_requests = min(args.detect_requests, 40)
+
+    paths = list_images(args.images)
+    if not paths:
+        print(f"No images found in {args.images}")
+        return 1
+
+    # Per-image INFO logs would dominate the timings
+    logging.disable(logging.INFO)
+
+    suites = {"preprocess": bench_preprocess, "model": bench_model, "storage": bench_storage,
+              "photos": bench_photos, "detect": bench_detect}
+    results = {}
+    for name in args.suites:
+        print(f"Running {name} benchmark...")
+        start = time.perf_counter()
+        try:
+            results[name] = suites[name](args, paths)
+        except Exception as e:
+            results[name] = {"skipped": f"{type(e).__name__}: {e}"}
+        print(f"  {name} done in {time.perf_counter() - start:.1f} s")
+
+    report = {
+        "environment": environment(),
+        "config": {"images": [os.path.basename(path) for path in paths],
+                   "runs": args.runs, "backends": args.backends,
+                   "batch_sizes": args.batch_sizes, "result_rows": args.result_rows,
+                   "photo_counts": args.photo_counts, "concurrency": args.concurrency},
+        "results": results
+    }
+
+    output_dir = os.path.dirname(args.output)
+    if output_dir:
+        os.makedirs(output_dir, exist_ok=True)
+    with open(args.output, 'w') as f:
+        json.dump(report, f, indent=2, sort_keys=True)
+    print(f"Results written to {args.output}")
+
+    for name, result in results.items():
+        if "skipped" in result:
+            print(f"  {name} skipped: {result['skipped']}")
+
+    if args.compare:
+        with open(args.compare, 'r') as f:
+            compare(json.load(f), report)
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,294 @@
+#!/usr/bin/env python3
+"""
+Build FP16 and INT8 variants of the ONNX bird classifier and report how much
+accuracy each variant loses per species.
+
+The FP16 variant keeps float32 inputs/outputs and is meant for the Nano's GPU
+(ModelHandler precision "fp16"). The INT8 variant is statically quantized
+(QDQ, symmetric int8) with activation ranges calibrated on the test images; it
+runs on the Pi's CPU (InferenceEngine precision "int8") and on TensorRT.
+Variants are written next to the model as <model>.fp16.onnx / <model>.int8.onnx,
+where both devices pick them up.
+
+Convert the Keras/SavedModel first (notebooks/tf2onnx_implementation.ipynb).
+
+Usage:
+  python3 scripts/build_quantized_models.py [--model common/models/bird_model.onnx]
+      [--calibration-dir test_images] [--eval-dir test_images]
+      [--precisions fp16 int8] [--report build/quantization_report.json]
+"""
+
+import argparse
+import glob
+import json
+import os
+import re
+import sys
+import time
+
+import cv2
+import numpy as np
+import onnx
+import onnxruntime as ort
+
+from bird_classes import BIRD_CLASSES
+
+PRECISION_SUFFIXES = {"fp16": ".fp16.onnx", "int8": ".int8.onnx"}
+IMAGE_PATTERNS = ("*.jpg", "*.jpeg", "*.png")
+
+
+def list_images(directory):
+    """Return the image files in a directory, sorted"""
+    paths = []
+    for pattern in IMAGE_PATTERNS:
+        paths.extend(glob.glob(os.path.join(directory, pattern)))
+    return sorted(paths)
+
+
+def load_class_names(model_path):
+    """Use a labels file next to the model (as ModelHandler does), else bird_classes.py"""
+    base_path = os.path.splitext(model_path)[0]
+    for ext in ['.txt', '.labels', '_labels.txt', '_classes.txt']:
+        labels_path = base_path + ext
+        if os.path.exists(labels_path):
+            with open(labels_path, 'r') as f:
+                return [line.strip() for line in f.readlines()]
+    return list(BIRD_CLASSES)
+
+
+def normalize_name(name):
+    """Lowercase a species name and drop everything but letters"""
+    return re.sub(r"[^a-z]", "", name.lower())
+
+
+def species_from_filename(path):
+    """Ground truth species from names like american_robin_0003.jpg"""
+    stem = os.path.splitext(os.path.basename(path))[0]
+    return re.sub(r"_\d+$", "", stem).replace("_", " ").title()
+
+
+def model_input_spec(model_path):
+    """Return (input name, layout, (height, width)) of an ONNX model"""
+    session = ort.InferenceSession(model_path, providers=["CPUExecutionProvider"])
+    model_input = session.get_inputs()[0]
+    shape = model_input.shape
+    if len(shape) == 4 and shape[1] == 3:
+        layout, height, width = "nchw", shape[2], shape[3]
+    else:
+        layout, height, width = "nhwc", shape[1], shape[2]
+    if not isinstance(height, int) or not isinstance(width, int):
+        height, width = 224, 224
+    return model_input.name, layout, (height, width)
+
+
+def preprocess(path, layout, size):
+    """Same preprocessing as the servers: resize, BGR to RGB, scale to [0, 1]"""
+    img = cv2.imread(path)
+    if img is None:
+        raise FileNotFoundError(f"Could not read image at {path}")
+    height, width = size
+    img = cv2.resize(img, (width, height), interpolation=cv2.INTER_AREA)
+    img = cv2.cvtColor(img, cv2.COLOR_BGR2RGB).astype(np.float32) / 255.0
+    if layout == "nchw":
+        img = img.transpose(2, 0, 1)
+    return np.ascontiguousarray(img[np.newaxis])
+
+
+def build_fp16(model_path, output_path):
+    """Convert weights and activations to FP16, keeping FP32 inputs/outputs"""
+    from onnxconverter_common import float16
+
+    model = onnx.load(model_path)
+    model_fp16 = float16.convert_float_to_float16(model, keep_io_types=True)
+    onnx.save(model_fp16, output_path)
+
+
+def build_int8(model_path, output_path, calibration_images, method):
+    """Statically quantize to QDQ int8 with ranges calibrated on the given images"""
+    from onnxruntime import quantization
+    from onnxruntime.quantization import (CalibrationDataReader, CalibrationMethod,
+                                          QuantFormat, QuantType, quantize_static)
+
+    input_name, layout, size = model_input_spec(model_path)
+
+    class ImageCalibrationReader(CalibrationDataReader):
+        def __init__(self):
+            self.paths = iter(calibration_images)
+
+        def get_next(self):
+            path = next(self.paths, None)
+            if path is None:
+                return None
+            return {input_name: preprocess(path, layout, size)}
+
+    # Shape inference and graph cleanup give the quantizer more ops to cover
+    source_path = model_path
+    try:
+        prepared_path = output_path + ".prep.onnx"
+        quantization.shape_inference.quant_pre_process(model_path, prepared_path)
+        source_path = prepared_path
+    except Exception as e:
+        print(f"Skipping quantization pre-processing: {e}")
+
+    methods = {
+        "minmax": CalibrationMethod.MinMax,
+        "entropy": CalibrationMethod.Entropy,
+        "percentile": CalibrationMethod.Percentile,
+    }
+    try:
+        # Symmetric int8 activations and weights, as TensorRT requires
+        quantize_static(
+            source_path, output_path, ImageCalibrationReader(),
+            quant_format=QuantFormat.QDQ,
+            activation_type=QuantType.QInt8,
+            weight_type=QuantType.QInt8,
+            per_channel=True,
+            calibrate_method=methods[method],
+            extra_options={"ActivationSymmetric": True, "WeightSymmetric": True}
+        )
+    finally:
+        if source_path != model_path:
+            os.remove(source_path)
+
+
+def evaluate(model_path, images, providers):
+    """Run a model on every image and return (probabilities, mean latency in ms)"""
+    session = ort.InferenceSession(model_path, providers=providers)
+    input_name, layout, size = model_input_spec(model_path)
+
+    outputs = []
+    total_time = 0.0
+    for path in images:
+        tensor = preprocess(path, layout, size)
+        start = time.time()
+        scores = session.run(None, {input_name: tensor})[0][0]
+        total_time += time.time() - start
+        outputs.append(np.asarray(scores, dtype=np.float32))
+    return np.stack(outputs), 1000.0 * total_time / len(images)
+
+
+def build_report(model_path, variant_paths, images, class_names, providers):
+    """Compare each variant with the FP32 model overall and per species"""
+    lookup = {normalize_name(name): i for i, name in enumerate(class_names)}
+    species = [species_from_filename(path) for path in images]
+    labels = np.array([lookup.get(normalize_name(name), -1) for name in species])
+    known = labels >= 0
+
+    results = {}
+    for precision, path in [("fp32", model_path)] + list(variant_paths.items()):
+        probabilities, latency = evaluate(path, images, providers)
+        results[precision] = (probabilities, probabilities.argmax(axis=1), latency)
+
+    reference_probs, reference_top1, _ = results["fp32"]
+    report = {"model": model_path, "images": len(images), "variants": {}, "species": {}}
+
+    for precision, (probabilities, top1, latency) in results.items():
+        path = model_path if precision == "fp32" else variant_paths[precision]
+        summary = {
+            "path": path,
+            "size_mb": round(os.path.getsize(path) / (1024 * 1024), 2),
+            "latency_ms": round(latency, 2),
+            "accuracy": float((top1[known] == labels[known]).mean()) if known.any() else None,
+        }
+        if precision != "fp32":
+            summary["top1_agreement"] = float((top1 == reference_top1).mean())
+            summary["max_probability_delta"] = float(np.abs(probabilities - reference_probs).max())
+        report["variants"][precision] = summary
+
+    for name in sorted(set(species)):
+        rows = np.array([s == name for s in species])
+        entry = {"images": int(rows.sum()), "in_class_list": bool(known[rows].all())}
+        for precision, (_, top1, _) in results.items():
+            if entry["in_class_list"]:
+                entry[f"{precision}_accuracy"] = float((top1[rows] == labels[rows]).mean())
+            if precision != "fp32":
+                entry[f"{precision}_agreement"] = float((top1[rows] == reference_top1[rows]).mean())
+                if entry["in_class_list"]:
+                    entry[f"{precision}_accuracy_delta"] = (entry[f"{precision}_accuracy"]
+                                                            - entry["fp32_accuracy"])
+        report["species"][name] = entry
+
+    return report
+
+
+def print_report(report, precisions):
+    """Print a per-variant summary and the per-species table"""
+    print(f"\n{'precision':<10}{'size MB':>10}{'latency ms':>12}{'accuracy':>10}{'agree':>8}")
+    for precision, summary in report["variants"].items():
+        accuracy = summary["accuracy"]
+        agreement = summary.get("top1_agreement")
+        print(f"{precision:<10}{summary['size_mb']:>10}{summary['latency_ms']:>12}"
+              f"{'-' if accuracy is None else f'{accuracy:.2f}':>10}"
+              f"{'-' if agreement is None else f'{agreement:.2f}':>8}")
+
+    header = f"\n{'species':<28}{'n':>4}{'fp32':>7}"
+    for precision in precisions:
+        header += f"{precision + ' d':>9}{precision + ' agr':>10}"
+    print(header)
+    for name, entry in report["species"].items():
+        line = f"{name:<28}{entry['images']:>4}"
+        line += f"{entry['fp32_accuracy']:>7.2f}" if "fp32_accuracy" in entry else f"{'-':>7}"
+        for precision in precisions:
+            delta = entry.get(f"{precision}_accuracy_delta")
+            line += f"{'-' if delta is None else f'{delta:+.2f}':>9}"
+            line += f"{entry[f'{precision}_agreement']:>10.2f}"
+        print(line)
+    print("\n'-' accuracy: species not in the classifier's class list, only agreement with fp32 is reported")
+
+
+def main():
+    parser = argparse.ArgumentParser(description='Build FP16/INT8 variants of the ONNX bird classifier')
+    parser.add_argument('--model', default='common/models/bird_model.onnx',
+                        help='FP32 ONNX model (default: common/models/bird_model.onnx)')
+    parser.add_argument('--calibration-dir', default='test_images',
+                        help='Images used to calibrate INT8 activation ranges (default: test_images)')
+    parser.add_argument('--eval-dir', default=None,
+                        help='Labeled images (<species>_<n>.jpg) for the accuracy report '
+                             '(default: the calibration directory)')
+    parser.add_argument('--precisions', nargs='+', choices=sorted(PRECISION_SUFFIXES),
+                        default=['fp16', 'int8'], help='Variants to build (default: fp16 int8)')
+    parser.add_argument('--calibration-method', choices=['minmax', 'entropy', 'percentile'],
+                        default='minmax', help='INT8 calibration method (default: minmax)')
+    parser.add_argument('--providers', nargs='+', default=['CPUExecutionProvider'],
+                        help='ONNX Runtime providers used for the accuracy report')
+    parser.add_argument('--report', default=None,
+                        help='Write the report as JSON to this path')
+    args = parser.parse_args()
+
+    if not os.path.exists(args.model):
+        print(f"Model not found at {args.model}")
+        return 1
+
+    calibration_images = list_images(args.calibration_dir)
+    eval_images = list_images(args.eval_dir or args.calibration_dir)
+    if not calibration_images or not eval_images:
+        print("No images found for calibration/evaluation")
+        return 1
+
+    variant_paths = {}
+    base_path = os.path.splitext(args.model)[0]
+    for precision in args.precisions:
+        output_path = base_path + PRECISION_SUFFIXES[precision]
+        print(f"Building {precision} model {output_path}...")
+        if precision == "fp16":
+            build_fp16(args.model, output_path)
+        else:
+            print(f"Calibrating on {len(calibration_images)} images from {args.calibration_dir}")
+            build_int8(args.model, output_path, calibration_images, args.calibration_method)
+        variant_paths[precision] = output_path
+
+    print(f"Evaluating on {len(eval_images)} images...")
+    report = build_report(args.model, variant_paths, eval_images,
+                          load_class_names(args.model), args.providers)
+    print_report(report, args.precisions)
+
+    if args.report:
+        os.makedirs(os.path.dirname(os.path.abspath(args.report)), exist_ok=True)
+        with open(args.report, 'w') as f:
+            json.dump(report, f, indent=2)
+        print(f"Report written to {args.report}")
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
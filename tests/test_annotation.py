@@ -0,0 +1,116 @@
+"""Tests for the Nano's annotation renderer."""
+import unittest
+from unittest.mock import patch, MagicMock
+import sys
+import os
+import shutil
+import tempfile
+
+# Add project directory to path to import modules
+sys.path.append(os.path.abspath(os.path.join(os.path.dirname(__file__), '..')))
+
+from nano_inference_server.inference.annotation import AnnotationRenderer
+
+DETECTIONS = [{"bbox": [10, 20, 30, 40], "class_name": "Robin", "confidence": 0.9}]
+
+
+class TestAnnotationRenderer(unittest.TestCase):
+    """Test cases for AnnotationRenderer class."""
+
+    def setUp(self):
+        """Set up source images and an OpenCV that encodes fixed-size JPEGs."""
+        self.temp_dir = tempfile.mkdtemp()
+        self.addCleanup(shutil.rmtree, self.temp_dir, ignore_errors=True)
+        self.images = []
+        for i in range(4):
+            path = os.path.join(self.temp_dir, f"bird{i}.jpg")
+            with open(path, "wb") as f:
+                f.write(b"\0" * (100 + i))
+            self.images.append(path)
+
+        patcher = patch('nano_inference_server.inference.annotation.cv2')
+        self.mock_cv2 = patcher.start()
+        self.addCleanup(patcher.stop)
+        self.mock_cv2.imread.side_effect = lambda path: MagicMock(shape=(600, 800, 3))
+        self.mock_cv2.resize.side_effect = lambda image, size, **kwargs: MagicMock(shape=(size[1], size[0], 3))
+        self.encoded_size = 100
+        self.mock_cv2.imencode.side_effect = lambda ext, image, params: (
+            True, MagicMock(tobytes=lambda: b"j" * self.encoded_size))
+
+    def test_cache_hit(self):
+        """Test that a second render is served from the cache."""
+        renderer = AnnotationRenderer(max_bytes=1000)
+
+        first = renderer.render(self.images[0], DETECTIONS)
+        self.assertEqual(renderer.render(self.images[0], DETECTIONS), first)
+        self.assertEqual(self.mock_cv2.imread.call_count, 1)
+        self.assertEqual(renderer.get_stats(), {"entries": 1, "bytes": 100, "hits": 1, "misses": 1})
+
+    def test_bounded_by_bytes(self):
+        """Test that the least recently used renderings are evicted past max_bytes."""
+        renderer = AnnotationRenderer(max_bytes=250)
+        renderer.render(self.images[0], DETECTIONS)
+        renderer.render(self.images[1], DETECTIONS)
+        # Touch the first so the second is the oldest
+        renderer.render(self.images[0], DETECTIONS)
+        renderer.render(self.images[2], DETECTIONS)
+
+        stats = renderer.get_stats()
+        self.assertEqual(stats["entries"], 2)
+        self.assertLessEqual(stats["bytes"], 250)
+
+        self.mock_cv2.imread.reset_mock()
+        renderer.render(self.images[0], DETECTIONS)
+        self.mock_cv2.imread.assert_not_called()
+        renderer.render(self.images[1], DETECTIONS)
+        self.mock_cv2.imread.assert_called_once()
+
+    def test_oversized_not_cached(self):
+        """Test that a rendering larger than the whole cache is returned but not kept."""
+        renderer = AnnotationRenderer(max_bytes=50)
+
+        self.assertEqual(len(renderer.render(self.images[0], DETECTIONS)), 100)
+        self.assertEqual(renderer.get_stats()["entries"], 0)
+
+    def test_key_covers_boxes_width_and_file(self):
+        """Test that a rendering is keyed by its boxes, width and source file."""
+        renderer = AnnotationRenderer()
+        key = renderer.key(self.images[0], DETECTIONS)
+        moved = [dict(DETECTIONS[0], bbox=[11, 20, 30, 40])]
+
+        self.assertEqual(renderer.key(self.images[0], DETECTIONS), key)
+        self.assertNotEqual(renderer.key(self.images[0], moved), key)
+        self.assertNotEqual(renderer.key(self.images[0], DETECTIONS, width=320), key)
+        self.assertNotEqual(renderer.key(self.images[1], DETECTIONS), key)
+
+        stat = os.stat(self.images[0])
+        os.utime(self.images[0], ns=(stat.st_atime_ns, stat.st_mtime_ns + 1000000))
+        self.assertNotEqual(renderer.key(self.images[0], DETECTIONS), key)
+
+    def test_downscale_before_drawing(self):
+        """Test that a smaller width resizes first and scales the boxes."""
+        renderer = AnnotationRenderer()
+        renderer.render(self.images[0], DETECTIONS, width=400)
+
+        self.assertEqual(self.mock_cv2.resize.call_args[0][1], (400, 300))
+        # The box is drawn at half size
+        first_corner = self.mock_cv2.rectangle.call_args_list[0][0][1]
+        self.assertEqual(first_corner, (5, 10))
+
+    def test_no_upscale(self):
+        """Test that a width above the source keeps the source size."""
+        renderer = AnnotationRenderer()
+        renderer.render(self.images[0], DETECTIONS, width=2000)
+        self.mock_cv2.resize.assert_not_called()
+
+    def test_unreadable_image(self):
+        """Test that an unreadable image renders nothing and is not cached."""
+        self.mock_cv2.imread.side_effect = lambda path: None
+        renderer = AnnotationRenderer()
+
+        self.assertIsNone(renderer.render(self.images[0], DETECTIONS))
+        self.assertEqual(renderer.get_stats()["entries"], 0)
+
+
+if __name__ == '__main__':
+    unittest.main()
@@ -0,0 +1,93 @@
+"""Tests for the Nano's API server readiness probe."""
+import unittest
+from unittest.mock import MagicMock
+import sys
+import os
+import shutil
+import tempfile
+
+# Add project directory to path to import modules
+sys.path.append(os.path.abspath(os.path.join(os.path.dirname(__file__), '..')))
+
+from nano_inference_server.api.server import APIServer
+from nano_inference_server.monitoring.metrics import MetricsRegistry
+
+
+class TestHealth(unittest.TestCase):
+    """Test cases for GET /health while the model loads."""
+
+    def setUp(self):
+        """Set up a server without a model, as main.py starts it."""
+        self.temp_dir = tempfile.mkdtemp()
+        self.addCleanup(shutil.rmtree, self.temp_dir, ignore_errors=True)
+        storage = MagicMock()
+        storage.base_dir = self.temp_dir
+        self.server = APIServer(storage, model=None,
+                                config={"access_key": "secret", "use_v0_ui": False},
+                                thumbnails=MagicMock(), metrics=MetricsRegistry())
+        self.client = self.server.app.test_client()
+
+    def make_model(self, warmup_time=1.234):
+        """A warmed-up inference executor."""
+        model = MagicMock()
+        model.warmup_time = warmup_time
+        return model
+
+    def test_starting(self):
+        """Test that /health answers 503 with Retry-After until the model is attached."""
+        response = self.client.get("/health")
+
+        self.assertEqual(response.status_code, 503)
+        self.assertEqual(response.headers["Retry-After"], "5")
+        self.assertEqual(response.get_json()["status"], "starting")
+        self.assertFalse(response.get_json()["ready"])
+
+    def test_ready_after_warmup(self):
+        """Test that /health turns 200 once the warm model is attached."""
+        self.assertEqual(self.client.get("/health").status_code, 503)
+        self.server.set_model(self.make_model())
+
+        response = self.client.get("/health")
+        self.assertEqual(response.status_code, 200)
+        health = response.get_json()
+        self.assertEqual(health["status"], "ready")
+        self.assertTrue(health["ready"])
+        self.assertEqual(health["warmup_s"], 1.23)
+
+    def test_attached_but_warming(self):
+        """Test that an attached model still warming up is not ready."""
+        self.server.set_model(self.make_model(warmup_time=None), status="starting")
+
+        response = self.client.get("/health")
+        self.assertEqual(response.status_code, 503)
+        self.assertNotIn("warmup_s", response.get_json())
+
+    def test_failed(self):
+        """Test that a failed model load stays 503 and reports the error."""
+        self.server.set_model(None, status="failed", error="engine build failed")
+
+        response = self.client.get("/health")
+        self.assertEqual(response.status_code, 503)
+        self.assertEqual(response.get_json()["status"], "failed")
+        self.assertEqual(response.get_json()["error"], "engine build failed")
+
+    def test_no_authentication(self):
+        """Test that the probe needs no access key while other routes do."""
+        self.server.set_model(self.make_model())
+
+        self.assertEqual(self.client.get("/health").status_code, 200)
+        self.assertEqual(self.client.get("/api/stats").status_code, 401)
+
+    def test_bare_model_wrapped(self):
+        """Test that a model without submit() is wrapped in an executor."""
+        model = MagicMock(spec=["detect_batch", "warmup_time", "ready"])
+        model.warmup_time = 0.5
+        self.server.set_model(model)
+        self.addCleanup(self.server.model.stop)
+
+        self.assertTrue(hasattr(self.server.model, "submit"))
+        self.assertEqual(self.client.get("/health").status_code, 200)
+
+
+if __name__ == '__main__':
+    unittest.main()
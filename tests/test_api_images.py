@@ -0,0 +1,187 @@
+"""Tests for the Nano's API server image routes and gallery."""
+import unittest
+from unittest.mock import patch, MagicMock
+import sys
+import os
+import shutil
+import tempfile
+
+# Add project directory to path to import modules
+sys.path.append(os.path.abspath(os.path.join(os.path.dirname(__file__), '..')))
+
+from nano_inference_server.api.server import APIServer
+from nano_inference_server.storage.thumbnail_cache import ThumbnailCache
+
+
+def write_file(path, data):
+    """Write a file, creating its directory."""
+    os.makedirs(os.path.dirname(path), exist_ok=True)
+    with open(path, "wb") as f:
+        f.write(data)
+    return path
+
+
+class APIServerTestCase(unittest.TestCase):
+    """A server over mocked storage in a temporary directory."""
+
+    def setUp(self):
+        """Set up the storage directories and the server."""
+        self.temp_dir = tempfile.mkdtemp()
+        self.addCleanup(shutil.rmtree, self.temp_dir, ignore_errors=True)
+        self.storage = MagicMock()
+        self.storage.base_dir = self.temp_dir
+        self.storage.images_dir = os.path.join(self.temp_dir, "images")
+        self.storage.annotated_dir = os.path.join(self.temp_dir, "annotated")
+        self.storage.organize_by_date = True
+        os.makedirs(self.storage.images_dir)
+        os.makedirs(self.storage.annotated_dir)
+
+        self.thumbnails = ThumbnailCache(os.path.join(self.temp_dir, "thumbnails"))
+        self.addCleanup(self.thumbnails.close)
+        self.server = APIServer(self.storage, config={"use_v0_ui": False}, thumbnails=self.thumbnails)
+        self.client = self.server.app.test_client()
+
+
+class TestServeImage(APIServerTestCase):
+    """Test cases for GET /images/<name>."""
+
+    def setUp(self):
+        """Set up a stored image in a dated folder."""
+        super().setUp()
+        self.image = write_file(os.path.join(self.storage.images_dir, "20240601", "bird.jpg"), b"original")
+
+    def test_original(self):
+        """Test that the original is served with an ETag and Cache-Control."""
+        response = self.client.get("/images/bird.jpg")
+
+        self.assertEqual(response.status_code, 200)
+        self.assertEqual(response.data, b"original")
+        self.assertIn(self.thumbnails.content_key(self.image), response.headers["ETag"])
+        self.assertEqual(response.headers["Cache-Control"], "public, max-age=86400")
+
+    def test_resized(self):
+        """Test that ?w= serves the cached thumbnail."""
+        thumbnail = write_file(os.path.join(self.temp_dir, "thumb.jpg"), b"thumbnail")
+        with patch.object(self.thumbnails, "get", return_value=thumbnail) as get:
+            response = self.client.get("/images/bird.jpg?w=300")
+
+        get.assert_called_once_with(self.image, 300)
+        self.assertEqual(response.status_code, 200)
+        self.assertEqual(response.data, b"thumbnail")
+        self.assertIn(self.thumbnails.content_key(thumbnail), response.headers["ETag"])
+
+    def test_original_when_resize_fails(self):
+        """Test that the original is served when no thumbnail can be made."""
+        with patch.object(self.thumbnails, "get", return_value=None):
+            response = self.client.get("/images/bird.jpg?w=300")
+
+        self.assertEqual(response.status_code, 200)
+        self.assertEqual(response.data, b"original")
+
+    def test_not_modified(self):
+        """Test that a matching If-None-Match gets a 304 without the body."""
+        etag = self.thumbnails.content_key(self.image)
+        response = self.client.get("/images/bird.jpg", headers={"If-None-Match": f'"{etag}"'})
+
+        self.assertEqual(response.status_code, 304)
+        self.assertEqual(response.data, b"")
+
+    def test_missing(self):
+        """Test that unknown images and paths outside the image folders are not found."""
+        write_file(os.path.join(self.temp_dir, "secret.jpg"), b"secret")
+
+        self.assertEqual(self.client.get("/images/other.jpg").status_code, 404)
+        self.assertEqual(self.client.get("/images/../secret.jpg").status_code, 404)
+
+
+class TestServeAnnotated(APIServerTestCase):
+    """Test cases for GET /api/results/<id>/annotated."""
+
+    def setUp(self):
+        """Set up a stored result and a mocked renderer."""
+        super().setUp()
+        self.image = write_file(os.path.join(self.storage.images_dir, "bird.jpg"), b"original")
+        self.detections = [{"bbox": [1, 2, 3, 4], "class_name": "Robin", "confidence": 0.9}]
+        self.result = {"id": 7, "image_path": self.image, "bird_detected": True,
+                       "detections": self.detections}
+        self.storage.get_result_by_id.side_effect = lambda result_id: (
+            dict(self.result) if result_id == 7 else None)
+        self.server.annotations = MagicMock()
+        self.server.annotations.key.return_value = "annotated-key"
+        self.server.annotations.render.return_value = b"annotated"
+
+    def test_rendered(self):
+        """Test that the stored boxes are drawn and served as a cacheable JPEG."""
+        response = self.client.get("/api/results/7/annotated")
+
+        self.assertEqual(response.status_code, 200)
+        self.assertEqual(response.data, b"annotated")
+        self.assertEqual(response.mimetype, "image/jpeg")
+        self.assertIn("annotated-key", response.headers["ETag"])
+        self.server.annotations.render.assert_called_once_with(self.image, self.detections, None)
+
+    def test_width_snapped(self):
+        """Test that ?w= is snapped to a thumbnail size before rendering."""
+        self.client.get("/api/results/7/annotated?w=100")
+        self.server.annotations.render.assert_called_once_with(self.image, self.detections, 320)
+
+    def test_not_modified(self):
+        """Test that a cached rendering is not drawn again."""
+        response = self.client.get("/api/results/7/annotated", headers={"If-None-Match": '"annotated-key"'})
+
+        self.assertEqual(response.status_code, 304)
+        self.server.annotations.render.assert_not_called()
+
+    def test_not_found(self):
+        """Test that unknown results and removed images are not found."""
+        self.assertEqual(self.client.get("/api/results/8/annotated").status_code, 404)
+
+        os.remove(self.image)
+        self.assertEqual(self.client.get("/api/results/7/annotated").status_code, 404)
+
+    def test_render_failure(self):
+        """Test that an image that cannot be drawn on is a server error."""
+        self.server.annotations.render.return_value = None
+        self.assertEqual(self.client.get("/api/results/7/annotated").status_code, 500)
+
+    def test_result_links_annotated_image(self):
+        """Test that results with detections link the endpoint and others do not."""
+        response = self.client.get("/api/results/7")
+        self.assertEqual(response.get_json()["result"]["annotated_url"], "/api/results/7/annotated")
+
+        self.result["bird_detected"] = False
+        response = self.client.get("/api/results/7")
+        self.assertNotIn("annotated_url", response.get_json()["result"])
+
+
+class TestGallery(APIServerTestCase):
+    """Test cases for GET /gallery paging."""
+
+    def render(self, url):
+        """Request a gallery page and return the template context."""
+        self.storage.get_recent_results.return_value = []
+        self.storage.count_results.return_value = 30
+        with patch("nano_inference_server.api.server.render_template", return_value="") as render:
+            self.assertEqual(self.client.get(url).status_code, 200)
+        return render.call_args[1]
+
+    def test_page_offset(self):
+        """Test that a later page skips the results of the pages before it."""
+        context = self.render("/gallery?page=3&per_page=12")
+
+        self.assertEqual(self.storage.get_recent_results.call_args[1]["offset"], 24)
+        self.assertEqual(context["total_pages"], 3)
+        self.assertTrue(context["has_prev"])
+        self.assertFalse(context["has_next"])
+
+    def test_count_follows_filters(self):
+        """Test that the page count is taken over the filtered results."""
+        context = self.render("/gallery?bird_only=true&with_species=true")
+
+        self.storage.count_results.assert_called_once_with(bird_only=True, with_species=True)
+        self.assertEqual(context["total_count"], 30)
+        self.assertEqual(self.storage.get_recent_results.call_args[1]["offset"], 0)
+
+
+if __name__ == '__main__':
+    unittest.main()
@@ -0,0 +1,104 @@
+"""Tests for the Nano's API server upload route and rate limit."""
+import unittest
+from unittest.mock import patch, MagicMock
+import io
+import sys
+import os
+import shutil
+import tempfile
+import threading
+
+# Add project directory to path to import modules
+sys.path.append(os.path.abspath(os.path.join(os.path.dirname(__file__), '..')))
+# main.py imports the executor from the package directory itself
+sys.path.append(os.path.abspath(os.path.join(os.path.dirname(__file__), '..', 'nano_inference_server')))
+
+from nano_inference_server.api.server import APIServer
+from inference import executor as script_executor
+
+
+class TestUploadErrors(unittest.TestCase):
+    """Test cases for POST /api/upload with the executor main.py builds."""
+
+    def setUp(self):
+        """Set up a server with an executor imported as main.py imports it."""
+        self.temp_dir = tempfile.mkdtemp()
+        self.addCleanup(shutil.rmtree, self.temp_dir, ignore_errors=True)
+        storage = MagicMock()
+        storage.base_dir = self.temp_dir
+        self.executor = script_executor.InferenceExecutor(MagicMock(), max_batch_size=1,
+                                                          max_batch_wait_ms=0, max_queue_size=1)
+        self.addCleanup(self.executor.stop)
+        self.server = APIServer(storage, model=self.executor,
+                                config={"use_v0_ui": False, "upload_folder": self.temp_dir},
+                                thumbnails=MagicMock())
+        self.client = self.server.app.test_client()
+
+        imread = patch("nano_inference_server.api.server.cv2.imread", return_value=MagicMock())
+        imread.start()
+        self.addCleanup(imread.stop)
+
+    def upload(self):
+        """Post one JPEG."""
+        return self.client.post("/api/upload", data={"file": (io.BytesIO(b"jpeg"), "bird.jpg")},
+                                content_type="multipart/form-data")
+
+    def test_queue_full(self):
+        """Test that a shed request answers 429 with Retry-After."""
+        with patch.object(self.executor, "submit", side_effect=script_executor.QueueFullError("full")):
+            response = self.upload()
+
+        self.assertEqual(response.status_code, 429)
+        self.assertEqual(response.headers["Retry-After"], "1")
+
+    def test_deadline_exceeded(self):
+        """Test that a request past its deadline answers 504."""
+        with patch.object(self.executor, "wait",
+                          side_effect=script_executor.DeadlineExceededError("late")):
+            response = self.upload()
+
+        self.assertEqual(response.status_code, 504)
+
+    def test_other_errors(self):
+        """Test that other inference errors still answer 500."""
+        with patch.object(self.executor, "wait", side_effect=RuntimeError("boom")):
+            response = self.upload()
+
+        self.assertEqual(response.status_code, 500)
+
+
+class TestRateLimit(unittest.TestCase):
+    """Test cases for the per-client rate limit."""
+
+    def setUp(self):
+        """Set up a server allowing 50 requests a minute."""
+        self.temp_dir = tempfile.mkdtemp()
+        self.addCleanup(shutil.rmtree, self.temp_dir, ignore_errors=True)
+        storage = MagicMock()
+        storage.base_dir = self.temp_dir
+        self.server = APIServer(storage, config={"use_v0_ui": False, "rate_limit": 50},
+                                thumbnails=MagicMock())
+
+    def test_concurrent_requests(self):
+        """Test that requests on several threads are counted exactly once each."""
+        request = MagicMock(remote_addr="10.0.0.2")
+        allowed = []
+        start = threading.Barrier(8)
+
+        def client():
+            start.wait()
+            for _ in range(20):
+                allowed.append(self.server._rate_limit_check(request))
+
+        threads = [threading.Thread(target=client) for _ in range(8)]
+        for thread in threads:
+            thread.start()
+        for thread in threads:
+            thread.join()
+
+        self.assertEqual(allowed.count(True), 50)
+        self.assertEqual(len(self.server.request_counts["10.0.0.2"]), 50)
+
+
+if __name__ == '__main__':
+    unittest.main()
@@ -0,0 +1,113 @@
+"""Tests for the FP16/INT8 model variant build script."""
+import unittest
+from unittest.mock import patch, MagicMock
+import importlib.util
+import sys
+import os
+import shutil
+import tempfile
+
+import numpy as np
+
+# Add the scripts directory to path to import the build script
+sys.path.append(os.path.abspath(os.path.join(os.path.dirname(__file__), '..', 'scripts')))
+
+# The report logic does not need ONNX itself
+_missing = {name: MagicMock() for name in ("onnx", "onnxruntime")
+            if importlib.util.find_spec(name) is None}
+with patch.dict(sys.modules, _missing):
+    import build_quantized_models as build
+from bird_classes import BIRD_CLASSES
+
+
+class TestNames(unittest.TestCase):
+    """Test cases for ground truth and class name lookup."""
+
+    def setUp(self):
+        """Set up a directory for the model."""
+        self.temp_dir = tempfile.mkdtemp()
+        self.addCleanup(shutil.rmtree, self.temp_dir, ignore_errors=True)
+        self.model_path = os.path.join(self.temp_dir, "bird_model.onnx")
+
+    def test_species_from_filename(self):
+        """Test that the species comes from the file name without its number."""
+        self.assertEqual(build.species_from_filename("/x/american_robin_0003.jpg"), "American Robin")
+        self.assertEqual(build.species_from_filename("blue_jay.png"), "Blue Jay")
+
+    def test_normalize_name(self):
+        """Test that names compare without case, spaces or punctuation."""
+        self.assertEqual(build.normalize_name("Black-capped Chickadee"),
+                         build.normalize_name("black capped chickadee"))
+
+    def test_labels_next_to_model(self):
+        """Test that a labels file next to the model is used, as on the Nano."""
+        with open(os.path.join(self.temp_dir, "bird_model_labels.txt"), "w") as f:
+            f.write("Robin\nWren\n")
+        self.assertEqual(build.load_class_names(self.model_path), ["Robin", "Wren"])
+
+    def test_default_class_names(self):
+        """Test that bird_classes.py is used without a labels file."""
+        self.assertEqual(build.load_class_names(self.model_path), list(BIRD_CLASSES))
+
+
+class TestReport(unittest.TestCase):
+    """Test cases for the per-variant and per-species accuracy report."""
+
+    def setUp(self):
+        """Set up model files and labeled images, one of a species the model does not know."""
+        self.temp_dir = tempfile.mkdtemp()
+        self.addCleanup(shutil.rmtree, self.temp_dir, ignore_errors=True)
+        self.paths = {}
+        for precision in ("fp32", "int8"):
+            path = os.path.join(self.temp_dir, f"bird_model.{precision}.onnx")
+            with open(path, "wb") as f:
+                f.write(b"\0" * 1024)
+            self.paths[precision] = path
+        self.images = ["robin_0001.jpg", "robin_0002.jpg", "wren_0001.jpg", "heron_0001.jpg"]
+        self.class_names = ["Robin", "Wren"]
+
+        # fp32 gets every known image right; int8 mistakes the second robin for a wren
+        self.probabilities = {
+            self.paths["fp32"]: np.array([[0.9, 0.1], [0.8, 0.2], [0.3, 0.7], [0.6, 0.4]], dtype=np.float32),
+            self.paths["int8"]: np.array([[0.9, 0.1], [0.4, 0.6], [0.2, 0.8], [0.6, 0.4]], dtype=np.float32),
+        }
+
+    def report(self):
+        """Build the report with evaluate() returning the fixed probabilities."""
+        evaluate = lambda path, images, providers: (self.probabilities[path], 2.0)
+        with patch.object(build, "evaluate", side_effect=evaluate):
+            return build.build_report(self.paths["fp32"], {"int8": self.paths["int8"]},
+                                      self.images, self.class_names, ["CPUExecutionProvider"])
+
+    def test_variant_summary(self):
+        """Test accuracy over known species and agreement with fp32 over all images."""
+        variants = self.report()["variants"]
+
+        self.assertEqual(variants["fp32"]["accuracy"], 1.0)
+        self.assertNotIn("top1_agreement", variants["fp32"])
+        self.assertAlmostEqual(variants["int8"]["accuracy"], 2 / 3)
+        self.assertEqual(variants["int8"]["top1_agreement"], 0.75)
+        self.assertAlmostEqual(variants["int8"]["max_probability_delta"], 0.4, places=5)
+        self.assertEqual(variants["int8"]["latency_ms"], 2.0)
+
+    def test_species_deltas(self):
+        """Test the per-species accuracy delta and agreement."""
+        species = self.report()["species"]
+
+        self.assertEqual(species["Robin"]["images"], 2)
+        self.assertEqual(species["Robin"]["int8_accuracy_delta"], -0.5)
+        self.assertEqual(species["Wren"]["int8_accuracy_delta"], 0.0)
+        self.assertEqual(species["Robin"]["int8_agreement"], 0.5)
+
+    def test_unknown_species(self):
+        """Test that a species outside the class list only reports agreement."""
+        heron = self.report()["species"]["Heron"]
+
+        self.assertFalse(heron["in_class_list"])
+        self.assertNotIn("fp32_accuracy", heron)
+        self.assertNotIn("int8_accuracy_delta", heron)
+        self.assertEqual(heron["int8_agreement"], 1.0)
+
+
+if __name__ == '__main__':
+    unittest.main()
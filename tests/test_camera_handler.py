@@ -1,15 +1,21 @@
 """Tests for the CameraHandler module."""
 import unittest
-from unittest.mock import patch, MagicMock, mock_open
+from unittest.mock import patch, MagicMock, mock_open, call
 import sys
 import os
 import time
+import types
+import tempfile
+import importlib
 from datetime import datetime
 
+import numpy as np
+
 # Add src directory to path to import modules
 sys.path.append(os.path.abspath(os.path.join(os.path.dirname(__file__), '..')))
 
-from src.camera.camera_handler import CameraHandler
+from src.camera.camera_handler import CameraHandler, ClipOutput, yuv420_to_rgb
+from src.camera.frame_buffer import FrameRingBuffer
 
 
 class TestCameraHandler(unittest.TestCase):
@@ -46,6 +52,34 @@ class TestCameraHandler(unittest.TestCase):
         self.mock_camera.configure.assert_called_once()
         self.mock_camera.start.assert_called_once()
 
+    @patch('src.camera.camera_handler.Picamera2')
+    @patch('src.camera.camera_handler.time.sleep')
+    def test_lean_setup_reuses_still_configuration(self, mock_sleep, mock_picamera):
+        """Test that the lean setup skips the settle delay and the config is cached."""
+        new_camera = MagicMock()
+        mock_picamera.return_value = new_camera
+        config = self.camera_handler._still_config
+        
+        self.camera_handler.setup(lean=True)
+        
+        # The settle delay is skipped (cleanup still pauses briefly)
+        self.assertNotIn(call(0.5), mock_sleep.call_args_list)
+        new_camera.create_still_configuration.assert_not_called()
+        new_camera.configure.assert_called_once_with(config)
+        new_camera.start.assert_called_once()
+        self.assertTrue(self.camera_handler.streaming)
+
+    def test_standby_and_resume(self):
+        """Test that standby stops streaming and resume restarts it."""
+        self.assertTrue(self.camera_handler.standby())
+        self.mock_camera.stop.assert_called_once()
+        self.assertFalse(self.camera_handler.streaming)
+        
+        self.assertGreaterEqual(self.camera_handler.resume(), 0.0)
+        self.assertEqual(self.mock_camera.start.call_count, 2)
+        self.mock_camera.configure.assert_called_once()
+        self.assertTrue(self.camera_handler.streaming)
+
     @patch('os.makedirs')
     def test_take_photo(self, mock_makedirs):
         """Test taking a photo."""
@@ -66,6 +100,36 @@ class TestCameraHandler(unittest.TestCase):
         # Check result
         self.assertEqual(result, output_path)
 
+    def test_capture_frame(self):
+        """Test capturing a frame into memory."""
+        width, height = self.camera_handler.lores_resolution
+        mock_request = MagicMock()
+        mock_request.make_array.return_value = np.full((height * 3 // 2, width), 128, dtype=np.uint8)
+        mock_request.get_metadata.return_value = {"SensorTimestamp": 1}
+        self.mock_camera.capture_request.return_value = mock_request
+        
+        frame = self.camera_handler.capture_frame()
+        
+        # No file is written and the request goes straight back to the camera
+        self.mock_camera.capture_file.assert_not_called()
+        mock_request.make_array.assert_called_once_with("lores")
+        mock_request.make_image.assert_called_once_with("main")
+        mock_request.release.assert_called_once()
+        
+        self.assertEqual(frame.lores.shape, (height, width, 3))
+        self.assertEqual(frame.image, mock_request.make_image.return_value)
+        self.assertEqual(frame.metadata, {"SensorTimestamp": 1})
+
+    def test_yuv420_to_rgb(self):
+        """Test converting a neutral grey YUV420 buffer to RGB."""
+        width, height = 8, 4
+        yuv = np.full((height * 3 // 2, width), 128, dtype=np.uint8)
+        
+        rgb = yuv420_to_rgb(yuv, width, height)
+        
+        self.assertEqual(rgb.shape, (height, width, 3))
+        self.assertTrue(np.all(rgb == 128))
+
     @patch('os.makedirs')
     @patch('src.camera.camera_handler.datetime')
     def test_take_timelapse_photos(self, mock_datetime, mock_makedirs):
@@ -108,6 +172,41 @@ class TestCameraHandler(unittest.TestCase):
             # Verify result
             self.assertEqual(result, expected_paths)
 
+    @patch('src.camera.camera_handler.MJPEGEncoder')
+    def test_capture_burst(self, mock_encoder):
+        """Test burst capture through the encoder output."""
+        count = 3
+        
+        def start_encoder(encoder, output):
+            for i in range(count):
+                output.outputframe(b'jpeg', True, i * 66666)
+        self.mock_camera.start_encoder.side_effect = start_encoder
+        
+        with patch.object(self.camera_handler, 'save_frame_async') as mock_save:
+            paths = self.camera_handler.capture_burst('/tmp/burst', count=count, fps=15)
+        
+        self.assertEqual(len(paths), count)
+        self.assertEqual(mock_save.call_count, count)
+        mock_save.assert_called_with(b'jpeg', paths[-1])
+        self.mock_camera.stop_encoder.assert_called_once()
+        # Still configuration is restored after the burst
+        self.assertEqual(self.mock_camera.switch_mode.call_count, 2)
+
+    @patch('src.camera.camera_handler.H264Encoder')
+    def test_video_mode(self, mock_encoder):
+        """Test that video mode runs the encoder with a keyframe per interval."""
+        self.camera_handler.start_video_mode(resolution=(1280, 720), fps=30, keyframe_interval=1.0)
+        
+        self.assertTrue(self.camera_handler.video_mode)
+        self.assertEqual(mock_encoder.call_args.kwargs["iperiod"], 30)
+        self.assertTrue(mock_encoder.call_args.kwargs["repeat"])
+        self.mock_camera.start_encoder.assert_called_once_with(
+            mock_encoder.return_value, self.camera_handler.clip_output)
+        
+        self.camera_handler.stop_video_mode()
+        self.assertFalse(self.camera_handler.video_mode)
+        self.mock_camera.stop_encoder.assert_called_once()
+
     def test_cleanup(self):
         """Test cleanup method."""
         self.camera_handler.cleanup()
@@ -117,5 +216,165 @@ class TestCameraHandler(unittest.TestCase):
         self.assertIsNone(self.camera_handler.camera)
 
 
+class TestFrameRingBuffer(unittest.TestCase):
+    """Test cases for FrameRingBuffer class."""
+
+    def setUp(self):
+        """Set up test fixtures."""
+        self.buffer = FrameRingBuffer(4, (2, 2))
+
+    def test_push_overwrites_oldest(self):
+        """Test that the ring keeps only the newest frames in preallocated slots."""
+        slots = self.buffer._frames
+        for i in range(6):
+            self.buffer.push(np.full((2, 2), i, dtype=np.uint8), timestamp=float(i))
+        
+        self.assertIs(self.buffer._frames, slots)
+        self.assertEqual(len(self.buffer), 4)
+        frames = self.buffer.frames_before(10.0, 10)
+        self.assertEqual([ts for ts, _ in frames], [2.0, 3.0, 4.0, 5.0])
+
+    def test_frames_around_trigger(self):
+        """Test splitting frames at the trigger time."""
+        for i in range(4):
+            self.buffer.push(np.full((2, 2), i, dtype=np.uint8), timestamp=float(i))
+        
+        before = self.buffer.frames_before(2.0, 2)
+        self.assertEqual([ts for ts, _ in before], [1.0, 2.0])
+        self.assertEqual(before[1][1][0, 0], 2)
+        
+        after = self.buffer.frames_after(2.0, 2, timeout=0)
+        self.assertEqual([ts for ts, _ in after], [3.0])
+
+
+class TestClipOutput(unittest.TestCase):
+    """Test cases for ClipOutput class."""
+
+    def setUp(self):
+        """Set up test fixtures: 10 fps with a keyframe every second."""
+        self.output = ClipOutput(preroll_seconds=1.5, sample_interval=1.0)
+        self.temp_dir = tempfile.TemporaryDirectory()
+        self.path = os.path.join(self.temp_dir.name, 'clip.h264')
+        self.samples = []
+
+    def tearDown(self):
+        """Clean up the clip directory."""
+        self.temp_dir.cleanup()
+
+    def feed(self, start, count):
+        """Feed frames start..start+count-1, frame i at i/10 s, keyframes every 10."""
+        for i in range(start, start + count):
+            self.output.outputframe(bytes([i % 256]), i % 10 == 0, i * 100000)
+
+    def on_keyframe(self, data, offset, index):
+        self.samples.append((data, offset, index))
+
+    def test_preroll_starts_at_keyframe(self):
+        """Test that the pre-roll is trimmed to the newest keyframe covering it."""
+        self.feed(0, 35)
+        
+        # 1.5 s back from frame 34 is frame 19, so the ring starts at keyframe 10
+        timestamps = [ts for ts, _, _ in self.output._ring]
+        self.assertEqual(timestamps[0], 10 * 100000)
+        self.assertTrue(self.output._ring[0][1])
+        self.assertEqual(len(timestamps), 25)
+
+    def test_clip_includes_preroll_and_samples_keyframes(self):
+        """Test that a clip starts with the pre-roll and samples keyframes."""
+        self.feed(0, 35)
+        self.assertTrue(self.output.start_clip(self.path, on_keyframe=self.on_keyframe))
+        self.assertFalse(self.output.start_clip(self.path))
+        self.feed(35, 30)
+        info = self.output.stop_clip()
+        
+        with open(self.path, 'rb') as f:
+            self.assertEqual(f.read(), bytes(range(10, 65)))
+        self.assertEqual(info["frames"], 55)
+        self.assertAlmostEqual(info["duration"], 5.4)
+        # Newest pre-roll keyframe first, then one per second
+        self.assertEqual([data for data, _, _ in self.samples], [bytes([30]), bytes([40]),
+                                                                 bytes([50]), bytes([60])])
+        self.assertEqual([index for _, _, index in self.samples], [0, 1, 2, 3])
+        self.assertAlmostEqual(self.samples[0][1], 2.0)
+        self.assertEqual(info["keyframes"], 4)
+        self.assertIsNone(self.output.stop_clip())
+
+    def test_sample_interval(self):
+        """Test that keyframes closer than the interval are not sampled."""
+        output = ClipOutput(preroll_seconds=1.0, sample_interval=2.0)
+        output.start_clip(self.path, on_keyframe=self.on_keyframe)
+        for i in range(50):
+            output.outputframe(b'x', i % 10 == 0, i * 100000)
+        output.stop_clip()
+        
+        self.assertEqual([offset for _, offset, _ in self.samples], [0.0, 2.0, 4.0])
+
+    def test_empty_preroll_waits_for_keyframe(self):
+        """Test that a clip without pre-roll starts at the next keyframe."""
+        self.output.start_clip(self.path)
+        self.feed(5, 10)
+        info = self.output.stop_clip()
+        
+        with open(self.path, 'rb') as f:
+            self.assertEqual(f.read(), bytes(range(10, 15)))
+        self.assertEqual(info["frames"], 5)
+
+
+def import_camera_handler_on_pi():
+    """Import a fresh copy of camera_handler through its Raspberry Pi branch.
+    
+    picamera2 is replaced by stubs and /proc/device-tree/model reads as a
+    Pi, so the development mocks are not installed. sys.modules is
+    restored afterwards; the returned module keeps working.
+    """
+    picamera2 = types.ModuleType('picamera2')
+    picamera2.Picamera2 = MagicMock()
+    picamera2.MappedArray = MagicMock()
+    encoders = types.ModuleType('picamera2.encoders')
+    encoders.JpegEncoder = encoders.MJPEGEncoder = encoders.H264Encoder = MagicMock()
+    outputs = types.ModuleType('picamera2.outputs')
+    outputs.FileOutput = MagicMock()
+    outputs.Output = type('Output', (), {'__init__': lambda self, pts=None: None})
+    
+    stubs = {'picamera2': picamera2, 'picamera2.encoders': encoders, 'picamera2.outputs': outputs}
+    with patch.dict(sys.modules, stubs), \
+            patch('platform.system', return_value='Linux'), \
+            patch('os.path.exists', return_value=True), \
+            patch('builtins.open', mock_open(read_data='Raspberry Pi 4 Model B Rev 1.4')):
+        original = sys.modules.pop('src.camera.camera_handler', None)
+        module = importlib.import_module('src.camera.camera_handler')
+    # The import also rebinds the package attribute that patch() resolves through
+    if original is not None:
+        sys.modules['src.camera'].camera_handler = original
+    return module
+
+
+class TestCameraHandlerOnPi(unittest.TestCase):
+    """Test cases for the module as imported on a Raspberry Pi."""
+
+    def setUp(self):
+        """Import the Pi branch and open a stub camera."""
+        self.module = import_camera_handler_on_pi()
+        self.assertTrue(self.module.IS_RASPBERRY_PI)
+        with patch.object(self.module.time, 'sleep'):
+            self.camera_handler = self.module.CameraHandler((1920, 1080), lores_resolution=(4, 2))
+
+    def test_capture_trigger_frames(self):
+        """Test that pre-trigger frames are dumped as images on the Pi."""
+        buffer = FrameRingBuffer(4, (3, 4))
+        for i in range(3):
+            buffer.push(np.full((3, 4), 100 + i, dtype=np.uint8), timestamp=float(i))
+        self.camera_handler.preroll_buffer = buffer
+        
+        frames = self.camera_handler.capture_trigger_frames(trigger_time=1.0, pre_frames=2,
+                                                            post_frames=1, timeout=0)
+        
+        self.assertEqual([frame.timestamp for frame in frames], [0.0, 1.0, 2.0])
+        self.assertEqual(frames[0].image.size, (4, 2))
+        self.assertEqual(frames[0].lores.shape, (2, 4, 3))
+        self.assertTrue(frames[1].metadata["pre_trigger"])
+        self.assertFalse(frames[2].metadata["pre_trigger"])
+
+
 if __name__ == '__main__':
     unittest.main() 
\ No newline at end of file
@@ -0,0 +1,94 @@
+"""Tests for the Nano's SQLite connection pool."""
+import unittest
+import sys
+import os
+import shutil
+import sqlite3
+import tempfile
+import threading
+
+# Add project directory to path to import modules
+sys.path.append(os.path.abspath(os.path.join(os.path.dirname(__file__), '..')))
+
+from nano_inference_server.storage.db_pool import SQLitePool
+
+
+class TestSQLitePool(unittest.TestCase):
+    """Test cases for SQLitePool class."""
+
+    def setUp(self):
+        """Set up a pool on a fresh database."""
+        self.temp_dir = tempfile.mkdtemp()
+        self.addCleanup(shutil.rmtree, self.temp_dir, ignore_errors=True)
+        self.pool = SQLitePool(os.path.join(self.temp_dir, "results.db"), readers=2, timeout=1.0)
+        self.addCleanup(self.pool.close)
+        with self.pool.writer() as conn:
+            conn.execute("CREATE TABLE items (id INTEGER PRIMARY KEY, name TEXT)")
+
+    def test_wal_mode(self):
+        """Test that the database is switched to WAL mode."""
+        with self.pool.reader() as conn:
+            self.assertEqual(conn.execute("PRAGMA journal_mode").fetchone()[0].lower(), "wal")
+
+    def test_writer_commits(self):
+        """Test that a successful writer block is visible to readers."""
+        with self.pool.writer() as conn:
+            conn.execute("INSERT INTO items (name) VALUES ('robin')")
+
+        with self.pool.reader() as conn:
+            self.assertEqual(conn.execute("SELECT name FROM items").fetchone()["name"], "robin")
+
+    def test_writer_rolls_back_on_error(self):
+        """Test that a failing writer block leaves nothing behind."""
+        with self.assertRaises(RuntimeError):
+            with self.pool.writer() as conn:
+                conn.execute("INSERT INTO items (name) VALUES ('robin')")
+                raise RuntimeError("failed")
+
+        with self.pool.reader() as conn:
+            self.assertEqual(conn.execute("SELECT COUNT(*) FROM items").fetchone()[0], 0)
+
+    def test_readers_are_read_only(self):
+        """Test that reader connections refuse writes."""
+        with self.pool.reader() as conn:
+            with self.assertRaises(sqlite3.OperationalError):
+                conn.execute("INSERT INTO items (name) VALUES ('robin')")
+
+    def test_readers_are_reused(self):
+        """Test that returned readers are handed out again."""
+        with self.pool.reader() as first:
+            pass
+        with self.pool.reader() as second:
+            self.assertIs(second, first)
+
+    def test_reader_limit(self):
+        """Test that a borrower waits for a free reader once all are open."""
+        borrowed = []
+
+        def borrow():
+            with self.pool.reader() as conn:
+                borrowed.append(conn)
+
+        with self.pool.reader() as first, self.pool.reader() as second:
+            waiter = threading.Thread(target=borrow)
+            waiter.start()
+            waiter.join(0.2)
+            self.assertEqual(borrowed, [])
+        waiter.join(2.0)
+
+        self.assertEqual(self.pool._reader_count, 2)
+        self.assertIn(borrowed[0], (first, second))
+
+    def test_reader_sees_committed_state_during_write(self):
+        """Test that a reader does not block on an open write transaction."""
+        with self.pool.writer() as conn:
+            conn.execute("INSERT INTO items (name) VALUES ('robin')")
+
+        with self.pool.writer() as conn:
+            conn.execute("INSERT INTO items (name) VALUES ('wren')")
+            with self.pool.reader() as reader:
+                self.assertEqual(reader.execute("SELECT COUNT(*) FROM items").fetchone()[0], 1)
+
+
+if __name__ == '__main__':
+    unittest.main()
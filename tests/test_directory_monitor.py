@@ -0,0 +1,237 @@
+"""Tests for the Nano's directory monitor, inotify watcher and processing watermark."""
+import unittest
+import sys
+import os
+import shutil
+import tempfile
+import threading
+import time
+
+# Add project directory to path to import modules
+sys.path.append(os.path.abspath(os.path.join(os.path.dirname(__file__), '..')))
+
+from nano_inference_server.monitoring.inotify_watcher import InotifyWatcher, inotify_available
+from nano_inference_server.monitoring.watermark import ProcessedWatermark
+from nano_inference_server.monitoring.directory_monitor import DirectoryMonitor
+
+
+def write_file(path, data=b"image"):
+    """Write a small file and return its path."""
+    with open(path, "wb") as f:
+        f.write(data)
+    return path
+
+
+class Collector:
+    """Records reported paths and lets a test wait for them; raises for paths in fail."""
+
+    def __init__(self, fail=()):
+        self.paths = []
+        self.fail = set(fail)
+        self._condition = threading.Condition()
+
+    def __call__(self, path):
+        with self._condition:
+            self.paths.append(path)
+            self._condition.notify_all()
+        if path in self.fail:
+            raise RuntimeError("inference failed")
+
+    def wait_for(self, count, timeout=3.0):
+        """Wait until at least count paths were reported."""
+        with self._condition:
+            return self._condition.wait_for(lambda: len(self.paths) >= count, timeout)
+
+
+@unittest.skipUnless(inotify_available(), "needs inotify")
+class TestInotifyWatcher(unittest.TestCase):
+    """Test cases for InotifyWatcher class."""
+
+    def setUp(self):
+        """Set up a watched directory."""
+        self.temp_dir = tempfile.mkdtemp()
+        self.addCleanup(shutil.rmtree, self.temp_dir, ignore_errors=True)
+        self.watch_dir = os.path.join(self.temp_dir, "input")
+        os.makedirs(self.watch_dir)
+        self.reported = Collector()
+        self.watcher = InotifyWatcher(self.watch_dir, self.reported)
+        self.watcher.start()
+        self.addCleanup(self.watcher.stop)
+
+    def test_reported_when_closed(self):
+        """Test that a file is reported once its writer closes it, not before."""
+        path = os.path.join(self.watch_dir, "bird.jpg")
+        with open(path, "wb") as f:
+            f.write(b"first half")
+            f.flush()
+            self.assertFalse(self.reported.wait_for(1, timeout=0.2))
+            f.write(b"second half")
+
+        self.assertTrue(self.reported.wait_for(1))
+        self.assertEqual(self.reported.paths, [path])
+
+    def test_renamed_into_directory(self):
+        """Test that a file moved into the directory is reported."""
+        source = write_file(os.path.join(self.temp_dir, "bird.jpg"))
+        target = os.path.join(self.watch_dir, "bird.jpg")
+        os.replace(source, target)
+
+        self.assertTrue(self.reported.wait_for(1))
+        self.assertEqual(self.reported.paths, [target])
+
+    def test_new_subdirectory(self):
+        """Test that files in a subdirectory created after start are reported."""
+        subdir = os.path.join(self.watch_dir, "2024-06-01")
+        os.makedirs(subdir)
+        time.sleep(0.1)  # Let the watch land on the new directory
+        path = write_file(os.path.join(subdir, "bird.jpg"))
+
+        self.assertTrue(self.reported.wait_for(1))
+        self.assertIn(path, self.reported.paths)
+
+
+class TestProcessedWatermark(unittest.TestCase):
+    """Test cases for ProcessedWatermark class."""
+
+    def setUp(self):
+        """Set up files with increasing change times."""
+        self.temp_dir = tempfile.mkdtemp()
+        self.addCleanup(shutil.rmtree, self.temp_dir, ignore_errors=True)
+        self.state_path = os.path.join(self.temp_dir, "state.json")
+        self.files = []
+        for name in ("a.jpg", "b.jpg", "c.jpg"):
+            self.files.append(write_file(os.path.join(self.temp_dir, name)))
+            time.sleep(0.01)
+
+    def test_in_order(self):
+        """Test that finished files move the watermark up to them."""
+        watermark = ProcessedWatermark(self.state_path)
+        for path in self.files:
+            watermark.mark_pending(path)
+            watermark.mark_done(path)
+
+        self.assertEqual(watermark.watermark_ns, ProcessedWatermark.ctime_ns(self.files[-1]))
+        self.assertTrue(all(watermark.is_processed(path) for path in self.files))
+
+    def test_out_of_order(self):
+        """Test that the watermark stays below a file still in flight."""
+        a, b, c = self.files
+        watermark = ProcessedWatermark(self.state_path)
+        for path in self.files:
+            watermark.mark_pending(path)
+        watermark.mark_done(c)
+        watermark.mark_done(a)
+
+        self.assertTrue(watermark.is_processed(a))
+        self.assertFalse(watermark.is_processed(b))
+        self.assertTrue(watermark.is_processed(c))
+        self.assertLess(watermark.watermark_ns, ProcessedWatermark.ctime_ns(b))
+        self.assertTrue(watermark.is_pending(b))
+
+    def test_restart(self):
+        """Test that a reloaded watermark only leaves unfinished files."""
+        a, b, c = self.files
+        watermark = ProcessedWatermark(self.state_path, save_interval=3600)
+        for path in self.files:
+            watermark.mark_pending(path)
+        watermark.mark_done(a)
+        watermark.mark_done(c)
+        watermark.save()
+
+        reloaded = ProcessedWatermark(self.state_path)
+        self.assertTrue(reloaded.is_processed(a))
+        self.assertFalse(reloaded.is_processed(b))
+        self.assertTrue(reloaded.is_processed(c))
+
+    def test_failed_file_holds_watermark(self):
+        """Test that a file whose processing failed is not passed, also after a restart."""
+        a, b, c = self.files
+        watermark = ProcessedWatermark(self.state_path, save_interval=3600)
+        for path in self.files:
+            watermark.mark_pending(path)
+        watermark.mark_failed(b)
+        watermark.mark_done(a)
+        watermark.mark_done(c)
+
+        self.assertFalse(watermark.is_processed(b))
+        self.assertFalse(watermark.is_pending(b))
+        self.assertLess(watermark.watermark_ns, ProcessedWatermark.ctime_ns(b))
+        watermark.save()
+        self.assertFalse(ProcessedWatermark(self.state_path).is_processed(b))
+
+    def test_deleted_failed_file(self):
+        """Test that a failed file that was deleted no longer holds the watermark."""
+        a, b, c = self.files
+        watermark = ProcessedWatermark(self.state_path)
+        watermark.mark_pending(a)
+        watermark.mark_failed(a)
+        os.remove(a)
+        watermark.mark_pending(b)
+        watermark.mark_done(b)
+
+        self.assertEqual(watermark.watermark_ns, ProcessedWatermark.ctime_ns(b))
+
+    def test_rewritten_file(self):
+        """Test that a file replaced after processing is processed again."""
+        path = self.files[-1]
+        watermark = ProcessedWatermark(self.state_path)
+        watermark.mark_pending(path)
+        watermark.mark_done(path)
+
+        time.sleep(0.01)
+        write_file(path + ".new", b"another image")
+        os.replace(path + ".new", path)
+        self.assertFalse(watermark.is_processed(path))
+
+    def test_corrupt_state(self):
+        """Test that an unreadable state file starts from zero."""
+        write_file(self.state_path, b"{not json")
+        watermark = ProcessedWatermark(self.state_path)
+        self.assertEqual(watermark.watermark_ns, 0)
+        self.assertFalse(watermark.is_processed(self.files[0]))
+
+
+class TestDirectoryMonitorRestart(unittest.TestCase):
+    """Test cases for DirectoryMonitor across restarts."""
+
+    def setUp(self):
+        """Set up an input directory and a state file outside it."""
+        self.temp_dir = tempfile.mkdtemp()
+        self.addCleanup(shutil.rmtree, self.temp_dir, ignore_errors=True)
+        self.input_dir = os.path.join(self.temp_dir, "input")
+        os.makedirs(self.input_dir)
+        self.state_path = os.path.join(self.temp_dir, "state.json")
+
+    def run_monitor(self, expected, fail=()):
+        """Run a monitor that processes existing files and return what it processed."""
+        processed = Collector(fail)
+        monitor = DirectoryMonitor(self.input_dir, processed, process_existing=True,
+                                   state_path=self.state_path)
+        monitor.start()
+        try:
+            processed.wait_for(expected)
+            time.sleep(0.2)  # Nothing else should arrive
+        finally:
+            monitor.stop()
+        return sorted(processed.paths)
+
+    def test_restart_skips_processed_files(self):
+        """Test that a restart only processes files that arrived while stopped."""
+        first = [write_file(os.path.join(self.input_dir, f"bird{i}.jpg")) for i in range(2)]
+        write_file(os.path.join(self.input_dir, "notes.txt"))
+        self.assertEqual(self.run_monitor(2), first)
+
+        time.sleep(0.01)
+        later = write_file(os.path.join(self.input_dir, "bird2.jpg"))
+        self.assertEqual(self.run_monitor(1), [later])
+
+    def test_failed_file_retried(self):
+        """Test that a file whose callback raised is processed again after a restart."""
+        paths = [write_file(os.path.join(self.input_dir, f"bird{i}.jpg")) for i in range(3)]
+        self.assertEqual(self.run_monitor(3, fail={paths[1]}), paths)
+
+        self.assertEqual(self.run_monitor(1), [paths[1]])
+
+
+if __name__ == '__main__':
+    unittest.main()
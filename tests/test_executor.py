@@ -0,0 +1,185 @@
+"""Tests for the Nano's inference executor."""
+import unittest
+import sys
+import os
+import threading
+import time
+
+# Add project directory to path to import modules
+sys.path.append(os.path.abspath(os.path.join(os.path.dirname(__file__), '..')))
+
+from nano_inference_server.inference.executor import (InferenceExecutor, QueueFullError,
+                                                      DeadlineExceededError)
+
+
+class FakeModel:
+    """Model that records its batches and can be held inside a forward pass."""
+
+    def __init__(self):
+        self.batches = []
+        self.running = threading.Event()
+        self.release = threading.Event()
+        self.release.set()
+        self.fail = False
+
+    def hold(self):
+        """Make the next forward pass wait for release."""
+        self.release.clear()
+
+    def detect_batch(self, images):
+        self.batches.append(list(images))
+        self.running.set()
+        self.release.wait(5.0)
+        if self.fail:
+            raise RuntimeError("CUDA error")
+        return [[{"image": image}] for image in images]
+
+    def get_batch_stats(self):
+        return {}
+
+
+class TestInferenceExecutor(unittest.TestCase):
+    """Test cases for InferenceExecutor class."""
+
+    def setUp(self):
+        """Set up an executor around the fake model."""
+        self.model = FakeModel()
+
+    def make_executor(self, **kwargs):
+        """Create an executor that is stopped after the test."""
+        executor = InferenceExecutor(self.model, **kwargs)
+        self.addCleanup(executor.stop, 2.0)
+        return executor
+
+    def block_worker(self, executor):
+        """Keep the worker busy in a forward pass until the model is released."""
+        self.model.hold()
+        self.addCleanup(self.model.release.set)  # Before the executor is stopped
+        request = executor.submit(["busy"])
+        self.assertTrue(self.model.running.wait(2.0))
+        return request
+
+    def test_results_per_image(self):
+        """Test that each request gets its own images' detections."""
+        executor = self.make_executor(max_batch_wait_ms=0)
+
+        self.assertEqual(executor.detect("a.jpg"), [{"image": "a.jpg"}])
+        self.assertEqual(executor.detect_batch(["b.jpg", "c.jpg"]),
+                         [[{"image": "b.jpg"}], [{"image": "c.jpg"}]])
+        self.assertEqual(executor.detect_batch([]), [])
+
+    def test_merges_queued_requests(self):
+        """Test that requests queued behind a forward pass run as one batch."""
+        executor = self.make_executor(max_batch_size=8, max_batch_wait_ms=0)
+        busy = self.block_worker(executor)
+        queued = [executor.submit([f"{i}.jpg"]) for i in range(3)]
+        self.model.release.set()
+
+        executor.wait(busy)
+        results = [executor.wait(request) for request in queued]
+        self.assertEqual(results, [[[{"image": f"{i}.jpg"}]] for i in range(3)])
+        self.assertEqual(self.model.batches[1], ["0.jpg", "1.jpg", "2.jpg"])
+        self.assertEqual(executor.get_batch_stats()["executor"]["batches"], 2)
+
+    def test_batch_size_limit(self):
+        """Test that a batch never exceeds max_batch_size images."""
+        executor = self.make_executor(max_batch_size=2, max_batch_wait_ms=0)
+        busy = self.block_worker(executor)
+        queued = [executor.submit([f"{i}.jpg"]) for i in range(5)]
+        self.model.release.set()
+
+        executor.wait(busy)
+        for request in queued:
+            executor.wait(request)
+        self.assertEqual([len(batch) for batch in self.model.batches[1:]], [2, 2, 1])
+
+    def test_queue_full_sheds(self):
+        """Test that submissions past max_queue_size raise QueueFullError."""
+        executor = self.make_executor(max_queue_size=2, max_batch_wait_ms=0)
+        self.block_worker(executor)
+        executor.submit(["1.jpg", "2.jpg"])
+
+        with self.assertRaises(QueueFullError):
+            executor.submit(["3.jpg"])
+        self.assertEqual(executor.get_batch_stats()["executor"]["shed"], 1)
+
+    def test_blocking_submit_waits_for_space(self):
+        """Test that the monitor's blocking submit waits instead of shedding."""
+        executor = self.make_executor(max_queue_size=1, max_batch_size=1, max_batch_wait_ms=0)
+        self.block_worker(executor)
+        executor.submit(["1.jpg"])
+
+        results = []
+        monitor = threading.Thread(target=lambda: results.append(executor.detect_batch(["2.jpg"])))
+        monitor.start()
+        monitor.join(0.2)
+        self.assertTrue(monitor.is_alive())
+
+        self.model.release.set()
+        monitor.join(2.0)
+        self.assertEqual(results, [[[{"image": "2.jpg"}]]])
+
+    def test_blocking_detect_waits_for_space(self):
+        """Test that the monitor's single-image path waits instead of shedding."""
+        executor = self.make_executor(max_queue_size=1, max_batch_size=1, max_batch_wait_ms=0)
+        self.block_worker(executor)
+        executor.submit(["1.jpg"])
+
+        with self.assertRaises(QueueFullError):
+            executor.detect("2.jpg")
+
+        results = []
+        monitor = threading.Thread(target=lambda: results.append(executor.detect("2.jpg", block=True)))
+        monitor.start()
+        monitor.join(0.2)
+        self.assertTrue(monitor.is_alive())
+
+        self.model.release.set()
+        monitor.join(2.0)
+        self.assertEqual(results, [[{"image": "2.jpg"}]])
+
+    def test_deadline_while_queued(self):
+        """Test that a request whose deadline passes in the queue is never run."""
+        executor = self.make_executor(max_batch_wait_ms=0)
+        self.block_worker(executor)
+        late = executor.submit(["late.jpg"], timeout=0.05)
+
+        with self.assertRaises(DeadlineExceededError):
+            executor.wait(late)
+        self.model.release.set()
+        executor.detect("next.jpg")
+
+        self.assertNotIn("late.jpg", [image for batch in self.model.batches for image in batch])
+        self.assertEqual(executor.get_batch_stats()["executor"]["expired"], 1)
+
+    def test_model_error_reaches_every_request(self):
+        """Test that a failed forward pass fails its requests and the worker goes on."""
+        executor = self.make_executor(max_batch_wait_ms=0)
+        self.model.fail = True
+        with self.assertRaises(RuntimeError):
+            executor.detect("a.jpg")
+
+        self.model.fail = False
+        self.assertEqual(executor.detect("b.jpg"), [{"image": "b.jpg"}])
+        self.assertEqual(executor.get_batch_stats()["executor"]["errors"], 1)
+
+    def test_stop(self):
+        """Test that stop finishes queued work and rejects new requests."""
+        executor = self.make_executor(max_batch_wait_ms=0)
+        busy = self.block_worker(executor)
+        queued = executor.submit(["queued.jpg"])
+        stopper = threading.Thread(target=executor.stop)
+        stopper.start()
+        time.sleep(0.05)
+        self.model.release.set()
+        stopper.join(2.0)
+
+        executor.wait(busy)
+        self.assertEqual(executor.wait(queued), [[{"image": "queued.jpg"}]])
+        self.assertFalse(executor.ready)
+        with self.assertRaises(RuntimeError):
+            executor.submit(["late.jpg"])
+
+
+if __name__ == '__main__':
+    unittest.main()
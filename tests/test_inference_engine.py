@@ -4,6 +4,8 @@ from unittest.mock import patch, MagicMock
 import sys
 import os
 
+import numpy as np
+
 # Add src directory to path to import modules
 sys.path.append(os.path.abspath(os.path.join(os.path.dirname(__file__), '..')))
 
@@ -58,5 +60,46 @@ class TestInferenceEngine(unittest.TestCase):
         self.assertEqual(result, expected_result)
 
 
+    def test_is_bird_without_model(self):
+        """Test that the bird gate keeps frames when no model is loaded."""
+        frame = np.zeros((240, 320, 3), dtype=np.uint8)
+        self.assertIsNone(self.engine.bird_score(frame))
+        self.assertTrue(self.engine.is_bird(frame))
+
+    def test_detect_gate(self):
+        """Test detections on an in-memory frame above and below the threshold."""
+        self.engine.model = MagicMock()
+        self.engine.input_name = 'input'
+        self.engine.class_names = ['Blue Jay', 'House Sparrow', 'Mourning Dove']
+        frame = np.zeros((240, 320, 3), dtype=np.uint8)
+        
+        # Confident prediction passes the gate
+        self.engine.model.run.return_value = [np.array([[0.1, 0.8, 0.1]], dtype=np.float32)]
+        detections = self.engine.detect(frame)
+        self.assertEqual(len(detections), 1)
+        self.assertEqual(detections[0]['species'], 'House Sparrow')
+        self.assertEqual(detections[0]['bbox'], [0, 0, 320, 240])
+        
+        # Input tensor is resized to the model input with a batch dimension
+        feed = self.engine.model.run.call_args[0][1]
+        self.assertEqual(feed['input'].shape, (1, 224, 224, 3))
+        
+        # Uncertain prediction is dropped
+        self.engine.model.run.return_value = [np.array([[0.4, 0.3, 0.3]], dtype=np.float32)]
+        self.assertEqual(self.engine.detect(frame), [])
+        self.assertFalse(self.engine.is_bird(frame))
+
+    def test_detect_box_in_stored_image(self):
+        """Test that a lores frame's box is given in the stored image's pixels."""
+        self.engine.model = MagicMock()
+        self.engine.input_name = 'input'
+        self.engine.class_names = ['Blue Jay', 'House Sparrow', 'Mourning Dove']
+        self.engine.model.run.return_value = [np.array([[0.1, 0.8, 0.1]], dtype=np.float32)]
+        lores = np.zeros((240, 320, 3), dtype=np.uint8)
+
+        detections = self.engine.detect(lores, image_size=(1920, 1080))
+        self.assertEqual(detections[0]['bbox'], [0, 0, 1920, 1080])
+
+
 if __name__ == '__main__':
     unittest.main() 
\ No newline at end of file
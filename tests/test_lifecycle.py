@@ -0,0 +1,147 @@
+"""Tests for the camera lifecycle module."""
+import unittest
+from unittest.mock import patch, MagicMock
+import sys
+import os
+from datetime import datetime, timezone
+
+# Add project directory to path to import modules
+sys.path.append(os.path.abspath(os.path.join(os.path.dirname(__file__), '..')))
+
+from pi_bird_cam.camera.lifecycle import ActiveSchedule, CameraLifecycle, resolve_timezone
+
+
+def utc(hour, minute=0):
+    """Unix time of a UTC wall-clock time."""
+    return datetime(2024, 6, 1, hour, minute, tzinfo=timezone.utc).timestamp()
+
+
+class TestActiveSchedule(unittest.TestCase):
+    """Test cases for ActiveSchedule class."""
+
+    def test_daytime_window(self):
+        """Test a window within one day; the end minute is outside it."""
+        schedule = ActiveSchedule(5, 0, 20, 0, timezone="UTC")
+
+        self.assertFalse(schedule.is_active(utc(4, 59)))
+        self.assertTrue(schedule.is_active(utc(5, 0)))
+        self.assertTrue(schedule.is_active(utc(19, 59)))
+        self.assertFalse(schedule.is_active(utc(20, 0)))
+
+    def test_window_across_midnight(self):
+        """Test a window that ends the next morning."""
+        schedule = ActiveSchedule(22, 0, 2, 30, timezone="UTC")
+
+        self.assertTrue(schedule.is_active(utc(23)))
+        self.assertTrue(schedule.is_active(utc(1)))
+        self.assertFalse(schedule.is_active(utc(3)))
+
+    def test_timezone_alias(self):
+        """Test that PST follows Pacific time, including daylight saving."""
+        schedule = ActiveSchedule(5, 0, 20, 0, timezone="PST")
+
+        # 12:00 UTC in June is 05:00 PDT
+        self.assertTrue(schedule.is_active(utc(12)))
+        self.assertFalse(schedule.is_active(utc(11, 59)))
+
+    def test_unknown_timezone_uses_local_time(self):
+        """Test that an unknown zone falls back to local time."""
+        self.assertIsNone(resolve_timezone("Nowhere/Land"))
+
+    def test_disabled_in_settings(self):
+        """Test that a disabled time range means no schedule."""
+        self.assertIsNone(ActiveSchedule.from_settings({"enabled": False}))
+        self.assertIsNotNone(ActiveSchedule.from_settings({"enabled": True, "timezone": "UTC"}))
+
+
+class TestCameraLifecycle(unittest.TestCase):
+    """Test cases for CameraLifecycle class."""
+
+    def setUp(self):
+        """Set up a streaming camera and a controllable clock."""
+        self.camera = MagicMock()
+        self.camera.streaming = True
+        self.camera.video_mode = False
+        self.camera.clip_recording = False
+        self.camera.standby.return_value = True
+        self.camera.resume.return_value = 0.02
+        self.schedule = MagicMock()
+        self.schedule.is_active.return_value = True
+
+        self.now = 1000.0
+        patcher = patch('pi_bird_cam.camera.lifecycle.time.monotonic', side_effect=lambda: self.now)
+        patcher.start()
+        self.addCleanup(patcher.stop)
+
+        self.on_open = MagicMock()
+        self.lifecycle = CameraLifecycle(self.camera, schedule=self.schedule, standby_after=30.0,
+                                         check_interval=60.0, on_open=self.on_open)
+
+    def test_standby_after_idle(self):
+        """Test that an idle camera goes to standby and wakes on motion."""
+        self.assertIsNone(self.lifecycle.update())
+
+        self.now += 31
+        self.assertEqual(self.lifecycle.update(), CameraLifecycle.STANDBY)
+        self.camera.standby.assert_called_once()
+
+        self.assertEqual(self.lifecycle.wake(), 0.02)
+        self.assertEqual(self.lifecycle.state, CameraLifecycle.ACTIVE)
+        self.camera.resume.assert_called_once()
+
+    def test_motion_delays_standby(self):
+        """Test that each wake restarts the idle timer."""
+        self.now += 20
+        self.lifecycle.wake()
+        self.now += 20
+
+        self.assertIsNone(self.lifecycle.update())
+        self.camera.standby.assert_not_called()
+
+    def test_video_mode_stays_active(self):
+        """Test that clip mode never stands by."""
+        self.camera.video_mode = True
+        self.now += 60
+
+        self.assertIsNone(self.lifecycle.update())
+        self.camera.standby.assert_not_called()
+
+    def test_off_outside_schedule(self):
+        """Test that the camera is closed outside the active hours and reopened lean."""
+        self.schedule.is_active.return_value = False
+        self.assertEqual(self.lifecycle.update(), CameraLifecycle.OFF)
+        self.camera.cleanup.assert_called_once()
+        self.assertIsNone(self.lifecycle.wake())
+
+        # The schedule is only checked every check_interval
+        self.schedule.is_active.return_value = True
+        self.now += 30
+        self.assertIsNone(self.lifecycle.update())
+        self.now += 30
+        self.assertEqual(self.lifecycle.update(), CameraLifecycle.ACTIVE)
+        self.camera.setup.assert_called_once_with(lean=True)
+        self.on_open.assert_called_once()
+
+    def test_clip_delays_off(self):
+        """Test that a recording clip is not cut off by the schedule."""
+        self.schedule.is_active.return_value = False
+        self.camera.clip_recording = True
+
+        self.assertIsNone(self.lifecycle.update())
+        self.camera.cleanup.assert_not_called()
+
+    def test_failed_reopen_stays_off(self):
+        """Test that a camera that fails to open stays off."""
+        self.schedule.is_active.return_value = False
+        self.lifecycle.update()
+        self.schedule.is_active.return_value = True
+        self.camera.setup.side_effect = RuntimeError("camera busy")
+        self.now += 60
+
+        self.assertIsNone(self.lifecycle.update())
+        self.assertEqual(self.lifecycle.state, CameraLifecycle.OFF)
+        self.on_open.assert_not_called()
+
+
+if __name__ == '__main__':
+    unittest.main()
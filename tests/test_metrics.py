@@ -0,0 +1,101 @@
+"""Tests for the metrics module."""
+import unittest
+import sys
+import os
+import threading
+import urllib.request
+
+# Add project directory to path to import modules
+sys.path.append(os.path.abspath(os.path.join(os.path.dirname(__file__), '..')))
+
+from pi_bird_cam.pipeline.metrics import MetricsRegistry, MetricsServer
+
+
+class TestMetricsRegistry(unittest.TestCase):
+    """Test cases for MetricsRegistry class."""
+
+    def setUp(self):
+        """Create an empty registry."""
+        self.registry = MetricsRegistry()
+
+    def test_counter_sums_thread_shards(self):
+        """Test that increments from many threads all count."""
+        counter = self.registry.counter("events_total", "Events", ("event",)).labels("captured")
+
+        def work():
+            for _ in range(1000):
+                counter.inc()
+
+        threads = [threading.Thread(target=work) for _ in range(8)]
+        for thread in threads:
+            thread.start()
+        for thread in threads:
+            thread.join()
+
+        self.assertEqual(counter.value(), 8000)
+
+    def test_finished_thread_shards_are_folded(self):
+        """Test that short-lived threads do not leave shards behind."""
+        counter = self.registry.counter("events_total", "Events").labels()
+
+        for _ in range(100):
+            thread = threading.Thread(target=counter.inc)
+            thread.start()
+            thread.join()
+
+        self.assertEqual(counter.value(), 100)
+        self.assertLessEqual(len(counter._values._shards), 64)
+
+    def test_histogram_buckets(self):
+        """Test cumulative buckets, sum and count."""
+        histogram = self.registry.histogram("stage_seconds", "Stages", ("stage",),
+                                            buckets=(0.1, 1.0)).labels("capture")
+        for value in (0.05, 0.5, 0.5, 5.0):
+            histogram.observe(value)
+
+        cumulative, total, count = histogram.snapshot()
+        self.assertEqual(cumulative, [1, 3, 4])
+        self.assertAlmostEqual(total, 6.05)
+        self.assertEqual(count, 4)
+
+    def test_render_prometheus_text(self):
+        """Test the text exposition format."""
+        self.registry.histogram("stage_seconds", "Stages", ("stage",),
+                                buckets=(0.1,)).labels("capture").observe(0.05)
+        self.registry.gauge("queue_depth", "Depth", lambda: {(("stage", "store"),): 2})
+
+        text = self.registry.render()
+        self.assertIn("# TYPE stage_seconds histogram", text)
+        self.assertIn('stage_seconds_bucket{stage="capture",le="0.1"} 1', text)
+        self.assertIn('stage_seconds_bucket{stage="capture",le="+Inf"} 1', text)
+        self.assertIn('stage_seconds_count{stage="capture"} 1', text)
+        self.assertIn('queue_depth{stage="store"} 2', text)
+
+    def test_wrong_label_count(self):
+        """Test that a label mismatch is rejected."""
+        family = self.registry.counter("events_total", "Events", ("event",))
+        with self.assertRaises(ValueError):
+            family.labels("a", "b")
+
+
+class TestMetricsServer(unittest.TestCase):
+    """Test cases for MetricsServer class."""
+
+    def test_serves_metrics(self):
+        """Test that /metrics returns the rendered registry."""
+        registry = MetricsRegistry()
+        registry.counter("events_total", "Events").labels().inc(3)
+        server = MetricsServer(registry, host="127.0.0.1", port=0)
+        server.start()
+        try:
+            port = server._server.server_address[1]
+            with urllib.request.urlopen(f"http://127.0.0.1:{port}/metrics", timeout=5) as response:
+                body = response.read().decode("utf-8")
+        finally:
+            server.stop()
+
+        self.assertIn("events_total 3", body)
+
+
+if __name__ == '__main__':
+    unittest.main()
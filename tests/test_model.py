@@ -0,0 +1,296 @@
+"""Tests for the Nano's model handler."""
+import unittest
+from unittest.mock import patch, MagicMock
+import sys
+import os
+import shutil
+import tempfile
+
+import cv2
+import numpy as np
+
+# Add project directory to path to import modules
+sys.path.append(os.path.abspath(os.path.join(os.path.dirname(__file__), '..')))
+
+from nano_inference_server.inference.model import ModelHandler
+
+
+class FakeSession:
+    """ONNX Runtime session reporting a fixed graph input and the providers it was given."""
+
+    def __init__(self, path, sess_options=None, providers=None, input_shape=(1, 3, 320, 320)):
+        self.path = path
+        self.providers = providers
+        self.input_shape = list(input_shape)
+
+    def get_providers(self):
+        return [provider[0] if isinstance(provider, tuple) else provider
+                for provider in self.providers]
+
+    def get_inputs(self):
+        return [MagicMock(shape=self.input_shape, type="tensor(float)")]
+
+    def get_outputs(self):
+        output = MagicMock()
+        output.name = "scores"
+        return [output]
+
+    def io_binding(self):
+        return MagicMock()
+
+
+def fake_onnxruntime(available, input_shape=(1, 3, 320, 320)):
+    """An onnxruntime module with the given execution providers."""
+    ort = MagicMock()
+    ort.__version__ = "1.16.0"
+    ort.get_available_providers.return_value = list(available)
+    ort.InferenceSession.side_effect = lambda path, **kwargs: FakeSession(
+        path, input_shape=input_shape, **kwargs)
+    return ort
+
+
+class OnnxTestCase(unittest.TestCase):
+    """A model file loaded through a fake ONNX Runtime."""
+
+    def setUp(self):
+        """Set up a model file and an engine cache directory."""
+        self.temp_dir = tempfile.mkdtemp()
+        self.addCleanup(shutil.rmtree, self.temp_dir, ignore_errors=True)
+        self.model_path = os.path.join(self.temp_dir, "bird_model.onnx")
+        with open(self.model_path, "wb") as f:
+            f.write(b"onnx")
+        self.cache_dir = os.path.join(self.temp_dir, "engines")
+
+    def load(self, available, model_type="onnx", device="cuda", **kwargs):
+        """Load the model with a fake ONNX Runtime offering the given providers."""
+        input_shape = kwargs.pop("input_shape", (1, 3, 320, 320))
+        with patch.dict(sys.modules, {"onnxruntime": fake_onnxruntime(available, input_shape)}):
+            return ModelHandler(self.model_path, model_type=model_type, device=device,
+                                engine_cache_dir=self.cache_dir, **kwargs)
+
+
+class TestOnnxBackend(OnnxTestCase):
+    """Test cases for loading ONNX models through ONNX Runtime."""
+
+    def test_tensorrt_preferred(self):
+        """Test that TensorRT comes first and caches its engines."""
+        handler = self.load(["TensorrtExecutionProvider", "CUDAExecutionProvider",
+                             "CPUExecutionProvider"])
+
+        providers = handler.model.providers
+        self.assertEqual(handler.model.get_providers(),
+                         ["TensorrtExecutionProvider", "CUDAExecutionProvider", "CPUExecutionProvider"])
+        options = providers[0][1]
+        self.assertTrue(options["trt_engine_cache_enable"])
+        self.assertTrue(options["trt_engine_cache_path"].startswith(self.cache_dir))
+        self.assertTrue(os.path.isdir(options["trt_engine_cache_path"]))
+        self.assertIsNotNone(handler.io_binding)
+
+    def test_onnx_falls_back_to_cuda(self):
+        """Test that model type onnx runs on CUDA without TensorRT."""
+        handler = self.load(["CUDAExecutionProvider", "CPUExecutionProvider"])
+
+        self.assertEqual(handler.model.get_providers(), ["CUDAExecutionProvider", "CPUExecutionProvider"])
+        self.assertIsNotNone(handler.io_binding)
+
+    def test_tensorrt_type_requires_provider(self):
+        """Test that model type tensorrt does not silently fall back."""
+        with self.assertRaises(RuntimeError):
+            self.load(["CUDAExecutionProvider", "CPUExecutionProvider"], model_type="tensorrt")
+
+    def test_cpu_device(self):
+        """Test that the cpu device only uses the CPU provider and no GPU binding."""
+        handler = self.load(["TensorrtExecutionProvider", "CPUExecutionProvider"], device="cpu")
+
+        self.assertEqual(handler.model.get_providers(), ["CPUExecutionProvider"])
+        self.assertIsNone(handler.io_binding)
+
+    def test_input_layout_from_graph(self):
+        """Test that layout and input size are read from the graph input."""
+        handler = self.load(["CPUExecutionProvider"], device="cpu")
+        self.assertEqual(handler.input_layout, "nchw")
+        self.assertEqual(handler.input_shape, (320, 320))
+
+        handler = self.load(["CPUExecutionProvider"], device="cpu", input_shape=(1, 416, 416, 3))
+        self.assertEqual(handler.input_layout, "nhwc")
+        self.assertEqual(handler.input_shape, (416, 416))
+
+    def test_dynamic_input_size(self):
+        """Test that dynamic spatial dimensions keep the default input size."""
+        handler = self.load(["CPUExecutionProvider"], device="cpu",
+                            input_shape=("batch", 3, "height", "width"))
+
+        self.assertEqual(handler.input_layout, "nchw")
+        self.assertEqual(handler.input_shape, (224, 224))
+
+    def test_fixed_batch_dimension(self):
+        """Test that a fixed batch dimension limits the batch size and a dynamic one does not."""
+        handler = self.load(["CPUExecutionProvider"], device="cpu", input_shape=(4, 3, 320, 320))
+        self.assertEqual(handler.max_batch_size, 4)
+
+        handler = self.load(["CPUExecutionProvider"], device="cpu", input_shape=("batch", 3, 320, 320))
+        self.assertIsNone(handler.max_batch_size)
+
+    def test_labels_next_to_model(self):
+        """Test that class names come from a labels file named after the model."""
+        with open(os.path.join(self.temp_dir, "bird_model.txt"), "w") as f:
+            f.write("Robin\nWren\n")
+
+        handler = self.load(["CPUExecutionProvider"], device="cpu")
+        self.assertEqual(handler.class_names, ["Robin", "Wren"])
+
+    def test_missing_model(self):
+        """Test that a missing model file is reported before loading."""
+        os.remove(self.model_path)
+        with self.assertRaises(FileNotFoundError):
+            self.load(["CPUExecutionProvider"], device="cpu")
+
+
+class TestPrecisionVariants(OnnxTestCase):
+    """Test cases for selecting the fp16/int8 model variants."""
+
+    def write_variant(self, precision):
+        """Write <model>.<precision>.onnx next to the model."""
+        path = os.path.join(self.temp_dir, f"bird_model.{precision}.onnx")
+        with open(path, "wb") as f:
+            f.write(precision.encode())
+        return path
+
+    def tensorrt_options(self, handler):
+        """Options the TensorRT provider was created with."""
+        return handler.model.providers[0][1]
+
+    def load_gpu(self, precision):
+        """Load on CUDA with TensorRT available."""
+        return self.load(["TensorrtExecutionProvider", "CUDAExecutionProvider", "CPUExecutionProvider"],
+                         precision=precision)
+
+    def test_fp16_variant(self):
+        """Test that fp16 loads <model>.fp16.onnx and enables TensorRT fp16 only."""
+        variant = self.write_variant("fp16")
+        handler = self.load_gpu("fp16")
+
+        self.assertEqual(handler.model_path, variant)
+        self.assertEqual(handler.model.path, variant)
+        self.assertTrue(self.tensorrt_options(handler)["trt_fp16_enable"])
+        self.assertFalse(self.tensorrt_options(handler)["trt_int8_enable"])
+
+    def test_fp16_without_variant(self):
+        """Test that fp16 runs the fp32 file with the TensorRT fp16 flag."""
+        handler = self.load_gpu("FP16")
+
+        self.assertEqual(handler.model_path, self.model_path)
+        self.assertEqual(handler.precision, "fp16")
+        self.assertTrue(self.tensorrt_options(handler)["trt_fp16_enable"])
+
+    def test_int8_variant(self):
+        """Test that int8 loads the calibrated variant with int8 and fp16 enabled."""
+        variant = self.write_variant("int8")
+        handler = self.load_gpu("int8")
+
+        self.assertEqual(handler.model.path, variant)
+        self.assertTrue(self.tensorrt_options(handler)["trt_int8_enable"])
+        self.assertTrue(self.tensorrt_options(handler)["trt_fp16_enable"])
+
+    def test_int8_falls_back_to_fp16(self):
+        """Test that int8 without a calibrated variant falls back to fp16."""
+        handler = self.load_gpu("int8")
+
+        self.assertEqual(handler.precision, "fp16")
+        self.assertEqual(handler.model.path, self.model_path)
+        self.assertFalse(self.tensorrt_options(handler)["trt_int8_enable"])
+        self.assertTrue(self.tensorrt_options(handler)["trt_fp16_enable"])
+
+    def test_fp32_ignores_variants(self):
+        """Test that fp32 keeps the original model even when variants exist."""
+        self.write_variant("fp16")
+        handler = self.load_gpu("fp32")
+
+        self.assertEqual(handler.model.path, self.model_path)
+        self.assertFalse(self.tensorrt_options(handler)["trt_fp16_enable"])
+
+    def test_engines_cached_per_precision(self):
+        """Test that engines of different precisions do not share a cache directory."""
+        cache_paths = {self.tensorrt_options(self.load_gpu(precision))["trt_engine_cache_path"]
+                       for precision in ("fp32", "fp16")}
+        self.assertEqual(len(cache_paths), 2)
+
+    def test_unsupported_precision(self):
+        """Test that an unknown precision is rejected."""
+        with self.assertRaises(ValueError):
+            self.load_gpu("int4")
+
+
+class ChannelMeanModel:
+    """Keras-like classifier scoring each image by its mean R, G and B input values."""
+
+    def __init__(self):
+        self.batch_sizes = []
+
+    def predict(self, batch, verbose=None):
+        self.batch_sizes.append(batch.shape[0])
+        return np.asarray(batch, dtype=np.float32).mean(axis=(1, 2))
+
+
+class TestDetectBatch(unittest.TestCase):
+    """Test cases for ModelHandler.detect_batch against per-image detect."""
+
+    def setUp(self):
+        """Set up solid red, green and blue images of different sizes."""
+        self.temp_dir = tempfile.mkdtemp()
+        self.addCleanup(shutil.rmtree, self.temp_dir, ignore_errors=True)
+        self.paths = []
+        for name, bgr, size in (("red", (0, 0, 255), (60, 80)), ("green", (0, 255, 0), (48, 64)),
+                                ("blue", (255, 0, 0), (100, 50))):
+            path = os.path.join(self.temp_dir, f"{name}.png")
+            cv2.imwrite(path, np.full(size + (3,), bgr, dtype=np.uint8))
+            self.paths.append(path)
+
+        self.handler = ModelHandler("unused.keras", model_type="keras", development_mode=True)
+        self.handler.development_mode = False
+        self.handler.model = ChannelMeanModel()
+        self.handler.input_shape = (32, 32)
+        self.handler.class_names = ["red", "green", "blue"]
+
+    def test_matches_detect(self):
+        """Test that each image gets the detections detect() finds on its own."""
+        expected = [self.handler.detect(path) for path in self.paths]
+        self.handler.model.batch_sizes.clear()
+
+        self.assertEqual(self.handler.detect_batch(self.paths), expected)
+        self.assertEqual(self.handler.model.batch_sizes, [3])
+        self.assertEqual([d[0]["class_name"] for d in expected], ["red", "green", "blue"])
+
+    def test_unreadable_image_keeps_order(self):
+        """Test that an unreadable file gets no detections and the others keep their place."""
+        paths = [self.paths[0], os.path.join(self.temp_dir, "missing.png"), self.paths[2]]
+        results = self.handler.detect_batch(paths)
+
+        self.assertEqual(results[1], [])
+        self.assertEqual(results[0], self.handler.detect(self.paths[0]))
+        self.assertEqual(results[2], self.handler.detect(self.paths[2]))
+
+    def test_fixed_batch_size_chunks(self):
+        """Test that a graph with a fixed batch dimension runs in chunks."""
+        self.handler.max_batch_size = 2
+        results = self.handler.detect_batch(self.paths)
+
+        self.assertEqual(self.handler.model.batch_sizes, [2, 1])
+        self.assertEqual(results, [self.handler.detect(path) for path in self.paths])
+
+    def test_batch_stats(self):
+        """Test that a batch is counted once with all of its images."""
+        self.handler.detect_batch(self.paths)
+
+        stats = self.handler.get_batch_stats()
+        self.assertEqual(stats["batches"], 1)
+        self.assertEqual(stats["images"], 3)
+        self.assertEqual(stats["average_batch_size"], 3.0)
+
+    def test_empty(self):
+        """Test that no images give no results."""
+        self.assertEqual(self.handler.detect_batch([]), [])
+
+
+if __name__ == '__main__':
+    unittest.main()
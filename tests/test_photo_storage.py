@@ -6,6 +6,7 @@ import os
 import json
 import tempfile
 import shutil
+import threading
 from datetime import datetime
 
 # Add src directory to path to import modules
@@ -24,6 +25,7 @@ class TestPhotoStorage(unittest.TestCase):
         self.base_dir = os.path.join(self.temp_dir, "test_photos")
         self.max_photos = 5
         self.storage = PhotoStorage(self.base_dir, self.max_photos)
+        self.addCleanup(self.storage.close)
 
     def tearDown(self):
         """Clean up after tests."""
@@ -45,6 +47,7 @@ class TestPhotoStorage(unittest.TestCase):
         
         # Create a new storage instance
         storage = PhotoStorage(self.base_dir)
+        self.addCleanup(storage.close)
         
         # Check directory was created
         self.assertTrue(os.path.exists(self.base_dir))
@@ -314,6 +317,9 @@ class TestPhotoStorage(unittest.TestCase):
             # Set creation time to simulate different creation times
             os.utime(full_path, (i, i))
             
+        # Files were created behind the storage's back, so rescan first
+        self.storage.reconcile()
+        
         # Enforce max photos
         self.storage._enforce_max_photos()
         
@@ -329,6 +335,131 @@ class TestPhotoStorage(unittest.TestCase):
         for i in range(num_photos - self.max_photos):
             self.assertNotIn(f'test{i}.jpg', remaining_photos)
 
+    def test_enforce_max_photos_uses_index(self):
+        """Test that saving evicts the oldest indexed photo without rescanning."""
+        os.makedirs(os.path.join(self.base_dir, '20220101'), exist_ok=True)
+        with patch('src.storage.photo_storage.time.time', side_effect=range(100, 200)):
+            for i in range(self.max_photos + 2):
+                self.storage.save_photo(b'data', f'20220101/photo{i}.jpg')
+        
+        with patch.object(self.storage, 'list_photos') as mock_list:
+            with patch('src.storage.photo_storage.time.time', return_value=300):
+                self.storage.save_photo(b'data', '20220101/newest.jpg')
+            mock_list.assert_not_called()
+        
+        self.assertEqual(self.storage.photo_count(), self.max_photos)
+        remaining = self.storage.list_photos()
+        self.assertIn(os.path.join('20220101', 'newest.jpg'), remaining)
+        for i in range(3):
+            self.assertNotIn(os.path.join('20220101', f'photo{i}.jpg'), remaining)
+
+    def test_metadata_journal_replay(self):
+        """Test that metadata changes survive a restart through the journal."""
+        self.storage.save_photo(b'data', 'a.jpg', {'species': 'robin'})
+        self.storage.save_photo(b'data', 'b.jpg')
+        self.storage.delete_photo('b.jpg')
+        self.storage.close()
+        
+        # Nothing was rewritten, only appended
+        self.assertFalse(os.path.exists(self.storage.metadata_file))
+        
+        storage = PhotoStorage(self.base_dir, self.max_photos)
+        self.addCleanup(storage.close)
+        self.assertEqual(set(storage.metadata), {'a.jpg'})
+        self.assertEqual(storage.metadata['a.jpg']['species'], 'robin')
+        self.assertEqual(storage.photo_count(), 1)
+
+    def test_metadata_journal_compaction(self):
+        """Test that a long journal is compacted into the metadata file."""
+        storage = PhotoStorage(self.base_dir, max_photos=100, compact_threshold=3)
+        self.addCleanup(storage.close)
+        os.makedirs(os.path.join(self.base_dir, '20220101'), exist_ok=True)
+        for i in range(3):
+            storage.save_photo(b'data', f'20220101/photo{i}.jpg')
+        
+        self.assertTrue(os.path.exists(storage.metadata_file))
+        self.assertEqual(os.path.getsize(storage.journal_file), 0)
+        with open(storage.metadata_file, 'r') as f:
+            self.assertEqual(len(json.load(f)), 3)
+
+    def test_metadata_journal_ignores_torn_record(self):
+        """Test that a partially written final record is ignored."""
+        with open(self.storage.journal_file, 'w') as f:
+            f.write(json.dumps({'op': 'put', 'key': 'a.jpg', 'value': {'filename': 'a.jpg'}}) + "\n")
+            f.write('{"op": "put", "key": "b.j')
+        
+        self.storage.load_metadata()
+        self.assertEqual(set(self.storage.metadata), {'a.jpg'})
+
+    def test_update_photo_metadata(self):
+        """Test that metadata updates are merged and journaled."""
+        self.storage.save_photo(b'data', 'a.jpg', {'species': 'robin'})
+
+        self.assertTrue(self.storage.update_photo_metadata('a.jpg', {'visit': {'frames': 3}}))
+        self.assertFalse(self.storage.update_photo_metadata('missing.jpg', {'visit': {}}))
+        self.storage.close()
+
+        storage = PhotoStorage(self.base_dir, self.max_photos)
+        self.addCleanup(storage.close)
+        self.assertEqual(storage.metadata['a.jpg']['species'], 'robin')
+        self.assertEqual(storage.metadata['a.jpg']['visit'], {'frames': 3})
+
+    def test_relative_filename_keyed_by_basename(self):
+        """Test that a photo saved under a dated path is found, updated and deleted by its name."""
+        os.makedirs(os.path.join(self.base_dir, '20220101'), exist_ok=True)
+        self.storage.save_photo(b'data', '20220101/clip_1.mp4', {'frames': 10})
+
+        self.assertEqual(self.storage.get_photo_metadata('clip_1.mp4')['frames'], 10)
+        self.assertTrue(self.storage.update_photo_metadata('clip_1.mp4', {'keyframes': 2}))
+        for i in range(self.max_photos):
+            self.storage.save_photo(b'data', f'20220101/photo{i}.jpg')
+
+        # Evicting the oldest photo drops its metadata too
+        self.assertNotIn('clip_1.mp4', self.storage.metadata)
+        self.assertNotIn('20220101/clip_1.mp4', self.storage.metadata)
+
+    def test_concurrent_saves_and_updates(self):
+        """Test saving from one thread while another updates metadata."""
+        storage = PhotoStorage(self.base_dir, max_photos=20, compact_threshold=25)
+        self.addCleanup(storage.close)
+        os.makedirs(os.path.join(self.base_dir, '20220101'), exist_ok=True)
+        storage.save_photo(b'data', '20220101/visit.jpg')
+        errors = []
+
+        def save():
+            try:
+                for i in range(200):
+                    storage.save_photo(b'data', f'20220101/photo{i}.jpg')
+            except Exception as e:
+                errors.append(e)
+
+        def update():
+            try:
+                for i in range(200):
+                    storage.update_photo_metadata('visit.jpg', {'visit': {'frames': i}})
+                    storage.save_photo(b'data', f'20220101/other{i}.jpg')
+            except Exception as e:
+                errors.append(e)
+
+        # Switch threads as often as possible to provoke interleaving
+        interval = sys.getswitchinterval()
+        sys.setswitchinterval(1e-6)
+        try:
+            threads = [threading.Thread(target=save), threading.Thread(target=update)]
+            for thread in threads:
+                thread.start()
+            for thread in threads:
+                thread.join()
+        finally:
+            sys.setswitchinterval(interval)
+        storage.close()
+
+        self.assertEqual(errors, [])
+        self.assertEqual(storage.photo_count(), 20)
+        reloaded = PhotoStorage(self.base_dir, max_photos=20)
+        self.addCleanup(reloaded.close)
+        self.assertEqual(set(reloaded.metadata), set(storage.metadata))
+
 
 if __name__ == '__main__':
     unittest.main() 
\ No newline at end of file
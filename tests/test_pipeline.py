@@ -0,0 +1,84 @@
+"""Tests for the pipeline stage module."""
+import unittest
+import sys
+import os
+import threading
+
+# Add project directory to path to import modules
+sys.path.append(os.path.abspath(os.path.join(os.path.dirname(__file__), '..')))
+
+from pi_bird_cam.pipeline.stage import Pipeline, PipelineStage
+
+
+class TestPipelineStage(unittest.TestCase):
+    """Test cases for PipelineStage class."""
+
+    def test_forwards_results(self):
+        """Test that handler results flow to the next stage."""
+        results = []
+        pipeline = Pipeline([
+            PipelineStage("double", lambda item: item * 2),
+            PipelineStage("collect", results.append)
+        ])
+        pipeline.start()
+        for i in range(5):
+            pipeline.submit(i)
+        pipeline.stop(drain=True)
+
+        self.assertEqual(sorted(results), [0, 2, 4, 6, 8])
+        stats = pipeline.get_stats()
+        self.assertEqual(stats["double"]["processed"], 5)
+        self.assertEqual(stats["collect"]["queue_depth"], 0)
+
+    def test_drop_oldest(self):
+        """Test that a full drop_oldest queue discards its oldest item."""
+        release = threading.Event()
+        results = []
+
+        def handler(item):
+            release.wait()
+            results.append(item)
+
+        stage = PipelineStage("slow", handler, max_queue_size=2)
+        stage.start()
+        stage.put("busy")
+        # Wait for the worker to take the first item
+        while stage.queue_depth():
+            pass
+        stage.put(1)
+        stage.put(2)
+        self.assertFalse(stage.put(3))
+        release.set()
+        stage.stop(drain=True)
+
+        self.assertEqual(results, ["busy", 2, 3])
+        self.assertEqual(stage.get_stats()["dropped"], 1)
+
+    def test_block_times_out(self):
+        """Test that a full blocking queue rejects items after the timeout."""
+        stage = PipelineStage("blocked", lambda item: None, max_queue_size=1,
+                              overflow=PipelineStage.BLOCK)
+        # Not started, so the queue never drains
+        self.assertTrue(stage.put(1))
+        self.assertFalse(stage.put(2, timeout=0.01))
+        self.assertEqual(stage.get_stats()["dropped"], 1)
+
+    def test_handler_errors_are_counted(self):
+        """Test that a failing handler does not stop the worker."""
+        def handler(item):
+            if item == "bad":
+                raise ValueError("bad item")
+
+        stage = PipelineStage("errors", handler)
+        stage.start()
+        stage.put("bad")
+        stage.put("good")
+        stage.stop(drain=True)
+
+        stats = stage.get_stats()
+        self.assertEqual(stats["errors"], 1)
+        self.assertEqual(stats["processed"], 1)
+
+
+if __name__ == '__main__':
+    unittest.main()
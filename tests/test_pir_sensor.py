@@ -14,10 +14,11 @@ from src.sensors.pir_sensor import PIRSensor
 class TestPIRSensor(unittest.TestCase):
     """Test cases for PIRSensor class."""
 
-    @patch('src.sensors.pir_sensor.GPIO')
-    def setUp(self, mock_gpio):
+    def setUp(self):
         """Set up test fixtures."""
-        self.mock_gpio = mock_gpio
+        patcher = patch('src.sensors.pir_sensor.GPIO')
+        self.mock_gpio = patcher.start()
+        self.addCleanup(patcher.stop)
         self.pin = 17
         self.cooldown_time = 0.5
         self.sensor = PIRSensor(self.pin, self.cooldown_time)
@@ -116,5 +117,63 @@ class TestPIRSensor(unittest.TestCase):
         self.mock_gpio.cleanup.assert_called_once_with(self.pin)
 
 
+class TestPIRSensorEdgeDetection(unittest.TestCase):
+    """Test cases for edge-triggered PIRSensor operation."""
+
+    def setUp(self):
+        """Set up test fixtures."""
+        patcher = patch('src.sensors.pir_sensor.GPIO')
+        self.mock_gpio = patcher.start()
+        self.addCleanup(patcher.stop)
+        self.pin = 17
+        self.sensor = PIRSensor(self.pin, cooldown_time=0.5, edge_detection=True)
+
+    def test_setup_registers_edge_callback(self):
+        """Test that edge detection registers a rising-edge callback."""
+        self.mock_gpio.add_event_detect.assert_called_once_with(
+            self.pin,
+            self.mock_gpio.RISING,
+            callback=self.sensor._on_edge,
+            bouncetime=self.sensor.bouncetime_ms
+        )
+
+    def test_wait_for_motion_edge(self):
+        """Test that a queued edge wakes the waiter with the interrupt timestamp."""
+        self.sensor._on_edge(self.pin)
+        edge_time = self.sensor._edges[0]
+        
+        self.assertTrue(self.sensor.wait_for_motion(timeout=1.0))
+        self.assertEqual(self.sensor.last_edge_time, edge_time)
+        self.mock_gpio.input.assert_not_called()
+
+    def test_wait_for_motion_edge_from_thread(self):
+        """Test that an edge from another thread unblocks a waiting caller."""
+        import threading
+        timer = threading.Timer(0.05, self.sensor._on_edge, args=(self.pin,))
+        timer.start()
+        
+        start = time.monotonic()
+        self.assertTrue(self.sensor.wait_for_motion(timeout=2.0))
+        self.assertLess(time.monotonic() - start, 1.0)
+        timer.join()
+
+    def test_wait_for_motion_edge_cooldown(self):
+        """Test that edges within the cooldown are ignored."""
+        self.sensor.last_detection_time = time.time()
+        self.sensor._on_edge(self.pin)
+        
+        self.assertFalse(self.sensor.wait_for_motion(timeout=0.05))
+
+    def test_wait_for_motion_edge_timeout(self):
+        """Test timing out when no edge arrives."""
+        self.assertFalse(self.sensor.wait_for_motion(timeout=0.05))
+
+    def test_cleanup_removes_edge_detection(self):
+        """Test that cleanup unregisters edge detection."""
+        self.sensor.cleanup()
+        self.mock_gpio.remove_event_detect.assert_called_once_with(self.pin)
+        self.mock_gpio.cleanup.assert_called_once_with(self.pin)
+
+
 if __name__ == '__main__':
     unittest.main() 
\ No newline at end of file
@@ -0,0 +1,131 @@
+"""Tests for the Nano's YOLO post-processing."""
+import unittest
+from unittest.mock import patch
+import sys
+import os
+
+import numpy as np
+
+# Add project directory to path to import modules
+sys.path.append(os.path.abspath(os.path.join(os.path.dirname(__file__), '..')))
+
+from nano_inference_server.inference import postprocess
+from nano_inference_server.inference.postprocess import batched_nms, decode_yolo
+
+CLASS_NAMES = ["bird", "squirrel"]
+
+
+def yolo_row(cx, cy, w, h, objectness=1.0, scores=(0.9, 0.0)):
+    """One raw YOLO output row."""
+    return [cx, cy, w, h, objectness] + list(scores)
+
+
+class TestBatchedNMS(unittest.TestCase):
+    """Test cases for batched_nms, with and without cv2.dnn.NMSBoxesBatched."""
+
+    def run_both(self, *args, **kwargs):
+        """Run NMS through the native batched call (if present) and the class-offset fallback."""
+        results = []
+        for batched in {postprocess._HAS_BATCHED_NMS, False}:
+            with patch.object(postprocess, "_HAS_BATCHED_NMS", batched):
+                results.append(batched_nms(*args, **kwargs).tolist())
+        return results
+
+    def test_suppresses_overlap_within_class(self):
+        """Test that the lower scoring of two overlapping boxes is dropped."""
+        boxes = np.array([[10, 10, 100, 100], [12, 12, 100, 100]], dtype=np.float32)
+        scores = np.array([0.6, 0.9], dtype=np.float32)
+        class_ids = np.array([0, 0])
+
+        for keep in self.run_both(boxes, scores, class_ids, 0.5, 0.45):
+            self.assertEqual(keep, [1])
+
+    def test_classes_do_not_suppress_each_other(self):
+        """Test that overlapping boxes of different classes are both kept."""
+        boxes = np.array([[10, 10, 100, 100], [12, 12, 100, 100]], dtype=np.float32)
+        scores = np.array([0.6, 0.9], dtype=np.float32)
+        class_ids = np.array([0, 1])
+
+        for keep in self.run_both(boxes, scores, class_ids, 0.5, 0.45):
+            self.assertEqual(keep, [1, 0])
+
+    def test_sorted_and_limited(self):
+        """Test that kept boxes are sorted by score and capped at max_detections."""
+        boxes = np.array([[0, 0, 10, 10], [100, 100, 10, 10], [200, 200, 10, 10]], dtype=np.float32)
+        scores = np.array([0.7, 0.95, 0.8], dtype=np.float32)
+        class_ids = np.array([0, 0, 0])
+
+        for keep in self.run_both(boxes, scores, class_ids, 0.5, 0.45):
+            self.assertEqual(keep, [1, 2, 0])
+        for keep in self.run_both(boxes, scores, class_ids, 0.5, 0.45, max_detections=2):
+            self.assertEqual(keep, [1, 2])
+
+    def test_empty(self):
+        """Test that no boxes keep nothing."""
+        keep = batched_nms(np.empty((0, 4), dtype=np.float32), np.empty(0, dtype=np.float32),
+                           np.empty(0, dtype=np.int64), 0.5, 0.45)
+        self.assertEqual(len(keep), 0)
+
+
+class TestDecodeYolo(unittest.TestCase):
+    """Test cases for decode_yolo."""
+
+    def test_normalized_coordinates(self):
+        """Test that normalized center boxes become top-left pixel boxes."""
+        outputs = [np.array([yolo_row(0.5, 0.5, 0.2, 0.4, scores=(0.1, 0.9))], dtype=np.float32)]
+        detections = decode_yolo(outputs, 640, 480, CLASS_NAMES, 0.5)
+
+        self.assertEqual(len(detections), 1)
+        self.assertEqual(detections[0]["class_name"], "squirrel")
+        self.assertEqual(detections[0]["class_id"], 1)
+        self.assertAlmostEqual(detections[0]["confidence"], 0.9, places=5)
+        self.assertEqual(detections[0]["bbox"], [256, 144, 128, 192])
+
+    def test_input_pixel_coordinates(self):
+        """Test that boxes in model input pixels are scaled to the image."""
+        outputs = [np.array([[yolo_row(320, 320, 64, 64)]], dtype=np.float32)]
+        detections = decode_yolo(outputs, 1280, 960, CLASS_NAMES, 0.5, input_size=(640, 640))
+
+        self.assertEqual(detections[0]["bbox"], [576, 432, 128, 96])
+
+    def test_confidence_threshold(self):
+        """Test that rows at or below the threshold are dropped."""
+        outputs = [np.array([yolo_row(0.5, 0.5, 0.2, 0.2, scores=(0.5, 0.3))], dtype=np.float32)]
+        self.assertEqual(decode_yolo(outputs, 640, 480, CLASS_NAMES, 0.5), [])
+
+    def test_objectness(self):
+        """Test that objectness scales the class scores when requested."""
+        outputs = [np.array([yolo_row(0.5, 0.5, 0.2, 0.2, objectness=0.5)], dtype=np.float32)]
+
+        self.assertEqual(len(decode_yolo(outputs, 640, 480, CLASS_NAMES, 0.5)), 1)
+        self.assertEqual(decode_yolo(outputs, 640, 480, CLASS_NAMES, 0.5, use_objectness=True), [])
+
+    def test_outputs_concatenated_and_suppressed(self):
+        """Test that rows of several output layers go through one NMS."""
+        outputs = [
+            np.array([[yolo_row(0.5, 0.5, 0.2, 0.2, scores=(0.7, 0.0))]], dtype=np.float32),
+            np.array([yolo_row(0.505, 0.5, 0.2, 0.2, scores=(0.9, 0.0)),
+                      yolo_row(0.1, 0.1, 0.1, 0.1, scores=(0.8, 0.0))], dtype=np.float32),
+            np.empty((0, 7), dtype=np.float32),
+        ]
+        detections = decode_yolo(outputs, 640, 480, CLASS_NAMES, 0.5)
+
+        self.assertEqual([round(d["confidence"], 2) for d in detections], [0.9, 0.8])
+
+    def test_unknown_class_and_limit(self):
+        """Test that unnamed classes get a placeholder and max_detections applies."""
+        rows = [yolo_row(0.1 * i + 0.05, 0.5, 0.05, 0.05, scores=(0.0, 0.0, 0.6 + 0.01 * i))
+                for i in range(5)]
+        outputs = [np.array(rows, dtype=np.float32)]
+        detections = decode_yolo(outputs, 640, 480, CLASS_NAMES, 0.5, max_detections=3)
+
+        self.assertEqual(len(detections), 3)
+        self.assertEqual(detections[0]["class_name"], "class_2")
+
+    def test_no_outputs(self):
+        """Test that empty outputs decode to nothing."""
+        self.assertEqual(decode_yolo([], 640, 480, CLASS_NAMES, 0.5), [])
+
+
+if __name__ == '__main__':
+    unittest.main()
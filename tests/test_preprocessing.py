@@ -0,0 +1,103 @@
+"""Tests for the Nano's fused image preprocessing."""
+import unittest
+import sys
+import os
+
+import cv2
+import numpy as np
+
+# Add project directory to path to import modules
+sys.path.append(os.path.abspath(os.path.join(os.path.dirname(__file__), '..')))
+
+from nano_inference_server.inference.preprocessing import preprocess_frame
+
+MEAN = [0.485, 0.456, 0.406]
+STD = [0.229, 0.224, 0.225]
+
+
+def reference(image, scale=1.0 / 255.0, mean=None, std=None, swap_rb=True):
+    """Unfused float64 preprocessing of an image already at the model size, as NHWC."""
+    pixels = image[:, :, ::-1] if swap_rb else image
+    pixels = pixels.astype(np.float64) * scale
+    if mean is not None:
+        pixels = pixels - np.asarray(mean)
+    if std is not None:
+        pixels = pixels / np.asarray(std)
+    return pixels[np.newaxis]
+
+
+class TestPreprocessFrame(unittest.TestCase):
+    """Test cases for preprocess_frame."""
+
+    def setUp(self):
+        """Set up a random BGR frame at the model size."""
+        self.rng = np.random.default_rng(7)
+        self.image = self.rng.integers(0, 256, size=(16, 24, 3), dtype=np.uint8)
+
+    def test_nhwc_matches_reference(self):
+        """Test that folded scale, mean and std match the unfused computation."""
+        tensor = preprocess_frame(self.image, (16, 24), mean=MEAN, std=STD)
+
+        self.assertEqual(tensor.shape, (1, 16, 24, 3))
+        self.assertEqual(tensor.dtype, np.float32)
+        np.testing.assert_allclose(tensor, reference(self.image, mean=MEAN, std=STD), atol=1e-5)
+
+    def test_nchw_matches_reference(self):
+        """Test that the NCHW output holds the same values as planes."""
+        tensor = preprocess_frame(self.image, (16, 24), layout="nchw", mean=MEAN, std=STD)
+
+        self.assertEqual(tensor.shape, (1, 3, 16, 24))
+        expected = reference(self.image, mean=MEAN, std=STD).transpose(0, 3, 1, 2)
+        np.testing.assert_allclose(tensor, expected, atol=1e-5)
+
+    def test_scale_only(self):
+        """Test that without mean and std pixels are only scaled to [0, 1]."""
+        tensor = preprocess_frame(self.image, (16, 24))
+        np.testing.assert_allclose(tensor, reference(self.image), atol=1e-6)
+
+    def test_mean_without_std(self):
+        """Test that a mean alone is subtracted after scaling."""
+        tensor = preprocess_frame(self.image, (16, 24), mean=MEAN)
+        np.testing.assert_allclose(tensor, reference(self.image, mean=MEAN), atol=1e-6)
+
+    def test_no_channel_swap(self):
+        """Test that swap_rb=False keeps the BGR channel order."""
+        tensor = preprocess_frame(self.image, (16, 24), swap_rb=False)
+        np.testing.assert_allclose(tensor, reference(self.image, swap_rb=False), atol=1e-6)
+
+    def test_resized_before_conversion(self):
+        """Test that a larger frame is resized as uint8 with INTER_AREA first."""
+        frame = self.rng.integers(0, 256, size=(64, 96, 3), dtype=np.uint8)
+        tensor = preprocess_frame(frame, (16, 24), mean=MEAN, std=STD)
+
+        resized = cv2.resize(frame, (24, 16), interpolation=cv2.INTER_AREA)
+        np.testing.assert_allclose(tensor, reference(resized, mean=MEAN, std=STD), atol=1e-5)
+
+    def test_fp16_into_batch_row(self):
+        """Test that a float16 NCHW tensor is written in place into one row of a batch."""
+        batch = np.zeros((2, 3, 16, 24), dtype=np.float16)
+        tensor = preprocess_frame(self.image, (16, 24), layout="nchw", mean=MEAN, std=STD,
+                                  dtype=np.float16, out=batch[1:2])
+
+        self.assertTrue(np.shares_memory(tensor, batch))
+        self.assertEqual(tensor.dtype, np.float16)
+        self.assertFalse(batch[0].any())
+        expected = reference(self.image, mean=MEAN, std=STD).transpose(0, 3, 1, 2)
+        np.testing.assert_allclose(batch[1:2].astype(np.float64), expected, atol=2e-2)
+
+    def test_fp16_nhwc(self):
+        """Test the float16 NHWC output."""
+        tensor = preprocess_frame(self.image, (16, 24), mean=MEAN, std=STD, dtype=np.float16)
+
+        self.assertEqual(tensor.dtype, np.float16)
+        np.testing.assert_allclose(tensor.astype(np.float64), reference(self.image, mean=MEAN, std=STD),
+                                   atol=2e-2)
+
+    def test_unsupported_layout(self):
+        """Test that an unknown layout is rejected."""
+        with self.assertRaises(ValueError):
+            preprocess_frame(self.image, (16, 24), layout="chw")
+
+
+if __name__ == '__main__':
+    unittest.main()
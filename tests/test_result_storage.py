@@ -0,0 +1,283 @@
+"""Tests for the Nano's result storage module."""
+import unittest
+import sys
+import os
+import shutil
+import tempfile
+import time
+
+# Add project directory to path to import modules
+sys.path.append(os.path.abspath(os.path.join(os.path.dirname(__file__), '..')))
+
+from nano_inference_server.storage.result_storage import ResultStorage
+
+
+class ResultStorageTestCase(unittest.TestCase):
+    """Storage in a temporary directory, with retention only run by the tests."""
+
+    def setUp(self):
+        """Set up a temporary output directory and a source image."""
+        self.temp_dir = tempfile.mkdtemp()
+        self.addCleanup(shutil.rmtree, self.temp_dir, ignore_errors=True)
+        self.output_dir = os.path.join(self.temp_dir, "output")
+        self.image_path = os.path.join(self.temp_dir, "bird.jpg")
+        with open(self.image_path, "wb") as f:
+            f.write(b"\0" * 1000)
+
+    def make_storage(self, **kwargs):
+        """Create storage that is closed after the test."""
+        kwargs.setdefault("retention_interval", 3600)
+        kwargs.setdefault("retention_high_water", 100.0)
+        storage = ResultStorage(self.output_dir, **kwargs)
+        self.addCleanup(storage.close)
+        return storage
+
+    def save(self, storage, species=None, confidence=0.9, detected=True, metadata=None):
+        """Save a result with one detection (or none)."""
+        detections = []
+        if detected:
+            detections.append({"class_name": species or "bird", "confidence": confidence})
+        return storage.save_result(self.image_path, detections, metadata=metadata)
+
+
+class TestResultStoragePagination(ResultStorageTestCase):
+    """Test cases for keyset pagination and the materialized counters."""
+
+    def test_keyset_pages(self):
+        """Test that cursor pages cover every result once, newest first."""
+        storage = self.make_storage()
+        saved = [self.save(storage) for _ in range(7)]
+
+        ids, before = [], None
+        while True:
+            page = storage.get_recent_results(limit=3, before=before)
+            if not page:
+                break
+            ids.extend(row["id"] for row in page)
+            before = (page[-1]["timestamp"], page[-1]["id"])
+
+        all_rows = storage.get_recent_results(limit=100)
+        self.assertEqual(ids, [row["id"] for row in all_rows])
+        self.assertEqual(len(ids), len(saved))
+        self.assertEqual(ids, sorted(ids, reverse=True))
+
+    def test_cursor_ties_on_timestamp(self):
+        """Test that results sharing a timestamp are split by id."""
+        storage = self.make_storage()
+        for _ in range(3):
+            self.save(storage)
+        with storage.pool.writer() as conn:
+            conn.execute("UPDATE detections SET timestamp = '2024-06-01T12:00:00'")
+
+        first = storage.get_recent_results(limit=2)
+        rest = storage.get_recent_results(limit=2, before=(first[-1]["timestamp"], first[-1]["id"]))
+        self.assertEqual(len(rest), 1)
+        self.assertNotIn(rest[0]["id"], [row["id"] for row in first])
+
+    def test_offset_pages(self):
+        """Test that offset paging still works without a cursor."""
+        storage = self.make_storage()
+        for _ in range(4):
+            self.save(storage)
+
+        all_ids = [row["id"] for row in storage.get_recent_results(limit=10)]
+        self.assertEqual([row["id"] for row in storage.get_recent_results(limit=2, offset=2)],
+                         all_ids[2:])
+
+    def test_filtered_listing(self):
+        """Test the bird_only and with_species filters."""
+        storage = self.make_storage()
+        self.save(storage, detected=False)
+        self.save(storage)
+        self.save(storage, species="Robin")
+
+        self.assertEqual(len(storage.get_recent_results(bird_only=True)), 2)
+        species_rows = storage.get_recent_results(with_species=True)
+        self.assertEqual([row["species"] for row in species_rows], ["Robin"])
+
+    def test_counters(self):
+        """Test that counts and stats come from the counters."""
+        storage = self.make_storage()
+        self.save(storage, detected=False)
+        self.save(storage, confidence=0.5)
+        self.save(storage, species="Robin", confidence=0.9)
+        self.save(storage, species="Robin", confidence=0.7)
+
+        self.assertEqual(storage.count_results(), 4)
+        self.assertEqual(storage.count_results(bird_only=True), 3)
+        self.assertEqual(storage.count_results(with_species=True), 2)
+
+        stats = storage.get_stats()
+        self.assertEqual(stats["total_detections"], 4)
+        self.assertEqual(stats["bird_detections"], 3)
+        self.assertEqual(stats["species_identified"], 2)
+        self.assertAlmostEqual(stats["average_confidence"], 0.7)
+        self.assertEqual(stats["top_species"], [{"species": "Robin", "count": 2}])
+        self.assertEqual(sum(day["count"] for day in stats["recent_counts"]), 4)
+
+    def test_counters_rebuilt_for_old_database(self):
+        """Test that a database without counters is backfilled on open."""
+        storage = self.make_storage()
+        self.save(storage)
+        self.save(storage, species="Robin")
+        with storage.pool.writer() as conn:
+            conn.execute("DELETE FROM detection_counts")
+        storage.close()
+
+        reopened = self.make_storage()
+        self.assertEqual(reopened.count_results(), 2)
+        self.assertEqual(reopened.count_results(with_species=True), 1)
+
+
+class TestResultStorageRetention(ResultStorageTestCase):
+    """Test cases for batched retention."""
+
+    def test_count_limit(self):
+        """Test that the oldest results are deleted down to max_results."""
+        storage = self.make_storage(max_results=3)
+        saved = [self.save(storage) for _ in range(5)]
+
+        self.assertEqual(storage._cleanup_old_results(), 2)
+        remaining = [row["id"] for row in storage.get_recent_results()]
+        self.assertEqual(remaining, [result["id"] for result in reversed(saved[2:])])
+        self.assertEqual(storage.count_results(), 3)
+
+    def test_files_unlinked(self):
+        """Test that a deleted result's image and JSON are removed."""
+        storage = self.make_storage(max_results=1)
+        oldest = self.save(storage)
+        newest = self.save(storage)
+
+        storage._cleanup_old_results()
+        self.assertFalse(os.path.exists(oldest["image_path"]))
+        self.assertFalse(os.path.exists(oldest["result_path"]))
+        self.assertTrue(os.path.exists(newest["image_path"]))
+
+    def test_several_batches(self):
+        """Test that retention continues past one batch per transaction."""
+        storage = self.make_storage(max_results=2, retention_batch_size=2)
+        for _ in range(7):
+            self.save(storage)
+
+        self.assertEqual(storage._cleanup_old_results(), 5)
+        self.assertEqual(len(storage.get_recent_results()), 2)
+
+    def test_size_limit(self):
+        """Test that results are deleted until the stored bytes fit."""
+        storage = self.make_storage()
+        saved = [self.save(storage) for _ in range(4)]
+        size = saved[0]["file_size"]
+        storage.max_storage_bytes = int(size * 2.5)
+
+        self.assertEqual(storage._cleanup_old_results(), 2)
+        with storage.pool.reader() as conn:
+            stored = conn.execute("SELECT count FROM detection_counts WHERE kind = 'bytes'").fetchone()[0]
+        self.assertLessEqual(stored, storage.max_storage_bytes)
+
+    def test_counters_follow_deletes(self):
+        """Test that the counters drop with the deleted results."""
+        storage = self.make_storage(max_results=1)
+        self.save(storage, species="Robin")
+        self.save(storage, detected=False)
+
+        storage._cleanup_old_results()
+        stats = storage.get_stats()
+        self.assertEqual(stats["total_detections"], 1)
+        self.assertEqual(stats["bird_detections"], 0)
+        self.assertEqual(stats["top_species"], [])
+
+    def test_old_visits_deleted(self):
+        """Test that visits ending before the deleted results go with them."""
+        storage = self.make_storage(max_results=1)
+        self.save(storage, metadata={"visit": {"key": "cam-1", "source": "cam"}})
+        self.save(storage)
+
+        storage._cleanup_old_results()
+        self.assertEqual(storage.get_visits(), [])
+
+    def test_high_water_wakes_retention(self):
+        """Test that saving past the high-water mark runs retention early."""
+        storage = self.make_storage(max_results=2, retention_high_water=1.05)
+        for _ in range(3):
+            self.save(storage)
+
+        for _ in range(50):
+            if storage.count_results() == 2:
+                break
+            time.sleep(0.05)
+        self.assertEqual(storage.count_results(), 2)
+
+
+class TestResultStorageSearch(ResultStorageTestCase):
+    """Test cases for full-text search and facets."""
+
+    def setUp(self):
+        """Set up storage with a few searchable results."""
+        super().setUp()
+        self.storage = self.make_storage()
+        self.robin = self.save(self.storage, species="American Robin",
+                               metadata={"source": "feeder", "notes": "juvenile on the rail"})
+        self.wren = self.save(self.storage, species="Carolina Wren", confidence=0.6,
+                              metadata={"source": "garden"})
+        self.save(self.storage, species="American Robin", metadata={"source": "garden"})
+
+    def search_ids(self, **kwargs):
+        """Ids of the matching results."""
+        return {row["id"] for row in self.storage.search_results(**kwargs)}
+
+    def test_fts_prefix_search(self):
+        """Test that every word matches as a prefix through the index."""
+        if not self.storage.fts_enabled:
+            self.skipTest("SQLite built without FTS5")
+
+        self.assertEqual(self.search_ids(query="carol"), {self.wren["id"]})
+        self.assertEqual(len(self.search_ids(query="amer rob")), 2)
+        self.assertEqual(self.search_ids(query="juvenile"), {self.robin["id"]})
+        self.assertEqual(self.search_ids(query="robin feeder"), {self.robin["id"]})
+
+    def test_fts_species_column(self):
+        """Test that the species filter only matches the species column."""
+        if not self.storage.fts_enabled:
+            self.skipTest("SQLite built without FTS5")
+
+        self.assertEqual(self.search_ids(species="garden"), set())
+        self.assertEqual(self.search_ids(species="wren"), {self.wren["id"]})
+
+    def test_fts_quotes_in_query(self):
+        """Test that quotes in user text do not break the FTS query."""
+        self.assertEqual(self.search_ids(query='"robin'), self.search_ids(query="robin"))
+
+    def test_like_fallback(self):
+        """Test that search works through LIKE without the index."""
+        self.storage.fts_enabled = False
+
+        self.assertEqual(self.search_ids(query="Wren"), {self.wren["id"]})
+        self.assertEqual(len(self.search_ids(query="garden")), 2)
+        self.assertEqual(len(self.search_ids(species="Robin")), 2)
+
+    def test_filters(self):
+        """Test the confidence and date filters."""
+        self.assertEqual(len(self.search_ids(min_confidence=0.8)), 2)
+        self.assertEqual(self.search_ids(start_date="9999-01-01"), set())
+        self.assertEqual(len(self.search_ids(end_date="9999-01-01")), 3)
+
+    def test_facets(self):
+        """Test species x day facet counts and the total."""
+        found = self.storage.search_with_facets(min_confidence=0.5, limit=1)
+
+        self.assertEqual(len(found["results"]), 1)
+        self.assertEqual(found["total"], 3)
+        counts = {facet["species"]: facet["count"] for facet in found["facets"]}
+        self.assertEqual(counts, {"American Robin": 2, "Carolina Wren": 1})
+
+    def test_deleted_results_leave_index(self):
+        """Test that retention removes results from the search index."""
+        self.storage.max_results = 2
+        self.storage._cleanup_old_results()
+
+        self.assertEqual(self.search_ids(query="juvenile"), set())
+        self.assertEqual(len(self.search_ids(query="robin")), 1)
+
+
+if __name__ == '__main__':
+    unittest.main()
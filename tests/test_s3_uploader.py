@@ -0,0 +1,215 @@
+"""Tests for the S3 uploader, its outbox and bandwidth throttle."""
+import unittest
+import sys
+import os
+import time
+import tempfile
+import threading
+
+# Add project directory to path to import modules
+sys.path.append(os.path.abspath(os.path.join(os.path.dirname(__file__), '..')))
+
+from pi_bird_cam.uploader.outbox import UploadOutbox
+from pi_bird_cam.uploader.throttle import TokenBucket
+from pi_bird_cam.uploader import s3_uploader
+from pi_bird_cam.uploader.s3_uploader import S3Uploader
+
+try:
+    from boto3.exceptions import S3UploadFailedError
+except ImportError:
+    S3UploadFailedError = None
+
+
+class FakeS3Client:
+    """Records uploads and fails the first fail_count calls with error."""
+
+    def __init__(self, fail_count=0, error=None):
+        self.fail_count = fail_count
+        self.error = error or OSError("connection reset")
+        self.uploads = []
+        self.uploaded = threading.Event()
+
+    def upload_file(self, file_path, bucket, key, Config=None, Callback=None):
+        if self.fail_count > 0:
+            self.fail_count -= 1
+            raise self.error
+        if Callback:
+            Callback(os.path.getsize(file_path))
+        self.uploads.append((bucket, key))
+        self.uploaded.set()
+
+
+class TestUploadOutbox(unittest.TestCase):
+    """Test cases for UploadOutbox class."""
+
+    def setUp(self):
+        """Set up test fixtures."""
+        self.db_path = os.path.join(tempfile.mkdtemp(), "outbox.db")
+        self.outbox = UploadOutbox(self.db_path)
+
+    def tearDown(self):
+        """Clean up after tests."""
+        self.outbox.close()
+
+    def test_claim_in_order(self):
+        """Test that uploads are claimed oldest first and only once."""
+        first = self.outbox.enqueue("/tmp/a.jpg", "a.jpg")
+        second = self.outbox.enqueue("/tmp/b.jpg", "b.jpg", {"trigger": "motion_detection"})
+
+        self.assertEqual(self.outbox.claim()["id"], first)
+        claimed = self.outbox.claim()
+        self.assertEqual(claimed["id"], second)
+        self.assertIn("motion_detection", claimed["metadata"])
+        self.assertIsNone(self.outbox.claim())
+
+    def test_retry_delay(self):
+        """Test that a retried upload is not due until its delay passes."""
+        ticket = self.outbox.enqueue("/tmp/a.jpg", "a.jpg")
+        self.outbox.claim()
+        self.outbox.retry(ticket, 60, "timeout")
+
+        self.assertIsNone(self.outbox.claim())
+        item = self.outbox.get(ticket)
+        self.assertEqual(item["status"], UploadOutbox.PENDING)
+        self.assertEqual(item["attempts"], 1)
+
+    def test_recover_interrupted(self):
+        """Test that uploads in progress at shutdown are requeued on reopen."""
+        ticket = self.outbox.enqueue("/tmp/a.jpg", "a.jpg")
+        self.outbox.claim()
+        self.outbox.close()
+
+        self.outbox = UploadOutbox(self.db_path)
+        self.assertEqual(self.outbox.claim()["id"], ticket)
+
+    def test_prune_completed(self):
+        """Test that only completed uploads older than the cutoff are deleted."""
+        done = self.outbox.enqueue("/tmp/a.jpg", "a.jpg")
+        pending = self.outbox.enqueue("/tmp/b.jpg", "b.jpg")
+        self.outbox.claim()
+        self.outbox.complete(done, "s3://bucket/a.jpg")
+
+        self.assertEqual(self.outbox.prune(max_age_days=1), 0)
+        self.assertEqual(self.outbox.prune(max_age_days=0), 1)
+        self.assertIsNone(self.outbox.get(done))
+        self.assertIsNotNone(self.outbox.get(pending))
+
+
+class TestTokenBucket(unittest.TestCase):
+    """Test cases for TokenBucket class."""
+
+    def test_limits_rate(self):
+        """Test that consuming beyond the burst waits for tokens."""
+        bucket = TokenBucket(rate=10000, burst=1000)
+        start = time.monotonic()
+        for _ in range(4):
+            bucket.consume(1000)
+        # 1000 bytes of burst, then 3000 bytes at 10000 bytes/s
+        self.assertGreaterEqual(time.monotonic() - start, 0.25)
+
+    def test_unlimited(self):
+        """Test that no rate means no waiting."""
+        bucket = TokenBucket(rate=None)
+        start = time.monotonic()
+        bucket.consume(10 ** 9)
+        self.assertLess(time.monotonic() - start, 0.1)
+
+
+class TestS3Uploader(unittest.TestCase):
+    """Test cases for S3Uploader class."""
+
+    def setUp(self):
+        """Set up test fixtures."""
+        self.temp_dir = tempfile.mkdtemp()
+        self.photo = os.path.join(self.temp_dir, "bird.jpg")
+        with open(self.photo, "wb") as f:
+            f.write(b"x" * 1000)
+
+        # Build without boto3, then attach a fake client
+        self._boto3 = s3_uploader.boto3
+        s3_uploader.boto3 = None
+        self.uploader = S3Uploader("bird-photos", os.path.join(self.temp_dir, "outbox.db"),
+                                   prefix="photos/", workers=1, base_backoff=0.01, nice=0)
+        s3_uploader.boto3 = self._boto3
+        self.uploader.transfer_config = None
+
+    def tearDown(self):
+        """Clean up after tests."""
+        self.uploader.close()
+
+    def _wait_for_status(self, ticket, status, timeout=5.0):
+        deadline = time.monotonic() + timeout
+        while time.monotonic() < deadline:
+            if self.uploader.upload_status(ticket)["status"] == status:
+                return True
+            time.sleep(0.01)
+        return False
+
+    def test_enqueue_returns_immediately(self):
+        """Test that enqueue returns a ticket before anything is uploaded."""
+        ticket = self.uploader.enqueue(self.photo)
+        self.assertEqual(self.uploader.upload_status(ticket)["status"], UploadOutbox.PENDING)
+
+    def test_upload_with_retry(self):
+        """Test that failed uploads are retried with backoff until they succeed."""
+        self.uploader.client = FakeS3Client(fail_count=2)
+        self.uploader.start()
+
+        ticket = self.uploader.enqueue(self.photo)
+        self.assertTrue(self._wait_for_status(ticket, UploadOutbox.DONE))
+        status = self.uploader.upload_status(ticket)
+        self.assertEqual(status["attempts"], 2)
+        self.assertEqual(status["url"], "s3://bird-photos/photos/bird.jpg")
+        self.assertEqual(self.uploader.list_uploaded(), ["s3://bird-photos/photos/bird.jpg"])
+
+    def test_gives_up_after_max_attempts(self):
+        """Test that an upload is marked failed after max_attempts."""
+        self.uploader.client = FakeS3Client(fail_count=100)
+        self.uploader.max_attempts = 3
+        self.uploader.start()
+
+        ticket = self.uploader.enqueue(self.photo)
+        self.assertTrue(self._wait_for_status(ticket, UploadOutbox.FAILED))
+        self.assertEqual(self.uploader.upload_status(ticket)["attempts"], 3)
+
+    @unittest.skipIf(S3UploadFailedError is None, "boto3 not installed")
+    def test_s3_upload_failed_is_retried(self):
+        """Test that boto3's wrapped ClientError (403, 5xx, SlowDown) is retried."""
+        error = S3UploadFailedError("Failed to upload: An error occurred (SlowDown)")
+        self.uploader.client = FakeS3Client(fail_count=1, error=error)
+        self.uploader.start()
+
+        ticket = self.uploader.enqueue(self.photo)
+        self.assertTrue(self._wait_for_status(ticket, UploadOutbox.DONE))
+        self.assertEqual(self.uploader.upload_status(ticket)["attempts"], 1)
+
+    def test_unexpected_error_keeps_worker(self):
+        """Test that an unexpected exception is retried instead of killing the worker."""
+        self.uploader.client = FakeS3Client(fail_count=1, error=RuntimeError("boom"))
+        self.uploader.start()
+
+        ticket = self.uploader.enqueue(self.photo)
+        self.assertTrue(self._wait_for_status(ticket, UploadOutbox.DONE))
+        self.assertEqual(self.uploader.upload_status(ticket)["attempts"], 1)
+        self.assertTrue(all(worker.is_alive() for worker in self.uploader._workers))
+
+    def test_prunes_completed_uploads(self):
+        """Test that the workers prune completed uploads from the outbox."""
+        self.uploader.client = FakeS3Client()
+        self.uploader.keep_done_days = 0
+        self.uploader.start()
+
+        ticket = self.uploader.enqueue(self.photo)
+        self.assertTrue(self._wait_for_status(ticket, UploadOutbox.DONE))
+
+        # Make the next prune due and wake the worker with another upload
+        self.uploader._next_prune = 0.0
+        self.uploader.enqueue(self.photo, "second.jpg")
+        deadline = time.monotonic() + 5.0
+        while self.uploader.upload_status(ticket) is not None and time.monotonic() < deadline:
+            time.sleep(0.01)
+        self.assertIsNone(self.uploader.upload_status(ticket))
+
+
+if __name__ == '__main__':
+    unittest.main()
@@ -0,0 +1,157 @@
+"""Tests for the streaming upload client."""
+import unittest
+import sys
+import os
+import socket
+import hashlib
+import tempfile
+import threading
+import time
+
+# Add project directory to path to import modules
+sys.path.append(os.path.abspath(os.path.join(os.path.dirname(__file__), '..')))
+
+from pi_bird_cam.uploader.stream_client import StreamClient, _send_message, _recv_message
+
+
+class FakeIngestServer:
+    """Minimal ingest server speaking the stream protocol on localhost."""
+
+    def __init__(self, stored=(), partial=None, not_ready=0):
+        self.stored = set(stored)
+        self.not_ready = not_ready  # Connections answered with not_ready first
+        self.partial = dict(partial or {})  # sha256 -> bytes already received
+        self.received = {}
+        self.offers = []
+        self._listener = socket.socket()
+        self._listener.bind(("127.0.0.1", 0))
+        self._listener.listen(1)
+        self.port = self._listener.getsockname()[1]
+        self._thread = threading.Thread(target=self._serve, daemon=True)
+        self._thread.start()
+
+    def _serve(self):
+        while self.not_ready:
+            conn, _ = self._listener.accept()
+            _recv_message(conn.makefile("rb"))
+            _send_message(conn, {"type": "not_ready", "retry_after": 0.2})
+            conn.close()
+            self.not_ready -= 1
+
+        conn, _ = self._listener.accept()
+        stream = conn.makefile("rb")
+        transfers = {}
+        try:
+            _recv_message(stream)
+            _send_message(conn, {"type": "welcome", "window": 2})
+            while True:
+                header, payload = _recv_message(stream)
+                seq = header.get("seq")
+                if header["type"] == "offer":
+                    self.offers.append(header)
+                    if header["sha256"] in self.stored:
+                        _send_message(conn, {"type": "accept", "seq": seq, "status": "duplicate"})
+                        continue
+                    data = self.partial.get(header["sha256"], b"")
+                    transfers[seq] = [header["sha256"], bytearray(data)]
+                    _send_message(conn, {"type": "accept", "seq": seq, "status": "send",
+                                         "offset": len(data)})
+                elif header["type"] == "data":
+                    transfers[seq][1].extend(payload)
+                elif header["type"] == "end":
+                    sha256, data = transfers.pop(seq)
+                    self.received[sha256] = bytes(data)
+                    self.stored.add(sha256)
+                    _send_message(conn, {"type": "done", "seq": seq, "status": "stored"})
+        except EOFError:
+            pass
+        finally:
+            conn.close()
+            self._listener.close()
+
+
+class TestStreamClient(unittest.TestCase):
+    """Test cases for StreamClient class."""
+
+    def setUp(self):
+        """Set up test fixtures."""
+        self.temp_dir = tempfile.mkdtemp()
+
+    def _make_photo(self, name, data):
+        path = os.path.join(self.temp_dir, name)
+        with open(path, "wb") as f:
+            f.write(data)
+        return path
+
+    def test_send_and_dedup(self):
+        """Test that photos are sent once and retries are acknowledged as duplicates."""
+        server = FakeIngestServer()
+        client = StreamClient("127.0.0.1", server.port, window=4, chunk_size=1000)
+        data = os.urandom(5000)
+        path = self._make_photo("bird.jpg", data)
+
+        sha256 = client.send(path, metadata={"trigger": "motion_detection"})
+        self.assertTrue(client.flush(5))
+        self.assertEqual(sha256, hashlib.sha256(data).hexdigest())
+        self.assertEqual(server.received[sha256], data)
+        self.assertEqual(server.offers[0]["metadata"], {"trigger": "motion_detection"})
+
+        client.send(path)
+        self.assertTrue(client.flush(5))
+        stats = client.get_stats()
+        self.assertEqual(stats["sent"], 1)
+        self.assertEqual(stats["duplicates"], 1)
+        # The server's smaller window wins
+        self.assertEqual(stats["window"], 2)
+        client.close()
+
+    def test_resume_partial_upload(self):
+        """Test that only the bytes the server is missing are sent."""
+        data = os.urandom(4000)
+        sha256 = hashlib.sha256(data).hexdigest()
+        server = FakeIngestServer(partial={sha256: data[:1500]})
+        client = StreamClient("127.0.0.1", server.port, chunk_size=1000)
+        path = self._make_photo("resume.jpg", data)
+
+        client.send(path)
+        self.assertTrue(client.flush(5))
+        self.assertEqual(server.received[sha256], data)
+        self.assertEqual(client.get_stats()["resumed"], 1)
+        client.close()
+
+    def test_buffer_until_ready(self):
+        """Test that photos are buffered while the server warms up and sent once it is ready."""
+        server = FakeIngestServer(not_ready=1)
+        client = StreamClient("127.0.0.1", server.port, chunk_size=1000)
+        data = os.urandom(2000)
+        path = self._make_photo("warmup.jpg", data)
+
+        sha256 = client.send(path)
+        self.assertEqual(client.get_stats()["pending"], 1)
+        self.assertNotIn(sha256, server.received)
+
+        # The retry timer sends the buffered photo without another send()
+        deadline = time.time() + 5
+        while sha256 not in server.received and time.time() < deadline:
+            time.sleep(0.05)
+        self.assertTrue(client.flush(5))
+        self.assertEqual(server.received[sha256], data)
+        self.assertEqual(client.get_stats()["sent"], 1)
+        client.close()
+
+    def test_unreachable_server(self):
+        """Test that send raises ConnectionError and keeps the photo queued."""
+        listener = socket.socket()
+        listener.bind(("127.0.0.1", 0))
+        port = listener.getsockname()[1]
+        listener.close()
+
+        client = StreamClient("127.0.0.1", port, max_retries=0)
+        path = self._make_photo("offline.jpg", b"x" * 100)
+        with self.assertRaises(ConnectionError):
+            client.send(path)
+        self.assertEqual(client.get_stats()["pending"], 1)
+
+
+if __name__ == '__main__':
+    unittest.main()
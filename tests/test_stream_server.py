@@ -0,0 +1,187 @@
+"""Tests for the Nano's streaming ingest server."""
+import unittest
+from unittest.mock import patch
+import hashlib
+import socket
+import sys
+import os
+import shutil
+import tempfile
+import threading
+import time
+
+# Add project directory to path to import modules
+sys.path.append(os.path.abspath(os.path.join(os.path.dirname(__file__), '..')))
+
+from nano_inference_server.ingest.stream_server import StreamIngestServer, send_message, recv_message
+from nano_inference_server.monitoring.directory_monitor import DirectoryMonitor
+from pi_bird_cam.uploader.stream_client import StreamClient
+
+
+class TestKeyframeIngest(unittest.TestCase):
+    """Test cases for keyframes received by StreamIngestServer."""
+
+    def setUp(self):
+        """Start an ingest server and a monitor on the same input directory."""
+        self.input_dir = tempfile.mkdtemp()
+        self.addCleanup(shutil.rmtree, self.input_dir, ignore_errors=True)
+
+        self.decoded = []
+        patcher = patch('nano_inference_server.ingest.stream_server.keyframe_to_jpeg',
+                        side_effect=self._fake_decode)
+        patcher.start()
+        self.addCleanup(patcher.stop)
+
+        self.detected = []
+        self.detected_event = threading.Event()
+        self.monitor = DirectoryMonitor(self.input_dir, self._on_image,
+                                        state_path=os.path.join(tempfile.mkdtemp(), "state.json"))
+        self.monitor.start()
+        self.addCleanup(self.monitor.stop)
+
+        self.server = StreamIngestServer(self.input_dir, host="127.0.0.1", port=0)
+        self.server.start()
+        self.addCleanup(self.server.stop)
+        self.port = self.server._server.server_address[1]
+
+        self.source_dir = tempfile.mkdtemp()
+        self.addCleanup(shutil.rmtree, self.source_dir, ignore_errors=True)
+
+    def _fake_decode(self, input_path, output_path, decoder="auto"):
+        """Write a JPEG the way keyframe_to_jpeg does; a bad keyframe leaves a truncated one."""
+        self.decoded.append(output_path)
+        with open(input_path, "rb") as f:
+            bad = f.read().startswith(b"bad")
+        with open(output_path, "wb") as f:
+            f.write(b"\xff\xd8" if bad else b"\xff\xd8 decoded keyframe \xff\xd9")
+        return None if bad else output_path
+
+    def _on_image(self, path):
+        """Record an image the monitor handed over for inference."""
+        self.detected.append(path)
+        self.detected_event.set()
+
+    def _send(self, name, data, timeout=5.0):
+        """Send one file to the server; returns whether it was acknowledged in time."""
+        path = os.path.join(self.source_dir, name)
+        with open(path, "wb") as f:
+            f.write(data)
+        client = StreamClient("127.0.0.1", self.port)
+        try:
+            client.send(path)
+            return client.flush(timeout=timeout)
+        finally:
+            client.close(timeout=0.1)
+
+    def test_keyframe_processed_once(self):
+        """Test that a decoded keyframe reaches the monitor once, under its final name."""
+        self.assertTrue(self._send("clip_kf000.h264", b"\x00\x00\x00\x01 keyframe"))
+
+        self.assertTrue(self.detected_event.wait(5.0))
+        time.sleep(0.3)  # Give a second event the chance to arrive
+
+        # The JPEG is written under a name the monitor's patterns skip
+        self.assertEqual(len(self.decoded), 1)
+        self.assertFalse(any(regex.match(self.decoded[0]) for regex in self.monitor.file_regex))
+
+        self.assertEqual(len(self.detected), 1)
+        self.assertEqual(os.path.dirname(self.detected[0]), self.input_dir)
+        self.assertTrue(os.path.basename(self.detected[0]).startswith("clip_kf000"))
+        self.assertTrue(self.detected[0].endswith(".jpg"))
+        self.assertTrue(os.path.exists(self.detected[0]))
+        self.assertEqual(self.server.get_stats()["keyframes"], 1)
+
+        # Nothing but bookkeeping is left in the spool directory
+        self.assertEqual(sorted(os.listdir(self.server.spool_dir)), ["received.log"])
+
+    def test_undecodable_keyframe_leaves_nothing(self):
+        """Test that a keyframe that fails to decode is discarded with its JPEG."""
+        # The client keeps resending an image the server reports corrupt
+        self.assertFalse(self._send("clip_kf001.h264", b"bad keyframe", timeout=0.5))
+        time.sleep(0.3)  # Let the last resend finish after the client disconnected
+
+        self.assertEqual(self.detected, [])
+        self.assertGreaterEqual(self.server.get_stats()["corrupt"], 1)
+        self.assertEqual(os.listdir(self.server.spool_dir), [])
+
+
+class TestIngestLimits(unittest.TestCase):
+    """Test cases for the size limits and hash expiry of StreamIngestServer."""
+
+    def setUp(self):
+        """Set up an input directory and a directory for the files to send."""
+        self.input_dir = tempfile.mkdtemp()
+        self.addCleanup(shutil.rmtree, self.input_dir, ignore_errors=True)
+        self.source_dir = tempfile.mkdtemp()
+        self.addCleanup(shutil.rmtree, self.source_dir, ignore_errors=True)
+
+    def start_server(self, **kwargs):
+        """Start a server on a free local port."""
+        server = StreamIngestServer(self.input_dir, host="127.0.0.1", port=0, **kwargs)
+        server.start()
+        self.addCleanup(server.stop)
+        return server
+
+    def connect(self, server):
+        """Open a raw protocol connection past the hello."""
+        sock = socket.create_connection(server._server.server_address, timeout=5.0)
+        self.addCleanup(sock.close)
+        stream = sock.makefile("rb")
+        self.addCleanup(stream.close)
+        send_message(sock, {"type": "hello", "client": "test"})
+        self.assertEqual(recv_message(stream)[0]["type"], "welcome")
+        return sock, stream
+
+    def images(self):
+        """Names of the files in the input directory."""
+        return [name for name in os.listdir(self.input_dir) if not name.startswith(".")]
+
+    def test_offer_over_limit(self):
+        """Test that an image larger than max_image_size is refused and dropped by the client."""
+        server = self.start_server(max_image_size=100)
+        path = os.path.join(self.source_dir, "big.jpg")
+        with open(path, "wb") as f:
+            f.write(b"x" * 200)
+
+        client = StreamClient("127.0.0.1", server._server.server_address[1])
+        try:
+            client.send(path)
+            self.assertTrue(client.flush(timeout=5.0))
+        finally:
+            client.close(timeout=0.1)
+
+        self.assertEqual(server.get_stats()["too_large"], 1)
+        self.assertEqual(self.images(), [])
+
+    def test_data_past_offered_size(self):
+        """Test that a client sending more than it offered is disconnected."""
+        server = self.start_server()
+        sock, stream = self.connect(server)
+        data = b"image"
+        send_message(sock, {"type": "offer", "seq": 1, "sha256": hashlib.sha256(data).hexdigest(),
+                            "name": "bird.jpg", "size_bytes": len(data)})
+        self.assertEqual(recv_message(stream)[0]["status"], "send")
+
+        send_message(sock, {"type": "data", "seq": 1, "offset": 0}, data + b" and more")
+        with self.assertRaises(EOFError):
+            recv_message(stream)
+        self.assertEqual(server.get_stats()["bytes"], 0)
+        self.assertEqual(self.images(), [])
+
+    def test_expired_hashes_pruned(self):
+        """Test that hashes older than received_ttl_hours are dropped from memory and the log."""
+        spool_dir = os.path.join(self.input_dir, ".incoming")
+        os.makedirs(spool_dir)
+        old, recent, unstamped = "a" * 64, "b" * 64, "c" * 64
+        with open(os.path.join(spool_dir, "received.log"), "w") as f:
+            f.write(f"{old} {time.time() - 7200:.0f}\n{recent} {time.time():.0f}\n{unstamped}\n")
+
+        server = StreamIngestServer(self.input_dir, received_ttl_hours=1.0)
+
+        self.assertEqual(set(server._received), {recent, unstamped})
+        with open(server.received_log) as f:
+            self.assertEqual([line.split()[0] for line in f], [recent, unstamped])
+
+
+if __name__ == '__main__':
+    unittest.main()
@@ -0,0 +1,214 @@
+"""Tests for the Nano's thumbnail cache."""
+import unittest
+from unittest.mock import patch, MagicMock
+import sys
+import os
+import shutil
+import tempfile
+import threading
+import time
+
+# Add project directory to path to import modules
+sys.path.append(os.path.abspath(os.path.join(os.path.dirname(__file__), '..')))
+
+import cv2
+from nano_inference_server.storage.thumbnail_cache import ThumbnailCache
+from nano_inference_server.storage.result_storage import ResultStorage
+
+# Encoding needs a real OpenCV build
+HAVE_OPENCV = isinstance(getattr(cv2, "__version__", None), str)
+
+
+def write_file(path, size):
+    """Write a file of the given size, creating its directory."""
+    os.makedirs(os.path.dirname(path), exist_ok=True)
+    with open(path, "wb") as f:
+        f.write(b"\0" * size)
+    return path
+
+
+class TestThumbnailCache(unittest.TestCase):
+    """Test cases for ThumbnailCache class."""
+
+    def setUp(self):
+        """Set up a cache directory and a source image."""
+        self.temp_dir = tempfile.mkdtemp()
+        self.addCleanup(shutil.rmtree, self.temp_dir, ignore_errors=True)
+        self.cache_dir = os.path.join(self.temp_dir, "thumbnails")
+        self.source = write_file(os.path.join(self.temp_dir, "bird.jpg"), 100)
+
+    def make_cache(self, **kwargs):
+        """Create a cache that is closed after the test."""
+        cache = ThumbnailCache(self.cache_dir, **kwargs)
+        self.addCleanup(cache.close)
+        return cache
+
+    def seed(self, cache, source_path, size=1000):
+        """Write fake thumbnails of every width for a source image."""
+        key = cache.content_key(source_path)
+        paths = [write_file(cache._thumbnail_path(key, width), size) for width in cache.sizes]
+        cache._add_bytes(size * len(paths))
+        return paths
+
+    def test_snap_width(self):
+        """Test that requested widths snap up to a cached size."""
+        cache = self.make_cache(sizes=(960, 320))
+
+        self.assertEqual(cache.snap_width(100), 320)
+        self.assertEqual(cache.snap_width(320), 320)
+        self.assertEqual(cache.snap_width(321), 960)
+        self.assertIsNone(cache.snap_width(2000))
+
+    def test_content_key_follows_file(self):
+        """Test that the key changes when the source is rewritten."""
+        cache = self.make_cache()
+        key = cache.content_key(self.source)
+        self.assertEqual(cache.content_key(self.source), key)
+
+        stat = os.stat(self.source)
+        os.utime(self.source, ns=(stat.st_atime_ns, stat.st_mtime_ns + 1000000))
+        self.assertNotEqual(cache.content_key(self.source), key)
+
+    def test_full_size_not_cached(self):
+        """Test that a width above the largest size serves the original."""
+        cache = self.make_cache(sizes=(320,))
+        self.assertIsNone(cache.get(self.source, 4000))
+
+    @unittest.skipUnless(HAVE_OPENCV, "needs OpenCV")
+    def test_generates_each_width(self):
+        """Test that thumbnails are resized to their width and counted."""
+        import numpy as np
+        source = os.path.join(self.temp_dir, "large.jpg")
+        cv2.imwrite(source, np.zeros((600, 1200, 3), dtype=np.uint8))
+        cache = self.make_cache(sizes=(320, 960))
+
+        path = cache.get(source, 300)
+        self.assertEqual(cv2.imread(path).shape[:2], (160, 320))
+        self.assertEqual(cache.get(source, 300), path)
+        self.assertEqual(cache.total_bytes, os.path.getsize(path))
+
+    def test_concurrent_misses_encode_once(self):
+        """Test that requests and the background worker missing together encode and count once."""
+        cache = self.make_cache(sizes=(320,))
+        encoded = []
+
+        def imencode(ext, image, params):
+            encoded.append(ext)
+            time.sleep(0.05)  # Let the other threads pile up on the lock
+            return True, MagicMock(tobytes=MagicMock(return_value=b"\0" * 50))
+
+        with patch("nano_inference_server.storage.thumbnail_cache.cv2") as fake_cv2:
+            fake_cv2.imread.return_value = MagicMock(shape=(120, 300, 3))
+            fake_cv2.imencode.side_effect = imencode
+            threads = [threading.Thread(target=cache.get, args=(self.source, 320)) for _ in range(4)]
+            for thread in threads:
+                thread.start()
+            cache._executor.submit(cache._generate_all, self.source).result(5.0)
+            for thread in threads:
+                thread.join()
+
+        self.assertEqual(len(encoded), 1)
+        self.assertEqual(cache.total_bytes, 50)
+        self.assertEqual(cache._locks, {})
+
+    def test_existing_thumbnails_counted(self):
+        """Test that a new cache picks up the size already on disk."""
+        cache = self.make_cache()
+        self.seed(cache, self.source)
+
+        self.assertEqual(self.make_cache().total_bytes, 2000)
+
+    def test_delete_removes_every_width(self):
+        """Test that deleting an image's thumbnails frees them all."""
+        cache = self.make_cache()
+        other = write_file(os.path.join(self.temp_dir, "other.jpg"), 100)
+        paths = self.seed(cache, self.source)
+        kept = self.seed(cache, other)
+
+        self.assertEqual(cache.delete(self.source), 2000)
+        self.assertFalse(any(os.path.exists(path) for path in paths))
+        self.assertTrue(all(os.path.exists(path) for path in kept))
+        self.assertEqual(cache.total_bytes, 2000)
+
+    def test_delete_missing_source(self):
+        """Test that deleting thumbnails of a missing image is a no-op."""
+        cache = self.make_cache()
+        self.assertEqual(cache.delete(os.path.join(self.temp_dir, "gone.jpg")), 0)
+
+    def test_prune_evicts_least_recently_used(self):
+        """Test that pruning keeps the most recently served thumbnails."""
+        cache = self.make_cache(sizes=(320,), max_size_mb=2500 / 1024 ** 2)
+        sources = [write_file(os.path.join(self.temp_dir, f"bird{i}.jpg"), 100) for i in range(3)]
+        paths = [self.seed(cache, source)[0] for source in sources]
+        now = time.time()
+        for age, path in zip((30, 20, 10), paths):
+            os.utime(path, (now - age, now - age))
+
+        # A hit refreshes the oldest one
+        self.assertEqual(cache.get(sources[0], 320), paths[0])
+
+        self.assertEqual(cache.prune(), 1)
+        self.assertEqual([os.path.exists(path) for path in paths], [True, False, True])
+        self.assertEqual(cache.total_bytes, 2000)
+
+    def test_prune_without_cap(self):
+        """Test that an uncapped cache is never pruned."""
+        cache = self.make_cache()
+        self.seed(cache, self.source)
+        self.assertEqual(cache.prune(), 0)
+
+
+class TestRetentionThumbnails(unittest.TestCase):
+    """Test cases for thumbnails under ResultStorage retention."""
+
+    def setUp(self):
+        """Set up storage sharing a thumbnail cache."""
+        self.temp_dir = tempfile.mkdtemp()
+        self.addCleanup(shutil.rmtree, self.temp_dir, ignore_errors=True)
+        self.images = [write_file(os.path.join(self.temp_dir, "input", f"bird{i}.jpg"), 1000)
+                       for i in range(3)]
+        self.thumbnails = ThumbnailCache(os.path.join(self.temp_dir, "output", "thumbnails"))
+        self.addCleanup(self.thumbnails.close)
+
+    def make_storage(self, **kwargs):
+        """Create storage whose retention only runs when called."""
+        storage = ResultStorage(os.path.join(self.temp_dir, "output"), retention_interval=3600,
+                                retention_high_water=100.0,
+                                thumbnails=self.thumbnails, **kwargs)
+        self.addCleanup(storage.close)
+        return storage
+
+    def save(self, storage, image_path, thumbnail_size=1000):
+        """Store a result and fake thumbnails of its image."""
+        result = storage.save_result(image_path, [])
+        key = self.thumbnails.content_key(result["image_path"])
+        paths = [write_file(self.thumbnails._thumbnail_path(key, width), thumbnail_size)
+                 for width in self.thumbnails.sizes]
+        self.thumbnails._add_bytes(thumbnail_size * len(paths))
+        return result, paths
+
+    def test_thumbnails_deleted_with_result(self):
+        """Test that retention removes the thumbnails of deleted results."""
+        storage = self.make_storage(max_results=2)
+        saved = [self.save(storage, image) for image in self.images]
+
+        self.assertEqual(storage._cleanup_old_results(), 1)
+        (oldest, oldest_thumbnails), (_, kept_thumbnails) = saved[0], saved[1]
+        self.assertFalse(os.path.exists(oldest["image_path"]))
+        self.assertFalse(any(os.path.exists(path) for path in oldest_thumbnails))
+        self.assertTrue(all(os.path.exists(path) for path in kept_thumbnails))
+        self.assertEqual(self.thumbnails.total_bytes, 4000)
+
+    def test_thumbnails_count_toward_storage_limit(self):
+        """Test that thumbnail bytes push results over max_storage_gb."""
+        # Each result is ~1 KB stored plus 2 KB of thumbnails
+        storage = self.make_storage(max_storage_gb=7000 / 1024 ** 3)
+        for image in self.images:
+            self.save(storage, image)
+
+        self.assertEqual(storage._cleanup_old_results(), 1)
+        self.assertEqual(storage.count_results(), 2)
+
+
+if __name__ == '__main__':
+    unittest.main()
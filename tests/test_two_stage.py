@@ -0,0 +1,126 @@
+"""Tests for the Nano's two-stage detect-then-classify pipeline."""
+import unittest
+from unittest.mock import patch, MagicMock
+import sys
+import os
+
+import numpy as np
+
+# Add project directory to path to import modules
+sys.path.append(os.path.abspath(os.path.join(os.path.dirname(__file__), '..')))
+
+from nano_inference_server.inference.two_stage import TwoStageDetector
+
+
+def bird(bbox, class_name="bird"):
+    """A detector result."""
+    return {"bbox": list(bbox), "class_name": class_name, "confidence": 0.8}
+
+
+class TestTwoStageDetector(unittest.TestCase):
+    """Test cases for TwoStageDetector class."""
+
+    def setUp(self):
+        """Set up a mocked detector and species classifier."""
+        self.detector = MagicMock()
+        self.detector.development_mode = False
+        self.classifier = MagicMock()
+        self.classifier.class_names = ["Robin", "Wren", "Finch"]
+        self.classifier.classify_batch.side_effect = lambda crops: np.tile(
+            np.array([0.1, 0.7, 0.2], dtype=np.float32), (len(crops), 1))
+        self.pipeline = TwoStageDetector(self.detector, self.classifier,
+                                         crop_padding=0.1, min_crop_size=16, species_threshold=0.3)
+        self.frame = np.zeros((480, 640, 3), dtype=np.uint8)
+
+    def test_crop_is_padded_view_of_frame(self):
+        """Test that the classifier gets a padded view into the full frame."""
+        self.detector.detect_batch.return_value = [[bird((100, 100, 50, 40))]]
+        self.pipeline.detect(self.frame)
+
+        crops = self.classifier.classify_batch.call_args[0][0]
+        self.assertEqual(len(crops), 1)
+        self.assertEqual(crops[0].shape, (48, 60, 3))
+        self.assertTrue(np.shares_memory(crops[0], self.frame))
+
+    def test_crop_clipped_to_frame(self):
+        """Test that padding stops at the frame edges."""
+        self.assertEqual(self.pipeline._crop_region((0, 0, 50, 50), 640, 480), (0, 0, 55, 55))
+        self.assertEqual(self.pipeline._crop_region((600, 440, 40, 40), 640, 480), (596, 436, 640, 480))
+
+    def test_one_classifier_batch_for_all_images(self):
+        """Test that every crop of every image is classified in one pass."""
+        self.detector.detect_batch.return_value = [
+            [bird((10, 10, 40, 40)), bird((100, 100, 40, 40))],
+            [bird((200, 200, 60, 60))],
+        ]
+        results = self.pipeline.detect_batch([self.frame, self.frame.copy()])
+
+        self.classifier.classify_batch.assert_called_once()
+        self.assertEqual(len(self.classifier.classify_batch.call_args[0][0]), 3)
+        self.assertEqual([len(r) for r in results], [2, 1])
+        self.assertTrue(all(d["species"] == "Wren" for r in results for d in r))
+
+    def test_skips_other_classes_and_small_boxes(self):
+        """Test that non-birds and tiny boxes are not classified."""
+        squirrel = bird((10, 10, 100, 100), class_name="squirrel")
+        tiny = bird((300, 300, 5, 5))
+        self.detector.detect_batch.return_value = [[squirrel, tiny]]
+
+        results = self.pipeline.detect(self.frame)
+        self.classifier.classify_batch.assert_not_called()
+        self.assertEqual(results, [squirrel, tiny])
+        self.assertNotIn("species", tiny)
+
+    def test_logits_softmaxed(self):
+        """Test that raw scores are turned into probabilities."""
+        self.classifier.classify_batch.side_effect = lambda crops: np.array([[2.0, 0.0, -1.0]],
+                                                                            dtype=np.float32)
+        self.detector.detect_batch.return_value = [[bird((100, 100, 50, 50))]]
+
+        detection = self.pipeline.detect(self.frame)[0]
+        expected = np.exp(2.0) / (np.exp(2.0) + np.exp(0.0) + np.exp(-1.0))
+        self.assertEqual(detection["species"], "Robin")
+        self.assertEqual(detection["species_id"], 0)
+        self.assertAlmostEqual(detection["species_confidence"], expected, places=5)
+
+    def test_below_species_threshold(self):
+        """Test that an uncertain classification leaves the species unset."""
+        self.pipeline.species_threshold = 0.8
+        self.detector.detect_batch.return_value = [[bird((100, 100, 50, 50))]]
+
+        self.assertNotIn("species", self.pipeline.detect(self.frame)[0])
+
+    def test_classifier_not_loaded(self):
+        """Test that detections are returned without species when the classifier has no model."""
+        self.classifier.classify_batch.side_effect = lambda crops: None
+        self.detector.detect_batch.return_value = [[bird((100, 100, 50, 50))]]
+
+        self.assertNotIn("species", self.pipeline.detect(self.frame)[0])
+
+    @patch('nano_inference_server.inference.two_stage.cv2')
+    def test_unreadable_image(self, mock_cv2):
+        """Test that an unreadable file gets no detections and is not sent to the detector."""
+        mock_cv2.imread.side_effect = lambda path: None if path == "broken.jpg" else self.frame
+        self.detector.detect_batch.return_value = [[bird((100, 100, 50, 50))]]
+
+        results = self.pipeline.detect_batch(["broken.jpg", "bird.jpg"])
+        self.assertEqual(len(self.detector.detect_batch.call_args[0][0]), 1)
+        self.assertEqual(results[0], [])
+        self.assertEqual(len(results[1]), 1)
+
+    def test_crop_stats(self):
+        """Test the crop statistics."""
+        self.detector.get_batch_stats.return_value = {}
+        self.classifier.get_batch_stats.return_value = {}
+        self.detector.detect_batch.return_value = [[bird((10, 10, 40, 40)), bird((100, 100, 40, 40))], []]
+        self.pipeline.detect_batch([self.frame, self.frame])
+
+        crops = self.pipeline.get_batch_stats()["crops"]
+        self.assertEqual(crops["frames"], 2)
+        self.assertEqual(crops["crops"], 2)
+        self.assertEqual(crops["classified"], 2)
+        self.assertEqual(crops["average_crops_per_frame"], 1.0)
+
+
+if __name__ == '__main__':
+    unittest.main()
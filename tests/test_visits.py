@@ -0,0 +1,108 @@
+"""Tests for the near-duplicate visit tracking module."""
+import unittest
+import sys
+import os
+
+import numpy as np
+
+# Add project directory to path to import modules
+sys.path.append(os.path.abspath(os.path.join(os.path.dirname(__file__), '..')))
+
+from pi_bird_cam.pipeline.visits import VisitTracker, dhash, hamming_distance
+
+
+class TestDHash(unittest.TestCase):
+    """Test cases for the dHash function."""
+
+    def setUp(self):
+        """Create a textured lores-sized frame."""
+        rng = np.random.default_rng(0)
+        self.frame = rng.integers(0, 256, (240, 320, 3), dtype=np.uint8)
+
+    def test_noise_keeps_hash_close(self):
+        """Test that sensor-like noise flips few bits."""
+        noise = np.random.default_rng(1).integers(-4, 5, self.frame.shape)
+        noisy = np.clip(self.frame.astype(int) + noise, 0, 255).astype(np.uint8)
+
+        self.assertLessEqual(hamming_distance(dhash(self.frame), dhash(noisy)), 5)
+
+    def test_different_scene_changes_hash(self):
+        """Test that a different frame is far from the original."""
+        other = np.random.default_rng(2).integers(0, 256, self.frame.shape, dtype=np.uint8)
+
+        self.assertGreater(hamming_distance(dhash(self.frame), dhash(other)), 10)
+
+    def test_grayscale_matches_rgb(self):
+        """Test that a gray frame hashes like the same frame in RGB."""
+        gray = self.frame[..., 0]
+        rgb = np.repeat(gray[..., np.newaxis], 3, axis=2)
+
+        self.assertEqual(dhash(gray), dhash(rgb))
+
+
+class TestVisitTracker(unittest.TestCase):
+    """Test cases for VisitTracker class."""
+
+    def test_duplicates_extend_visit(self):
+        """Test that near-identical frames join the current visit."""
+        tracker = VisitTracker(max_distance=2, visit_gap=10.0)
+
+        visit, is_new, ended = tracker.observe(0b1111, timestamp=100.0)
+        self.assertTrue(is_new)
+        self.assertIsNone(ended)
+
+        same, is_new, _ = tracker.observe(0b1110, timestamp=101.0)
+        self.assertFalse(is_new)
+        self.assertIs(same, visit)
+        self.assertEqual(visit.frames, 2)
+        self.assertEqual(tracker.suppressed, 1)
+
+    def test_different_frame_starts_visit(self):
+        """Test that a different frame ends the visit and starts a new one."""
+        tracker = VisitTracker(max_distance=2, visit_gap=10.0)
+        first, _, _ = tracker.observe(0, timestamp=100.0)
+
+        second, is_new, ended = tracker.observe(0xFFFF, timestamp=101.0)
+
+        self.assertTrue(is_new)
+        self.assertIs(ended, first)
+        self.assertNotEqual(second.visit_id, first.visit_id)
+
+    def test_gap_and_duration_split_visits(self):
+        """Test that a long pause or a long stay starts a new visit."""
+        tracker = VisitTracker(max_distance=2, visit_gap=10.0, max_visit_duration=25.0)
+        tracker.observe(0, timestamp=100.0)
+
+        _, is_new, _ = tracker.observe(0, timestamp=111.0)
+        self.assertTrue(is_new)
+
+        for t in (118.0, 125.0, 132.0):
+            _, is_new, _ = tracker.observe(0, timestamp=t)
+        self.assertFalse(is_new)
+        _, is_new, _ = tracker.observe(0, timestamp=139.0)
+        self.assertTrue(is_new)
+
+    def test_expire(self):
+        """Test that expire ends a visit only after the gap."""
+        tracker = VisitTracker(visit_gap=10.0)
+        visit, _, _ = tracker.observe(0, timestamp=100.0)
+
+        self.assertIsNone(tracker.expire(now=105.0))
+        self.assertIs(tracker.expire(now=111.0), visit)
+        self.assertIsNone(tracker.current)
+
+    def test_visit_record(self):
+        """Test the visit summary stored with the representative photo."""
+        tracker = VisitTracker(visit_gap=10.0)
+        visit, _, _ = tracker.observe(0xAB, timestamp=100.0)
+        tracker.observe(0xAB, timestamp=104.0)
+
+        record = visit.to_dict()
+        self.assertEqual(record["phash"], "00000000000000ab")
+        self.assertEqual(record["frames"], 2)
+        self.assertEqual(record["suppressed"], 1)
+        self.assertEqual(record["ended_at"], 104.0)
+
+
+if __name__ == '__main__':
+    unittest.main()